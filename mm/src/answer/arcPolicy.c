@@ -0,0 +1,185 @@
+#include "policy.h"
+#include "frameList.h"
+#include <pthread.h>
+
+extern FrameTable *frameTable;
+
+/* Number of frames the policy caches pages in (ARC's c) */
+#define ARC_CAPACITY NUM_FRAME_TABLE_ENTRIES
+/* Number of ghost entries, at most one per frame as in ARC */
+#define NUM_GHOSTS NUM_FRAME_TABLE_ENTRIES
+/* Number of buckets in the ghost hash table (a power of two) */
+#define NUM_GHOST_BUCKETS 2048
+/* Marks an empty bucket or the end of a bucket's chain */
+#define GHOST_NONE 0xFFFF
+
+/**
+ * Defines a ghost entry, the identity of a recently evicted page. Ghosts are
+ * linked into B1 or B2 by their index and chained into a hash bucket by key.
+*/
+typedef struct Ghost {
+    uint32_t key;       // The page's owner thread and vpn, see ghostKey
+    uint16_t hashNext;  // Next ghost in the same bucket
+    uint8_t inB2;       // Whether the ghost is in B2 rather than B1
+} Ghost;
+
+/* Resident pages seen once (T1) and more than once (T2), LRU first */
+static FrameList t1;
+static FrameList t2;
+/* Ghosts of pages evicted from T1 (B1) and T2 (B2), LRU first. Indexed by
+   ghost number rather than frame number */
+static FrameList b1;
+static FrameList b2;
+static Ghost ghosts[NUM_GHOSTS];
+static uint16_t ghostBuckets[NUM_GHOST_BUCKETS];
+/* Ghosts not in B1 or B2, chained through hashNext */
+static uint16_t freeGhosts;
+/* Target size of T1, adapted on ghost hits */
+static int targetT1Size;
+static pthread_mutex_t arcLock = PTHREAD_MUTEX_INITIALIZER;
+
+#pragma region ARC Ghost Functions
+
+static uint32_t ghostKey(uint8_t threadId, uint16_t vpn) {
+    return ((uint32_t)threadId << 16) | vpn;
+}
+
+static uint16_t *ghostBucket(uint32_t key) {
+    return &ghostBuckets[(key * 2654435761u) >> 21 & (NUM_GHOST_BUCKETS - 1)];
+}
+
+/**
+ * Returns the ghost with the given key, or GHOST_NONE if there is none.
+*/
+static uint16_t findGhost(uint32_t key) {
+    uint16_t ghost = *ghostBucket(key);
+    while (ghost != GHOST_NONE && ghosts[ghost].key != key) {
+        ghost = ghosts[ghost].hashNext;
+    }
+    return ghost;
+}
+
+/**
+ * Unlinks the ghost from its list and hash bucket and frees it.
+*/
+static void removeGhost(uint16_t ghost) {
+    removeFromFrameList(ghosts[ghost].inB2 ? &b2 : &b1, ghost);
+    uint16_t *link = ghostBucket(ghosts[ghost].key);
+    while (*link != ghost) {
+        link = &ghosts[*link].hashNext;
+    }
+    *link = ghosts[ghost].hashNext;
+    ghosts[ghost].hashNext = freeGhosts;
+    freeGhosts = ghost;
+}
+
+/**
+ * Remembers an evicted page at the MRU end of B1 or B2. Forgets the oldest
+ * ghost of the longer list if every ghost is in use.
+*/
+static void addGhost(uint32_t key, bool inB2) {
+    if (freeGhosts == GHOST_NONE) {
+        removeGhost(b1.size >= b2.size ? b1.head : b2.head);
+    }
+    uint16_t ghost = freeGhosts;
+    freeGhosts = ghosts[ghost].hashNext;
+    ghosts[ghost].key = key;
+    ghosts[ghost].inB2 = inB2;
+    uint16_t *bucket = ghostBucket(key);
+    ghosts[ghost].hashNext = *bucket;
+    *bucket = ghost;
+    appendToFrameList(inB2 ? &b2 : &b1, ghost);
+}
+
+#pragma endregion
+
+#pragma region ARC Policy
+
+static void arcInit() {
+    initFrameList(&t1);
+    initFrameList(&t2);
+    initFrameList(&b1);
+    initFrameList(&b2);
+    for (int i = 0; i < NUM_GHOST_BUCKETS; i++) {
+        ghostBuckets[i] = GHOST_NONE;
+    }
+    for (int i = 0; i < NUM_GHOSTS; i++) {
+        ghosts[i].hashNext = i + 1 < NUM_GHOSTS ? i + 1 : GHOST_NONE;
+    }
+    freeGhosts = 0;
+    targetT1Size = 0;
+}
+
+static void arcOnAllocate(FTEntry *entry) {
+    pthread_mutex_lock(&arcLock);
+    uint16_t ghost = findGhost(ghostKey(frameOwner(entry), frameVirtualPageNum(entry)));
+    if (ghost == GHOST_NONE) {
+        // A page not seen recently starts in T1. Keep T1 and B1 within the
+        // cache size so B1 only remembers pages T1 could have kept
+        if (t1.size + b1.size >= ARC_CAPACITY && b1.size > 0) {
+            removeGhost(b1.head);
+        }
+        appendToFrameList(&t1, entry->frameNum);
+    } else {
+        // A ghost hit means the list it was evicted from was too small, so
+        // grow that list's share of the cache
+        if (ghosts[ghost].inB2) {
+            int delta = b1.size > b2.size ? b1.size / b2.size : 1;
+            targetT1Size = targetT1Size - delta > 0 ? targetT1Size - delta : 0;
+        } else {
+            int delta = b2.size > b1.size ? b2.size / b1.size : 1;
+            targetT1Size = targetT1Size + delta < ARC_CAPACITY ? targetT1Size + delta : ARC_CAPACITY;
+        }
+        removeGhost(ghost);
+        appendToFrameList(&t2, entry->frameNum);
+    }
+    pthread_mutex_unlock(&arcLock);
+}
+
+static void arcOnAccess(FTEntry *entry) {
+    // A page referenced again moves to the MRU end of T2
+    pthread_mutex_lock(&arcLock);
+    if (t2.tail != entry->frameNum) {
+        removeFromFrameList(&t1, entry->frameNum);
+        removeFromFrameList(&t2, entry->frameNum);
+        appendToFrameList(&t2, entry->frameNum);
+    }
+    pthread_mutex_unlock(&arcLock);
+}
+
+static void arcOnEvict(FTEntry *entry) {
+    // The owner and vpn are still set, so remember the page as a ghost
+    pthread_mutex_lock(&arcLock);
+    bool fromT2 = t2.linked[entry->frameNum];
+    removeFromFrameList(&t1, entry->frameNum);
+    removeFromFrameList(&t2, entry->frameNum);
+    addGhost(ghostKey(frameOwner(entry), frameVirtualPageNum(entry)), fromT2);
+    pthread_mutex_unlock(&arcLock);
+}
+
+static FTEntry* arcPickVictim() {
+    FTEntry *victim = NULL;
+    // Retry until the owner of some frame is not busy
+    while (victim == NULL) {
+        pthread_mutex_lock(&arcLock);
+        // Evict from T1 while it is larger than its target, otherwise from T2
+        bool preferT1 = t1.size > 0 && t1.size > targetT1Size;
+        victim = lockFirstEvictableFrame(preferT1 ? &t1 : &t2);
+        if (victim == NULL) {
+            victim = lockFirstEvictableFrame(preferT1 ? &t2 : &t1);
+        }
+        pthread_mutex_unlock(&arcLock);
+    }
+    return victim;
+}
+
+const ReplacementPolicy arcPolicy = {
+    .name = "arc",
+    .init = arcInit,
+    .onAllocate = arcOnAllocate,
+    .onAccess = arcOnAccess,
+    .onEvict = arcOnEvict,
+    .pickVictim = arcPickVictim,
+};
+
+#pragma endregion
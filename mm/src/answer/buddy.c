@@ -0,0 +1,115 @@
+#include "buddy.h"
+
+extern BuddyAllocator *buddyAllocator;
+
+#pragma region Buddy Functions
+
+/**
+ * Adds the run to the free list of its order. The allocator must be locked
+ * by the caller.
+*/
+static void pushFreeRun(uint16_t firstFrame, uint8_t order) {
+    uint16_t head = buddyAllocator->freeRuns[order];
+    buddyAllocator->next[firstFrame] = head;
+    buddyAllocator->prev[firstFrame] = BUDDY_NONE;
+    if (head != BUDDY_NONE) {
+        buddyAllocator->prev[head] = firstFrame;
+    }
+    buddyAllocator->freeRuns[order] = firstFrame;
+    buddyAllocator->freeOrder[firstFrame] = order;
+}
+
+/**
+ * Removes the run from the free list of its order. The allocator must be
+ * locked by the caller.
+*/
+static void unlinkFreeRun(uint16_t firstFrame, uint8_t order) {
+    uint16_t next = buddyAllocator->next[firstFrame];
+    uint16_t prev = buddyAllocator->prev[firstFrame];
+    if (prev == BUDDY_NONE) {
+        buddyAllocator->freeRuns[order] = next;
+    } else {
+        buddyAllocator->next[prev] = next;
+    }
+    if (next != BUDDY_NONE) {
+        buddyAllocator->prev[next] = prev;
+    }
+    buddyAllocator->freeOrder[firstFrame] = BUDDY_NOT_FREE;
+}
+
+uint16_t allocateFrameRun(uint8_t order) {
+    if (order > BUDDY_MAX_ORDER) {
+        return BUDDY_NONE;
+    }
+    pthread_mutex_lock(&buddyAllocator->lock);
+    // Find the smallest free run that is large enough
+    uint8_t runOrder = order;
+    while (runOrder <= BUDDY_MAX_ORDER && buddyAllocator->freeRuns[runOrder] == BUDDY_NONE) {
+        runOrder++;
+    }
+    if (runOrder > BUDDY_MAX_ORDER) {
+        pthread_mutex_unlock(&buddyAllocator->lock);
+        return BUDDY_NONE;
+    }
+    uint16_t firstFrame = buddyAllocator->freeRuns[runOrder];
+    unlinkFreeRun(firstFrame, runOrder);
+    // Split it in halves, keeping the lower half and freeing the upper one,
+    // until it is the requested size
+    while (runOrder > order) {
+        runOrder--;
+        pushFreeRun(firstFrame + (1 << runOrder), runOrder);
+    }
+    buddyAllocator->numFreeFrames -= 1 << order;
+    pthread_mutex_unlock(&buddyAllocator->lock);
+    return firstFrame;
+}
+
+void freeFrameRun(uint16_t firstFrame, uint8_t order) {
+    pthread_mutex_lock(&buddyAllocator->lock);
+    buddyAllocator->numFreeFrames += 1 << order;
+    // Merge with the buddy while it is a free run of the same size
+    while (order < BUDDY_MAX_ORDER) {
+        uint16_t buddy = firstFrame ^ (1 << order);
+        if (buddy >= NUM_FRAME_TABLE_ENTRIES || buddyAllocator->freeOrder[buddy] != order) {
+            break;
+        }
+        unlinkFreeRun(buddy, order);
+        firstFrame = firstFrame < buddy ? firstFrame : buddy;
+        order++;
+    }
+    pushFreeRun(firstFrame, order);
+    pthread_mutex_unlock(&buddyAllocator->lock);
+}
+
+uint16_t countBuddyFreeFrames() {
+    return __atomic_load_n(&buddyAllocator->numFreeFrames, __ATOMIC_RELAXED);
+}
+
+void initializeBuddyAllocator() {
+    pthread_mutex_init(&buddyAllocator->lock, NULL);
+    for (int order = 0; order < NUM_BUDDY_ORDERS; order++) {
+        buddyAllocator->freeRuns[order] = BUDDY_NONE;
+    }
+    for (int i = 0; i < NUM_FRAME_TABLE_ENTRIES; i++) {
+        buddyAllocator->freeOrder[i] = BUDDY_NOT_FREE;
+    }
+    // Cover the frames with the largest aligned runs that fit. Runs are
+    // pushed from the end so that the lowest frames are handed out first
+    uint16_t runStarts[NUM_FRAME_TABLE_ENTRIES];
+    uint8_t runOrders[NUM_FRAME_TABLE_ENTRIES];
+    int numRuns = 0;
+    for (int frame = 0; frame < NUM_FRAME_TABLE_ENTRIES; frame += 1 << runOrders[numRuns - 1]) {
+        uint8_t order = BUDDY_MAX_ORDER;
+        while (frame % (1 << order) != 0 || frame + (1 << order) > NUM_FRAME_TABLE_ENTRIES) {
+            order--;
+        }
+        runStarts[numRuns] = frame;
+        runOrders[numRuns++] = order;
+    }
+    for (int i = numRuns - 1; i >= 0; i--) {
+        pushFreeRun(runStarts[i], runOrders[i]);
+    }
+    buddyAllocator->numFreeFrames = NUM_FRAME_TABLE_ENTRIES;
+}
+
+#pragma endregion
@@ -0,0 +1,70 @@
+#ifndef VIRTUALMEMFRAMEWORKC_BUDDY_H
+#define VIRTUALMEMFRAMEWORKC_BUDDY_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "frame.h"
+
+#pragma region Buddy Macros
+
+/* Largest run the buddy allocator keeps, 2^8 = 256 frames (1 MiB) */
+#define BUDDY_MAX_ORDER 8
+/* Number of run sizes, one free list each */
+#define NUM_BUDDY_ORDERS (BUDDY_MAX_ORDER + 1)
+/* Frame number returned when no run is free, and the end of a free list */
+#define BUDDY_NONE 0xFFFF
+/* Order stored for a frame that does not start a free run */
+#define BUDDY_NOT_FREE 0xFF
+
+#pragma endregion
+
+#pragma region Buddy Structs
+
+/**
+ * Defines a binary buddy allocator over the user frames. Free frames are
+ * kept in runs of 2^order physically contiguous frames that start at a
+ * multiple of their size. A run's buddy is the run of the same size next to
+ * it that it was split from, and the two are merged again whenever both are
+ * free. Runs of each order are kept in a doubly linked list through their
+ * first frames.
+*/
+typedef struct BuddyAllocator {
+    pthread_mutex_t lock;                       // Lock for the whole allocator
+    uint16_t numFreeFrames;                     // Number of frames in all free runs
+    uint16_t freeRuns[NUM_BUDDY_ORDERS];        // First frame of the first free run of each order
+    uint16_t next[NUM_FRAME_TABLE_ENTRIES];     // Next free run of the same order
+    uint16_t prev[NUM_FRAME_TABLE_ENTRIES];     // Previous free run of the same order
+    uint8_t freeOrder[NUM_FRAME_TABLE_ENTRIES]; // Order of the free run starting at each frame, or BUDDY_NOT_FREE
+} BuddyAllocator;
+
+#pragma endregion
+
+#pragma region Buddy FunctionDeclarations
+
+/**
+ * Removes a free run of 2^order frames from the allocator, splitting a
+ * larger run if there is none of that size, and returns its first frame.
+ * Returns BUDDY_NONE if there is no run large enough.
+*/
+uint16_t allocateFrameRun(uint8_t order);
+
+/**
+ * Returns a run of 2^order frames taken with allocateFrameRun (or a single
+ * frame with order 0) to the allocator, merging it with its buddy for as
+ * long as the buddy is free.
+*/
+void freeFrameRun(uint16_t firstFrame, uint8_t order);
+
+/**
+ * Returns the number of free frames in the allocator.
+*/
+uint16_t countBuddyFreeFrames();
+
+/**
+ * Places every frame in the allocator in the largest runs possible.
+*/
+void initializeBuddyAllocator();
+
+#pragma endregion
+
+#endif //VIRTUALMEMFRAMEWORKC_BUDDY_H
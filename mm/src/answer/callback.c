@@ -2,6 +2,11 @@
 #include "utils.h"
 #include "memory.h"
 #include "thread.h"
+#include "stats.h"
+#include "reclaim.h"
+#include "merge.h"
+#include "flusher.h"
+#include "prefetch.h"
 #include <stdint.h>
 #include <stdio.h>
 
@@ -10,8 +15,6 @@
 // more than enough given file naming schema)
 const int MAX_FILE_NAME_SIZE = 128;
 extern uint8_t currentThreadId;
-extern int currentlyCheckedFrame;
-extern pthread_mutex_t evictionMutex;
 
 void startupCallback() {
     logData("\nstartupCallback(): Initializing system memory...\n");
@@ -22,18 +25,30 @@ void startupCallback() {
     logData("startupCallback(): System memory initialized...\n");
     flushLog();
 
-    // Initialize eviction mutex
-    pthread_mutex_init(&evictionMutex, NULL);
+    // Counters are kept per test run
+    resetVMStats();
+
     // Since currentThreadId is a global var defined in thread.c,
     // its value needs to be reset to 1 after each test is run
     currentThreadId = 1;
-    // Since clock algorithm for swapping modifies a global var
-    // defined in frane.c, its value needs to be reset to 0 to
-    // ensure previous tests don't affect current one
-    currentlyCheckedFrame = 0;
+
+    // Start refilling the free list in the background
+    startReclaimer();
+    // Start writing dirty frames back before they are evicted
+    startFlusher();
+    // Start merging identical pages in the background
+    startMerger();
+    // Start prefetching the pages predicted to fault
+    startPrefetcher();
 }
 
 void shutdownCallback() {
+    stopPrefetcher();
+    stopMerger();
+    stopFlusher();
+    stopReclaimer();
+    logVMStats();
+
     logData("shutdownCallback(): De-initializing system memory...\n");
     flushLog();
 
@@ -0,0 +1,142 @@
+#include "policy.h"
+#include "frameScan.h"
+#include <pthread.h>
+
+extern FrameTable *frameTable;
+
+/* Number of frames in each shard */
+#define CLOCK_SHARD_SIZE (NUM_FRAME_TABLE_ENTRIES / NUM_CLOCK_SHARDS)
+
+_Static_assert(NUM_FRAME_TABLE_ENTRIES % NUM_CLOCK_SHARDS == 0, "Clock shards must split the frame table evenly");
+_Static_assert(CLOCK_SHARD_SIZE == FRAME_SCAN_WIDTH, "Clock shards must be scanned in one go");
+
+/**
+ * Defines a shard of the frame table with its own clock hand. The lock is
+ * held while the hand moves, so each shard is swept by one thread at a time.
+*/
+typedef struct ClockShard {
+    pthread_mutex_t lock;      // Lock for the hand
+    int currentlyCheckedFrame; // The frame the hand points at
+} ClockShard;
+
+static ClockShard clockShards[NUM_CLOCK_SHARDS];
+/* Spreads evicting threads over the shards */
+static uint32_t nextShardTicket;
+
+#pragma region Clock Policy
+
+static void clockInit() {
+    for (int i = 0; i < NUM_CLOCK_SHARDS; i++) {
+        pthread_mutex_init(&clockShards[i].lock, NULL);
+        clockShards[i].currentlyCheckedFrame = i * CLOCK_SHARD_SIZE;
+    }
+    nextShardTicket = 0;
+}
+
+static void clockOnAllocate(FTEntry *entry) {
+    markFrameAccessed(entry);
+}
+
+static void clockOnAccess(FTEntry *entry) {
+    // A relaxed store is enough, the hand only needs to see it eventually
+    markFrameAccessed(entry);
+}
+
+/**
+ * Returns the first set bit in the shard's bitmap at or after the given
+ * offset, wrapping around to the start of the shard. There must be one.
+*/
+static int nextSetBit(const uint64_t *bitmap, int offset) {
+    int word = offset / 64;
+    uint64_t bits = bitmap[word] & (~0ULL << (offset % 64));
+    // Coming back around to the first word, its bits at or after the offset
+    // are already known to be clear
+    while (bits == 0) {
+        word = (word + 1) % FRAME_SCAN_WORDS;
+        bits = bitmap[word];
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+/**
+ * Moves the shard's hand to each frame that is owned and not accessed in
+ * turn, clearing the accessed bits of the frames it passes on the way, until
+ * one can be locked. Returns the locked frame to evict, or NULL if every
+ * frame in the shard is unowned or busy. The shard must be locked by the
+ * caller.
+*/
+static FTEntry* sweepClockShard(ClockShard *shard, int shardStart) {
+    // Use a clock algorithm to evict the frame that was accessed the longest period of time ago
+    uint64_t *accessedBitmap = &frameTable->accessedBitmap[shardStart / 64];
+    uint64_t *ownedBitmap = &frameTable->ownedBitmap[shardStart / 64];
+    FTEntry *evictedFrameTE = NULL;
+    for (int attempt = 0; evictedFrameTE == NULL && attempt < CLOCK_SHARD_SIZE; attempt++) {
+        // Accessors set the accessed bits without taking any lock, so the
+        // candidates are only a snapshot
+        uint64_t candidates[FRAME_SCAN_WORDS];
+        if (!findEvictionCandidates(accessedBitmap, ownedBitmap, candidates)) {
+            // Every owned frame was accessed, so the hand would clear all of
+            // their bits and come back around to where it started
+            clearFramesAccessed(shardStart, CLOCK_SHARD_SIZE);
+            uint64_t anyOwned = 0;
+            for (int i = 0; i < FRAME_SCAN_WORDS; i++) {
+                candidates[i] = __atomic_load_n(&ownedBitmap[i], __ATOMIC_RELAXED);
+                anyOwned |= candidates[i];
+            }
+            if (anyOwned == 0) {
+                break;
+            }
+        }
+        // Give the frames the hand passes over their second chance
+        int hand = shard->currentlyCheckedFrame - shardStart;
+        int victim = nextSetBit(candidates, hand);
+        if (victim >= hand) {
+            clearFramesAccessed(shardStart + hand, victim - hand);
+        } else {
+            clearFramesAccessed(shardStart + hand, CLOCK_SHARD_SIZE - hand);
+            clearFramesAccessed(shardStart, victim);
+        }
+        shard->currentlyCheckedFrame = shardStart + (victim + 1) % CLOCK_SHARD_SIZE;
+        // Accessors never take a shard lock, so waiting on a busy owner
+        // while holding one is safe
+        FTEntry *entry = &frameTable->entries[shardStart + victim];
+        if (lockEvictionCandidate(entry, true)) {
+            evictedFrameTE = entry;
+        }
+    }
+    return evictedFrameTE;
+}
+
+static FTEntry* clockPickVictim() {
+    FTEntry *evictedFrameTE = NULL;
+    // Hash a ticket to pick the first shard so concurrent evictions start on
+    // different shards, then move on to the next shard whenever one is being
+    // swept by another thread or has nothing to evict
+    uint32_t ticket = __atomic_fetch_add(&nextShardTicket, 1, __ATOMIC_RELAXED);
+    int shardNum = (ticket * 2654435761u >> 16) % NUM_CLOCK_SHARDS;
+    for (int attempt = 0; evictedFrameTE == NULL; attempt++, shardNum = (shardNum + 1) % NUM_CLOCK_SHARDS) {
+        ClockShard *shard = &clockShards[shardNum];
+        // Only wait for a shard once every shard has been found busy
+        if (attempt < NUM_CLOCK_SHARDS) {
+            if (pthread_mutex_trylock(&shard->lock) != 0) {
+                continue;
+            }
+        } else {
+            pthread_mutex_lock(&shard->lock);
+        }
+        evictedFrameTE = sweepClockShard(shard, shardNum * CLOCK_SHARD_SIZE);
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return evictedFrameTE;
+}
+
+const ReplacementPolicy clockPolicy = {
+    .name = "clock",
+    .init = clockInit,
+    .onAllocate = clockOnAllocate,
+    .onAccess = clockOnAccess,
+    .onEvict = NULL,
+    .pickVictim = clockPickVictim,
+};
+
+#pragma endregion
@@ -0,0 +1,48 @@
+#include "policy.h"
+#include "frameList.h"
+#include <pthread.h>
+
+/* Mapped frames in the order their pages were brought in */
+static FrameList fifoList;
+static pthread_mutex_t fifoLock = PTHREAD_MUTEX_INITIALIZER;
+
+#pragma region FIFO Policy
+
+static void fifoInit() {
+    initFrameList(&fifoList);
+}
+
+static void fifoOnAllocate(FTEntry *entry) {
+    pthread_mutex_lock(&fifoLock);
+    removeFromFrameList(&fifoList, entry->frameNum);
+    appendToFrameList(&fifoList, entry->frameNum);
+    pthread_mutex_unlock(&fifoLock);
+}
+
+static void fifoOnEvict(FTEntry *entry) {
+    pthread_mutex_lock(&fifoLock);
+    removeFromFrameList(&fifoList, entry->frameNum);
+    pthread_mutex_unlock(&fifoLock);
+}
+
+static FTEntry* fifoPickVictim() {
+    FTEntry *victim = NULL;
+    // Retry until the owner of some frame is not busy
+    while (victim == NULL) {
+        pthread_mutex_lock(&fifoLock);
+        victim = lockFirstEvictableFrame(&fifoList);
+        pthread_mutex_unlock(&fifoLock);
+    }
+    return victim;
+}
+
+const ReplacementPolicy fifoPolicy = {
+    .name = "fifo",
+    .init = fifoInit,
+    .onAllocate = fifoOnAllocate,
+    .onAccess = NULL,
+    .onEvict = fifoOnEvict,
+    .pickVictim = fifoPickVictim,
+};
+
+#pragma endregion
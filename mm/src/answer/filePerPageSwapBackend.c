@@ -0,0 +1,105 @@
+#include "swapBackend.h"
+#include "swapIo.h"
+#include "swap.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+extern const int PAGE_SIZE;
+extern const int MAX_FILE_NAME_SIZE;
+
+/* One bit per slot, set if the slot has a file. Only the slot's writer and
+   the swap device, once the slot is freed, touch a slot's bit */
+static uint64_t slotFiles[(NUM_SWAP_SLOTS + 63) / 64];
+
+#pragma region File Per Page Swap Backend
+
+/**
+ * Opens the file of the given slot with the given flags. Returns the file
+ * descriptor, or -1 on error.
+*/
+static int openSlotFile(uint16_t slot, int flags) {
+    char fileName[MAX_FILE_NAME_SIZE];
+    sprintf(fileName, SWAP_SLOT_FILE_FORMAT, slot);
+    return open(fileName, flags, 0600);
+}
+
+/**
+ * Deletes the file of the given slot.
+*/
+static void removeSlotFile(uint16_t slot) {
+    char fileName[MAX_FILE_NAME_SIZE];
+    sprintf(fileName, SWAP_SLOT_FILE_FORMAT, slot);
+    remove(fileName);
+}
+
+static bool filePerPageOpen() {
+    memset(slotFiles, 0, sizeof(slotFiles));
+    return true;
+}
+
+/**
+ * Reads or writes each page of the run through its slot's file, one file at
+ * a time like the original swap files.
+*/
+static void filePerPageTransfer(bool write, SwapSlotRun *run) {
+    run->result = 0;
+    for (int i = 0; i < run->numPages; i++) {
+        uint16_t slot = run->firstSlot + i;
+        int fd = openSlotFile(slot, write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY);
+        if (fd < 0) {
+            run->result = -1;
+            return;
+        }
+        if (write) {
+            __atomic_fetch_or(&slotFiles[slot / 64], 1ULL << (slot % 64), __ATOMIC_RELAXED);
+        }
+        ssize_t bytes = write ? writeSwapPages(fd, &run->pages[i], 1, 0) : readSwapPages(fd, &run->pages[i], 1, 0);
+        close(fd);
+        if (bytes != PAGE_SIZE) {
+            run->result = -1;
+            return;
+        }
+        run->result += bytes;
+    }
+}
+
+static void filePerPageWritePages(SwapSlotRun *runs, int numRuns) {
+    for (int i = 0; i < numRuns; i++) {
+        filePerPageTransfer(true, &runs[i]);
+    }
+}
+
+static void filePerPageReadPages(SwapSlotRun *runs, int numRuns) {
+    for (int i = 0; i < numRuns; i++) {
+        filePerPageTransfer(false, &runs[i]);
+    }
+}
+
+static void filePerPageDiscard(uint16_t slot) {
+    uint64_t bit = 1ULL << (slot % 64);
+    if (__atomic_fetch_and(&slotFiles[slot / 64], ~bit, __ATOMIC_RELAXED) & bit) {
+        removeSlotFile(slot);
+    }
+}
+
+static void filePerPageClose() {
+    for (uint32_t word = 0; word < (NUM_SWAP_SLOTS + 63) / 64; word++) {
+        for (uint64_t bits = slotFiles[word]; bits != 0; bits &= bits - 1) {
+            removeSlotFile(word * 64 + __builtin_ctzll(bits));
+        }
+        slotFiles[word] = 0;
+    }
+}
+
+const SwapBackend filePerPageSwapBackend = {
+    .name = "file per page",
+    .open = filePerPageOpen,
+    .writePages = filePerPageWritePages,
+    .readPages = filePerPageReadPages,
+    .discard = filePerPageDiscard,
+    .close = filePerPageClose,
+};
+
+#pragma endregion
@@ -0,0 +1,82 @@
+#include "swapBackend.h"
+#include "swapIo.h"
+#include "swap.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+extern const int PAGE_SIZE;
+
+/* The swap file, -1 while the backend is closed */
+static int swapFd = -1;
+
+#pragma region File Swap Backend
+
+/**
+ * Returns the byte offset of the given slot in the swap file.
+*/
+static off_t swapSlotOffset(uint16_t slot) {
+    return (off_t)slot * PAGE_SIZE;
+}
+
+static bool fileOpen() {
+    // Size the file to hold every slot up front so that evictions never
+    // have to grow it
+    swapFd = open(SWAP_FILE_NAME, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (swapFd < 0) {
+        return false;
+    }
+    if (ftruncate(swapFd, swapSlotOffset(NUM_SWAP_SLOTS - 1) + PAGE_SIZE) != 0) {
+        close(swapFd);
+        remove(SWAP_FILE_NAME);
+        swapFd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Issues the runs through the swap I/O engine as a single batch, so an
+ * engine that can overlaps them.
+*/
+static void fileSubmit(bool write, SwapSlotRun *runs, int numRuns) {
+    SwapIoRequest requests[numRuns];
+    for (int i = 0; i < numRuns; i++) {
+        requests[i] = (SwapIoRequest){.write = write, .offset = swapSlotOffset(runs[i].firstSlot),
+                                      .pages = runs[i].pages, .numPages = runs[i].numPages};
+    }
+    swapIoEngine->submit(swapFd, requests, numRuns);
+    for (int i = 0; i < numRuns; i++) {
+        runs[i].result = requests[i].result;
+    }
+}
+
+static void fileWritePages(SwapSlotRun *runs, int numRuns) {
+    fileSubmit(true, runs, numRuns);
+}
+
+static void fileReadPages(SwapSlotRun *runs, int numRuns) {
+    fileSubmit(false, runs, numRuns);
+}
+
+static void fileDiscard(uint16_t slot) {
+    // A freed slot is simply written over when it is reused
+    (void)slot;
+}
+
+static void fileClose() {
+    close(swapFd);
+    remove(SWAP_FILE_NAME);
+    swapFd = -1;
+}
+
+const SwapBackend fileSwapBackend = {
+    .name = "file",
+    .open = fileOpen,
+    .writePages = fileWritePages,
+    .readPages = fileReadPages,
+    .discard = fileDiscard,
+    .close = fileClose,
+};
+
+#pragma endregion
@@ -0,0 +1,224 @@
+#include "flusher.h"
+#include "frame.h"
+#include "page.h"
+#include "rmap.h"
+#include "swap.h"
+#include "stats.h"
+#include "utils.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+extern FrameTable *frameTable;
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+FlusherConfig flusherConfig = {
+    .enabled = true,
+    .framesPerScan = DEFAULT_FLUSH_FRAMES_PER_SCAN,
+    .scanIntervalMs = DEFAULT_FLUSH_SCAN_INTERVAL_MS,
+    .clusterPages = DEFAULT_FLUSH_CLUSTER_PAGES,
+    .freeFrames = DEFAULT_FLUSH_FREE_FRAMES,
+};
+
+/* The flusher writes on behalf of the kernel, which has thread id 0 */
+static Thread flusherThread;
+static pthread_mutex_t flushLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flushCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t flushIdleCond = PTHREAD_COND_INITIALIZER;
+static bool flusherCreated;
+static bool flusherEnabled;
+static bool flusherBusy;
+/* Lock for the scan cursor, held for the whole of a scan */
+static pthread_mutex_t scanLock = PTHREAD_MUTEX_INITIALIZER;
+/* Next frame to check */
+static uint16_t scanCursor;
+
+#pragma region Flusher Functions
+
+/**
+ * Returns the frame of the thread's page at vpn if the flusher may write it
+ * back: a dirty frame that is not accessed, mapped to the page alone.
+ * Returns NULL otherwise. The thread's page table must be locked by the
+ * caller, which keeps the page mapped to the frame.
+*/
+static FTEntry* flushableFrame(PageTable *pageTable, uint8_t threadId, uint16_t vpn) {
+    PTEntry *pte = &pageTable->entries[vpn];
+    // Write protected pages may share their frame, pages of shared regions
+    // are written to the region's slots, and a page in transit is already
+    // being written back
+    if (!pte->present || pte->writeProtected || pte->sharedRegion || pte->inTransit) {
+        return NULL;
+    }
+    FTEntry *entry = &frameTable->entries[pte->frameTblNum];
+    if (!entry->dirty || frameAccessed(entry) || frameShared(entry)
+        || frameOwner(entry) != threadId || frameVirtualPageNum(entry) != vpn) {
+        return NULL;
+    }
+    return entry;
+}
+
+/**
+ * Writes back the flushable frames of the thread's pages in the aligned
+ * block of pages holding vpn. Gives up if the thread's page table stays busy.
+ * Returns the number of frames cleaned.
+*/
+static uint16_t flushCluster(uint8_t threadId, uint16_t vpn) {
+    PageTable *pageTable = getThreadPageTable(threadId);
+    // Threads hold their page table while they access memory, so like
+    // eviction give a busy thread a few chances before moving on
+    for (int attempt = 1; pthread_mutex_trylock(&pageTable->lock) != 0; attempt++) {
+        if (attempt == EVICTION_LOCK_ATTEMPTS) {
+            return 0;
+        }
+        sched_yield();
+    }
+    FTEntry *cluster[FLUSH_CLUSTER_LIMIT];
+    int numFrames = 0;
+    uint16_t firstVpn = vpn - vpn % flusherConfig.clusterPages;
+    for (uint16_t page = firstVpn; page < firstVpn + flusherConfig.clusterPages && page < NUM_PAGE_TABLE_ENTRIES; page++) {
+        FTEntry *entry = flushableFrame(pageTable, threadId, page);
+        if (entry != NULL) {
+            cluster[numFrames++] = entry;
+        }
+    }
+    if (numFrames == 0) {
+        pthread_mutex_unlock(&pageTable->lock);
+        return 0;
+    }
+
+    // Frames are always locked in increasing order. Their pages stay mapped
+    // to them while the page table is held, so no frame changes hands
+    FTEntry *lockOrder[FLUSH_CLUSTER_LIMIT];
+    for (int i = 0; i < numFrames; i++) {
+        int j = i;
+        for (; j > 0 && lockOrder[j - 1]->frameNum > cluster[i]->frameNum; j--) {
+            lockOrder[j] = lockOrder[j - 1];
+        }
+        lockOrder[j] = cluster[i];
+    }
+    for (int i = 0; i < numFrames; i++) {
+        pthread_mutex_lock(&lockOrder[i]->lock);
+    }
+    uint16_t slots[FLUSH_CLUSTER_LIMIT];
+    int numPages = beginWriteBackPageCluster(&flusherThread, cluster, numFrames, slots);
+    for (int i = numFrames - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&lockOrder[i]->lock);
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+
+    // Write the cluster with nothing locked, so its thread keeps running.
+    // Its pages wait before writing to their frames until the write is done
+    if (numPages > 0) {
+        finishPageClusterTransit(&flusherThread, cluster, slots, numPages);
+    }
+    STAT_INC(flushedClusters);
+    return numFrames;
+}
+
+uint16_t flushDirtyFrames(uint16_t numFrames) {
+    uint16_t numFlushed = 0;
+    pthread_mutex_lock(&scanLock);
+    for (uint16_t i = 0; i < numFrames; i++) {
+        FTEntry *entry = &frameTable->entries[scanCursor];
+        scanCursor = (scanCursor + 1) % NUM_FRAME_TABLE_ENTRIES;
+        // The frame is only looked at here, flushCluster checks it again
+        // under its owner's page table
+        uint8_t ownerThreadId = frameOwner(entry);
+        if (ownerThreadId == 0 || !entry->dirty || frameAccessed(entry)) {
+            continue;
+        }
+        numFlushed += flushCluster(ownerThreadId, frameVirtualPageNum(entry));
+    }
+    pthread_mutex_unlock(&scanLock);
+    return numFlushed;
+}
+
+/**
+ * Body of the flusher thread. Checks a batch of frames every scan interval
+ * while it is enabled and few enough frames are free.
+*/
+static void* flushFramesInBackground(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&flushLock);
+    while (true) {
+        while (!flusherEnabled) {
+            pthread_cond_wait(&flushCond, &flushLock);
+        }
+        struct timespec wakeAt;
+        clock_gettime(CLOCK_REALTIME, &wakeAt);
+        wakeAt.tv_nsec += (long)flusherConfig.scanIntervalMs * 1000000;
+        wakeAt.tv_sec += wakeAt.tv_nsec / 1000000000;
+        wakeAt.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&flushCond, &flushLock, &wakeAt);
+        // The flusher may have been stopped while it slept
+        if (!flusherEnabled || countFreeFrames() >= flusherConfig.freeFrames) {
+            continue;
+        }
+        flusherBusy = true;
+        pthread_mutex_unlock(&flushLock);
+
+        STAT_INC(flusherWakeups);
+        flushDirtyFrames(flusherConfig.framesPerScan);
+
+        pthread_mutex_lock(&flushLock);
+        flusherBusy = false;
+        pthread_cond_broadcast(&flushIdleCond);
+    }
+    return NULL;
+}
+
+#pragma endregion
+
+#pragma region Flusher Callback
+
+void startFlusher() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    if (flusherConfig.framesPerScan == 0) {
+        flusherConfig.framesPerScan = 1;
+    }
+    if (flusherConfig.clusterPages == 0) {
+        flusherConfig.clusterPages = 1;
+    }
+    if (flusherConfig.clusterPages > FLUSH_CLUSTER_LIMIT) {
+        flusherConfig.clusterPages = FLUSH_CLUSTER_LIMIT;
+    }
+    // Frames of a previous run mean nothing now
+    pthread_mutex_lock(&scanLock);
+    scanCursor = 0;
+    pthread_mutex_unlock(&scanLock);
+    if (!flusherConfig.enabled) {
+        return;
+    }
+    sprintf(logBuffer, "startFlusher(): Checking %d frames every %d ms below %d free frames, in blocks of %d pages\n",
+                        flusherConfig.framesPerScan, flusherConfig.scanIntervalMs, flusherConfig.freeFrames, flusherConfig.clusterPages);
+    logData(logBuffer);
+    flushLog();
+
+    pthread_mutex_lock(&flushLock);
+    // The thread is created once and only parked between runs, for the same
+    // reason as the reclaimer's
+    if (!flusherCreated) {
+        flusherThread.threadId = 0;
+        pthread_create(&flusherThread.thread, NULL, flushFramesInBackground, NULL);
+        flusherCreated = true;
+    }
+    flusherEnabled = true;
+    pthread_cond_signal(&flushCond);
+    pthread_mutex_unlock(&flushLock);
+}
+
+void stopFlusher() {
+    pthread_mutex_lock(&flushLock);
+    flusherEnabled = false;
+    pthread_cond_signal(&flushCond);
+    // Wait for the scan in progress to finish
+    while (flusherBusy) {
+        pthread_cond_wait(&flushIdleCond, &flushLock);
+    }
+    pthread_mutex_unlock(&flushLock);
+}
+
+#pragma endregion
@@ -0,0 +1,73 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FLUSHER_H
+#define VIRTUALMEMFRAMEWORKC_FLUSHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "reclaim.h"
+
+#pragma region Flusher Macros
+
+/* Default number of frames checked each time the flusher wakes */
+#define DEFAULT_FLUSH_FRAMES_PER_SCAN 256
+/* Default milliseconds the flusher sleeps between scans */
+#define DEFAULT_FLUSH_SCAN_INTERVAL_MS 5
+/* Default number of pages in the aligned block of a thread's pages that is
+   written back together */
+#define DEFAULT_FLUSH_CLUSTER_PAGES 16
+/* Most pages that can ever be written back together */
+#define FLUSH_CLUSTER_LIMIT 64
+/* Default number of free frames below which the flusher cleans frames. Above
+   it no eviction is near, and the writes would only be repeated once the
+   pages are written to again */
+#define DEFAULT_FLUSH_FREE_FRAMES (2 * DEFAULT_HIGH_WATERMARK)
+
+#pragma endregion
+
+#pragma region Flusher Structs
+
+/**
+ * Defines the settings of the background flusher. They are read when the
+ * flusher is started, so changes take effect on the next startupCallback.
+*/
+typedef struct FlusherConfig {
+    bool enabled;               // Whether the flusher runs at all
+    uint16_t framesPerScan;     // Frames checked each time the flusher wakes
+    uint16_t scanIntervalMs;    // Milliseconds the flusher sleeps between scans
+    uint16_t clusterPages;      // Pages in each aligned block written back together, at most FLUSH_CLUSTER_LIMIT
+    uint16_t freeFrames;        // The flusher only cleans frames while fewer than this are free
+} FlusherConfig;
+
+#pragma endregion
+
+#pragma region Flusher FunctionDeclarations
+
+/**
+ * Checks the next numFrames frames after the ones checked last, and writes
+ * back each dirty frame the replacement policy would take next, one whose
+ * accessed bit is clear, before it is picked for eviction. The frame is
+ * written together with the other such frames of its owner's pages in the
+ * same aligned block of clusterPages pages, to consecutive swap slots with a
+ * single call. Frames of shared regions, and frames shared by several
+ * pages, are left for eviction to write. Policies that keep no accessed
+ * bits leave every dirty frame looking cold. Returns the number of frames
+ * cleaned.
+*/
+uint16_t flushDirtyFrames(uint16_t numFrames);
+
+/**
+ * Starts the background flusher if it is enabled, creating its thread on
+ * first use.
+*/
+void startFlusher();
+
+/**
+ * Stops the background flusher and waits until it is no longer writing.
+ * The thread is kept parked for the next startFlusher.
+*/
+void stopFlusher();
+
+#pragma endregion
+
+extern FlusherConfig flusherConfig;
+
+#endif //VIRTUALMEMFRAMEWORKC_FLUSHER_H
@@ -1,12 +1,22 @@
 #include "frame.h"
 #include "page.h"
 #include "swap.h"
+#include "reclaim.h"
+#include "stats.h"
+#include "policy.h"
+#include "buddy.h"
+#include "rmap.h"
+#include "region.h"
+#include "prefetch.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <sched.h>
+#include <string.h>
 
 extern unsigned char *SYSTEM_MEMORY;
 extern const int USER_BASE_ADDR;
 extern FreeList *freeList;
+extern FreeFrameStack *freeFrameStack;
 extern FrameTable *frameTable;
 extern PageDirectory *directory;
 
@@ -14,149 +24,524 @@ extern const int PAGE_SIZE;
 // Max log buffer size
 extern const int MAX_BUFFER_SIZE;
 
-int currentlyCheckedFrame = 0;
-pthread_mutex_t evictionMutex;
+FreeFramePoolType freeFramePoolType = FREE_POOL_BUDDY;
+
+_Static_assert(NUM_FRAME_TABLE_ENTRIES % 64 == 0, "Frame bitmaps must cover the frame table exactly");
+
+#pragma region Frame Metadata Functions
+
+uint8_t frameOwner(FTEntry *entry) {
+    return __atomic_load_n(&frameTable->ownerThreadIds[entry->frameNum], __ATOMIC_RELAXED);
+}
+
+uint16_t frameVirtualPageNum(FTEntry *entry) {
+    return frameTable->virtualPageNums[entry->frameNum];
+}
+
+void setFrameOwner(FTEntry *entry, uint8_t threadId, uint16_t vpn) {
+    uint16_t frameNum = entry->frameNum;
+    uint64_t bit = 1ULL << (frameNum % 64);
+    frameTable->virtualPageNums[frameNum] = vpn;
+    __atomic_store_n(&frameTable->ownerThreadIds[frameNum], threadId, __ATOMIC_RELAXED);
+    if (threadId != 0) {
+        __atomic_fetch_or(&frameTable->ownedBitmap[frameNum / 64], bit, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&frameTable->ownedBitmap[frameNum / 64], ~bit, __ATOMIC_RELAXED);
+    }
+}
+
+bool frameAccessed(FTEntry *entry) {
+    uint16_t frameNum = entry->frameNum;
+    return (__atomic_load_n(&frameTable->accessedBitmap[frameNum / 64], __ATOMIC_RELAXED) >> (frameNum % 64)) & 1;
+}
+
+void markFrameAccessed(FTEntry *entry) {
+    // Skip the atomic write if the bit is already set, so frequently accessed
+    // frames do not keep taking the word's cache line away from each other
+    uint16_t frameNum = entry->frameNum;
+    if (!frameAccessed(entry)) {
+        __atomic_fetch_or(&frameTable->accessedBitmap[frameNum / 64], 1ULL << (frameNum % 64), __ATOMIC_RELAXED);
+    }
+}
+
+bool clearFrameAccessed(FTEntry *entry) {
+    uint16_t frameNum = entry->frameNum;
+    uint64_t bit = 1ULL << (frameNum % 64);
+    if (!frameAccessed(entry)) {
+        return false;
+    }
+    return (__atomic_fetch_and(&frameTable->accessedBitmap[frameNum / 64], ~bit, __ATOMIC_RELAXED) & bit) != 0;
+}
+
+void clearFramesAccessed(uint16_t firstFrame, uint16_t numFrames) {
+    uint32_t frameNum = firstFrame;
+    uint32_t end = (uint32_t)firstFrame + numFrames;
+    while (frameNum < end) {
+        // Clear the bits of the frames in range within the current word
+        uint32_t bitsInWord = 64 - frameNum % 64 < end - frameNum ? 64 - frameNum % 64 : end - frameNum;
+        uint64_t mask = (bitsInWord == 64 ? ~0ULL : (1ULL << bitsInWord) - 1) << (frameNum % 64);
+        __atomic_fetch_and(&frameTable->accessedBitmap[frameNum / 64], ~mask, __ATOMIC_RELAXED);
+        frameNum += bitsInWord;
+    }
+}
+
+#pragma endregion
 
 #pragma region Frame Functions
 
-uint16_t evictAFrame(Thread *thread) {
-    pthread_mutex_lock(&evictionMutex);
+/**
+ * Returns the bit standing for the thread in a bitmask of threads.
+*/
+static uint32_t threadBit(uint8_t threadId) {
+    return 1u << (threadId - 1);
+}
+
+/**
+ * Unlocks the page tables of the threads in the bitmask.
+*/
+static void unlockPageTables(uint32_t threads) {
+    for (uint8_t threadId = 1; threadId <= NUM_PAGE_TABLES; threadId++) {
+        if (threads & threadBit(threadId)) {
+            pthread_mutex_unlock(&getThreadPageTable(threadId)->lock);
+        }
+    }
+}
+
+/**
+ * Locks the page tables of the threads in the bitmask without waiting for
+ * any of them. Returns false holding none of them if one is busy.
+*/
+static bool lockPageTables(uint32_t threads) {
+    for (uint8_t threadId = 1; threadId <= NUM_PAGE_TABLES; threadId++) {
+        if ((threads & threadBit(threadId)) && pthread_mutex_trylock(&getThreadPageTable(threadId)->lock) != 0) {
+            unlockPageTables(threads & (threadBit(threadId) - 1));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool lockEvictionCandidate(FTEntry *entry, bool waitForOwner) {
+    uint8_t ownerThreadId = frameOwner(entry);
+    if (ownerThreadId == 0) {
+        return false;
+    }
+    // Accessors lock their page table before the frame, so the page table
+    // is always taken first. Accessors only hold it briefly, so a busy owner
+    // is given a few chances before its frame is skipped, otherwise a thread
+    // that is constantly accessing memory would have its frames evicted out
+    // of order
+    PageTable *ownersPageTable = getThreadPageTable(ownerThreadId);
+    if (waitForOwner) {
+        pthread_mutex_lock(&ownersPageTable->lock);
+    } else {
+        for (int attempt = 1; pthread_mutex_trylock(&ownersPageTable->lock) != 0; attempt++) {
+            if (attempt == EVICTION_LOCK_ATTEMPTS) {
+                return false;
+            }
+            sched_yield();
+        }
+    }
+    pthread_mutex_lock(&entry->lock);
+    // The frame may have been evicted and remapped before the locks were
+    // taken. A page being written back stays mapped to its frame, which must
+    // not change hands until the write is done
+    if (frameOwner(entry) != ownerThreadId || ownersPageTable->entries[frameVirtualPageNum(entry)].inTransit) {
+        pthread_mutex_unlock(&entry->lock);
+        pthread_mutex_unlock(&ownersPageTable->lock);
+        return false;
+    }
+    // Pages sharing the frame are unmapped along with it, so their page
+    // tables are needed too. Their threads may be waiting for the frame
+    // while holding them, so give up on the frame if any of them is busy
+    uint32_t sharerThreads = frameSharerThreads(entry) & ~threadBit(ownerThreadId);
+    if (!lockPageTables(sharerThreads)) {
+        pthread_mutex_unlock(&entry->lock);
+        pthread_mutex_unlock(&ownersPageTable->lock);
+        return false;
+    }
+    // A page of a shared region is swapped out for all of its mappings
+    // under its region's lock. Faults hold the lock while they wait for the
+    // mappings' page tables, so give up on the frame if it is busy
+    if (!trylockSharedRegion(&ownersPageTable->entries[frameVirtualPageNum(entry)])) {
+        pthread_mutex_unlock(&entry->lock);
+        unlockPageTables(sharerThreads);
+        pthread_mutex_unlock(&ownersPageTable->lock);
+        return false;
+    }
+    return true;
+}
+
+void unlockEvictionCandidate(FTEntry *entry) {
+    uint8_t ownerThreadId = frameOwner(entry);
+    uint32_t sharerThreads = frameSharerThreads(entry) & ~threadBit(ownerThreadId);
+    unlockSharedRegion(&getThreadPageTable(ownerThreadId)->entries[frameVirtualPageNum(entry)]);
+    pthread_mutex_unlock(&entry->lock);
+    unlockPageTables(sharerThreads);
+    pthread_mutex_unlock(&getThreadPageTable(ownerThreadId)->lock);
+}
 
+uint16_t evictAFrame(const Thread *thread) {
     char logBuffer[MAX_BUFFER_SIZE];
     sprintf(logBuffer, "Thread %d evictAFrame(): Finding frame to evict...\n", thread->threadId);
     logData(logBuffer);
     flushLog();
 
-    // Use a clock algorithm to evict the frame that was accessed the longest period of time ago
-    FTEntry *evictedFrameTE = NULL;
-    for (currentlyCheckedFrame; evictedFrameTE == NULL; currentlyCheckedFrame++) {
-        // Prevent accessing outside frame table bounds
-        if (currentlyCheckedFrame == NUM_FRAME_TABLE_ENTRIES) {
-            currentlyCheckedFrame = 0;
-        }
-        if (frameTable->entries[currentlyCheckedFrame].ownerThreadId == 0) {
-            continue;
-        }
-        if (frameTable->entries[currentlyCheckedFrame].accessed == 1) {
-            frameTable->entries[currentlyCheckedFrame].accessed = 0;
-            continue;
-        }
-        evictedFrameTE = &frameTable->entries[currentlyCheckedFrame];
-        // Lock the entry that will be evicted
-        pthread_mutex_lock(&evictedFrameTE->lock);
-    }
-    // Get the page table and entry of the evicted frames owner
-    int evictedOwnerId = evictedFrameTE->ownerThreadId;
+    // Let the replacement policy choose the frame, it comes back locked
+    // along with its owner's page table
+    FTEntry *evictedFrameTE = replacementPolicy->pickVictim();
+    // Get the page table and entry of the evicted frames owner (its page
+    // table is now locked)
+    int evictedOwnerId = frameOwner(evictedFrameTE);
+    uint16_t evictedVpn = frameVirtualPageNum(evictedFrameTE);
     PageTable *evictedFrameOwnersPageTable = getThreadPageTable(evictedOwnerId);
-    PTEntry *evictedPageTE = &evictedFrameOwnersPageTable->entries[evictedFrameTE->virtualPageNum];
+    PTEntry *evictedPageTE = &evictedFrameOwnersPageTable->entries[evictedVpn];
 
     sprintf(logBuffer, "Thread %d evictAFrame(): Evicting thread %d's frame %d associated with vpn %d...\n",
-                            thread->threadId, evictedFrameTE->ownerThreadId, evictedFrameTE->frameNum, evictedFrameTE->virtualPageNum);
+                            thread->threadId, evictedOwnerId, evictedFrameTE->frameNum, evictedVpn);
     logData(logBuffer);
     flushLog();
 
+    // Stop tracking the frame and swap its page to disk, along with the
+    // pages sharing it. A frame that still has to be written out is only
+    // given its slot or file for now
+    uint32_t sharerThreads = frameSharerThreads(evictedFrameTE) & ~threadBit(evictedOwnerId);
+    if (replacementPolicy->onEvict != NULL) {
+        replacementPolicy->onEvict(evictedFrameTE);
+    }
+    notePrefetchEviction(evictedFrameTE);
+    PageTransit transit;
+    bool inTransit = beginSwapPageToDisk(thread, evictedFrameTE, &transit);
 
-    // Lock the evicted page's owner's page table
-    pthread_mutex_lock(&getThreadPageTable(evictedOwnerId)->lock);
-
-    // Swap the first entry in the allocatedFramesList to disk
-    swapPageToDisk(thread, evictedFrameTE);
-
-    // Mark the previous frame owner's page table entry as not present
+    // Mark the previous frame owner's page table entry as not present, and
+    // those of the pages sharing the frame. Pages still to be written stay
+    // in transit until the frame is written out
+    unmapFrameSharers(evictedFrameTE);
     evictedPageTE->present = 0;
     evictedPageTE->frameTblNum = 0;
+    evictedPageTE->writeProtected = 0;
+    if (evictedPageTE->sharedRegion) {
+        forgetSharedPageFrame(evictedPageTE);
+    }
 
-    // Unlock evicted thread's page table
-    pthread_mutex_unlock(&getThreadPageTable(evictedOwnerId)->lock);
+    // Unlock the evicted frame, its region if it has one and the page
+    // tables of its pages
+    unlockSharedRegion(evictedPageTE);
+    pthread_mutex_unlock(&evictedFrameTE->lock);
+    unlockPageTables(sharerThreads);
+    pthread_mutex_unlock(&evictedFrameOwnersPageTable->lock);
 
-    // Put the frame table entry back into free list
-    if (freeList->numFreeFrames == 0) {
-        freeList->first = evictedFrameTE;
-        freeList->last = evictedFrameTE;
-    } else {
-        freeList->last->next = evictedFrameTE;
-        freeList->last = evictedFrameTE;
+    // Write the frame in transit with nothing locked, so the owner and every
+    // other thread keep running meanwhile. Anything needing the frame's slot
+    // or file waits for the write to finish
+    if (inTransit) {
+        finishPageTransit(thread, &transit);
     }
-    evictedFrameTE->next = NULL;
-    freeList->numFreeFrames++;
+    // Make room in the compressed pool for the next eviction now that no
+    // page table is held, the pool locks the owner of each page it writes out
+    trimCompressedPool(thread);
 
-    sprintf(logBuffer, "Thread %d evictAFrame(): Frame %d placed back in free list...\n", thread->threadId, evictedFrameTE->frameNum);
+    sprintf(logBuffer, "Thread %d evictAFrame(): Frame %d evicted...\n", thread->threadId, evictedFrameTE->frameNum);
     logData(logBuffer);
     flushLog();
 
-    pthread_mutex_unlock(&evictionMutex);
-
     return evictedFrameTE->frameNum;
 }
 
-uint16_t allocateFrameForPage(Thread *thread, uint32_t vpn) {
-    char logBuffer[MAX_BUFFER_SIZE];
+/**
+ * Returns a tagged stack top pointing at the given frame, with the version
+ * after the one in the old top.
+*/
+static uint32_t nextStackTop(uint32_t oldTop, uint16_t frameNum) {
+    return (((oldTop >> 16) + 1) << 16) | frameNum;
+}
 
-    sprintf(logBuffer, "Thread %d allocateFrameForPage(): Allocating frame for page %d\n", thread->threadId, vpn);
-    logData(logBuffer);
-    flushLog();
+/**
+ * Pushes the frames onto the free frame stack. They are linked together
+ * first so the whole batch is published with a single compare and swap.
+*/
+static void pushFramesToFreeStack(FTEntry **entries, int numEntries) {
+    for (int i = 0; i + 1 < numEntries; i++) {
+        __atomic_store_n(&freeFrameStack->next[entries[i]->frameNum], entries[i + 1]->frameNum, __ATOMIC_RELAXED);
+    }
+    uint16_t bottom = entries[numEntries - 1]->frameNum;
+    uint32_t oldTop = __atomic_load_n(&freeFrameStack->top, __ATOMIC_RELAXED);
+    uint32_t newTop;
+    do {
+        __atomic_store_n(&freeFrameStack->next[bottom], (uint16_t)oldTop, __ATOMIC_RELAXED);
+        newTop = nextStackTop(oldTop, entries[0]->frameNum);
+    } while (!__atomic_compare_exchange_n(&freeFrameStack->top, &oldTop, newTop, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_add_fetch(&freeFrameStack->numFreeFrames, numEntries, __ATOMIC_RELAXED);
+}
+
+/**
+ * Pops a frame off the free frame stack, or returns NULL if it is empty.
+*/
+static FTEntry* popFrameFromFreeStack() {
+    uint32_t oldTop = __atomic_load_n(&freeFrameStack->top, __ATOMIC_ACQUIRE);
+    uint32_t newTop;
+    do {
+        uint16_t frameNum = (uint16_t)oldTop;
+        if (frameNum == FREE_STACK_EMPTY) {
+            return NULL;
+        }
+        // The frame may be popped by another thread meanwhile, in which case
+        // the version has changed and the compare and swap fails
+        newTop = nextStackTop(oldTop, __atomic_load_n(&freeFrameStack->next[frameNum], __ATOMIC_RELAXED));
+    } while (!__atomic_compare_exchange_n(&freeFrameStack->top, &oldTop, newTop, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    __atomic_sub_fetch(&freeFrameStack->numFreeFrames, 1, __ATOMIC_RELAXED);
+    return &frameTable->entries[(uint16_t)oldTop];
+}
+
+/**
+ * Places the frames at the end of the free list, taking its lock once, or
+ * pushes them onto the free frame stack, or frees them into the buddy
+ * allocator one at a time.
+*/
+static void pushFramesToFreeList(FTEntry **entries, int numEntries) {
+    if (numEntries == 0) {
+        return;
+    }
+    if (freeFramePoolType == FREE_POOL_STACK) {
+        pushFramesToFreeStack(entries, numEntries);
+        return;
+    }
+    if (freeFramePoolType == FREE_POOL_BUDDY) {
+        for (int i = 0; i < numEntries; i++) {
+            freeFrameRun(entries[i]->frameNum, 0);
+        }
+        return;
+    }
+    pthread_mutex_lock(&freeList->lock);
+    for (int i = 0; i < numEntries; i++) {
+        if (freeList->numFreeFrames == 0) {
+            freeList->first = entries[i];
+            freeList->last = entries[i];
+        } else {
+            freeList->last->next = entries[i];
+            freeList->last = entries[i];
+        }
+        entries[i]->next = NULL;
+        freeList->numFreeFrames++;
+    }
+    pthread_mutex_unlock(&freeList->lock);
+}
+
+/**
+ * Removes up to maxEntries frames from the front of the free list, taking
+ * its lock once, or from the free frame stack or the buddy allocator.
+ * Returns how many were removed.
+*/
+static int takeFramesFromFreeList(FTEntry **entries, int maxEntries) {
+    int numEntries = 0;
+    if (freeFramePoolType == FREE_POOL_STACK) {
+        while (numEntries < maxEntries && (entries[numEntries] = popFrameFromFreeStack()) != NULL) {
+            numEntries++;
+        }
+        return numEntries;
+    }
+    if (freeFramePoolType == FREE_POOL_BUDDY) {
+        uint16_t frameNum;
+        while (numEntries < maxEntries && (frameNum = allocateFrameRun(0)) != BUDDY_NONE) {
+            entries[numEntries++] = &frameTable->entries[frameNum];
+        }
+        return numEntries;
+    }
 
     // Lock the free list for allocation
     pthread_mutex_lock(&freeList->lock);
+    while (numEntries < maxEntries && freeList->numFreeFrames > 0) {
+        // Get the frame table entry for the first available free frame
+        FTEntry *entry = freeList->first;
+        // Remove the frame table entry from the freeList
+        if (freeList->numFreeFrames == 1) {
+            freeList->first = NULL;
+            freeList->last = NULL;
+        } else {
+            freeList->first = entry->next;
+        }
+        freeList->numFreeFrames--;
+        entry->next = NULL;
+        entries[numEntries++] = entry;
+    }
+    // Allocation complete so free list can be unlocked
+    pthread_mutex_unlock(&freeList->lock);
+    return numEntries;
+}
+
+uint16_t countFreeFrames() {
+    if (freeFramePoolType == FREE_POOL_STACK) {
+        int32_t numFreeFrames = __atomic_load_n(&freeFrameStack->numFreeFrames, __ATOMIC_RELAXED);
+        return numFreeFrames > 0 ? numFreeFrames : 0;
+    }
+    if (freeFramePoolType == FREE_POOL_BUDDY) {
+        return countBuddyFreeFrames();
+    }
+    return __atomic_load_n(&freeList->numFreeFrames, __ATOMIC_RELAXED);
+}
+
+void returnFrameToFreeList(FTEntry *entry) {
+    pushFramesToFreeList(&entry, 1);
+}
+
+FTEntry* takeFrameFromFreeList() {
+    FTEntry *entry = NULL;
+    takeFramesFromFreeList(&entry, 1);
+    return entry;
+}
+
+/**
+ * Returns the thread's magazine.
+*/
+static FrameMagazine* getThreadFrameMagazine(const Thread *thread) {
+    return &frameTable->magazines[thread->threadId - 1];
+}
+
+void releaseFrame(const Thread *thread, FTEntry *entry) {
+    FrameMagazine *magazine = getThreadFrameMagazine(thread);
+    // Make room by returning the oldest batch to the free list
+    if (magazine->numFrames == FRAME_MAGAZINE_SIZE) {
+        FTEntry *batch[FRAME_MAGAZINE_BATCH];
+        for (int i = 0; i < FRAME_MAGAZINE_BATCH; i++) {
+            batch[i] = &frameTable->entries[magazine->frames[i]];
+        }
+        pushFramesToFreeList(batch, FRAME_MAGAZINE_BATCH);
+        magazine->numFrames -= FRAME_MAGAZINE_BATCH;
+        memmove(magazine->frames, &magazine->frames[FRAME_MAGAZINE_BATCH], magazine->numFrames * sizeof(uint16_t));
+    }
+    magazine->frames[magazine->numFrames++] = entry->frameNum;
+}
+
+void drainFrameMagazine(const Thread *thread) {
+    FrameMagazine *magazine = getThreadFrameMagazine(thread);
+    FTEntry *frames[FRAME_MAGAZINE_SIZE];
+    for (int i = 0; i < magazine->numFrames; i++) {
+        frames[i] = &frameTable->entries[magazine->frames[i]];
+    }
+    pushFramesToFreeList(frames, magazine->numFrames);
+    magazine->numFrames = 0;
+}
+
+/**
+ * Returns a free frame from the thread's magazine, refilling the magazine
+ * from the free list with one batch if it is empty. Returns NULL if both are
+ * empty.
+*/
+static FTEntry* takeFreeFrame(const Thread *thread) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    FrameMagazine *magazine = getThreadFrameMagazine(thread);
+    if (magazine->numFrames == 0) {
+        sprintf(logBuffer, "Thread %d takeFreeFrame(): There are %d frames available\n", thread->threadId, countFreeFrames());
+        logData(logBuffer);
+        flushLog();
+
+        FTEntry *batch[FRAME_MAGAZINE_BATCH];
+        int numTaken = takeFramesFromFreeList(batch, FRAME_MAGAZINE_BATCH);
+        for (int i = numTaken - 1; i >= 0; i--) {
+            magazine->frames[magazine->numFrames++] = batch[i]->frameNum;
+        }
+        if (numTaken > 0) {
+            STAT_INC(magazineRefills);
+        }
+        // Let the reclaimer replenish the free list before it runs out
+        wakeReclaimerIfNeeded(countFreeFrames());
+    }
+    if (magazine->numFrames == 0) {
+        return NULL;
+    }
+    // Frames are taken from the top so the most recently released one is
+    // reused first
+    return &frameTable->entries[magazine->frames[--magazine->numFrames]];
+}
 
-    sprintf(logBuffer, "Thread %d allocateFrameForPage(): There are %d frames available\n", thread->threadId, freeList->numFreeFrames);
+uint16_t allocateFrameForPage(const Thread *thread, uint32_t vpn) {
+    char logBuffer[MAX_BUFFER_SIZE];
+
+    sprintf(logBuffer, "Thread %d allocateFrameForPage(): Allocating frame for page %d\n", thread->threadId, vpn);
     logData(logBuffer);
     flushLog();
 
-    FTEntry *entry;
-    // Evict a frame from the allocated frames list if there are none available
-    if (freeList->numFreeFrames == 0) {
+    FTEntry *entry = takeFreeFrame(thread);
+    // Evict a frame directly if there are none available. The free list is
+    // not locked meanwhile, so other threads can still take frames that the
+    // reclaimer frees
+    if (entry == NULL) {
         sprintf(logBuffer, "Thread %d allocateFrameForPage(): Beginning frame eviction attempt...\n", thread->threadId);
         logData(logBuffer);
         flushLog();
+        STAT_INC(directReclaims);
         entry = &frameTable->entries[evictAFrame(thread)];
-    } else {
-        sprintf(logBuffer, "Thread %d allocateFrameForPage(): Fetching free frame...\n", thread->threadId);
-        logData(logBuffer);
-        flushLog();
-        // Get the frame table entry for the first available free frame
-        entry = freeList->first;
-        // Lock the frame table entry and update its values
-        pthread_mutex_lock(&entry->lock);
     }
 
     sprintf(logBuffer, "Thread %d allocateFrameForPage(): Found free frame %d at physical addr %d (%p)\n", thread->threadId, entry->frameNum, USER_BASE_ADDR + (PAGE_SIZE * entry->frameNum), entry->physAddr);
     logData(logBuffer);
     flushLog();
 
-    // Remove the frame table entry from the freeList
-    if (freeList->numFreeFrames == 1) {
-        freeList->first = NULL;
-        freeList->last = NULL;
-    } else {
-        freeList->first = entry->next;
+    // Lock the frame table entry and update its values
+    pthread_mutex_lock(&entry->lock);
+    // The frame has no owner until the page is mapped to it, so it cannot be
+    // evicted while it is being filled. It starts clean, pages without a swap
+    // slot are written back regardless
+    entry->dirty = 0;
+    entry->prefetched = PREFETCH_NONE;
+    entry->next = NULL;
+
+    // Unlock the entry
+    pthread_mutex_unlock(&entry->lock);
+
+    // Return that entry's frame number (i.e. its index into the frame table)
+    return entry->frameNum;
+}
+
+uint16_t allocateFrameRunForPages(const Thread *thread, uint8_t order) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    if (freeFramePoolType != FREE_POOL_BUDDY) {
+        return BUDDY_NONE;
+    }
+    uint16_t firstFrame = allocateFrameRun(order);
+    // Let the reclaimer replenish the free frames before they run out
+    wakeReclaimerIfNeeded(countFreeFrames());
+    if (firstFrame == BUDDY_NONE) {
+        return BUDDY_NONE;
     }
-    freeList->numFreeFrames--;
 
-    sprintf(logBuffer, "Thread %d allocateFrameForPage(): Frame %d removed from free list\n", thread->threadId, entry->frameNum);
+    sprintf(logBuffer, "Thread %d allocateFrameRunForPages(): Found free frames %d to %d\n",
+                        thread->threadId, firstFrame, firstFrame + (1 << order) - 1);
     logData(logBuffer);
     flushLog();
 
-    // Update the frame's accessed bit
-    entry->accessed = 1;
-    entry->next = NULL;
-    entry->ownerThreadId = thread->threadId;
-    entry->virtualPageNum = vpn;     // unused 16 MSB will be trucated
+    // Prepare each frame as allocateFrameForPage does
+    for (int i = 0; i < 1 << order; i++) {
+        FTEntry *entry = &frameTable->entries[firstFrame + i];
+        pthread_mutex_lock(&entry->lock);
+        entry->dirty = 0;
+        entry->prefetched = PREFETCH_NONE;
+        entry->next = NULL;
+        pthread_mutex_unlock(&entry->lock);
+    }
+    return firstFrame;
+}
 
-    sprintf(logBuffer, "Thread %d allocateFrameForPage(): There are %d frames remaining in free list\n", thread->threadId, freeList->numFreeFrames);
-    logData(logBuffer);
-    flushLog();
+void mapFrameToPage(const Thread *thread, uint32_t vpn, uint16_t frameNum) {
+    mapFrameToOwnerPage(thread->threadId, vpn, frameNum);
+}
 
-    // Mark the thread's page table entry as present
-    getThreadPageTable(thread->threadId)->entries[vpn].present = 1;
+void mapFrameToOwnerPage(uint8_t threadId, uint32_t vpn, uint16_t frameNum) {
+    FTEntry *entry = &frameTable->entries[frameNum];
+    PTEntry *pte = &getThreadPageTable(threadId)->entries[vpn];
 
-    // Unlock the entry
+    // Give the frame its owner, making it visible to eviction
+    pthread_mutex_lock(&entry->lock);
+    setFrameOwner(entry, threadId, vpn);     // unused 16 MSB will be trucated
     pthread_mutex_unlock(&entry->lock);
-    // Allocation complete so free list can be unlocked
-    pthread_mutex_unlock(&freeList->lock);
+    replacementPolicy->onAllocate(entry);
 
-    // Return that entry's frame number (i.e. its index into the frame table)
-    return entry->frameNum;
+    // Mark the thread's page table entry as present. A prefetch of the page
+    // still in progress must not map it again
+    pte->frameTblNum = frameNum;
+    pte->present = 1;
+    pte->writeProtected = 0;
+    pte->prefetching = 0;
 }
 
 #pragma endregion
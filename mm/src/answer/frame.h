@@ -2,8 +2,10 @@
 #define VIRTUALMEMFRAMEWORKC_FRAME_H
 
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include "thread.h"
+#include "page.h"
 #include "utils.h"
 
 #pragma region Frame Macros
@@ -11,6 +13,17 @@
 /* There are 1792 frame table entries, one for each physical frame able to be
    allocated */
 #define NUM_FRAME_TABLE_ENTRIES 1792
+/* Number of times eviction tries to lock a frame owner's page table before
+   moving on to another frame */
+#define EVICTION_LOCK_ATTEMPTS 16
+/* Index stored at the top of an empty free frame stack */
+#define FREE_STACK_EMPTY 0xFFFF
+/* Number of 64 bit words in a bitmap with one bit per frame */
+#define FRAME_BITMAP_WORDS (NUM_FRAME_TABLE_ENTRIES / 64)
+/* Number of free frames a thread can keep for itself */
+#define FRAME_MAGAZINE_SIZE 8
+/* Number of frames moved between a magazine and the free list at once */
+#define FRAME_MAGAZINE_BATCH (FRAME_MAGAZINE_SIZE / 2)
 
 #pragma endregion
 
@@ -18,27 +31,55 @@
 
 typedef struct FTEntry FTEntry;
 
+/**
+ * Defines what brought a frame's page into memory ahead of its first access.
+*/
+typedef enum PrefetchSource {
+    PREFETCH_NONE,        // The page was brought in by an access, or was accessed since
+    PREFETCH_READAHEAD,   // Read ahead of a sequential read fault
+    PREFETCH_STRIDE,      // Predicted from a stride repeated between faults
+    PREFETCH_CORRELATION, // Predicted from a sequence of strides seen before
+} PrefetchSource;
+
 /**
  * Defines a frame table entry implemented as a linked list node. Contains
- * the ThreadId of the thread whose page is written to the frame, that
- * thread's virtual page number, and the physical frame that the
- * virtual page is written to.
+ * the physical frame and the state only needed once a frame has been
+ * picked. The frame's owner, virtual page number and accessed bit live in
+ * the frame table's arrays, see frameOwner and frameAccessed.
 */
 struct FTEntry {
     pthread_mutex_t lock;      // Lock for the frame
-    uint8_t accessed;          // Accessed bit to indicate if the frame was accessed since last clock run
-    uint8_t ownerThreadId;     // The threadId of the owner thread
-    uint16_t virtualPageNum;   // The virtual page number associated with the frame
+    uint8_t dirty;             // Dirty bit to indicate if the frame was written since it was last swapped in
+    uint8_t prefetched;        // The PrefetchSource that brought the page in, until the page is accessed
     uint16_t frameNum;         // Number of the frame (its index in the frame table)
+    uint32_t lastUse;          // Owner's virtual time when the frame was last seen referenced
     uint8_t *physAddr;         // Pointer to the physical frame
     FTEntry *next;             // Next frame in the list
 };
 
 /**
- * Defines the frame table. Used for structuring system memory.
+ * Defines a thread's magazine, a small stack of free frames reserved for the
+ * thread so that most frame allocations do not touch the shared free list.
+ * Only used by the thread that owns it, so it needs no lock.
+*/
+typedef struct FrameMagazine {
+    uint16_t frames[FRAME_MAGAZINE_SIZE]; // Frame numbers of the reserved frames
+    uint8_t numFrames;                    // Number of frames in the magazine
+} FrameMagazine;
+
+/**
+ * Defines the frame table. Used for structuring system memory. The state
+ * victim searches read for every frame is kept in dense arrays indexed by
+ * frame number, so a sweep touches a few cache lines rather than one entry
+ * per frame. The owned bitmap mirrors ownerThreadIds for the same reason.
 */
 typedef struct FrameTable {
-    FTEntry entries[NUM_FRAME_TABLE_ENTRIES]; // All frame table entries
+    uint64_t accessedBitmap[FRAME_BITMAP_WORDS];         // Set if the frame was accessed since the hand last passed it
+    uint64_t ownedBitmap[FRAME_BITMAP_WORDS];            // Set if the frame has an owner
+    uint8_t ownerThreadIds[NUM_FRAME_TABLE_ENTRIES];     // The threadId of each frame's owner, 0 if it has none
+    uint16_t virtualPageNums[NUM_FRAME_TABLE_ENTRIES];   // The virtual page number mapped to each frame
+    FrameMagazine magazines[NUM_PAGE_TABLES];            // Each thread's magazine, indexed by threadId - 1
+    FTEntry entries[NUM_FRAME_TABLE_ENTRIES];            // All frame table entries
 } FrameTable;
 
 /**
@@ -53,21 +94,153 @@ typedef struct FreeList {
     uint16_t numFreeFrames; // Number of nodes in the free list
 } FreeList;
 
+/**
+ * Defines the ways free frames can be kept.
+*/
+typedef enum FreeFramePoolType {
+    FREE_POOL_LIST,        // The FreeList, guarded by a mutex
+    FREE_POOL_STACK,       // The FreeFrameStack, lock free
+    FREE_POOL_BUDDY,       // The BuddyAllocator, can hand out contiguous runs
+} FreeFramePoolType;
+
+/**
+ * Defines a lock free (Treiber) stack of free frames. The top word holds the
+ * number of the top frame in its low 16 bits and a version in its high 16
+ * bits. Every push and pop bumps the version, so a compare and swap fails if
+ * the top was popped and pushed back in between (the ABA problem).
+*/
+typedef struct FreeFrameStack {
+    uint32_t top;                            // Tagged top of the stack
+    int32_t numFreeFrames;                   // Number of frames in the stack, may briefly lag behind
+    uint16_t next[NUM_FRAME_TABLE_ENTRIES];  // Frame below each frame in the stack
+} FreeFrameStack;
+
 #pragma endregion
 
 #pragma region Frame FunctionDeclarations
 
 /**
  * Finds and evicts a frame from the allocatedFramesList. Will swap the frame
- * data to disk. Returns the frame number of the frame that was evicted.
+ * data to disk, writing it to its swap slot after every lock is dropped
+ * while its page waits in transit. Returns the frame number of the frame
+ * that was evicted, which is left for the caller to use or return to the
+ * free list.
+*/
+uint16_t evictAFrame(const Thread *thread);
+
+/**
+ * Returns the threadId of the frame's owner, or 0 if it has none. The owner
+ * can only change while the frame is locked, callers that do not hold the
+ * lock must check it again once they do.
+*/
+uint8_t frameOwner(FTEntry *entry);
+
+/**
+ * Returns the virtual page number mapped to the frame.
+*/
+uint16_t frameVirtualPageNum(FTEntry *entry);
+
+/**
+ * Gives the frame to the thread's virtual page, or takes it away from its
+ * owner if threadId is 0. The frame must be locked by the caller.
+*/
+void setFrameOwner(FTEntry *entry, uint8_t threadId, uint16_t vpn);
+
+/**
+ * Returns whether the frame's accessed bit is set.
+*/
+bool frameAccessed(FTEntry *entry);
+
+/**
+ * Sets the frame's accessed bit. Safe to call without any lock.
+*/
+void markFrameAccessed(FTEntry *entry);
+
+/**
+ * Clears the frame's accessed bit and returns whether it was set.
+*/
+bool clearFrameAccessed(FTEntry *entry);
+
+/**
+ * Clears the accessed bits of numFrames frames starting at firstFrame.
+*/
+void clearFramesAccessed(uint16_t firstFrame, uint16_t numFrames);
+
+/**
+ * Locks the frame's owner's page table and then the frame, as eviction
+ * requires, followed by the page tables of any other pages sharing the
+ * frame and the region of a shared page. Returns false without holding any
+ * of the locks if the frame has no owner, if its page is being written back,
+ * if a sharer's page table or the region is busy, or if its owner's page table stays busy and waitForOwner
+ * is false. Callers holding a lock that
+ * accessors may take under their page table must not wait.
+*/
+bool lockEvictionCandidate(FTEntry *entry, bool waitForOwner);
+
+/**
+ * Unlocks a frame locked by lockEvictionCandidate along with the page tables
+ * and region it took.
+*/
+void unlockEvictionCandidate(FTEntry *entry);
+
+/**
+ * Places an unused frame back in the pool of free frames.
+*/
+void returnFrameToFreeList(FTEntry *entry);
+
+/**
+ * Removes a frame from the pool of free frames and returns it, or returns
+ * NULL if there are none.
+*/
+FTEntry* takeFrameFromFreeList();
+
+/**
+ * Returns the number of frames in the pool of free frames.
 */
-uint16_t evictAFrame(Thread *thread);
+uint16_t countFreeFrames();
 
 /**
- * Allocates a frame for the page and returns that frame's frame number.
+ * Places an unused frame in the thread's magazine, moving a batch of frames
+ * from the magazine to the free list first if it is full.
 */
-uint16_t allocateFrameForPage(Thread *thread, uint32_t vpn);
+void releaseFrame(const Thread *thread, FTEntry *entry);
+
+/**
+ * Returns every frame in the thread's magazine to the free list.
+*/
+void drainFrameMagazine(const Thread *thread);
+
+/**
+ * Allocates a frame for the page and returns that frame's frame number. The
+ * frame is not mapped to the page (and cannot be evicted) until
+ * mapFrameToPage is called.
+*/
+uint16_t allocateFrameForPage(const Thread *thread, uint32_t vpn);
+
+/**
+ * Allocates a run of 2^order physically contiguous frames for the thread's
+ * pages and returns the first frame's number, or BUDDY_NONE if the pool of
+ * free frames has no such run (or cannot hand out runs at all). Like
+ * allocateFrameForPage, the frames are not mapped to any page.
+*/
+uint16_t allocateFrameRunForPages(const Thread *thread, uint8_t order);
+
+/**
+ * Maps an allocated frame to the thread's page and marks the page as present.
+ * The thread's page table must be locked by the caller.
+*/
+void mapFrameToPage(const Thread *thread, uint32_t vpn, uint16_t frameNum);
+
+/**
+ * Like mapFrameToPage, but for a page of the thread with the given threadId.
+ * Lets a background thread map a frame on behalf of the page's owner.
+*/
+void mapFrameToOwnerPage(uint8_t threadId, uint32_t vpn, uint16_t frameNum);
 
 #pragma endregion
 
+/* The pool free frames are kept in. Only change it while the system is shut
+   down, since frames are not moved between pools */
+extern FreeFramePoolType freeFramePoolType;
+
 #endif //VIRTUALMEMFRAMEWORKC_FRAME_H
\ No newline at end of file
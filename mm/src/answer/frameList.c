@@ -0,0 +1,56 @@
+#include "frameList.h"
+
+extern FrameTable *frameTable;
+
+#pragma region FrameList Functions
+
+void initFrameList(FrameList *list) {
+    for (int i = 0; i < NUM_FRAME_TABLE_ENTRIES; i++) {
+        list->linked[i] = false;
+    }
+    list->head = FRAME_LIST_END;
+    list->tail = FRAME_LIST_END;
+    list->size = 0;
+}
+
+void appendToFrameList(FrameList *list, uint16_t frameNum) {
+    list->prev[frameNum] = list->tail;
+    list->next[frameNum] = FRAME_LIST_END;
+    if (list->tail == FRAME_LIST_END) {
+        list->head = frameNum;
+    } else {
+        list->next[list->tail] = frameNum;
+    }
+    list->tail = frameNum;
+    list->linked[frameNum] = true;
+    list->size++;
+}
+
+void removeFromFrameList(FrameList *list, uint16_t frameNum) {
+    if (!list->linked[frameNum]) {
+        return;
+    }
+    if (list->prev[frameNum] == FRAME_LIST_END) {
+        list->head = list->next[frameNum];
+    } else {
+        list->next[list->prev[frameNum]] = list->next[frameNum];
+    }
+    if (list->next[frameNum] == FRAME_LIST_END) {
+        list->tail = list->prev[frameNum];
+    } else {
+        list->prev[list->next[frameNum]] = list->prev[frameNum];
+    }
+    list->linked[frameNum] = false;
+    list->size--;
+}
+
+FTEntry* lockFirstEvictableFrame(FrameList *list) {
+    for (uint16_t frameNum = list->head; frameNum != FRAME_LIST_END; frameNum = list->next[frameNum]) {
+        if (lockEvictionCandidate(&frameTable->entries[frameNum], false)) {
+            return &frameTable->entries[frameNum];
+        }
+    }
+    return NULL;
+}
+
+#pragma endregion
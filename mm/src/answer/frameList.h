@@ -0,0 +1,58 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FRAMELIST_H
+#define VIRTUALMEMFRAMEWORKC_FRAMELIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "frame.h"
+
+#pragma region FrameList Macros
+
+/* Marks the end of a frame list */
+#define FRAME_LIST_END 0xFFFF
+
+#pragma endregion
+
+#pragma region FrameList Structs
+
+/**
+ * Defines a doubly linked list of frame numbers, used by replacement policies
+ * to order frames. Links are stored in arrays indexed by frame number so a
+ * frame can be found and unlinked in constant time. Not thread safe.
+*/
+typedef struct FrameList {
+    uint16_t prev[NUM_FRAME_TABLE_ENTRIES]; // Previous frame in the list for each frame
+    uint16_t next[NUM_FRAME_TABLE_ENTRIES]; // Next frame in the list for each frame
+    bool linked[NUM_FRAME_TABLE_ENTRIES];   // Whether each frame is in the list
+    uint16_t head;                          // First frame in the list
+    uint16_t tail;                          // Last frame in the list
+    uint16_t size;                          // Number of frames in the list
+} FrameList;
+
+#pragma endregion
+
+#pragma region FrameList FunctionDeclarations
+
+/**
+ * Empties the list.
+*/
+void initFrameList(FrameList *list);
+
+/**
+ * Adds the frame to the end of the list. The frame must not be in the list.
+*/
+void appendToFrameList(FrameList *list, uint16_t frameNum);
+
+/**
+ * Removes the frame from the list if it is in it.
+*/
+void removeFromFrameList(FrameList *list, uint16_t frameNum);
+
+/**
+ * Walks the list from its head and returns the first frame that could be
+ * locked with lockEvictionCandidate, or NULL if none could be.
+*/
+FTEntry* lockFirstEvictableFrame(FrameList *list);
+
+#pragma endregion
+
+#endif //VIRTUALMEMFRAMEWORKC_FRAMELIST_H
@@ -0,0 +1,165 @@
+#include "frameScan.h"
+#include "utils.h"
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FRAME_SCAN_X86
+#endif
+
+extern const int PAGE_SIZE;
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+/* Bytes of a frame checked between early exits of isFrameZero */
+#define ZERO_CHECK_BLOCK 128
+
+FrameScanType frameScanType = FRAME_SCAN_SCALAR;
+
+static const char *frameScanNames[NUM_FRAME_SCAN_TYPES] = {
+    [FRAME_SCAN_SCALAR] = "scalar",
+    [FRAME_SCAN_SSE2] = "SSE2",
+    [FRAME_SCAN_AVX2] = "AVX2",
+};
+
+#pragma region Frame Scan Functions
+
+static bool findEvictionCandidatesScalar(const uint64_t *accessed, const uint64_t *owned, uint64_t *candidates) {
+    uint64_t found = 0;
+    for (int i = 0; i < FRAME_SCAN_WORDS; i++) {
+        candidates[i] = __atomic_load_n(&owned[i], __ATOMIC_RELAXED) & ~__atomic_load_n(&accessed[i], __ATOMIC_RELAXED);
+        found |= candidates[i];
+    }
+    return found != 0;
+}
+
+#ifdef FRAME_SCAN_X86
+
+// The vector loads are not atomic, but every word is read whole, so a frame
+// can only be seen just before or just after a concurrent update
+
+__attribute__((target("sse2")))
+static bool findEvictionCandidatesSse2(const uint64_t *accessed, const uint64_t *owned, uint64_t *candidates) {
+    __m128i found = _mm_setzero_si128();
+    for (int i = 0; i < FRAME_SCAN_WORDS; i += 2) {
+        __m128i group = _mm_andnot_si128(_mm_loadu_si128((const __m128i *)&accessed[i]),
+                                         _mm_loadu_si128((const __m128i *)&owned[i]));
+        _mm_storeu_si128((__m128i *)&candidates[i], group);
+        found = _mm_or_si128(found, group);
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(found, _mm_setzero_si128())) != 0xFFFF;
+}
+
+__attribute__((target("avx2")))
+static bool findEvictionCandidatesAvx2(const uint64_t *accessed, const uint64_t *owned, uint64_t *candidates) {
+    __m256i group = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i *)accessed),
+                                        _mm256_loadu_si256((const __m256i *)owned));
+    _mm256_storeu_si256((__m256i *)candidates, group);
+    return !_mm256_testz_si256(group, group);
+}
+
+#endif
+
+static bool isFrameZeroScalar(const uint8_t *physAddr) {
+    const uint64_t *words = (const uint64_t *)physAddr;
+    for (int block = 0; block < PAGE_SIZE / 8; block += ZERO_CHECK_BLOCK / 8) {
+        uint64_t bits = 0;
+        for (int i = 0; i < ZERO_CHECK_BLOCK / 8; i++) {
+            bits |= words[block + i];
+        }
+        if (bits != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef FRAME_SCAN_X86
+
+__attribute__((target("sse2")))
+static bool isFrameZeroSse2(const uint8_t *physAddr) {
+    for (int block = 0; block < PAGE_SIZE; block += ZERO_CHECK_BLOCK) {
+        __m128i bits = _mm_setzero_si128();
+        for (int i = 0; i < ZERO_CHECK_BLOCK; i += 16) {
+            bits = _mm_or_si128(bits, _mm_loadu_si128((const __m128i *)&physAddr[block + i]));
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128())) != 0xFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+__attribute__((target("avx2")))
+static bool isFrameZeroAvx2(const uint8_t *physAddr) {
+    for (int block = 0; block < PAGE_SIZE; block += ZERO_CHECK_BLOCK) {
+        __m256i bits = _mm256_setzero_si256();
+        for (int i = 0; i < ZERO_CHECK_BLOCK; i += 32) {
+            bits = _mm256_or_si256(bits, _mm256_loadu_si256((const __m256i *)&physAddr[block + i]));
+        }
+        if (!_mm256_testz_si256(bits, bits)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
+
+bool isFrameZero(const uint8_t *physAddr) {
+    switch (frameScanType) {
+#ifdef FRAME_SCAN_X86
+    case FRAME_SCAN_AVX2:
+        return isFrameZeroAvx2(physAddr);
+    case FRAME_SCAN_SSE2:
+        return isFrameZeroSse2(physAddr);
+#endif
+    default:
+        return isFrameZeroScalar(physAddr);
+    }
+}
+
+bool findEvictionCandidates(const uint64_t *accessed, const uint64_t *owned, uint64_t *candidates) {
+    switch (frameScanType) {
+#ifdef FRAME_SCAN_X86
+    case FRAME_SCAN_AVX2:
+        return findEvictionCandidatesAvx2(accessed, owned, candidates);
+    case FRAME_SCAN_SSE2:
+        return findEvictionCandidatesSse2(accessed, owned, candidates);
+#endif
+    default:
+        return findEvictionCandidatesScalar(accessed, owned, candidates);
+    }
+}
+
+bool frameScanSupported(FrameScanType type) {
+    switch (type) {
+    case FRAME_SCAN_SCALAR:
+        return true;
+#ifdef FRAME_SCAN_X86
+    case FRAME_SCAN_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case FRAME_SCAN_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+void initializeFrameScan() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    frameScanType = FRAME_SCAN_SCALAR;
+    for (int type = NUM_FRAME_SCAN_TYPES - 1; type > FRAME_SCAN_SCALAR; type--) {
+        if (frameScanSupported(type)) {
+            frameScanType = type;
+            break;
+        }
+    }
+
+    sprintf(logBuffer, "Using %s frame scan\n", frameScanNames[frameScanType]);
+    logData(logBuffer);
+    flushLog();
+}
+
+#pragma endregion
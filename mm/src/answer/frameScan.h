@@ -0,0 +1,61 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FRAMESCAN_H
+#define VIRTUALMEMFRAMEWORKC_FRAMESCAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#pragma region Frame Scan Macros
+
+/* Number of frames examined by one candidate scan, one AVX2 register of bits */
+#define FRAME_SCAN_WIDTH 256
+/* Number of bitmap words examined by one candidate scan */
+#define FRAME_SCAN_WORDS (FRAME_SCAN_WIDTH / 64)
+
+#pragma endregion
+
+#pragma region Frame Scan Structs
+
+/**
+ * Defines the ways a group of frames can be scanned for eviction candidates,
+ * or a frame for non-zero bytes.
+*/
+typedef enum FrameScanType {
+    FRAME_SCAN_SCALAR,     // One 64 bit word at a time
+    FRAME_SCAN_SSE2,       // Two 128 bit registers
+    FRAME_SCAN_AVX2,       // One 256 bit register
+    NUM_FRAME_SCAN_TYPES
+} FrameScanType;
+
+#pragma endregion
+
+#pragma region Frame Scan FunctionDeclarations
+
+/**
+ * Sets a bit in candidates for every frame in a group of FRAME_SCAN_WIDTH
+ * frames that is owned but has not been accessed, and returns whether any
+ * was found. The bitmaps may change during the scan, so a candidate must be
+ * checked again once it is locked.
+*/
+bool findEvictionCandidates(const uint64_t *accessed, const uint64_t *owned, uint64_t *candidates);
+
+/**
+ * Returns whether every byte of the page sized frame at physAddr is zero.
+*/
+bool isFrameZero(const uint8_t *physAddr);
+
+/**
+ * Returns whether the processor can run the given kind of scan.
+*/
+bool frameScanSupported(FrameScanType type);
+
+/**
+ * Selects the widest scan the processor supports.
+*/
+void initializeFrameScan();
+
+#pragma endregion
+
+/* The scan findEvictionCandidates and isFrameZero use, set by initializeFrameScan */
+extern FrameScanType frameScanType;
+
+#endif //VIRTUALMEMFRAMEWORKC_FRAMESCAN_H
@@ -0,0 +1,58 @@
+#include "policy.h"
+#include "frameList.h"
+#include <pthread.h>
+
+/* Mapped frames from least to most recently used */
+static FrameList lruList;
+static pthread_mutex_t lruLock = PTHREAD_MUTEX_INITIALIZER;
+
+#pragma region LRU Policy
+
+static void lruInit() {
+    initFrameList(&lruList);
+}
+
+static void lruOnAllocate(FTEntry *entry) {
+    pthread_mutex_lock(&lruLock);
+    removeFromFrameList(&lruList, entry->frameNum);
+    appendToFrameList(&lruList, entry->frameNum);
+    pthread_mutex_unlock(&lruLock);
+}
+
+static void lruOnAccess(FTEntry *entry) {
+    // Move the frame to the most recently used end
+    pthread_mutex_lock(&lruLock);
+    if (lruList.tail != entry->frameNum) {
+        removeFromFrameList(&lruList, entry->frameNum);
+        appendToFrameList(&lruList, entry->frameNum);
+    }
+    pthread_mutex_unlock(&lruLock);
+}
+
+static void lruOnEvict(FTEntry *entry) {
+    pthread_mutex_lock(&lruLock);
+    removeFromFrameList(&lruList, entry->frameNum);
+    pthread_mutex_unlock(&lruLock);
+}
+
+static FTEntry* lruPickVictim() {
+    FTEntry *victim = NULL;
+    // Retry until the owner of some frame is not busy
+    while (victim == NULL) {
+        pthread_mutex_lock(&lruLock);
+        victim = lockFirstEvictableFrame(&lruList);
+        pthread_mutex_unlock(&lruLock);
+    }
+    return victim;
+}
+
+const ReplacementPolicy lruPolicy = {
+    .name = "lru",
+    .init = lruInit,
+    .onAllocate = lruOnAllocate,
+    .onAccess = lruOnAccess,
+    .onEvict = lruOnEvict,
+    .pickVictim = lruPickVictim,
+};
+
+#pragma endregion
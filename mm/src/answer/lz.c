@@ -0,0 +1,248 @@
+#include "lz.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Number of bytes at the end of the input that are always literals, so the
+   match search can read 4 bytes ahead without bounds checks */
+#define LZ_LAST_LITERALS 5
+/* Matches must start this many bytes before the end of the input */
+#define LZ_MATCH_SEARCH_END 12
+/* Value of a token's length field meaning more length bytes follow */
+#define LZ_LENGTH_MORE 15
+/* Short runs of literals are copied as a fixed number of bytes when there is
+   room, which is much quicker than a copy of the exact length */
+#define LZ_LITERAL_COPY 16
+/* Matches are copied in steps of this many bytes when there is room */
+#define LZ_MATCH_COPY 8
+
+#pragma region LZ Helper Functions
+
+/**
+ * Reads 4 bytes that may not be aligned.
+*/
+static uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * Reads 8 bytes that may not be aligned.
+*/
+static uint64_t read64(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * Copies numBytes bytes, or LZ_LITERAL_COPY bytes if that is more and both
+ * buffers have room for them.
+*/
+static void copyLiterals(uint8_t *dst, size_t dstRoom, const uint8_t *src, size_t srcRoom, size_t numBytes) {
+    if (numBytes <= LZ_LITERAL_COPY && dstRoom >= LZ_LITERAL_COPY && srcRoom >= LZ_LITERAL_COPY) {
+        memcpy(dst, src, LZ_LITERAL_COPY);
+    } else {
+        memcpy(dst, src, numBytes);
+    }
+}
+
+/**
+ * Hashes the 4 bytes at a position to an index in the match table.
+*/
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * Writes the part of a length that did not fit in its token: bytes of 255
+ * followed by the remainder. Returns the new output position, or NULL if the
+ * output is full.
+*/
+static uint8_t* writeLength(uint8_t *op, uint8_t *oend, size_t length) {
+    length -= LZ_LENGTH_MORE;
+    for (; length >= 255; length -= 255) {
+        if (op >= oend) {
+            return NULL;
+        }
+        *op++ = 255;
+    }
+    if (op >= oend) {
+        return NULL;
+    }
+    *op++ = length;
+    return op;
+}
+
+/**
+ * Reads the length bytes written by writeLength and adds them to length.
+ * Returns false if the input ends first.
+*/
+static bool readLength(const uint8_t **ip, const uint8_t *iend, size_t *length) {
+    uint8_t byte;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/**
+ * Writes a sequence of numLiterals literals followed by a match of
+ * matchLength bytes at the given offset back, or by nothing if matchLength is
+ * 0. The input ends at end. Returns the new output position, or NULL if the
+ * output is full.
+*/
+static uint8_t* writeSequence(uint8_t *op, uint8_t *oend, const uint8_t *literals, const uint8_t *end,
+                              size_t numLiterals, size_t offset, size_t matchLength) {
+    if (op >= oend) {
+        return NULL;
+    }
+    uint8_t *token = op++;
+    *token = (numLiterals < LZ_LENGTH_MORE ? numLiterals : LZ_LENGTH_MORE) << 4;
+    if (numLiterals >= LZ_LENGTH_MORE && (op = writeLength(op, oend, numLiterals)) == NULL) {
+        return NULL;
+    }
+    if ((size_t)(oend - op) < numLiterals) {
+        return NULL;
+    }
+    copyLiterals(op, oend - op, literals, end - literals, numLiterals);
+    op += numLiterals;
+    if (matchLength == 0) {
+        return op;
+    }
+    if (oend - op < 2) {
+        return NULL;
+    }
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    size_t extraLength = matchLength - LZ_MIN_MATCH;
+    *token |= extraLength < LZ_LENGTH_MORE ? extraLength : LZ_LENGTH_MORE;
+    if (extraLength >= LZ_LENGTH_MORE && (op = writeLength(op, oend, extraLength)) == NULL) {
+        return NULL;
+    }
+    return op;
+}
+
+#pragma endregion
+
+#pragma region LZ Functions
+
+int lzCompress(const uint8_t *src, int srcSize, uint8_t *dst, int dstCapacity) {
+    // Position of the last place each hash was seen, 0 doubles as "never"
+    // since a match at the current position is rejected anyway
+    uint16_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + srcSize;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dstCapacity;
+
+    if (srcSize >= LZ_MATCH_SEARCH_END) {
+        const uint8_t *matchLimit = end - LZ_LAST_LITERALS;
+        const uint8_t *searchLimit = end - LZ_MATCH_SEARCH_END;
+        while (ip < searchLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t hash = hashSequence(sequence);
+            const uint8_t *candidate = src + table[hash];
+            table[hash] = ip - src;
+            if (candidate >= ip || read32(candidate) != sequence) {
+                // Step further the longer nothing has matched, so data that
+                // does not compress is passed over quickly
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            // Grow the match backwards over literals and then forwards
+            while (ip > anchor && candidate > src && ip[-1] == candidate[-1]) {
+                ip--;
+                candidate--;
+            }
+            const uint8_t *matchEnd = ip + LZ_MIN_MATCH;
+            while (matchEnd + sizeof(uint64_t) <= matchLimit) {
+                uint64_t difference = read64(matchEnd) ^ read64(candidate + (matchEnd - ip));
+                if (difference != 0) {
+                    matchEnd += __builtin_ctzll(difference) / 8;
+                    break;
+                }
+                matchEnd += sizeof(uint64_t);
+            }
+            if (matchEnd + sizeof(uint64_t) > matchLimit) {
+                while (matchEnd < matchLimit && *matchEnd == candidate[matchEnd - ip]) {
+                    matchEnd++;
+                }
+            }
+            op = writeSequence(op, oend, anchor, end, ip - anchor, ip - candidate, matchEnd - ip);
+            if (op == NULL) {
+                return 0;
+            }
+            ip = anchor = matchEnd;
+        }
+    }
+    // Whatever is left after the last match is written as literals
+    op = writeSequence(op, oend, anchor, end, end - anchor, 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+    return op - dst;
+}
+
+int lzDecompress(const uint8_t *src, int srcSize, uint8_t *dst, int dstCapacity) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + srcSize;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dstCapacity;
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t numLiterals = token >> 4;
+        if (numLiterals == LZ_LENGTH_MORE && !readLength(&ip, iend, &numLiterals)) {
+            return -1;
+        }
+        if ((size_t)(iend - ip) < numLiterals || (size_t)(oend - op) < numLiterals) {
+            return -1;
+        }
+        copyLiterals(op, oend - op, ip, iend - ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+        // Only the last sequence ends without a match
+        if (ip == iend) {
+            break;
+        }
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLength = token & 0x0F;
+        if (matchLength == LZ_LENGTH_MORE && !readLength(&ip, iend, &matchLength)) {
+            return -1;
+        }
+        matchLength += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(oend - op) < matchLength) {
+            return -1;
+        }
+        const uint8_t *match = op - offset;
+        if (offset >= LZ_MATCH_COPY && (size_t)(oend - op) >= matchLength + LZ_MATCH_COPY) {
+            // Each step only reads bytes written before it, and anything
+            // written past the match is overwritten by what follows
+            for (size_t i = 0; i < matchLength; i += LZ_MATCH_COPY) {
+                memcpy(op + i, match + i, LZ_MATCH_COPY);
+            }
+        } else if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+        } else {
+            // The match overlaps the bytes it produces, so it repeats them
+            for (size_t i = 0; i < matchLength; i++) {
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+    return op - dst;
+}
+
+#pragma endregion
@@ -0,0 +1,39 @@
+#ifndef VIRTUALMEMFRAMEWORKC_LZ_H
+#define VIRTUALMEMFRAMEWORKC_LZ_H
+
+#include <stdint.h>
+
+#pragma region LZ Macros
+
+/* Shortest repeat that is encoded as a match rather than as literals */
+#define LZ_MIN_MATCH 4
+/* Number of bits of the hash used to find earlier repeats */
+#define LZ_HASH_BITS 12
+/* Largest input that can be compressed, matches reach back at most 64 KiB */
+#define LZ_MAX_INPUT (64 * 1024)
+
+#pragma endregion
+
+#pragma region LZ FunctionDeclarations
+
+/**
+ * Compresses srcSize bytes into dst with a fast LZ77 compressor in the style
+ * of LZ4. The output is a series of sequences, each a token holding the
+ * number of literals and the match length, the literals, and a 16 bit
+ * offset back to the match. The last sequence has literals only. Returns the
+ * compressed size, or 0 if it would not fit in dstCapacity bytes. srcSize
+ * must be at most LZ_MAX_INPUT.
+*/
+int lzCompress(const uint8_t *src, int srcSize, uint8_t *dst, int dstCapacity);
+
+/**
+ * Decompresses srcSize bytes produced by lzCompress into dst. Returns the
+ * decompressed size, or -1 if the input is malformed or would not fit in
+ * dstCapacity bytes. Bytes of dst past the decompressed size may be
+ * overwritten.
+*/
+int lzDecompress(const uint8_t *src, int srcSize, uint8_t *dst, int dstCapacity);
+
+#pragma endregion
+
+#endif //VIRTUALMEMFRAMEWORKC_LZ_H
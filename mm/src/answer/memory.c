@@ -1,5 +1,10 @@
 #include "memory.h"
 #include "utils.h"
+#include "policy.h"
+#include "frameScan.h"
+#include "stats.h"
+#include "readahead.h"
+#include "prefetch.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -26,14 +31,95 @@ unsigned char SYSTEM_MEMORY[8*1024*1024];
 PageDirectory *directory;
 /* Pointer to the free list located in kernel space (64 bytes) */
 FreeList *freeList;
+FreeFrameStack *freeFrameStack;
+/* Pointer to the buddy allocator located in kernel space */
+BuddyAllocator *buddyAllocator;
 /* Pointer to the frame table containing the frame table entries (114688 bytes) */
 FrameTable *frameTable;
+/* Pointer to the swap device located in kernel space (64584 bytes) */
+SwapDevice *swapDevice;
+/* Pointer to the shared zero frame located in kernel space, read by pages
+   that were never written. Never written to */
+uint8_t *zeroFrame;
+/* Pointer to the compressed pool located in kernel space (363576 bytes) */
+CompressedPool *compressedPool;
+/* Pointer to the reverse map from frames to the pages sharing them located
+   in kernel space (52784 bytes) */
+ReverseMap *reverseMap;
+/* Pointer to the shared region table located in kernel space (15536 bytes) */
+SharedRegionTable *sharedRegionTable;
 /* Pointer to the beginning of user space */
 uint8_t *userSpace;
 
 // Max log buffer size
 extern const int MAX_BUFFER_SIZE;
 
+// All kernel structures must fit below user space (1M)
+_Static_assert(SHARED_REGION_TABLE_OFFSET + sizeof(SharedRegionTable) <= 1024 * 1024, "Kernel structures overflow into user space");
+
+#pragma endregion
+
+#pragma region Frame Run Functions
+
+/**
+ * Returns the number of pages from vpn on that an access covering spanBytes
+ * from the start of that page touches and that are not present, stopping at
+ * the first present page, page of a shared region or page in transit, which
+ * are brought in on their own. The thread's page table must be locked by the caller.
+*/
+static int countMissingPages(PageTable *pageTable, uint32_t vpn, uint32_t spanBytes) {
+    uint32_t numMissing = 0;
+    while (numMissing * PAGE_SIZE < spanBytes && vpn + numMissing < NUM_PAGE_TABLE_ENTRIES
+           && pageTable->entries[vpn + numMissing].present == 0 && !pageTable->entries[vpn + numMissing].sharedRegion
+           && !pageTable->entries[vpn + numMissing].inTransit) {
+        numMissing++;
+    }
+    return numMissing;
+}
+
+/**
+ * Locks the frame mapped to the page at vpn and, for an access that covers
+ * spanBytes from the start of that page, the frames after it for as long as
+ * they hold the pages after vpn. The access can then be copied in one go.
+ * Each page added counts as a reference by the thread, and is reported to
+ * the replacement policy unless it is one of the first numFaulted pages,
+ * which were just faulted in. A write stops at the first page sharing its
+ * frame, which must be copied before it is written, at the first page being
+ * written back and at the first page of a file mapped read only. Returns the number of frames locked.
+ * The page must be present and the thread's page table locked by the caller.
+*/
+static int lockFrameRun(uint8_t threadId, PageTable *pageTable, uint32_t vpn, uint32_t spanBytes, uint32_t numFaulted, bool forWrite) {
+    uint16_t firstFrame = pageTable->entries[vpn].frameTblNum;
+    uint32_t runFrames = 1;
+    while (runFrames * PAGE_SIZE < spanBytes && vpn + runFrames < NUM_PAGE_TABLE_ENTRIES) {
+        PTEntry *pte = &pageTable->entries[vpn + runFrames];
+        if (pte->present == 0 || pte->frameTblNum != firstFrame + runFrames
+            || (forWrite && (pte->writeProtected || pte->inTransit || sharedPageReadOnly(pte)))) {
+            break;
+        }
+        __atomic_add_fetch(&pageTable->virtualTime, 1, __ATOMIC_RELAXED);
+        if (runFrames >= numFaulted && replacementPolicy->onAccess != NULL) {
+            replacementPolicy->onAccess(&frameTable->entries[pte->frameTblNum]);
+        }
+        runFrames++;
+    }
+    // Frames are always locked in increasing order
+    for (uint32_t i = 0; i < runFrames; i++) {
+        pthread_mutex_lock(&frameTable->entries[firstFrame + i].lock);
+        notePrefetchAccess(threadId, vpn + i, &frameTable->entries[firstFrame + i]);
+    }
+    return runFrames;
+}
+
+/**
+ * Unlocks the frames locked by lockFrameRun.
+*/
+static void unlockFrameRun(FTEntry *firstEntry, int runFrames) {
+    for (int i = runFrames - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&firstEntry[i].lock);
+    }
+}
+
 #pragma endregion
 
 #pragma region API
@@ -105,6 +191,7 @@ void writeToAddr(const Thread *thread, int addr, int size, const void* data) {
     uint32_t dataOffset = 0;
     size_t bytesToWrite;
     uint16_t frameOffset;
+    int runFrames;
     uint8_t *physicalAddr;
     PTEntry *pte;
     int leftToWrite = size;
@@ -116,39 +203,82 @@ void writeToAddr(const Thread *thread, int addr, int size, const void* data) {
         sprintf(logBuffer, "Thread %d writeToAddr(): Fetched vpn %d for addr %d\n", thread->threadId, vpn, currentAddr);
         logData(logBuffer);
         flushLog();
+        // A file mapped read only cannot be written back, so it cannot be
+        // written to at all
+        if (sharedPageReadOnly(pte)) {
+            sprintf(logBuffer, "Thread %d writeToAddr(): Write to read only mapped file at addr %d\n", thread->threadId, currentAddr);
+            logData(logBuffer);
+            flushLog();
+            kernelPanic(thread, currentAddr);
+            return;
+        }
 
         // Lock the thread's page table while in use
         pthread_mutex_lock(&pageTable->lock);
-        // If the frame is not present in memory swap it back
-        while (pte->present == 0) {
+        // If the frame is not present in memory swap it back, and if it is
+        // shared with other pages give the page a copy of its own. A page
+        // being written out, even one still in memory, is only written to
+        // once it is in its slot
+        int numFaulted = 0;
+        while (pte->present == 0 || pte->writeProtected || pte->inTransit) {
+            if (pte->inTransit) {
+                waitForPageTransit(pageTable, vpn);
+                continue;
+            }
+            if (pte->present != 0) {
+                sprintf(logBuffer, "Thread %d writeToAddr(): Copy-on-write fault for vpn %d\n", thread->threadId, vpn);
+                logData(logBuffer);
+                flushLog();
+                pthread_mutex_unlock(&pageTable->lock);
+                if (handleCopyOnWriteFault(thread, vpn) && numFaulted == 0) {
+                    numFaulted = 1;
+                }
+                pthread_mutex_lock(&pageTable->lock);
+                continue;
+            }
             sprintf(logBuffer, "Thread %d writeToAddr(): Page fault for vpn %d\n", thread->threadId, vpn);
             logData(logBuffer);
             flushLog();
 
+            // Bring in the pages after it that are written and missing too
+            int numMissing = countMissingPages(pageTable, vpn, (currentAddr & OFFSET_MASK) + leftToWrite);
+            // Start prefetching the pages expected to fault after it
+            predictPageFaults(thread, vpn);
             // unlock the thread's page table
             pthread_mutex_unlock(&pageTable->lock);
 
-            // Allocate a frame for the page
-            pte->frameTblNum = allocateFrameForPage(thread, vpn);
-            // Swap the frame back into memory
-            swapPageFromDisk(thread, vpn, pte->frameTblNum);
+            // Bring the pages into memory, in one contiguous run if possible
+            if (numMissing > 1) {
+                numFaulted = handlePageRunFault(thread, vpn, numMissing);
+            } else {
+                handlePageFault(thread, vpn);
+                numFaulted = 1;
+            }
 
             // Lock the thread's page table while in use
             pthread_mutex_lock(&pageTable->lock);
         }
+        // Every reference advances the thread's virtual time
+        __atomic_add_fetch(&pageTable->virtualTime, 1, __ATOMIC_RELAXED);
         // Fetch the frame table entry
         fte = &frameTable->entries[pte->frameTblNum];
-        // Lock the frame
-        pthread_mutex_lock(&fte->lock);
-        sprintf(logBuffer, "Thread %d writeToAddr(): Fetching frame %d at addr %p for vpn %d\n", thread->threadId, fte->frameNum, fte->physAddr, vpn);
+        // Let the replacement policy know the frame was referenced again. A
+        // page just faulted in was already reported by mapFrameToPage
+        if (numFaulted == 0 && replacementPolicy->onAccess != NULL) {
+            replacementPolicy->onAccess(fte);
+        }
+        // Get offset
+        frameOffset = currentAddr & OFFSET_MASK;
+        // Lock the frame, along with the frames right after it that hold the
+        // next pages written
+        runFrames = lockFrameRun(thread->threadId, pageTable, vpn, frameOffset + leftToWrite, numFaulted, true);
+        sprintf(logBuffer, "Thread %d writeToAddr(): Fetching %d frames from frame %d at addr %p for vpn %d\n", thread->threadId, runFrames, fte->frameNum, fte->physAddr, vpn);
         logData(logBuffer);
         flushLog();
 
-        // Get offset
-        frameOffset = currentAddr & OFFSET_MASK;
-        // Get the amount of bytes that will be written to this frame
-        if (leftToWrite > PAGE_SIZE - frameOffset) {
-            bytesToWrite = PAGE_SIZE - frameOffset;    
+        // Get the amount of bytes that will be written to these frames
+        if (leftToWrite > runFrames * PAGE_SIZE - frameOffset) {
+            bytesToWrite = runFrames * PAGE_SIZE - frameOffset;
         } else {
             bytesToWrite = leftToWrite;
         }
@@ -162,13 +292,17 @@ void writeToAddr(const Thread *thread, int addr, int size, const void* data) {
         sprintf(logBuffer, "Thread %d writeToAddr(): Writing %ld bytes from data into %p\n", thread->threadId, bytesToWrite, physicalAddr);
         logData(logBuffer);
         flushLog();
-        // Write to the frame
+        // Write to the frames, which are contiguous in physical memory
         memcpy(physicalAddr, data + dataOffset, bytesToWrite);
+        // Mark the frames as modified so their swap slots are rewritten on eviction
+        for (int i = 0; i < runFrames; i++) {
+            fte[i].dirty = 1;
+        }
         leftToWrite -= bytesToWrite;
         dataOffset += bytesToWrite;
         currentAddr += bytesToWrite;
-        // Unlock the frame
-        pthread_mutex_unlock(&fte->lock);
+        // Unlock the frames
+        unlockFrameRun(fte, runFrames);
         // unlock the thread's page table
         pthread_mutex_unlock(&pageTable->lock);
     }
@@ -196,9 +330,10 @@ void readFromAddr(Thread *thread, int addr, int size, void* outData) {
     FTEntry *fte;
     int vpn;
     uint32_t currentAddr = addr;
-    uint32_t frameOffset;
+    uint16_t frameOffset;
     uint32_t dataOffset = 0;
     size_t bytesToRead;
+    int runFrames;
     uint8_t *physicalAddr;
     PTEntry *pte;
     int leftToRead = size;
@@ -213,35 +348,70 @@ void readFromAddr(Thread *thread, int addr, int size, void* outData) {
 
         // Lock the thread's page table while in use
         pthread_mutex_lock(&pageTable->lock);
+        // Get offset
+        frameOffset = currentAddr & OFFSET_MASK;
+        // A page that was never written, or was all zeros when it was
+        // swapped out, has no frame. Read it from the zero frame instead of
+        // allocating one. A page of a shared region may be in memory for
+        // another mapping, so it is always faulted in
+        if (pte->present == 0 && !pte->sharedRegion && (pte->swapSlot == SWAP_SLOT_NONE || pte->swapSlot == SWAP_SLOT_ZERO)) {
+            __atomic_add_fetch(&pageTable->virtualTime, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&pageTable->lock);
+            bytesToRead = leftToRead > PAGE_SIZE - frameOffset ? PAGE_SIZE - frameOffset : leftToRead;
+            sprintf(logBuffer, "Thread %d readFromAddr(): Reading %ld bytes of zero vpn %d from the zero frame\n", thread->threadId, bytesToRead, vpn);
+            logData(logBuffer);
+            flushLog();
+            memcpy(outData + dataOffset, zeroFrame + frameOffset, bytesToRead);
+            STAT_INC(zeroFrameReads);
+            leftToRead -= bytesToRead;
+            dataOffset += bytesToRead;
+            currentAddr += bytesToRead;
+            continue;
+        }
         // If the frame is not present in memory swap it back
-        if (pte->present == 0) {
-            sprintf(logBuffer, "Thread %d writeToAddr(): Page fault for vpn %d\n", thread->threadId, vpn);
+        bool faulted = false;
+        while (pte->present == 0) {
+            // A page being written out can only be read back once it is in
+            // its slot
+            if (pte->inTransit) {
+                waitForPageTransit(pageTable, vpn);
+                continue;
+            }
+            sprintf(logBuffer, "Thread %d readFromAddr(): Page fault for vpn %d\n", thread->threadId, vpn);
             logData(logBuffer);
             flushLog();
 
+            // Start prefetching the pages expected to fault after it
+            predictPageFaults(thread, vpn);
             // Unlock the thread's page table
             pthread_mutex_unlock(&pageTable->lock);
 
-            // Allocate a frame for the page
-            pte->frameTblNum = allocateFrameForPage(thread, vpn);
-            // Swap the frame back into memory
-            swapPageFromDisk(thread, vpn, pte->frameTblNum);
+            // Bring the page back into memory, along with the pages after
+            // it if the thread is reading through its pages in order
+            handleReadaheadFault(thread, vpn);
+            faulted = true;
 
             // Lock the thread's page table while in use
             pthread_mutex_lock(&pageTable->lock);
         }
+        // Every reference advances the thread's virtual time
+        __atomic_add_fetch(&pageTable->virtualTime, 1, __ATOMIC_RELAXED);
         // Fetch the frame table entry
-        fte = &frameTable->entries[pte->frameTblNum];        
-        // Lock the frame
-        pthread_mutex_lock(&fte->lock);
-        sprintf(logBuffer, "Thread %d readFromAddr(): Fetched frame %d at addr %p for vpn %d\n", thread->threadId, fte->frameNum, fte->physAddr, vpn);
+        fte = &frameTable->entries[pte->frameTblNum];
+        // Let the replacement policy know the frame was referenced again. A
+        // page just faulted in was already reported by mapFrameToPage
+        if (!faulted && replacementPolicy->onAccess != NULL) {
+            replacementPolicy->onAccess(fte);
+        }
+        // Lock the frame, along with the frames right after it that hold the
+        // next pages read
+        runFrames = lockFrameRun(thread->threadId, pageTable, vpn, frameOffset + leftToRead, faulted ? 1 : 0, false);
+        sprintf(logBuffer, "Thread %d readFromAddr(): Fetched %d frames from frame %d at addr %p for vpn %d\n", thread->threadId, runFrames, fte->frameNum, fte->physAddr, vpn);
         logData(logBuffer);
         flushLog();
-        // Get offset
-        frameOffset = currentAddr & OFFSET_MASK;
-        // Get the amount of bytes that will be read from the fra
-        if (leftToRead > PAGE_SIZE - frameOffset) {
-            bytesToRead = PAGE_SIZE - frameOffset;
+        // Get the amount of bytes that will be read from the frames
+        if (leftToRead > runFrames * PAGE_SIZE - frameOffset) {
+            bytesToRead = runFrames * PAGE_SIZE - frameOffset;
         } else {
             bytesToRead = leftToRead;
         }
@@ -260,8 +430,8 @@ void readFromAddr(Thread *thread, int addr, int size, void* outData) {
         leftToRead -= bytesToRead;
         dataOffset += bytesToRead;
         currentAddr += bytesToRead;        
-        // Unlock the frame
-        pthread_mutex_unlock(&fte->lock);
+        // Unlock the frames
+        unlockFrameRun(fte, runFrames);
         // Unlock the thread's page table
         pthread_mutex_unlock(&pageTable->lock);
     }
@@ -278,6 +448,32 @@ char* getCacheFileName(Thread *thread, int addr, char *fileNameBuf) {
     // The file name is in the format of "{threadId}_{vpn}.swp"
     uint32_t vpn = virtualAddressToVPN(addr);
     sprintf(fileNameBuf, "%d_%d.swp", thread->threadId, vpn);
+    // Swapped pages live in slots of the swap device, so export the page's
+    // slot to a file of that name for callers expecting one file per page
+    // A page in transit is only in its slot once it is written out
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+    PTEntry *pte = &pageTable->entries[vpn];
+    pthread_mutex_lock(&pageTable->lock);
+    waitForPageTransit(pageTable, vpn);
+    uint16_t slot = pte->sharedRegion ? *sharedPageSlot(pte) : pte->swapSlot;
+    // A resident page keeps its slot, but the slot is out of date once the
+    // frame is written to, so a dirty page has no file until it is swapped
+    // out again
+    if (pte->present) {
+        FTEntry *fte = &frameTable->entries[pte->frameTblNum];
+        pthread_mutex_lock(&fte->lock);
+        if (fte->dirty) {
+            slot = SWAP_SLOT_NONE;
+        }
+        pthread_mutex_unlock(&fte->lock);
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+    if (slot != SWAP_SLOT_NONE) {
+        exportSwapSlot(slot, fileNameBuf);
+    } else {
+        // Nor may a file exported while the page was swapped out stay behind
+        remove(fileNameBuf);
+    }
 
     return fileNameBuf;
 }
@@ -299,6 +495,7 @@ void initializeSystemMemory() {
     directory = &SYSTEM_MEMORY[PAGE_DIRECTORY_OFFSET];
     for (int i = 0; i < 32; i++) {
         pthread_mutex_init(&(directory->tables[i].lock), NULL);
+        pthread_cond_init(&(directory->tables[i].transitCond), NULL);
     }
     sprintf(logBuffer, "Page table directory initialized at: %p\n", directory);
     logData(logBuffer);
@@ -335,9 +532,69 @@ void initializeSystemMemory() {
     sprintf(logBuffer, "Free list initialized at: %p\n", freeList);
     logData(logBuffer);
     flushLog();
+
+    logData("Initializing free frame stack...\n");
+    flushLog();
+    freeFrameStack = (FreeFrameStack *)&SYSTEM_MEMORY[FREE_FRAME_STACK_OFFSET];
+    // Stack the frames so they are popped in the same order as the free list
+    for (int i = 0; i < NUM_FRAME_TABLE_ENTRIES; i++) {
+        freeFrameStack->next[i] = i + 1 < NUM_FRAME_TABLE_ENTRIES ? i + 1 : FREE_STACK_EMPTY;
+    }
+    freeFrameStack->top = 0;
+    freeFrameStack->numFreeFrames = NUM_FRAME_TABLE_ENTRIES;
+    sprintf(logBuffer, "Free frame stack initialized at: %p\n", freeFrameStack);
+    logData(logBuffer);
+    flushLog();
+
+    logData("Initializing buddy allocator...\n");
+    flushLog();
+    buddyAllocator = (BuddyAllocator *)&SYSTEM_MEMORY[BUDDY_ALLOCATOR_OFFSET];
+    initializeBuddyAllocator();
+    sprintf(logBuffer, "Buddy allocator initialized at: %p\n", buddyAllocator);
+    logData(logBuffer);
+    flushLog();
+
+    // The zero frame is already zeroed along with the rest of memory
+    zeroFrame = &SYSTEM_MEMORY[ZERO_FRAME_OFFSET];
+
+    logData("Initializing swap device...\n");
+    flushLog();
+    swapDevice = (SwapDevice *)&SYSTEM_MEMORY[SWAP_DEVICE_OFFSET];
+    compressedPool = (CompressedPool *)&SYSTEM_MEMORY[COMPRESSED_POOL_OFFSET];
+    initializeSwapDevice();
+    sprintf(logBuffer, "Swap device initialized at: %p\n", swapDevice);
+    logData(logBuffer);
+    flushLog();
+
+    logData("Initializing reverse map...\n");
+    flushLog();
+    reverseMap = (ReverseMap *)&SYSTEM_MEMORY[REVERSE_MAP_OFFSET];
+    initializeReverseMap();
+    sprintf(logBuffer, "Reverse map initialized at: %p\n", reverseMap);
+    logData(logBuffer);
+    flushLog();
+
+    logData("Initializing shared regions...\n");
+    flushLog();
+    sharedRegionTable = (SharedRegionTable *)&SYSTEM_MEMORY[SHARED_REGION_TABLE_OFFSET];
+    initializeSharedRegions();
+    sprintf(logBuffer, "Shared regions initialized at: %p\n", sharedRegionTable);
+    logData(logBuffer);
+    flushLog();
+
+    // Pick the widest victim scan the processor supports
+    initializeFrameScan();
+    // Reset the replacement policy so previous tests don't affect the current one
+    initializeReplacementPolicy();
 }
 
 void deinitializeSystemMemory() {
+    // Write the dirty pages of mapped files back before memory is cleared
+    deinitializeSharedRegions();
+
+    // Close and delete the swap file
+    deinitializeSwapDevice();
+
     // Destroy free list lock
     pthread_mutex_destroy(&freeList->lock);
 
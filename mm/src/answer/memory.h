@@ -4,6 +4,9 @@
 #include "frame.h"
 #include "page.h"
 #include "swap.h"
+#include "buddy.h"
+#include "rmap.h"
+#include "region.h"
 #include <stdint.h>
 
 #pragma region Memory Macros
@@ -25,6 +28,23 @@
 // #define ALLOCATED_FRAMES_LIST_OFFSET FRAME_TABLE_OFFSET + sizeof(FrameTable)
 /* The free list starts after the frame table */
 #define FREE_LIST_OFFSET FRAME_TABLE_OFFSET + sizeof(FrameTable)
+/* The swap device starts after the free list */
+#define SWAP_DEVICE_OFFSET FREE_LIST_OFFSET + sizeof(FreeList)
+/* The free frame stack starts after the swap device */
+#define FREE_FRAME_STACK_OFFSET SWAP_DEVICE_OFFSET + sizeof(SwapDevice)
+/* The buddy allocator starts after the free frame stack */
+#define BUDDY_ALLOCATOR_OFFSET FREE_FRAME_STACK_OFFSET + sizeof(FreeFrameStack)
+/* Kernel structures end after the buddy allocator */
+#define KERNEL_STRUCTURES_END BUDDY_ALLOCATOR_OFFSET + sizeof(BuddyAllocator)
+/* The shared zero frame is the first page aligned frame after the kernel
+   structures */
+#define ZERO_FRAME_OFFSET ((KERNEL_STRUCTURES_END + 4095) / 4096 * 4096)
+/* The compressed pool starts after the zero frame */
+#define COMPRESSED_POOL_OFFSET (ZERO_FRAME_OFFSET + 4096)
+/* The reverse map starts after the compressed pool */
+#define REVERSE_MAP_OFFSET (COMPRESSED_POOL_OFFSET + sizeof(CompressedPool))
+/* The shared region table starts after the reverse map */
+#define SHARED_REGION_TABLE_OFFSET (REVERSE_MAP_OFFSET + sizeof(ReverseMap))
 
 #pragma endregion
 
@@ -67,7 +87,8 @@ void writeToAddr(const Thread* thread, int addr, int size, const void* data);
 
 /**
  * This function allocates heap memory in the given thread of the given size. If there is no more heap memory left for
- * allocation in this thread, the function returns -1. Heap memory starts at USER_BASE_ADDR and goes up to STACK_END_ADDR.
+ * allocation in this thread, the function returns -1. Pages are only given frames when first written, until then they
+ * read as zeros. Heap memory starts at USER_BASE_ADDR and goes up to STACK_END_ADDR.
  * These constants are listed in memory.c.
  * @param thread The thread for which we want to allocate heap memory.
  * @param size The number of bytes we want to allocate.
@@ -77,7 +98,8 @@ int allocateHeapMem(Thread *thread, int size);
 
 /**
  * This function allocates stack memory in the given thread of the given size. If there is no more stack memory left for
- * allocation in this thread, the function returns -1. Stack memory starts at ALL_MEM_SIZE and goes down to STACK_END_ADDR.
+ * allocation in this thread, the function returns -1. Pages are only given frames when first written, until then they
+ * read as zeros. Stack memory starts at ALL_MEM_SIZE and goes down to STACK_END_ADDR.
  * These constants are listed in memory.c.
  * @param thread The thread for which we want to allocate stack memory.
  * @param size The number of bytes we want to allocate.
@@ -0,0 +1,305 @@
+#include "merge.h"
+#include "frame.h"
+#include "page.h"
+#include "rmap.h"
+#include "swap.h"
+#include "policy.h"
+#include "prefetch.h"
+#include "stats.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+extern FrameTable *frameTable;
+extern const int PAGE_SIZE;
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+/* Index of an empty bucket of mergeCandidates */
+#define MERGE_CANDIDATE_NONE 0xFFFF
+
+_Static_assert((1 << MERGE_CANDIDATE_BITS) > NUM_FRAME_TABLE_ENTRIES, "Merge candidates must have more buckets than there are frames");
+
+MergeConfig mergeConfig = {
+    .enabled = false,
+    .framesPerScan = DEFAULT_MERGE_FRAMES_PER_SCAN,
+    .scanIntervalMs = DEFAULT_MERGE_SCAN_INTERVAL_MS,
+};
+
+static pthread_t mergerThread;
+static pthread_mutex_t mergeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mergeCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t mergeIdleCond = PTHREAD_COND_INITIALIZER;
+static bool mergerCreated;
+static bool mergerEnabled;
+static bool mergerBusy;
+/* Lock for the scan state below, held for the whole of a scan */
+static pthread_mutex_t scanLock = PTHREAD_MUTEX_INITIALIZER;
+/* Checksum of each frame when it was last scanned */
+static uint32_t frameChecksums[NUM_FRAME_TABLE_ENTRIES];
+static bool frameChecksummed[NUM_FRAME_TABLE_ENTRIES];
+/* Frames scanned during this pass, by checksum */
+static uint16_t mergeCandidates[1 << MERGE_CANDIDATE_BITS];
+/* Next frame to scan */
+static uint16_t scanCursor;
+
+#pragma region Merge Functions
+
+/**
+ * Returns a checksum of the page in the frame. Four words are mixed in at a
+ * time so the multiplications do not wait on each other.
+*/
+static uint32_t checksumFrame(const uint8_t *physAddr) {
+    const uint64_t *words = (const uint64_t *)physAddr;
+    uint64_t lanes[4] = {1, 2, 3, 4};
+    for (int i = 0; i < PAGE_SIZE / (int)sizeof(uint64_t); i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            lanes[lane] = (lanes[lane] ^ words[i + lane]) * 0x9E3779B97F4A7C15ULL;
+        }
+    }
+    uint64_t hash = lanes[0] ^ (lanes[1] >> 7) ^ (lanes[2] >> 17) ^ (lanes[3] >> 31);
+    return (hash ^ (hash >> 32)) * 0x9E3779B1u;
+}
+
+/**
+ * Forgets every checksum and candidate, so the next scan starts a new pass
+ * at the first frame.
+*/
+static void resetMergeScan() {
+    pthread_mutex_lock(&scanLock);
+    memset(frameChecksummed, 0, sizeof(frameChecksummed));
+    memset(mergeCandidates, 0xFF, sizeof(mergeCandidates));
+    scanCursor = 0;
+    pthread_mutex_unlock(&scanLock);
+}
+
+/**
+ * Returns the bucket of mergeCandidates holding the frame scanned during
+ * this pass with the given checksum, or the empty bucket where it belongs.
+ * Each frame is scanned once a pass, so the checksums of the candidates do
+ * not change until the buckets are emptied, and there are more buckets than
+ * frames.
+*/
+static uint16_t* findMergeCandidate(uint32_t checksum) {
+    uint32_t bucket = checksum >> (32 - MERGE_CANDIDATE_BITS);
+    while (mergeCandidates[bucket] != MERGE_CANDIDATE_NONE && frameChecksums[mergeCandidates[bucket]] != checksum) {
+        bucket = (bucket + 1) % (1 << MERGE_CANDIDATE_BITS);
+    }
+    return &mergeCandidates[bucket];
+}
+
+/**
+ * Locks the page tables of both threads without waiting, once if they are
+ * the same thread. Returns false holding neither if one is busy.
+*/
+static bool tryLockPageTables(uint8_t threadId, uint8_t otherThreadId) {
+    if (pthread_mutex_trylock(&getThreadPageTable(threadId)->lock) != 0) {
+        return false;
+    }
+    if (otherThreadId != threadId && pthread_mutex_trylock(&getThreadPageTable(otherThreadId)->lock) != 0) {
+        pthread_mutex_unlock(&getThreadPageTable(threadId)->lock);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Maps the page of the fold frame to the keep frame if both hold the same
+ * bytes, write protecting the pages of both, and frees the fold frame. The
+ * fold frame must not be shared. Threads accessing either page are not
+ * waited for, the frames are left alone instead. Returns whether the frames
+ * were merged.
+*/
+static bool mergeFrames(FTEntry *keep, FTEntry *fold) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    uint8_t keepOwner = frameOwner(keep);
+    uint8_t foldOwner = frameOwner(fold);
+    if (keepOwner == 0 || foldOwner == 0 || !tryLockPageTables(keepOwner, foldOwner)) {
+        return false;
+    }
+    // Frames are always locked in increasing order
+    FTEntry *first = keep->frameNum < fold->frameNum ? keep : fold;
+    FTEntry *second = keep->frameNum < fold->frameNum ? fold : keep;
+    pthread_mutex_lock(&first->lock);
+    pthread_mutex_lock(&second->lock);
+
+    // The frames may have been evicted and remapped before the locks were
+    // taken, and the pages written to since they were checksummed. Pages of
+    // shared regions are written through every mapping, so they are never
+    // write protected, and pages being written back keep their frames
+    bool merged = false;
+    uint16_t foldVpn = frameVirtualPageNum(fold);
+    PTEntry *keepPte = &getThreadPageTable(keepOwner)->entries[frameVirtualPageNum(keep)];
+    PTEntry *foldPte = &getThreadPageTable(foldOwner)->entries[foldVpn];
+    if (frameOwner(keep) == keepOwner && frameOwner(fold) == foldOwner && !frameShared(fold)
+        && !keepPte->sharedRegion && !foldPte->sharedRegion && !keepPte->inTransit && !foldPte->inTransit
+        && memcmp(keep->physAddr, fold->physAddr, PAGE_SIZE) == 0 && addFrameSharer(keep, foldOwner, foldVpn)) {
+        // A page sharing a frame keeps its slot only while it is up to
+        // date, since nothing writes it back until the frame is evicted
+        if (fold->dirty) {
+            discardSwapSlot(foldPte);
+        }
+        keepPte->writeProtected = 1;
+        foldPte->frameTblNum = keep->frameNum;
+        foldPte->writeProtected = 1;
+        if (replacementPolicy->onEvict != NULL) {
+            replacementPolicy->onEvict(fold);
+        }
+        // A prefetched page folded before it was accessed was prefetched for
+        // nothing. This also clears fold->prefetched, so the frame is not
+        // counted again once it is reused
+        notePrefetchEviction(fold);
+        setFrameOwner(fold, 0, 0);
+        fold->dirty = 0;
+        merged = true;
+    }
+
+    pthread_mutex_unlock(&second->lock);
+    pthread_mutex_unlock(&first->lock);
+    pthread_mutex_unlock(&getThreadPageTable(keepOwner)->lock);
+    if (foldOwner != keepOwner) {
+        pthread_mutex_unlock(&getThreadPageTable(foldOwner)->lock);
+    }
+    if (!merged) {
+        return false;
+    }
+
+    sprintf(logBuffer, "mergeFrames(): Merged thread %d's vpn %d in frame %d into frame %d\n",
+                        foldOwner, foldVpn, fold->frameNum, keep->frameNum);
+    logData(logBuffer);
+    flushLog();
+    STAT_INC(framesMerged);
+    returnFrameToFreeList(fold);
+    return true;
+}
+
+uint16_t scanFramesForMerging(uint16_t numFrames) {
+    uint16_t numMerged = 0;
+    pthread_mutex_lock(&scanLock);
+    for (uint16_t i = 0; i < numFrames; i++) {
+        uint16_t frameNum = scanCursor;
+        scanCursor = (scanCursor + 1) % NUM_FRAME_TABLE_ENTRIES;
+        // Candidates are only kept for one pass, by the next one they are
+        // likely to have changed
+        if (frameNum == 0) {
+            memset(mergeCandidates, 0xFF, sizeof(mergeCandidates));
+        }
+        FTEntry *entry = &frameTable->entries[frameNum];
+        if (frameOwner(entry) == 0) {
+            frameChecksummed[frameNum] = false;
+            continue;
+        }
+        pthread_mutex_lock(&entry->lock);
+        bool owned = frameOwner(entry) != 0;
+        uint32_t checksum = owned ? checksumFrame(entry->physAddr) : 0;
+        pthread_mutex_unlock(&entry->lock);
+        // Only pages unchanged since the last pass are merged, pages being
+        // written to would soon have to be copied again
+        bool stable = owned && frameChecksummed[frameNum] && frameChecksums[frameNum] == checksum;
+        frameChecksums[frameNum] = checksum;
+        frameChecksummed[frameNum] = owned;
+        if (!stable) {
+            continue;
+        }
+
+        uint16_t *bucket = findMergeCandidate(checksum);
+        if (*bucket == MERGE_CANDIDATE_NONE) {
+            *bucket = frameNum;
+            continue;
+        }
+        // Keep whichever frame is already shared, a shared frame's pages
+        // cannot be moved
+        FTEntry *candidate = &frameTable->entries[*bucket];
+        bool merged = frameShared(entry) ? mergeFrames(entry, candidate) : mergeFrames(candidate, entry);
+        if (merged) {
+            numMerged++;
+            if (frameShared(entry)) {
+                *bucket = frameNum;
+                frameChecksummed[candidate->frameNum] = false;
+            } else {
+                frameChecksummed[frameNum] = false;
+            }
+        }
+    }
+    pthread_mutex_unlock(&scanLock);
+    return numMerged;
+}
+
+/**
+ * Body of the merger thread. Scans a batch of frames every scan interval
+ * while it is enabled.
+*/
+static void* mergeFramesInBackground(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&mergeLock);
+    while (true) {
+        while (!mergerEnabled) {
+            pthread_cond_wait(&mergeCond, &mergeLock);
+        }
+        struct timespec wakeAt;
+        clock_gettime(CLOCK_REALTIME, &wakeAt);
+        wakeAt.tv_nsec += (long)mergeConfig.scanIntervalMs * 1000000;
+        wakeAt.tv_sec += wakeAt.tv_nsec / 1000000000;
+        wakeAt.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&mergeCond, &mergeLock, &wakeAt);
+        // The merger may have been stopped while it slept
+        if (!mergerEnabled) {
+            continue;
+        }
+        mergerBusy = true;
+        pthread_mutex_unlock(&mergeLock);
+
+        scanFramesForMerging(mergeConfig.framesPerScan);
+
+        pthread_mutex_lock(&mergeLock);
+        mergerBusy = false;
+        pthread_cond_broadcast(&mergeIdleCond);
+    }
+    return NULL;
+}
+
+#pragma endregion
+
+#pragma region Merge Callback
+
+void startMerger() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    if (mergeConfig.framesPerScan == 0) {
+        mergeConfig.framesPerScan = 1;
+    }
+    // Frames of a previous run mean nothing now
+    resetMergeScan();
+    if (!mergeConfig.enabled) {
+        return;
+    }
+    sprintf(logBuffer, "startMerger(): Scanning %d frames every %d ms\n", mergeConfig.framesPerScan, mergeConfig.scanIntervalMs);
+    logData(logBuffer);
+    flushLog();
+
+    pthread_mutex_lock(&mergeLock);
+    // The thread is created once and only parked between runs, for the same
+    // reason as the reclaimer's
+    if (!mergerCreated) {
+        pthread_create(&mergerThread, NULL, mergeFramesInBackground, NULL);
+        mergerCreated = true;
+    }
+    mergerEnabled = true;
+    pthread_cond_signal(&mergeCond);
+    pthread_mutex_unlock(&mergeLock);
+}
+
+void stopMerger() {
+    pthread_mutex_lock(&mergeLock);
+    mergerEnabled = false;
+    pthread_cond_signal(&mergeCond);
+    // Wait for the scan in progress to finish
+    while (mergerBusy) {
+        pthread_cond_wait(&mergeIdleCond, &mergeLock);
+    }
+    pthread_mutex_unlock(&mergeLock);
+}
+
+#pragma endregion
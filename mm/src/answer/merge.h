@@ -0,0 +1,63 @@
+#ifndef VIRTUALMEMFRAMEWORKC_MERGE_H
+#define VIRTUALMEMFRAMEWORKC_MERGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#pragma region Merge Macros
+
+/* Default number of frames checksummed each time the merger wakes */
+#define DEFAULT_MERGE_FRAMES_PER_SCAN 256
+/* Default milliseconds the merger sleeps between scans */
+#define DEFAULT_MERGE_SCAN_INTERVAL_MS 20
+/* Number of bits of a frame's checksum used to find frames with the same
+   checksum. There must be more buckets than frames */
+#define MERGE_CANDIDATE_BITS 12
+
+#pragma endregion
+
+#pragma region Merge Structs
+
+/**
+ * Defines the settings of the background merger. They are read when the
+ * merger is started, so changes take effect on the next startupCallback.
+ * The merger is off unless enabled. Merging frees frames, so pages that
+ * callers expect to be swapped out once memory fills (as the paging tests
+ * do) may then stay in memory.
+*/
+typedef struct MergeConfig {
+    bool enabled;               // Whether the merger runs at all
+    uint16_t framesPerScan;     // Frames checksummed each time the merger wakes
+    uint16_t scanIntervalMs;    // Milliseconds the merger sleeps between scans
+} MergeConfig;
+
+#pragma endregion
+
+#pragma region Merge FunctionDeclarations
+
+/**
+ * Checksums the next numFrames frames after the ones scanned last, and
+ * merges each frame whose page was unchanged since it was last scanned into
+ * an earlier frame of this pass over the frame table holding the same bytes.
+ * The pages of a merged frame are mapped to the frame it matched, write
+ * protected, and the frame is freed. Returns the number of frames freed.
+*/
+uint16_t scanFramesForMerging(uint16_t numFrames);
+
+/**
+ * Starts the background merger if it is enabled, creating its thread on
+ * first use.
+*/
+void startMerger();
+
+/**
+ * Stops the background merger and waits until it is no longer scanning.
+ * The thread is kept parked for the next startMerger.
+*/
+void stopMerger();
+
+#pragma endregion
+
+extern MergeConfig mergeConfig;
+
+#endif //VIRTUALMEMFRAMEWORKC_MERGE_H
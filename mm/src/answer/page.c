@@ -1,15 +1,38 @@
 #include "page.h"
 #include "frame.h"
+#include "swap.h"
+#include "stats.h"
+#include "buddy.h"
+#include "rmap.h"
+#include "region.h"
 #include "utils.h"
 #include <stdio.h>
+#include <string.h>
 
 extern unsigned char *SYSTEM_MEMORY;
 extern const int PAGE_SIZE;
 extern const int MAX_BUFFER_SIZE;
 extern PageDirectory *directory;
+extern FrameTable *frameTable;
 
 #pragma region Page Functions
 
+/**
+ * Fills a newly allocated frame with the page's contents: swapped back in
+ * if the page was swapped out before, or zeros if it was never written.
+*/
+static void fillFrameForPage(const Thread *thread, PTEntry *pte, uint32_t vpn, uint16_t frameNum) {
+    // Only this thread faults its pages in, but the compressed pool may move
+    // the page from its pool entry to a slot meanwhile. swapPageFromDisk
+    // reads the slot again under the pool lock. The prefetcher may map the
+    // page, but keeps its slot
+    if (pte->swapSlot != SWAP_SLOT_NONE) {
+        swapPageFromDisk(thread, vpn, frameNum);
+    } else {
+        memset(frameTable->entries[frameNum].physAddr, 0, PAGE_SIZE);
+    }
+}
+
 uint32_t virtualAddressToVPN(uint32_t virtualAddr) {
     // The address space goes up to 8M meaning that at most, 23 bits will be
     // used. Since there are 2048 pages that are 4098 bytes, the virtual page
@@ -21,57 +44,291 @@ PageTable* getThreadPageTable(uint8_t threadId) {
     return &(directory->tables[threadId-1]);
 }
 
-void allocatePages(Thread *thread, uint32_t startAddr, uint32_t endAddr) {
-    char logBuffer[MAX_BUFFER_SIZE];
-    sprintf(logBuffer, "Thead %d allocatePages(): Beginning page allocation attempt...\n", thread->threadId);
-    logData(logBuffer);
-    flushLog();
+void waitForPageTransit(PageTable *pageTable, uint32_t vpn) {
+    // Only the thread itself and a fork of it wait on a page table, so a
+    // single queue per table wakes hardly anyone for another page
+    while (pageTable->entries[vpn].inTransit) {
+        STAT_INC(transitWaits);
+        pthread_cond_wait(&pageTable->transitCond, &pageTable->lock);
+    }
+}
 
-    // Get the thread's table
+void endPageTransit(PageTable *pageTable, uint32_t vpn) {
+    pthread_mutex_lock(&pageTable->lock);
+    pageTable->entries[vpn].inTransit = 0;
+    pthread_cond_broadcast(&pageTable->transitCond);
+    pthread_mutex_unlock(&pageTable->lock);
+}
+
+void handlePageFault(const Thread *thread, uint32_t vpn) {
     PageTable *pageTable = getThreadPageTable(thread->threadId);
-    sprintf(logBuffer, "Thead %d allocatePages(): Retrieved page table...\n", thread->threadId);
+    PTEntry *pte = &pageTable->entries[vpn];
+
+    // A page of a shared region is brought in for all of its mappings
+    if (pte->sharedRegion) {
+        handleSharedPageFault(thread, vpn);
+        return;
+    }
+
+    STAT_INC(pageFaults);
+
+    // Allocate a frame for the page and fill it
+    uint16_t frameNum = allocateFrameForPage(thread, vpn);
+    fillFrameForPage(thread, pte, vpn, frameNum);
+
+    // Map the frame to the page, unless the prefetcher brought the page in
+    // meanwhile from the same slot
+    pthread_mutex_lock(&pageTable->lock);
+    bool prefetched = pte->present;
+    if (!prefetched) {
+        mapFrameToPage(thread, vpn, frameNum);
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+    if (prefetched) {
+        releaseFrame(thread, &frameTable->entries[frameNum]);
+    }
+}
+
+int handlePageRunFault(const Thread *thread, uint32_t vpn, int numPages) {
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+
+    // Take the largest run that the pages fill completely, settling for a
+    // smaller one if memory is too fragmented
+    uint8_t order = 0;
+    while (order < BUDDY_MAX_ORDER && 2 << order <= numPages) {
+        order++;
+    }
+    uint16_t firstFrame = allocateFrameRunForPages(thread, order);
+    while (firstFrame == BUDDY_NONE && order > 1) {
+        firstFrame = allocateFrameRunForPages(thread, --order);
+    }
+    if (firstFrame == BUDDY_NONE) {
+        handlePageFault(thread, vpn);
+        return 1;
+    }
+
+    int runPages = 1 << order;
+    for (int i = 0; i < runPages; i++) {
+        STAT_INC(pageFaults);
+        // Only this thread and the prefetcher bring its pages in, and the
+        // prefetcher leaves the slot as it was
+        fillFrameForPage(thread, &pageTable->entries[vpn + i], vpn + i, firstFrame + i);
+        pthread_mutex_lock(&pageTable->lock);
+        bool prefetched = pageTable->entries[vpn + i].present;
+        if (!prefetched) {
+            mapFrameToPage(thread, vpn + i, firstFrame + i);
+        }
+        pthread_mutex_unlock(&pageTable->lock);
+        if (prefetched) {
+            returnFrameToFreeList(&frameTable->entries[firstFrame + i]);
+        }
+    }
+    return runPages;
+}
+
+/**
+ * Locks the frame the write protected page shares with other pages and
+ * returns it, or returns NULL if the page is no longer present or no longer
+ * protected. A page found to be the only one left mapped to its frame loses
+ * its protection instead. The thread's page table must be locked by the
+ * caller.
+*/
+static FTEntry* lockSharedFrame(PTEntry *pte) {
+    if (pte->present == 0 || !pte->writeProtected) {
+        return NULL;
+    }
+    FTEntry *shared = &frameTable->entries[pte->frameTblNum];
+    pthread_mutex_lock(&shared->lock);
+    if (!frameShared(shared)) {
+        pte->writeProtected = 0;
+        pthread_mutex_unlock(&shared->lock);
+        return NULL;
+    }
+    return shared;
+}
+
+bool handleCopyOnWriteFault(const Thread *thread, uint32_t vpn) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+    PTEntry *pte = &pageTable->entries[vpn];
+
+    pthread_mutex_lock(&pageTable->lock);
+    FTEntry *shared = lockSharedFrame(pte);
+    if (shared != NULL) {
+        pthread_mutex_unlock(&shared->lock);
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+    if (shared == NULL) {
+        return false;
+    }
+
+    // Allocate the copy with the page table unlocked, since it may have to
+    // evict a frame
+    uint16_t frameNum = allocateFrameForPage(thread, vpn);
+    FTEntry *copy = &frameTable->entries[frameNum];
+
+    // The shared frame may have been evicted meanwhile, or every other page
+    // may have stopped sharing it
+    pthread_mutex_lock(&pageTable->lock);
+    shared = lockSharedFrame(pte);
+    if (shared == NULL) {
+        pthread_mutex_unlock(&pageTable->lock);
+        releaseFrame(thread, copy);
+        return false;
+    }
+    sprintf(logBuffer, "Thread %d handleCopyOnWriteFault(): Copying vpn %d from shared frame %d to frame %d\n",
+                        thread->threadId, vpn, shared->frameNum, frameNum);
     logData(logBuffer);
     flushLog();
-    uint32_t vpn;
-    uint32_t offset;
-    PTEntry *pte;
-    while (startAddr < endAddr) {
-        // Fetch the page table entry
-        vpn = virtualAddressToVPN(startAddr);
-        pte = &pageTable->entries[vpn];
-
-        // Check for page fault
-        if (pte->valid == 0) {
-            // Allocate frame for page
-            pte->frameTblNum = allocateFrameForPage(thread, vpn);
-            pte->valid = 1;
-        }
+    memcpy(copy->physAddr, shared->physAddr, PAGE_SIZE);
+    if (frameOwner(shared) == thread->threadId && frameVirtualPageNum(shared) == vpn) {
+        // The frame's dirty bit describes its owner's slot, which the copy
+        // takes along. The sharer that becomes the owner has an up to date
+        // slot or none at all, so the bit holds for it either way
+        copy->dirty = shared->dirty;
+        promoteFrameSharer(shared);
+    } else {
+        removeFrameSharer(shared, thread->threadId, vpn);
+    }
+    pthread_mutex_unlock(&shared->lock);
+    mapFrameToPage(thread, vpn, frameNum);
+    pthread_mutex_unlock(&pageTable->lock);
+    STAT_INC(copyOnWriteFaults);
+    return true;
+}
 
-        // Lock the thread's page table for duration of allocation
-        pthread_mutex_lock(&pageTable->lock);
-        while (pte->present == 0) {
-            pthread_mutex_unlock(&pageTable->lock);
+void forkPageTable(const Thread *parent, Thread *child) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    PageTable *parentTable = getThreadPageTable(parent->threadId);
+    PageTable *childTable = getThreadPageTable(child->threadId);
+    int numShared = 0;
+    int numCopied = 0;
+    uint8_t page[PAGE_SIZE];
 
-            pte->frameTblNum = allocateFrameForPage(thread, vpn);
+    // The child is not running yet, but eviction may already look at its
+    // page table once its pages share frames. Both tables are locked in
+    // increasing order of threadId, as a shared region being brought in
+    // locks them. They are released around any swap I/O
+    PageTable *firstTable = parent->threadId < child->threadId ? parentTable : childTable;
+    PageTable *secondTable = firstTable == parentTable ? childTable : parentTable;
+    pthread_mutex_lock(&firstTable->lock);
+    pthread_mutex_lock(&secondTable->lock);
+    childTable->virtualTime = parentTable->virtualTime;
+    for (uint32_t vpn = 0; vpn < NUM_PAGE_TABLE_ENTRIES; vpn++) {
+        PTEntry *from = &parentTable->entries[vpn];
+        PTEntry *to = &childTable->entries[vpn];
+        if (!from->valid) {
+            continue;
+        }
+        // A page in transit is waited for until it is in its slot or file,
+        // even one still in memory, and a page in the compressed pool is
+        // written out to a slot of its own first, since a pool entry belongs
+        // to one page. Both need the tables released, and the page is looked
+        // at again once they are locked
+        while (from->inTransit || (!from->sharedRegion && swapSlotInPool(from->swapSlot))) {
+            pthread_mutex_unlock(&secondTable->lock);
+            pthread_mutex_unlock(&firstTable->lock);
+            pthread_mutex_lock(&parentTable->lock);
+            waitForPageTransit(parentTable, vpn);
+            bool pooled = !from->sharedRegion && swapSlotInPool(from->swapSlot);
+            pthread_mutex_unlock(&parentTable->lock);
+            if (pooled) {
+                writeBackPooledPage(parent, from);
+            }
+            pthread_mutex_lock(&firstTable->lock);
+            pthread_mutex_lock(&secondTable->lock);
+        }
+        to->valid = 1;
+        // The child becomes another mapping of a shared region's page, and
+        // shares its frame without any protection. If the reverse map is
+        // full it joins the frame when it first accesses the page
+        if (from->sharedRegion) {
+            to->sharedRegion = 1;
+            to->regionPage = from->regionPage;
+            if (from->present) {
+                FTEntry *fte = &frameTable->entries[from->frameTblNum];
+                pthread_mutex_lock(&fte->lock);
+                if (addFrameSharer(fte, child->threadId, vpn)) {
+                    to->frameTblNum = fte->frameNum;
+                    to->present = 1;
+                    numShared++;
+                }
+                pthread_mutex_unlock(&fte->lock);
+            }
+            continue;
+        }
+        // A page that is not in memory only has its slot to share, if it
+        // has one
+        if (from->present == 0) {
+            to->swapSlot = shareSwapSlot(from);
+            continue;
+        }
 
-            // Lock the thread's page table for duration of allocation
-            pthread_mutex_lock(&pageTable->lock);
+        FTEntry *fte = &frameTable->entries[from->frameTblNum];
+        pthread_mutex_lock(&fte->lock);
+        // The parent's slot is up to date unless the parent owns the frame
+        // and wrote to it. A page sharing a frame may only keep an up to
+        // date slot
+        bool parentOwnsFrame = frameOwner(fte) == parent->threadId && frameVirtualPageNum(fte) == vpn;
+        if (!parentOwnsFrame || fte->dirty == 0) {
+            to->swapSlot = shareSwapSlot(from);
+        }
+        uint16_t copySlot = SWAP_SLOT_NONE;
+        if (addFrameSharer(fte, child->threadId, vpn)) {
+            to->frameTblNum = fte->frameNum;
+            to->present = 1;
+            to->writeProtected = 1;
+            from->writeProtected = 1;
+            numShared++;
+        } else if (to->swapSlot == SWAP_SLOT_NONE) {
+            // There is no room left to map the frame to the child as well,
+            // so the child gets a copy of the page in swap instead. Nothing
+            // reads the child's slot before it runs, so the copy is written
+            // with the tables released
+            copySlot = beginSwapPageCopy(parent, fte, to, child->threadId, vpn, page);
+            numCopied++;
+        }
+        pthread_mutex_unlock(&fte->lock);
+        if (copySlot != SWAP_SLOT_NONE) {
+            pthread_mutex_unlock(&secondTable->lock);
+            pthread_mutex_unlock(&firstTable->lock);
+            finishSwapPageCopy(parent, page, vpn, copySlot);
+            pthread_mutex_lock(&firstTable->lock);
+            pthread_mutex_lock(&secondTable->lock);
         }
+    }
+    pthread_mutex_unlock(&secondTable->lock);
+    pthread_mutex_unlock(&firstTable->lock);
 
+    sprintf(logBuffer, "Thread %d forkPageTable(): Forked thread %d sharing %d frames, %d pages copied to swap\n",
+                        parent->threadId, child->threadId, numShared, numCopied);
+    logData(logBuffer);
+    flushLog();
+}
 
-        sprintf(logBuffer, "Thead %d allocatePages(): Associated vpn %d with fte %d\n", thread->threadId, vpn, pte->frameTblNum);
-        logData(logBuffer);
-        flushLog();
+void allocatePages(const Thread *thread, uint32_t startAddr, uint32_t endAddr) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    sprintf(logBuffer, "Thead %d allocatePages(): Beginning page allocation attempt...\n", thread->threadId);
+    logData(logBuffer);
+    flushLog();
 
-        offset = startAddr & OFFSET_MASK;
-        if (endAddr - startAddr > PAGE_SIZE - offset) {
-            startAddr += PAGE_SIZE - offset;
-        } else {
-            startAddr += endAddr - startAddr;
-        }
-        // Unlock the thread's page table
-        pthread_mutex_unlock(&pageTable->lock);
+    // Get the thread's table
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+    uint32_t firstVpn = virtualAddressToVPN(startAddr);
+    uint32_t lastVpn = virtualAddressToVPN(endAddr - 1);
+    // Lock the thread's page table for duration of allocation
+    pthread_mutex_lock(&pageTable->lock);
+    // Only mark the pages valid. Each page is given a frame when it is first
+    // written, until then it reads from the shared zero frame
+    for (uint32_t vpn = firstVpn; vpn <= lastVpn; vpn++) {
+        pageTable->entries[vpn].valid = 1;
     }
+    // Unlock the thread's page table
+    pthread_mutex_unlock(&pageTable->lock);
+
+    sprintf(logBuffer, "Thead %d allocatePages(): Marked vpns %d to %d valid\n", thread->threadId, firstVpn, lastVpn);
+    logData(logBuffer);
+    flushLog();
 }
 
 #pragma endregion
@@ -2,18 +2,19 @@
 #define VIRTUALMEMFRAMEWORKC_PAGE_H
 
 #include "thread.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 #pragma region Page Macros
 
 /* There are 2048 entries per page table */
 #define NUM_PAGE_TABLE_ENTRIES 2048
-/* Each page table is 8232 bytes (NUM_PAGES * PTE_SIZE + 40) */
-#define PAGE_TABLE_SIZE 8232
+/* Each page table is 12336 bytes (NUM_PAGES * PTE_SIZE + 48) */
+#define PAGE_TABLE_SIZE 12336
 /* There are 32 page tables (arbitrarily chosen) */
 #define NUM_PAGE_TABLES 32
-/* The page directory will be 262144 bytes (PAGE_TABLE_SIZE * NUM_PAGE_TABLES) */
-#define DIRECTORY_SIZE 8232 * 32
+/* The page directory will be 394752 bytes (PAGE_TABLE_SIZE * NUM_PAGE_TABLES) */
+#define DIRECTORY_SIZE 12336 * 32
 /* Given a 23 bit address, the 11 MSB are the VPN */
 #define VPN_SHIFT 12
 /* Given a uint32_t representing the virtual address, will zero all bits
@@ -31,9 +32,17 @@
  * This struct defines a page table entry.
 */
 typedef struct PTEntry {
-    uint16_t frameTblNum;  // The number of the frame table entry associated with the page
-    uint8_t valid;         // Whether the entry is valid
-    uint8_t present;       // Whether it was swapped to disk
+    uint16_t frameTblNum;        // The number of the frame table entry associated with the page
+    uint8_t valid : 1;           // Whether the entry is valid
+    uint8_t present : 1;         // Whether it was swapped to disk
+    uint8_t writeProtected : 1;  // Whether the frame is shared with other pages, so writes must copy it first
+    uint8_t sharedRegion : 1;    // Whether the page belongs to a shared region, which keeps its swap slot
+    uint8_t prefetching : 1;     // Whether the prefetcher is reading the page in, cleared when anything maps the page
+    uint8_t inTransit : 1;       // Whether the page is unmapped but still being written to its swap slot
+    union {
+        uint16_t swapSlot;       // The swap slot holding the page on disk (SWAP_SLOT_NONE if it has none)
+        uint16_t regionPage;     // The shared page mapped by the entry, if sharedRegion is set
+    };
 } PTEntry;
 
 /**
@@ -41,6 +50,10 @@ typedef struct PTEntry {
 */
 typedef struct PageTable {
     pthread_mutex_t lock;                    // Lock for the thread's page table
+    pthread_cond_t transitCond;              // Signalled with the lock held whenever a page stops being in transit
+    uint32_t virtualTime;                    // Number of memory references the thread has made
+    uint16_t readaheadNextVpn;               // The page after the last one brought in by a read fault
+    uint8_t readaheadWindow;                 // Pages read ahead by the last read fault, 0 if it was not sequential
     PTEntry entries[NUM_PAGE_TABLE_ENTRIES]; // The entries held by the page table
 } PageTable;
 
@@ -58,9 +71,67 @@ typedef struct PageDirectory {
 /**
  * Handles the allocation of the pages for address range starting at and
  * including startAddr and ending at but excluding endAddr. It must be the
- * case that startAddr < endAddr.
+ * case that startAddr < endAddr. The pages are only marked valid, frames
+ * are allocated on demand when they are first written.
 */
-void allocatePages(Thread *thread, uint32_t startAddr, uint32_t endAddr);
+void allocatePages(const Thread *thread, uint32_t startAddr, uint32_t endAddr);
+
+/**
+ * Brings the thread's page into memory by allocating a frame for it, swapping
+ * its contents back in if it was swapped out or zeroing it if it was never
+ * written, and mapping the frame to the page. If the prefetcher maps the page
+ * first, the frame is given back instead. The thread's page table must not
+ * be locked by the caller.
+*/
+void handlePageFault(const Thread *thread, uint32_t vpn);
+
+/**
+ * Brings up to numPages of the thread's pages starting at vpn into memory in
+ * one run of physically contiguous frames, as large a power of two as the
+ * pages fill and the free frames allow. Falls back to handlePageFault for
+ * the first page alone if there is no such run. Returns the number of pages
+ * brought in. None of the pages may be present, and the thread's page table
+ * must not be locked by the caller. Pages the prefetcher maps meanwhile are
+ * left as it mapped them.
+*/
+int handlePageRunFault(const Thread *thread, uint32_t vpn, int numPages);
+
+/**
+ * Gives the thread's write protected page a frame of its own, copied from
+ * the frame it shares with other pages, so it can be written to. A page
+ * left as the only one mapped to its frame simply loses its protection.
+ * Returns whether a new frame was mapped to the page, or false if the page
+ * is no longer present. The thread's page table must not be locked by the
+ * caller.
+*/
+bool handleCopyOnWriteFault(const Thread *thread, uint32_t vpn);
+
+/**
+ * Gives the child thread every page of the parent thread. Pages in memory
+ * share their frame with the parent, write protected on both sides so the
+ * first write by either copies it, and pages that were swapped out share
+ * their swap slot. Pages of shared regions stay shared, writable by both.
+ * Nothing is copied unless the reverse map is full. The tables are both
+ * locked but released around any swap I/O, such as writing out a page of
+ * the compressed pool or a copy. The child must not have any pages yet, and
+ * neither thread's page table may be locked by the caller.
+*/
+void forkPageTable(const Thread *parent, Thread *child);
+
+/**
+ * Returns once the page at vpn is no longer in transit, waiting for it to
+ * finish being written out for as long as it is. The page table must be
+ * locked by the caller, it is released while waiting and held again on
+ * return.
+*/
+void waitForPageTransit(PageTable *pageTable, uint32_t vpn);
+
+/**
+ * Marks the page at vpn as no longer in transit, now that it is in its swap
+ * slot, and wakes the threads waiting for it. The page table must not be
+ * locked by the caller.
+*/
+void endPageTransit(PageTable *pageTable, uint32_t vpn);
 
 /**
  * Extracts the page number from a given virtual address.
@@ -0,0 +1,35 @@
+#include "policy.h"
+#include "utils.h"
+#include <stdio.h>
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+ReplacementPolicyType replacementPolicyType = POLICY_CLOCK;
+const ReplacementPolicy *replacementPolicy = &clockPolicy;
+
+/* Every policy, indexed by its ReplacementPolicyType */
+static const ReplacementPolicy *replacementPolicies[NUM_REPLACEMENT_POLICIES] = {
+    [POLICY_CLOCK] = &clockPolicy,
+    [POLICY_LRU] = &lruPolicy,
+    [POLICY_FIFO] = &fifoPolicy,
+    [POLICY_ARC] = &arcPolicy,
+    [POLICY_WSCLOCK] = &wsClockPolicy,
+};
+
+#pragma region Policy Functions
+
+void initializeReplacementPolicy() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    if (replacementPolicyType >= NUM_REPLACEMENT_POLICIES) {
+        replacementPolicyType = POLICY_CLOCK;
+    }
+    replacementPolicy = replacementPolicies[replacementPolicyType];
+    replacementPolicy->init();
+
+    sprintf(logBuffer, "Using %s page replacement\n", replacementPolicy->name);
+    logData(logBuffer);
+    flushLog();
+}
+
+#pragma endregion
@@ -0,0 +1,71 @@
+#ifndef VIRTUALMEMFRAMEWORKC_POLICY_H
+#define VIRTUALMEMFRAMEWORKC_POLICY_H
+
+#include <stdbool.h>
+#include "frame.h"
+
+#pragma region Policy Macros
+
+/* Default number of its own memory references after which a thread's page
+   leaves its working set under WSClock */
+#define DEFAULT_WORKING_SET_WINDOW 512
+/* Number of parts the clock splits the frame table into, each with its own
+   hand so that threads can evict in parallel. Each part is one frame scan
+   wide (1792 / 256) */
+#define NUM_CLOCK_SHARDS 7
+
+#pragma endregion
+
+#pragma region Policy Structs
+
+/**
+ * Defines the page replacement policies that can be selected.
+*/
+typedef enum ReplacementPolicyType {
+    POLICY_CLOCK,             // Second chance clock over the frame table
+    POLICY_LRU,               // Exact least recently used
+    POLICY_FIFO,              // First in first out
+    POLICY_ARC,               // Adaptive replacement cache, resists one-shot scans
+    POLICY_WSCLOCK,           // Clock over each thread's working set in its own virtual time
+    NUM_REPLACEMENT_POLICIES
+} ReplacementPolicyType;
+
+/**
+ * Defines a page replacement policy as a set of hooks called by the frame
+ * table. Every hook, pickVictim included, may be called concurrently by
+ * different threads.
+*/
+typedef struct ReplacementPolicy {
+    const char *name;                    // Name used in logs and benchmarks
+    void (*init)();                      // Resets the policy's state, called by initializeSystemMemory
+    void (*onAllocate)(FTEntry *entry);  // A page was mapped to the frame
+    void (*onAccess)(FTEntry *entry);    // A page mapped to the frame was read or written, NULL if unused
+    void (*onEvict)(FTEntry *entry);     // The frame's page is being evicted, NULL if unused
+    FTEntry* (*pickVictim)();            // Returns a frame to evict, locked with lockEvictionCandidate
+} ReplacementPolicy;
+
+#pragma endregion
+
+#pragma region Policy FunctionDeclarations
+
+/**
+ * Selects the policy named by replacementPolicyType and initializes it.
+*/
+void initializeReplacementPolicy();
+
+#pragma endregion
+
+/* The policy initializeReplacementPolicy will select */
+extern ReplacementPolicyType replacementPolicyType;
+/* The policy currently in use */
+extern const ReplacementPolicy *replacementPolicy;
+/* WSClock's working set window (tau), in references of the page's owner */
+extern uint32_t workingSetWindow;
+
+extern const ReplacementPolicy clockPolicy;
+extern const ReplacementPolicy lruPolicy;
+extern const ReplacementPolicy fifoPolicy;
+extern const ReplacementPolicy arcPolicy;
+extern const ReplacementPolicy wsClockPolicy;
+
+#endif //VIRTUALMEMFRAMEWORKC_POLICY_H
@@ -0,0 +1,338 @@
+#include "prefetch.h"
+#include "reclaim.h"
+#include "swap.h"
+#include "stats.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+extern FrameTable *frameTable;
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+uint8_t prefetchDegree = DEFAULT_PREFETCH_DEGREE;
+
+static pthread_t prefetcherThread;
+static pthread_mutex_t prefetchLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetchCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t prefetchIdleCond = PTHREAD_COND_INITIALIZER;
+static bool prefetcherCreated;
+static bool prefetcherEnabled;
+static bool prefetcherBusy;
+/* Predicted pages waiting to be prefetched, in the order they were predicted */
+static PrefetchRequest prefetchQueue[PREFETCH_QUEUE_SIZE];
+static uint16_t prefetchQueueHead;
+static uint16_t numQueuedPrefetches;
+/* The history of each thread's faults, by thread id less one */
+static FaultHistory faultHistories[NUM_PAGE_TABLES];
+
+#pragma region Prefetch Functions
+
+/**
+ * Returns the entry of the thread's correlation table for the pair of
+ * strides. It holds them only if its strides match.
+*/
+static StrideCorrelation* findCorrelation(FaultHistory *history, int16_t first, int16_t second) {
+    uint32_t bucket = ((uint16_t)first * 31u + (uint16_t)second) * 0x9E3779B1u;
+    return &history->correlations[bucket >> 26 & (PREFETCH_CORRELATION_ENTRIES - 1)];
+}
+
+/**
+ * Returns the stride expected to follow the pair of strides, or 0 if the
+ * thread's correlation table is not confident of any.
+*/
+static int16_t predictCorrelatedStride(FaultHistory *history, int16_t first, int16_t second) {
+    StrideCorrelation *correlation = findCorrelation(history, first, second);
+    if (correlation->first != first || correlation->second != second || correlation->confidence < PREFETCH_CORRELATION_CONFIDENCE) {
+        return 0;
+    }
+    return correlation->next;
+}
+
+/**
+ * Records that the stride followed the thread's two newest strides in its
+ * correlation table, replacing whatever pair the entry held.
+*/
+static void learnCorrelation(FaultHistory *history, int16_t next) {
+    StrideCorrelation *correlation = findCorrelation(history, history->strides[1], history->strides[0]);
+    if (correlation->first == history->strides[1] && correlation->second == history->strides[0] && correlation->next == next) {
+        if (correlation->confidence < PREFETCH_MAX_CONFIDENCE) {
+            correlation->confidence++;
+        }
+        return;
+    }
+    correlation->first = history->strides[1];
+    correlation->second = history->strides[0];
+    correlation->next = next;
+    correlation->confidence = 0;
+}
+
+/**
+ * Queues the predicted pages for the prefetcher, dropping those that do not
+ * fit.
+*/
+static void queuePrefetches(const PrefetchRequest *requests, int numRequests) {
+    pthread_mutex_lock(&prefetchLock);
+    for (int i = 0; i < numRequests; i++) {
+        if (!prefetcherEnabled || numQueuedPrefetches == PREFETCH_QUEUE_SIZE) {
+            STAT_INC(prefetchesDropped);
+            continue;
+        }
+        prefetchQueue[(prefetchQueueHead + numQueuedPrefetches) % PREFETCH_QUEUE_SIZE] = requests[i];
+        numQueuedPrefetches++;
+    }
+    pthread_cond_signal(&prefetchCond);
+    pthread_mutex_unlock(&prefetchLock);
+}
+
+/**
+ * Records the thread's fault on vpn, or an access to a prefetched page that
+ * stands for one, and queues the pages predicted after it. A fault has
+ * every predicted page queued. A hit only has the last one queued, the
+ * others were queued by the faults and hits before it.
+*/
+static void recordFault(uint8_t threadId, uint32_t vpn, bool hit) {
+    uint8_t degree = prefetchDegree < PREFETCH_DEGREE_LIMIT ? prefetchDegree : PREFETCH_DEGREE_LIMIT;
+    FaultHistory *history = &faultHistories[threadId - 1];
+    int16_t stride = (int16_t)(vpn - history->lastVpn);
+    history->lastVpn = vpn;
+    if (history->numFaults < 4) {
+        history->numFaults++;
+    }
+    // The first fault has no stride, the second none before it to compare
+    // with, and the third no pair of strides before it
+    if (history->numFaults < 2) {
+        return;
+    }
+    if (history->numFaults >= 3) {
+        if (stride != history->strides[0]) {
+            history->strideConfidence = 0;
+        } else if (history->strideConfidence < PREFETCH_MAX_CONFIDENCE) {
+            history->strideConfidence++;
+        }
+    }
+    if (history->numFaults == 4) {
+        learnCorrelation(history, stride);
+    }
+    history->strides[1] = history->strides[0];
+    history->strides[0] = stride;
+    if (stride == 0 || degree == 0) {
+        return;
+    }
+
+    // Follow the constant stride if it held long enough, otherwise the
+    // strides the correlation table expects, for as long as it has them
+    PrefetchRequest requests[PREFETCH_DEGREE_LIMIT];
+    int numRequests = 0;
+    uint8_t source = history->strideConfidence >= PREFETCH_STRIDE_CONFIDENCE ? PREFETCH_STRIDE : PREFETCH_CORRELATION;
+    int16_t first = history->strides[1];
+    int16_t second = history->strides[0];
+    int32_t predictedVpn = vpn;
+    for (int i = 0; i < degree; i++) {
+        int16_t next = source == PREFETCH_STRIDE ? stride : predictCorrelatedStride(history, first, second);
+        predictedVpn += next;
+        if (next == 0 || predictedVpn < 0 || predictedVpn >= NUM_PAGE_TABLE_ENTRIES) {
+            break;
+        }
+        first = second;
+        second = next;
+        if (!hit || i == degree - 1) {
+            requests[numRequests].threadId = threadId;
+            requests[numRequests].source = source;
+            requests[numRequests].vpn = predictedVpn;
+            numRequests++;
+        }
+    }
+    // Stop predicting while too many of the thread's prefetched pages have
+    // not been used yet
+    int allowed = PREFETCH_MAX_PENDING - __atomic_load_n(&history->numPending, __ATOMIC_RELAXED);
+    if (numRequests > allowed) {
+        numRequests = allowed > 0 ? allowed : 0;
+    }
+    if (numRequests > 0) {
+        queuePrefetches(requests, numRequests);
+    }
+}
+
+void predictPageFaults(const Thread *thread, uint32_t vpn) {
+    // Only pages coming back from swap tell which pages will come back next,
+    // a page faulted on for the first time has no slot
+    PTEntry *pte = &getThreadPageTable(thread->threadId)->entries[vpn];
+    if (prefetchDegree == 0 || pte->sharedRegion || pte->swapSlot == SWAP_SLOT_NONE) {
+        return;
+    }
+    STAT_INC(prefetchFaults);
+    recordFault(thread->threadId, vpn, false);
+}
+
+/**
+ * Brings the requested page in from its swap slot, if it is still swapped
+ * out to the swap device, and maps it for its owner. The page is claimed in
+ * its page table entry while it is read. Anything that maps the page
+ * meanwhile clears the claim, and the page read is then dropped, since the
+ * page may have been written and written out again to the same slot.
+*/
+static void prefetchPage(PrefetchRequest request) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    // The frames down to the low watermark are left for faulting threads,
+    // a guess is never worth making one of them evict a page
+    if (countFreeFrames() <= reclaimConfig.lowWatermark) {
+        STAT_INC(prefetchesDropped);
+        return;
+    }
+    PageTable *pageTable = getThreadPageTable(request.threadId);
+    PTEntry *pte = &pageTable->entries[request.vpn];
+    pthread_mutex_lock(&pageTable->lock);
+    uint16_t slot = pte->swapSlot;
+    // A page in transit is not in its slot yet
+    bool claimed = pte->valid && pte->present == 0 && !pte->sharedRegion && !pte->prefetching && !pte->inTransit
+                   && swapSlotOnDisk(slot);
+    if (claimed) {
+        pte->prefetching = 1;
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+    if (!claimed) {
+        return;
+    }
+
+    FTEntry *entry = takeFrameFromFreeList();
+    bool read = entry != NULL && readSwapSlot(slot, entry->physAddr);
+
+    pthread_mutex_lock(&pageTable->lock);
+    bool mapped = read && pte->prefetching;
+    if (mapped) {
+        // The frame has no owner yet, so nothing else sees it
+        entry->dirty = 0;
+        entry->prefetched = request.source;
+        entry->next = NULL;
+        mapFrameToOwnerPage(request.threadId, request.vpn, entry->frameNum);
+    }
+    pte->prefetching = 0;
+    pthread_mutex_unlock(&pageTable->lock);
+    if (!mapped) {
+        if (entry != NULL) {
+            returnFrameToFreeList(entry);
+        }
+        STAT_INC(prefetchesDropped);
+        return;
+    }
+
+    __atomic_add_fetch(&faultHistories[request.threadId - 1].numPending, 1, __ATOMIC_RELAXED);
+    if (request.source == PREFETCH_STRIDE) {
+        STAT_INC(stridePrefetches);
+    } else {
+        STAT_INC(correlationPrefetches);
+    }
+    sprintf(logBuffer, "prefetchPage(): Prefetched thread %d's vpn %d from slot %d into frame %d\n",
+                        request.threadId, request.vpn, slot, entry->frameNum);
+    logData(logBuffer);
+    flushLog();
+}
+
+/**
+ * Body of the prefetcher thread. Prefetches queued pages one at a time, in
+ * the order they were predicted, while it is enabled.
+*/
+static void* prefetchInBackground(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&prefetchLock);
+    while (true) {
+        while (!prefetcherEnabled || numQueuedPrefetches == 0) {
+            pthread_cond_wait(&prefetchCond, &prefetchLock);
+        }
+        PrefetchRequest request = prefetchQueue[prefetchQueueHead];
+        prefetchQueueHead = (prefetchQueueHead + 1) % PREFETCH_QUEUE_SIZE;
+        numQueuedPrefetches--;
+        prefetcherBusy = true;
+        pthread_mutex_unlock(&prefetchLock);
+
+        prefetchPage(request);
+
+        pthread_mutex_lock(&prefetchLock);
+        prefetcherBusy = false;
+        pthread_cond_broadcast(&prefetchIdleCond);
+    }
+    return NULL;
+}
+
+void notePrefetchAccess(uint8_t threadId, uint32_t vpn, FTEntry *entry) {
+    uint8_t source = entry->prefetched;
+    if (source == PREFETCH_NONE) {
+        return;
+    }
+    entry->prefetched = PREFETCH_NONE;
+    if (source == PREFETCH_READAHEAD) {
+        STAT_INC(readaheadHits);
+        return;
+    }
+    __atomic_sub_fetch(&faultHistories[frameOwner(entry) - 1].numPending, 1, __ATOMIC_RELAXED);
+    if (source == PREFETCH_STRIDE) {
+        STAT_INC(strideHits);
+    } else {
+        STAT_INC(correlationHits);
+    }
+    // Without the prefetch this access would have faulted, and the pattern
+    // would be lost if it went unrecorded
+    recordFault(threadId, vpn, true);
+}
+
+void notePrefetchEviction(FTEntry *entry) {
+    uint8_t source = entry->prefetched;
+    if (source == PREFETCH_NONE) {
+        return;
+    }
+    entry->prefetched = PREFETCH_NONE;
+    if (source == PREFETCH_READAHEAD) {
+        STAT_INC(readaheadWasted);
+        // The owner is reading ahead further than it reads, so read ahead less
+        getThreadPageTable(frameOwner(entry))->readaheadWindow /= 2;
+        return;
+    }
+    __atomic_sub_fetch(&faultHistories[frameOwner(entry) - 1].numPending, 1, __ATOMIC_RELAXED);
+    if (source == PREFETCH_STRIDE) {
+        STAT_INC(strideWasted);
+    } else {
+        STAT_INC(correlationWasted);
+    }
+}
+
+#pragma endregion
+
+#pragma region Prefetch Callback
+
+void startPrefetcher() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    sprintf(logBuffer, "startPrefetcher(): Predicting %d pages ahead of each fault\n", prefetchDegree);
+    logData(logBuffer);
+    flushLog();
+
+    pthread_mutex_lock(&prefetchLock);
+    // The thread is created once and only parked between runs, for the same
+    // reason as the reclaimer's
+    if (!prefetcherCreated) {
+        pthread_create(&prefetcherThread, NULL, prefetchInBackground, NULL);
+        prefetcherCreated = true;
+    }
+    // Threads of a previous run mean nothing now
+    memset(faultHistories, 0, sizeof(faultHistories));
+    prefetchQueueHead = 0;
+    numQueuedPrefetches = 0;
+    prefetcherEnabled = true;
+    pthread_mutex_unlock(&prefetchLock);
+}
+
+void stopPrefetcher() {
+    pthread_mutex_lock(&prefetchLock);
+    prefetcherEnabled = false;
+    numQueuedPrefetches = 0;
+    // Wait for the page being prefetched
+    while (prefetcherBusy) {
+        pthread_cond_wait(&prefetchIdleCond, &prefetchLock);
+    }
+    pthread_mutex_unlock(&prefetchLock);
+}
+
+#pragma endregion
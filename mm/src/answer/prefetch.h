@@ -0,0 +1,129 @@
+#ifndef VIRTUALMEMFRAMEWORKC_PREFETCH_H
+#define VIRTUALMEMFRAMEWORKC_PREFETCH_H
+
+#include <stdint.h>
+#include "thread.h"
+#include "page.h"
+#include "frame.h"
+
+#pragma region Prefetch Macros
+
+/* Default number of pages predicted ahead of each fault */
+#define DEFAULT_PREFETCH_DEGREE 4
+/* Most pages that can ever be predicted ahead of a single fault */
+#define PREFETCH_DEGREE_LIMIT 16
+/* Times in a row a stride must repeat before pages are predicted from it */
+#define PREFETCH_STRIDE_CONFIDENCE 2
+/* Times a pair of strides must have been followed by the same stride again
+   before that stride is predicted from them */
+#define PREFETCH_CORRELATION_CONFIDENCE 1
+/* Confidence at which the counts above stop growing, so a pattern that
+   changes is unlearnt quickly */
+#define PREFETCH_MAX_CONFIDENCE 3
+/* Number of entries in each thread's table of stride correlations (a power
+   of two) */
+#define PREFETCH_CORRELATION_ENTRIES 64
+/* Most pages prefetched for a thread that were neither accessed nor evicted
+   yet */
+#define PREFETCH_MAX_PENDING 32
+/* Number of predicted pages that can wait for the prefetcher */
+#define PREFETCH_QUEUE_SIZE 128
+
+#pragma endregion
+
+#pragma region Prefetch Structs
+
+/**
+ * Defines an entry of a thread's correlation table: the stride that followed
+ * the last time two strides were seen in a row.
+*/
+typedef struct StrideCorrelation {
+    int16_t first;      // The older of the two strides
+    int16_t second;     // The newer of the two strides
+    int16_t next;       // The stride that followed them
+    uint8_t confidence; // Times in a row the same stride followed them, less one
+} StrideCorrelation;
+
+/**
+ * Defines the history the prefetcher keeps of a thread's faults, as strides
+ * between the pages faulted on. Patterns are learnt two ways: a stride that
+ * repeats fault after fault, and a table of the stride that followed each
+ * pair of strides, which catches sequences that repeat without a constant
+ * stride, such as walking several arrays side by side. An access to a page
+ * the prefetcher brought in counts as the fault it avoided. Only updated by
+ * the thread itself.
+*/
+typedef struct FaultHistory {
+    uint16_t lastVpn;                                             // Page of the thread's last fault
+    uint8_t numFaults;                                            // Faults seen, up to 4, so it is known which strides are set
+    uint8_t strideConfidence;                                     // Times in a row the newest stride repeated
+    int16_t strides[2];                                           // Strides between the last three faults, newest first
+    uint8_t numPending;                                           // Pages prefetched for the thread that were neither accessed nor evicted yet
+    StrideCorrelation correlations[PREFETCH_CORRELATION_ENTRIES]; // The thread's correlation table
+} FaultHistory;
+
+/**
+ * Defines a page predicted to fault, waiting for the prefetcher.
+*/
+typedef struct PrefetchRequest {
+    uint8_t threadId; // The page's owner
+    uint8_t source;   // The PrefetchSource that predicted the page
+    uint16_t vpn;     // The page's virtual page number
+} PrefetchRequest;
+
+#pragma endregion
+
+#pragma region Prefetch FunctionDeclarations
+
+/**
+ * Records a fault of the thread's page at vpn in the thread's history, and
+ * queues the swapped out pages it predicts to fault next for the prefetcher.
+ * Called before the fault is handled, so the prefetcher reads the predicted
+ * pages while the thread waits for its own. Faults on pages of shared
+ * regions and on pages that were never swapped out are ignored. The
+ * thread's page table must be locked by the caller.
+*/
+void predictPageFaults(const Thread *thread, uint32_t vpn);
+
+/**
+ * Counts the thread's access to its page at vpn, mapped to the given frame,
+ * as a hit if the frame was brought in ahead of it. A hit on a page the
+ * prefetcher predicted is recorded in the thread's history in place of the
+ * fault it avoided. The frame and the thread's page table must be locked by
+ * the caller.
+*/
+void notePrefetchAccess(uint8_t threadId, uint32_t vpn, FTEntry *entry);
+
+/**
+ * Counts the eviction of a frame that was brought in ahead of an access and
+ * never accessed as wasted. A frame read ahead also shrinks its owner's
+ * readahead window. The frame and its owner's page table must be locked by
+ * the caller.
+*/
+void notePrefetchEviction(FTEntry *entry);
+
+#pragma endregion
+
+#pragma region Prefetch Callback
+
+/**
+ * Forgets every thread's history and starts the prefetcher thread, which
+ * brings in the pages queued by predictPageFaults. It only takes free frames,
+ * and only while there are more than the reclaimer's low watermark, so it
+ * never evicts a page itself.
+*/
+void startPrefetcher();
+
+/**
+ * Drops the queued predictions and waits for the page being prefetched, if
+ * any. The thread is kept parked for the next startPrefetcher.
+*/
+void stopPrefetcher();
+
+#pragma endregion
+
+/* Pages predicted ahead of each fault, at most PREFETCH_DEGREE_LIMIT. 0 turns
+   the prefetcher off */
+extern uint8_t prefetchDegree;
+
+#endif //VIRTUALMEMFRAMEWORKC_PREFETCH_H
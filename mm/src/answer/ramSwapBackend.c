@@ -0,0 +1,78 @@
+#include "swapBackend.h"
+#include "swap.h"
+#include <string.h>
+#include <sys/mman.h>
+
+extern const int PAGE_SIZE;
+
+/* Memory holding every slot, NULL while the backend is closed */
+static uint8_t *ramSlots;
+
+#pragma region RAM Swap Backend
+
+/**
+ * Returns the bytes reserved for every slot.
+*/
+static size_t ramSize() {
+    return (size_t)NUM_SWAP_SLOTS * PAGE_SIZE;
+}
+
+static bool ramOpen() {
+    // Reserve room for every slot without committing to it, the host only
+    // backs the slots that are written
+    void *slots = mmap(NULL, ramSize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (slots == MAP_FAILED) {
+        return false;
+    }
+    ramSlots = slots;
+    return true;
+}
+
+/**
+ * Copies the pages of the run between their buffers and their slots.
+*/
+static void ramTransfer(bool write, SwapSlotRun *run) {
+    uint8_t *slot = ramSlots + (size_t)run->firstSlot * PAGE_SIZE;
+    for (int i = 0; i < run->numPages; i++, slot += PAGE_SIZE) {
+        if (write) {
+            memcpy(slot, run->pages[i].iov_base, PAGE_SIZE);
+        } else {
+            memcpy(run->pages[i].iov_base, slot, PAGE_SIZE);
+        }
+    }
+    run->result = (ssize_t)run->numPages * PAGE_SIZE;
+}
+
+static void ramWritePages(SwapSlotRun *runs, int numRuns) {
+    for (int i = 0; i < numRuns; i++) {
+        ramTransfer(true, &runs[i]);
+    }
+}
+
+static void ramReadPages(SwapSlotRun *runs, int numRuns) {
+    for (int i = 0; i < numRuns; i++) {
+        ramTransfer(false, &runs[i]);
+    }
+}
+
+static void ramDiscard(uint16_t slot) {
+    // Hand the slot's memory back to the host. It reads as zeros until it
+    // is written again
+    madvise(ramSlots + (size_t)slot * PAGE_SIZE, PAGE_SIZE, MADV_DONTNEED);
+}
+
+static void ramClose() {
+    munmap(ramSlots, ramSize());
+    ramSlots = NULL;
+}
+
+const SwapBackend ramSwapBackend = {
+    .name = "RAM",
+    .open = ramOpen,
+    .writePages = ramWritePages,
+    .readPages = ramReadPages,
+    .discard = ramDiscard,
+    .close = ramClose,
+};
+
+#pragma endregion
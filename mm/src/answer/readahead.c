@@ -0,0 +1,117 @@
+#include "readahead.h"
+#include "swap.h"
+#include "stats.h"
+#include "utils.h"
+#include <stdio.h>
+
+extern FrameTable *frameTable;
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+uint8_t readaheadMaxWindow = DEFAULT_READAHEAD_MAX_WINDOW;
+
+#pragma region Readahead Functions
+
+/**
+ * Returns whether the page can be read ahead: it is valid, not in memory,
+ * not a page of a shared region, and in a slot on the swap device that it is
+ * no longer in transit to. Pages
+ * that were never written or sit in the compressed pool gain nothing from
+ * being read along with others.
+*/
+static bool canReadAhead(PTEntry *pte) {
+    return pte->valid && pte->present == 0 && !pte->sharedRegion && !pte->inTransit && swapSlotOnDisk(pte->swapSlot);
+}
+
+/**
+ * Updates the thread's readahead window for a read fault on vpn and returns
+ * it. The thread's page table must be locked by the caller.
+*/
+static uint8_t nextReadaheadWindow(PageTable *pageTable, uint32_t vpn) {
+    uint8_t maxWindow = readaheadMaxWindow < READAHEAD_WINDOW_LIMIT ? readaheadMaxWindow : READAHEAD_WINDOW_LIMIT;
+    uint32_t nextVpn = pageTable->readaheadNextVpn;
+    uint8_t window = pageTable->readaheadWindow;
+    if (vpn == nextVpn) {
+        // Every page of the last window was passed without a fault, so the
+        // run is sequential and reading ahead paid off
+        window = window == 0 ? READAHEAD_MIN_WINDOW : window * 2;
+    } else if (vpn > nextVpn || vpn + window < nextVpn) {
+        // A fault inside the last window is still part of the run, a page
+        // read ahead was evicted before it was read and already shrank the
+        // window. Anywhere else starts over
+        window = 0;
+    }
+    if (window > maxWindow) {
+        window = maxWindow;
+    }
+    pageTable->readaheadWindow = window;
+    return window;
+}
+
+int handleReadaheadFault(const Thread *thread, uint32_t vpn) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+    PTEntry *pte = &pageTable->entries[vpn];
+
+    // A page of a shared region is brought in for all of its mappings
+    if (pte->sharedRegion) {
+        handlePageFault(thread, vpn);
+        return 1;
+    }
+
+    // Only this thread faults its pages in, so the pages found here keep
+    // their slots until they are mapped below. The prefetcher may map some
+    // of them first, from the same slots
+    pthread_mutex_lock(&pageTable->lock);
+    uint8_t window = nextReadaheadWindow(pageTable, vpn);
+    int numPages = 1;
+    if (canReadAhead(pte)) {
+        while (numPages <= window && vpn + numPages < NUM_PAGE_TABLE_ENTRIES && canReadAhead(&pageTable->entries[vpn + numPages])) {
+            numPages++;
+        }
+    }
+    pageTable->readaheadNextVpn = vpn + numPages;
+    pthread_mutex_unlock(&pageTable->lock);
+    if (numPages == 1) {
+        handlePageFault(thread, vpn);
+        return 1;
+    }
+
+    // Allocate the frames with the page table unlocked, since they may have
+    // to evict frames
+    uint16_t frameNums[READAHEAD_WINDOW_LIMIT + 1];
+    for (int i = 0; i < numPages; i++) {
+        frameNums[i] = allocateFrameForPage(thread, vpn + i);
+    }
+    swapPagesFromDisk(thread, vpn, frameNums, numPages);
+    STAT_INC(pageFaults);
+    __atomic_fetch_add(&vmStats.readaheadPages, numPages - 1, __ATOMIC_RELAXED);
+
+    int numPrefetched = 0;
+    pthread_mutex_lock(&pageTable->lock);
+    for (int i = 0; i < numPages; i++) {
+        // Collect the frames of pages the prefetcher mapped first at the
+        // front, they are given back below
+        if (pageTable->entries[vpn + i].present) {
+            frameNums[numPrefetched++] = frameNums[i];
+            continue;
+        }
+        // The faulting page is read right away, the others only count once
+        // they are. The frames have no owner yet, so nothing else sees them
+        frameTable->entries[frameNums[i]].prefetched = i > 0 ? PREFETCH_READAHEAD : PREFETCH_NONE;
+        mapFrameToPage(thread, vpn + i, frameNums[i]);
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+    for (int i = 0; i < numPrefetched; i++) {
+        releaseFrame(thread, &frameTable->entries[frameNums[i]]);
+    }
+
+    sprintf(logBuffer, "Thread %d handleReadaheadFault(): Brought in vpn %d and read ahead %d pages\n",
+                        thread->threadId, vpn, numPages - 1);
+    logData(logBuffer);
+    flushLog();
+    return numPages;
+}
+
+#pragma endregion
@@ -0,0 +1,40 @@
+#ifndef VIRTUALMEMFRAMEWORKC_READAHEAD_H
+#define VIRTUALMEMFRAMEWORKC_READAHEAD_H
+
+#include <stdint.h>
+#include "thread.h"
+#include "page.h"
+#include "frame.h"
+
+#pragma region Readahead Macros
+
+/* Pages read ahead by the first fault found to continue a sequential run */
+#define READAHEAD_MIN_WINDOW 4
+/* Default most pages read ahead by a single fault */
+#define DEFAULT_READAHEAD_MAX_WINDOW 32
+/* Most pages that can ever be read ahead by a single fault */
+#define READAHEAD_WINDOW_LIMIT 64
+
+#pragma endregion
+
+#pragma region Readahead FunctionDeclarations
+
+/**
+ * Brings the thread's page into memory for a read, as handlePageFault does.
+ * If the fault continues a sequential run of faults, the swapped out pages
+ * right after it are brought in along with it and their slots read in as
+ * few calls as possible. The window of pages read ahead doubles with every
+ * fault that lands just past the previous window, and is halved whenever a
+ * page read ahead is evicted before it is accessed (see
+ * notePrefetchEviction). Returns the number of pages brought in. The
+ * thread's page table must not be locked by the caller.
+*/
+int handleReadaheadFault(const Thread *thread, uint32_t vpn);
+
+#pragma endregion
+
+/* Most pages read ahead by a single fault, at most READAHEAD_WINDOW_LIMIT.
+   0 turns readahead off */
+extern uint8_t readaheadMaxWindow;
+
+#endif //VIRTUALMEMFRAMEWORKC_READAHEAD_H
@@ -0,0 +1,192 @@
+#include "reclaim.h"
+#include "frame.h"
+#include "stats.h"
+#include "swap.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+extern FrameTable *frameTable;
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+ReclaimConfig reclaimConfig = {
+    .lowWatermark = DEFAULT_LOW_WATERMARK,
+    .highWatermark = DEFAULT_HIGH_WATERMARK,
+    .batchSize = DEFAULT_RECLAIM_BATCH_SIZE,
+};
+
+/* The reclaimer evicts on behalf of the kernel, which has thread id 0 */
+static Thread reclaimerThread;
+static pthread_mutex_t reclaimLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reclaimCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t reclaimIdleCond = PTHREAD_COND_INITIALIZER;
+static bool reclaimerCreated;
+static bool reclaimerEnabled;
+static bool reclaimerBusy;
+static bool reclaimRequested;
+/* Frames waiting to be written back, in the order they were scheduled */
+static uint16_t writeBackQueue[NUM_FRAME_TABLE_ENTRIES];
+static uint16_t writeBackHead;
+static uint16_t numWriteBacks;
+static bool writeBackScheduled[NUM_FRAME_TABLE_ENTRIES];
+
+#pragma region Reclaim Functions
+
+/**
+ * Writes back every frame in the write back queue that is still dirty and
+ * mapped. Frames whose owner is busy are skipped, the replacement policy
+ * schedules them again if they are still dirty when it next passes them.
+*/
+static void writeBackScheduledFrames() {
+    pthread_mutex_lock(&reclaimLock);
+    while (numWriteBacks > 0 && reclaimerEnabled) {
+        uint16_t frameNum = writeBackQueue[writeBackHead];
+        writeBackHead = (writeBackHead + 1) % NUM_FRAME_TABLE_ENTRIES;
+        numWriteBacks--;
+        writeBackScheduled[frameNum] = false;
+        pthread_mutex_unlock(&reclaimLock);
+
+        // The frame is written with its locks dropped, as eviction writes
+        // it, while its pages wait before writing to it
+        FTEntry *entry = &frameTable->entries[frameNum];
+        if (lockEvictionCandidate(entry, false)) {
+            PageTransit transit;
+            bool inTransit = entry->dirty && beginWriteBackPage(&reclaimerThread, entry, &transit);
+            unlockEvictionCandidate(entry);
+            if (inTransit) {
+                finishPageTransit(&reclaimerThread, &transit);
+            }
+        }
+
+        pthread_mutex_lock(&reclaimLock);
+    }
+    pthread_mutex_unlock(&reclaimLock);
+}
+
+/**
+ * Body of the reclaimer thread. Sleeps until woken, then writes back any
+ * scheduled frames and evicts frames in batches until the high watermark is
+ * reached.
+*/
+static void* reclaimFrames(void *arg) {
+    (void)arg;
+    char logBuffer[MAX_BUFFER_SIZE];
+    pthread_mutex_lock(&reclaimLock);
+    while (true) {
+        while ((!reclaimRequested && numWriteBacks == 0) || !reclaimerEnabled) {
+            pthread_cond_wait(&reclaimCond, &reclaimLock);
+        }
+        // The reclaimer may only have been woken to write back frames
+        bool evictionRequested = reclaimRequested;
+        reclaimRequested = false;
+        reclaimerBusy = true;
+        pthread_mutex_unlock(&reclaimLock);
+
+        // Cleaning frames first lets the evictions below drop them without I/O
+        writeBackScheduledFrames();
+
+        STAT_INC(reclaimerWakeups);
+        sprintf(logBuffer, "reclaimFrames(): Woken with %d free frames...\n", countFreeFrames());
+        logData(logBuffer);
+        flushLog();
+
+        // Evict in batches, checking whether the reclaimer was stopped and
+        // writing back frames the policy scheduled between batches
+        while (evictionRequested && countFreeFrames() < reclaimConfig.highWatermark && __atomic_load_n(&reclaimerEnabled, __ATOMIC_RELAXED)) {
+            writeBackScheduledFrames();
+            for (int i = 0; i < reclaimConfig.batchSize && countFreeFrames() < reclaimConfig.highWatermark; i++) {
+                returnFrameToFreeList(&frameTable->entries[evictAFrame(&reclaimerThread)]);
+                STAT_INC(reclaimedFrames);
+            }
+        }
+
+        sprintf(logBuffer, "reclaimFrames(): Sleeping with %d free frames...\n", countFreeFrames());
+        logData(logBuffer);
+        flushLog();
+
+        pthread_mutex_lock(&reclaimLock);
+        reclaimerBusy = false;
+        pthread_cond_broadcast(&reclaimIdleCond);
+    }
+    return NULL;
+}
+
+void wakeReclaimerIfNeeded(uint16_t numFreeFrames) {
+    if (numFreeFrames >= reclaimConfig.lowWatermark) {
+        return;
+    }
+    pthread_mutex_lock(&reclaimLock);
+    reclaimRequested = true;
+    pthread_cond_signal(&reclaimCond);
+    pthread_mutex_unlock(&reclaimLock);
+}
+
+void scheduleWriteBack(uint16_t frameNum) {
+    pthread_mutex_lock(&reclaimLock);
+    if (reclaimerEnabled && !writeBackScheduled[frameNum]) {
+        writeBackQueue[(writeBackHead + numWriteBacks) % NUM_FRAME_TABLE_ENTRIES] = frameNum;
+        numWriteBacks++;
+        writeBackScheduled[frameNum] = true;
+        pthread_cond_signal(&reclaimCond);
+    }
+    pthread_mutex_unlock(&reclaimLock);
+}
+
+#pragma endregion
+
+#pragma region Reclaim Callback
+
+void startReclaimer() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    // Keep the watermarks within the frame table so the reclaimer always has
+    // frames left to evict
+    if (reclaimConfig.highWatermark > NUM_FRAME_TABLE_ENTRIES / 2) {
+        reclaimConfig.highWatermark = NUM_FRAME_TABLE_ENTRIES / 2;
+    }
+    if (reclaimConfig.lowWatermark > reclaimConfig.highWatermark) {
+        reclaimConfig.lowWatermark = reclaimConfig.highWatermark;
+    }
+    if (reclaimConfig.batchSize == 0) {
+        reclaimConfig.batchSize = 1;
+    }
+    sprintf(logBuffer, "startReclaimer(): Reclaiming from %d up to %d free frames in batches of %d\n",
+                        reclaimConfig.lowWatermark, reclaimConfig.highWatermark, reclaimConfig.batchSize);
+    logData(logBuffer);
+    flushLog();
+
+    pthread_mutex_lock(&reclaimLock);
+    // The thread is created once and only parked between runs, since a test
+    // that panics inside one of its threads keeps running on that thread's
+    // stack, which pthread_create does not cope with
+    if (!reclaimerCreated) {
+        reclaimerThread.threadId = 0;
+        pthread_create(&reclaimerThread.thread, NULL, reclaimFrames, NULL);
+        reclaimerCreated = true;
+    }
+    reclaimRequested = false;
+    // Write backs scheduled before the last stop refer to frames of a
+    // previous run
+    for (int i = 0; i < NUM_FRAME_TABLE_ENTRIES; i++) {
+        writeBackScheduled[i] = false;
+    }
+    writeBackHead = 0;
+    numWriteBacks = 0;
+    reclaimerEnabled = true;
+    pthread_mutex_unlock(&reclaimLock);
+}
+
+void stopReclaimer() {
+    pthread_mutex_lock(&reclaimLock);
+    __atomic_store_n(&reclaimerEnabled, false, __ATOMIC_RELAXED);
+    reclaimRequested = false;
+    // Wait for the batch in progress to finish
+    while (reclaimerBusy) {
+        pthread_cond_wait(&reclaimIdleCond, &reclaimLock);
+    }
+    pthread_mutex_unlock(&reclaimLock);
+}
+
+#pragma endregion
@@ -0,0 +1,61 @@
+#ifndef VIRTUALMEMFRAMEWORKC_RECLAIM_H
+#define VIRTUALMEMFRAMEWORKC_RECLAIM_H
+
+#include <stdint.h>
+
+#pragma region Reclaim Macros
+
+/* Default number of free frames below which the reclaimer is woken */
+#define DEFAULT_LOW_WATERMARK 32
+/* Default number of free frames the reclaimer evicts up to */
+#define DEFAULT_HIGH_WATERMARK 96
+/* Default number of frames evicted before the watermarks are rechecked */
+#define DEFAULT_RECLAIM_BATCH_SIZE 16
+
+#pragma endregion
+
+#pragma region Reclaim Structs
+
+/**
+ * Defines the settings of the background reclaimer. They are read when the
+ * reclaimer is started, so changes take effect on the next startupCallback.
+*/
+typedef struct ReclaimConfig {
+    uint16_t lowWatermark;  // The reclaimer wakes when fewer frames than this are free
+    uint16_t highWatermark; // The reclaimer sleeps once this many frames are free
+    uint16_t batchSize;     // Frames evicted between watermark checks
+} ReclaimConfig;
+
+#pragma endregion
+
+#pragma region Reclaim FunctionDeclarations
+
+/**
+ * Starts the background reclaimer, creating its thread on first use.
+*/
+void startReclaimer();
+
+/**
+ * Stops the background reclaimer and waits until it is no longer evicting.
+ * The thread is kept parked for the next startReclaimer.
+*/
+void stopReclaimer();
+
+/**
+ * Wakes the reclaimer if the given number of free frames is below the low
+ * watermark. Cheap enough to call on every frame allocation.
+*/
+void wakeReclaimerIfNeeded(uint16_t numFreeFrames);
+
+/**
+ * Asks the reclaimer to write the dirty frame back to swap in the
+ * background so it can later be evicted without I/O. Frames already
+ * scheduled are ignored.
+*/
+void scheduleWriteBack(uint16_t frameNum);
+
+#pragma endregion
+
+extern ReclaimConfig reclaimConfig;
+
+#endif //VIRTUALMEMFRAMEWORKC_RECLAIM_H
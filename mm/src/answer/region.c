@@ -0,0 +1,535 @@
+#include "region.h"
+#include "memory.h"
+#include "policy.h"
+#include "stats.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern SharedRegionTable *sharedRegionTable;
+extern FrameTable *frameTable;
+extern const int PAGE_SIZE;
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+_Static_assert(SHARED_REGION_PAGES < SHARED_PAGE_NOT_RESIDENT, "Shared pages must be numbered below SHARED_PAGE_NOT_RESIDENT");
+
+#pragma region Shared Region Helper Functions
+
+/**
+ * Returns the shared page mapped by the page table entry.
+*/
+static SharedPage* sharedPageOf(PTEntry *pte) {
+    return &sharedRegionTable->pages[pte->regionPage];
+}
+
+/**
+ * Returns the region of the shared page mapped by the page table entry.
+*/
+static SharedRegion* sharedRegionOf(PTEntry *pte) {
+    return &sharedRegionTable->regions[sharedPageOf(pte)->regionNum];
+}
+
+/**
+ * Returns the bit standing for the thread in a bitmask of threads.
+*/
+static uint32_t threadBit(uint8_t threadId) {
+    return 1u << (threadId - 1);
+}
+
+/**
+ * Returns a bitmask with bit threadId - 1 set for every thread mapping the
+ * region. The region must be locked by the caller.
+*/
+static uint32_t regionThreads(SharedRegion *region) {
+    uint32_t threads = 0;
+    for (int i = 0; i < region->numMappings; i++) {
+        threads |= threadBit(region->mappings[i].threadId);
+    }
+    return threads;
+}
+
+/**
+ * Locks the page tables of the threads in the bitmask, in increasing order
+ * of threadId so that two regions being brought in never wait on each
+ * other.
+*/
+static void lockRegionPageTables(uint32_t threads) {
+    for (uint8_t threadId = 1; threadId <= NUM_PAGE_TABLES; threadId++) {
+        if (threads & threadBit(threadId)) {
+            pthread_mutex_lock(&getThreadPageTable(threadId)->lock);
+        }
+    }
+}
+
+/**
+ * Unlocks the page tables locked by lockRegionPageTables.
+*/
+static void unlockRegionPageTables(uint32_t threads) {
+    for (uint8_t threadId = 1; threadId <= NUM_PAGE_TABLES; threadId++) {
+        if (threads & threadBit(threadId)) {
+            pthread_mutex_unlock(&getThreadPageTable(threadId)->lock);
+        }
+    }
+}
+
+/**
+ * Returns the number of bytes of the region's file that the page at
+ * pageIndex maps, which is less than a page only for the region's last page.
+*/
+static size_t filePageBytes(SharedRegion *region, uint32_t pageIndex) {
+    uint32_t pageStart = pageIndex * PAGE_SIZE;
+    uint32_t bytesLeft = region->fileLength - pageStart;
+    return bytesLeft < (uint32_t)PAGE_SIZE ? bytesLeft : (uint32_t)PAGE_SIZE;
+}
+
+/**
+ * Reads the page at pageIndex of the region's file into the frame. Bytes
+ * past the end of the file or of the mapping are zeroed.
+*/
+static void readPageFromFile(const Thread *thread, SharedRegion *region, uint32_t pageIndex, FTEntry *entry) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    ssize_t readBytes = pread(region->fd, entry->physAddr, filePageBytes(region, pageIndex),
+                              region->fileOffset + (off_t)pageIndex * PAGE_SIZE);
+    if (readBytes < 0) {
+        sprintf(logBuffer, "Thread %d readPageFromFile(): Error reading page %d of the file into frame %d\n",
+                            thread->threadId, pageIndex, entry->frameNum);
+        logData(logBuffer);
+        flushLog();
+        perror("Errno");
+        readBytes = 0;
+    }
+    memset(entry->physAddr + readBytes, 0, PAGE_SIZE - readBytes);
+    STAT_INC(fileReads);
+}
+
+/**
+ * Writes the frame to the page at pageIndex of the region's file. Only the
+ * mapped bytes of the region's last page are written. Returns false if the
+ * write failed.
+*/
+static bool writePageToFile(SharedRegion *region, uint32_t pageIndex, FTEntry *entry) {
+    size_t pageBytes = filePageBytes(region, pageIndex);
+    ssize_t writtenBytes = pwrite(region->fd, entry->physAddr, pageBytes, region->fileOffset + (off_t)pageIndex * PAGE_SIZE);
+    if (writtenBytes != (ssize_t)pageBytes) {
+        return false;
+    }
+    STAT_INC(fileWrites);
+    entry->dirty = 0;
+    return true;
+}
+
+#pragma endregion
+
+#pragma region Shared Region Functions
+
+SharedRegion* createSharedRegion(int size) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    uint32_t numPages = size > 0 ? (size + PAGE_SIZE - 1) / PAGE_SIZE : 0;
+    pthread_mutex_lock(&sharedRegionTable->lock);
+    if (numPages == 0 || sharedRegionTable->numRegions == MAX_SHARED_REGIONS
+        || sharedRegionTable->numPages + numPages > SHARED_REGION_PAGES) {
+        pthread_mutex_unlock(&sharedRegionTable->lock);
+        sprintf(logBuffer, "createSharedRegion(): No room for a region of %d bytes\n", size);
+        logData(logBuffer);
+        flushLog();
+        return NULL;
+    }
+    uint8_t regionNum = sharedRegionTable->numRegions;
+    SharedRegion *region = &sharedRegionTable->regions[regionNum];
+    pthread_mutex_lock(&region->lock);
+    region->firstPage = sharedRegionTable->numPages;
+    region->numPages = numPages;
+    region->numMappings = 0;
+    region->readOnly = false;
+    region->fd = SHARED_REGION_NO_FILE;
+    for (uint32_t i = 0; i < numPages; i++) {
+        SharedPage *page = &sharedRegionTable->pages[region->firstPage + i];
+        page->frameNum = SHARED_PAGE_NOT_RESIDENT;
+        page->swapSlot = SWAP_SLOT_NONE;
+        page->regionNum = regionNum;
+        page->inTransit = 0;
+    }
+    pthread_mutex_unlock(&region->lock);
+    sharedRegionTable->numPages += numPages;
+    sharedRegionTable->numRegions++;
+    pthread_mutex_unlock(&sharedRegionTable->lock);
+
+    sprintf(logBuffer, "createSharedRegion(): Created region %d of %d pages\n", regionNum, numPages);
+    logData(logBuffer);
+    flushLog();
+    return region;
+}
+
+/**
+ * Gives back a region that no thread maps. Regions are handed out in order,
+ * so its slot and pages can only be reused if no region was created after
+ * it. Otherwise it is left without pages until the system shuts down.
+*/
+static void releaseSharedRegion(SharedRegion *region) {
+    pthread_mutex_lock(&sharedRegionTable->lock);
+    pthread_mutex_lock(&region->lock);
+    if (region == &sharedRegionTable->regions[sharedRegionTable->numRegions - 1]) {
+        sharedRegionTable->numPages -= region->numPages;
+        sharedRegionTable->numRegions--;
+    }
+    region->numPages = 0;
+    pthread_mutex_unlock(&region->lock);
+    pthread_mutex_unlock(&sharedRegionTable->lock);
+}
+
+int mapSharedRegion(Thread *thread, SharedRegion *region) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+    uint32_t size = region->numPages * PAGE_SIZE;
+    // The region's first page must not hold any of the rest of the heap
+    uint32_t memoryBeginsAt = (thread->heapBottom + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    if (memoryBeginsAt + size > thread->stackTop) {
+        sprintf(logBuffer, "Thread %d mapSharedRegion(): Not enough heap space left for %d pages\n", thread->threadId, region->numPages);
+        logData(logBuffer);
+        flushLog();
+        return -1;
+    }
+    thread->heapBottom = memoryBeginsAt;
+    allocateHeapMem(thread, size);
+
+    // Point the pages at the region's pages. They are brought in on their
+    // first access, or along with the other mappings if one of them is
+    // accessed first
+    uint32_t firstVpn = virtualAddressToVPN(memoryBeginsAt);
+    pthread_mutex_lock(&region->lock);
+    pthread_mutex_lock(&pageTable->lock);
+    for (uint32_t i = 0; i < region->numPages; i++) {
+        PTEntry *pte = &pageTable->entries[firstVpn + i];
+        pte->sharedRegion = 1;
+        pte->regionPage = region->firstPage + i;
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+    // Pages of mappings beyond the last one kept are only mapped when they
+    // are accessed themselves
+    if (region->numMappings < SHARED_REGION_MAX_MAPPINGS) {
+        region->mappings[region->numMappings].firstVpn = firstVpn;
+        region->mappings[region->numMappings].threadId = thread->threadId;
+        region->numMappings++;
+    }
+    pthread_mutex_unlock(&region->lock);
+
+    sprintf(logBuffer, "Thread %d mapSharedRegion(): Mapped region %ld at vpns %d to %d\n",
+                        thread->threadId, region - sharedRegionTable->regions, firstVpn, firstVpn + region->numPages - 1);
+    logData(logBuffer);
+    flushLog();
+    return memoryBeginsAt;
+}
+
+int mapFile(Thread *thread, const char *path, int offset, int length) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    uint32_t numPages = length > 0 ? (length + PAGE_SIZE - 1) / PAGE_SIZE : 0;
+    uint32_t memoryBeginsAt = (thread->heapBottom + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    if (offset < 0 || offset % PAGE_SIZE != 0 || numPages == 0 || memoryBeginsAt + numPages * PAGE_SIZE > thread->stackTop) {
+        sprintf(logBuffer, "Thread %d mapFile(): Cannot map %d bytes of %s at offset %d\n", thread->threadId, length, path, offset);
+        logData(logBuffer);
+        flushLog();
+        return -1;
+    }
+    // Fall back to mapping the file read only if it cannot be written
+    bool readOnly = false;
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        readOnly = true;
+        fd = open(path, O_RDONLY);
+    }
+    if (fd < 0) {
+        sprintf(logBuffer, "Thread %d mapFile(): Error opening %s\n", thread->threadId, path);
+        logData(logBuffer);
+        flushLog();
+        perror("Errno");
+        return -1;
+    }
+    SharedRegion *region = createSharedRegion(length);
+    if (region == NULL) {
+        close(fd);
+        return -1;
+    }
+    // No thread maps the region yet, but its lock orders these writes
+    // before the faults that read them
+    pthread_mutex_lock(&region->lock);
+    region->readOnly = readOnly;
+    region->fd = fd;
+    region->fileOffset = offset;
+    region->fileLength = length;
+    pthread_mutex_unlock(&region->lock);
+
+    sprintf(logBuffer, "Thread %d mapFile(): Mapping %d bytes of %s at offset %d%s\n",
+                        thread->threadId, length, path, offset, readOnly ? " read only" : "");
+    logData(logBuffer);
+    flushLog();
+    int addr = mapSharedRegion(thread, region);
+    if (addr == -1) {
+        // Nothing maps the region, so neither its file nor its pages are
+        // needed any more
+        pthread_mutex_lock(&region->lock);
+        region->fd = SHARED_REGION_NO_FILE;
+        pthread_mutex_unlock(&region->lock);
+        close(fd);
+        releaseSharedRegion(region);
+    }
+    return addr;
+}
+
+void forkSharedRegions(const Thread *parent, const Thread *child) {
+    uint8_t numRegions = __atomic_load_n(&sharedRegionTable->numRegions, __ATOMIC_RELAXED);
+    for (uint8_t regionNum = 0; regionNum < numRegions; regionNum++) {
+        SharedRegion *region = &sharedRegionTable->regions[regionNum];
+        pthread_mutex_lock(&region->lock);
+        int numMappings = region->numMappings;
+        for (int i = 0; i < numMappings && region->numMappings < SHARED_REGION_MAX_MAPPINGS; i++) {
+            if (region->mappings[i].threadId == parent->threadId) {
+                region->mappings[region->numMappings].firstVpn = region->mappings[i].firstVpn;
+                region->mappings[region->numMappings].threadId = child->threadId;
+                region->numMappings++;
+            }
+        }
+        pthread_mutex_unlock(&region->lock);
+    }
+}
+
+/**
+ * Returns once the shared page is no longer in transit. The region must be
+ * locked by the caller, it is released while waiting and held again on
+ * return.
+*/
+static void waitForSharedPageTransit(SharedRegion *region, SharedPage *page) {
+    while (page->inTransit) {
+        STAT_INC(transitWaits);
+        pthread_cond_wait(&region->transitCond, &region->lock);
+    }
+}
+
+/**
+ * Maps the thread's page to the frame already holding its shared page,
+ * unless it was mapped along with the other mappings meanwhile. The region
+ * must be locked by the caller.
+*/
+static void joinSharedPage(const Thread *thread, uint32_t vpn, SharedPage *page) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+    PTEntry *pte = &pageTable->entries[vpn];
+    // The page cannot be swapped out while its region is locked
+    FTEntry *entry = &frameTable->entries[page->frameNum];
+    pthread_mutex_lock(&pageTable->lock);
+    if (pte->present == 0) {
+        pthread_mutex_lock(&entry->lock);
+        if (!addFrameSharer(entry, thread->threadId, vpn)) {
+            pthread_mutex_unlock(&entry->lock);
+            pthread_mutex_unlock(&pageTable->lock);
+            sprintf(logBuffer, "Thread %d joinSharedPage(): No room left in the reverse map for vpn %d\n", thread->threadId, vpn);
+            logData(logBuffer);
+            flushLog();
+            kernelPanic(thread, vpn * PAGE_SIZE);
+            return;
+        }
+        pte->frameTblNum = entry->frameNum;
+        pte->present = 1;
+        pte->writeProtected = 0;
+        pthread_mutex_unlock(&entry->lock);
+        STAT_INC(sharedPageMaps);
+    }
+    if (replacementPolicy->onAccess != NULL) {
+        replacementPolicy->onAccess(entry);
+    }
+    pthread_mutex_unlock(&pageTable->lock);
+}
+
+/**
+ * Fills the frame with the shared page and maps it to the thread's page as
+ * the frame's owner, and to the pages of every other mapping of the region
+ * as its sharers. The region must be locked by the caller, and the page not
+ * be in memory.
+*/
+static void bringInSharedPage(const Thread *thread, uint32_t vpn, SharedPage *page, SharedRegion *region, uint16_t frameNum) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    FTEntry *entry = &frameTable->entries[frameNum];
+    // The page's slot cannot change while it is not in memory and its
+    // region is locked. A page of a file is always read from the file
+    uint16_t pageIndex = page - &sharedRegionTable->pages[region->firstPage];
+    if (region->fd != SHARED_REGION_NO_FILE) {
+        readPageFromFile(thread, region, pageIndex, entry);
+    } else if (page->swapSlot != SWAP_SLOT_NONE) {
+        swapPageFromDisk(thread, vpn, frameNum);
+    } else {
+        memset(entry->physAddr, 0, PAGE_SIZE);
+    }
+
+    // The thread may map the region beyond the mappings that are kept
+    uint32_t threads = regionThreads(region) | threadBit(thread->threadId);
+    int numMapped = 1;
+    lockRegionPageTables(threads);
+    mapFrameToPage(thread, vpn, frameNum);
+    page->frameNum = frameNum;
+    pthread_mutex_lock(&entry->lock);
+    for (int i = 0; i < region->numMappings; i++) {
+        SharedRegionMapping *mapping = &region->mappings[i];
+        uint16_t mappingVpn = mapping->firstVpn + pageIndex;
+        if (mapping->threadId == thread->threadId && mappingVpn == vpn) {
+            continue;
+        }
+        // A page left out because the reverse map is full joins the frame
+        // once it is accessed itself
+        if (addFrameSharer(entry, mapping->threadId, mappingVpn)) {
+            PTEntry *mappingPte = &getThreadPageTable(mapping->threadId)->entries[mappingVpn];
+            mappingPte->frameTblNum = frameNum;
+            mappingPte->present = 1;
+            mappingPte->writeProtected = 0;
+            STAT_INC(sharedPageMaps);
+            numMapped++;
+        }
+    }
+    pthread_mutex_unlock(&entry->lock);
+    unlockRegionPageTables(threads);
+
+    sprintf(logBuffer, "Thread %d bringInSharedPage(): Mapped shared page %ld in frame %d to %d pages\n",
+                        thread->threadId, page - sharedRegionTable->pages, frameNum, numMapped);
+    logData(logBuffer);
+    flushLog();
+}
+
+void handleSharedPageFault(const Thread *thread, uint32_t vpn) {
+    PTEntry *pte = &getThreadPageTable(thread->threadId)->entries[vpn];
+    // The page an entry maps never changes once its region is mapped
+    SharedPage *page = sharedPageOf(pte);
+    SharedRegion *region = sharedRegionOf(pte);
+
+    STAT_INC(pageFaults);
+    // A page being written out is only brought in or joined once its frame
+    // is in its slot or file
+    pthread_mutex_lock(&region->lock);
+    waitForSharedPageTransit(region, page);
+    if (page->frameNum != SHARED_PAGE_NOT_RESIDENT) {
+        joinSharedPage(thread, vpn, page);
+        pthread_mutex_unlock(&region->lock);
+        return;
+    }
+    pthread_mutex_unlock(&region->lock);
+
+    // Allocate the frame with the region unlocked, since it may have to
+    // evict a frame
+    uint16_t frameNum = allocateFrameForPage(thread, vpn);
+
+    // Another mapping may have brought the page in meanwhile, and even
+    // started writing it out again
+    pthread_mutex_lock(&region->lock);
+    waitForSharedPageTransit(region, page);
+    if (page->frameNum != SHARED_PAGE_NOT_RESIDENT) {
+        joinSharedPage(thread, vpn, page);
+        pthread_mutex_unlock(&region->lock);
+        releaseFrame(thread, &frameTable->entries[frameNum]);
+        return;
+    }
+    bringInSharedPage(thread, vpn, page, region, frameNum);
+    pthread_mutex_unlock(&region->lock);
+}
+
+uint16_t* sharedPageSlot(PTEntry *pte) {
+    return &sharedPageOf(pte)->swapSlot;
+}
+
+void forgetSharedPageFrame(PTEntry *pte) {
+    sharedPageOf(pte)->frameNum = SHARED_PAGE_NOT_RESIDENT;
+}
+
+bool sharedPageInFile(PTEntry *pte) {
+    return pte->sharedRegion && sharedRegionOf(pte)->fd != SHARED_REGION_NO_FILE;
+}
+
+bool sharedPageReadOnly(PTEntry *pte) {
+    return pte->sharedRegion && sharedRegionOf(pte)->readOnly;
+}
+
+void writeSharedPageToFile(const Thread *thread, FTEntry *fte, PTEntry *pte) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    SharedRegion *region = sharedRegionOf(pte);
+    uint32_t pageIndex = pte->regionPage - region->firstPage;
+    sprintf(logBuffer, "Thread %d writeSharedPageToFile(): Writing frame %d back to page %d of the file of region %ld\n",
+                        thread->threadId, fte->frameNum, pageIndex, region - sharedRegionTable->regions);
+    logData(logBuffer);
+    flushLog();
+    if (!writePageToFile(region, pageIndex, fte)) {
+        sprintf(logBuffer, "Thread %d writeSharedPageToFile(): Error writing frame %d to the file\n", thread->threadId, fte->frameNum);
+        logData(logBuffer);
+        flushLog();
+        perror("Errno");
+        kernelPanic(thread, frameVirtualPageNum(fte) * PAGE_SIZE);
+    }
+}
+
+void beginSharedPageTransit(PTEntry *pte) {
+    sharedPageOf(pte)->inTransit = 1;
+}
+
+void endSharedPageTransit(PTEntry *pte) {
+    SharedRegion *region = sharedRegionOf(pte);
+    pthread_mutex_lock(&region->lock);
+    sharedPageOf(pte)->inTransit = 0;
+    pthread_cond_broadcast(&region->transitCond);
+    pthread_mutex_unlock(&region->lock);
+}
+
+bool trylockSharedRegion(PTEntry *pte) {
+    if (!pte->sharedRegion) {
+        return true;
+    }
+    return pthread_mutex_trylock(&sharedRegionOf(pte)->lock) == 0;
+}
+
+void unlockSharedRegion(PTEntry *pte) {
+    if (pte->sharedRegion) {
+        pthread_mutex_unlock(&sharedRegionOf(pte)->lock);
+    }
+}
+
+#pragma endregion
+
+#pragma region Shared Region Callback
+
+void initializeSharedRegions() {
+    pthread_mutex_init(&sharedRegionTable->lock, NULL);
+    for (int i = 0; i < MAX_SHARED_REGIONS; i++) {
+        pthread_mutex_init(&sharedRegionTable->regions[i].lock, NULL);
+        pthread_cond_init(&sharedRegionTable->regions[i].transitCond, NULL);
+        sharedRegionTable->regions[i].numPages = 0;
+        sharedRegionTable->regions[i].numMappings = 0;
+        sharedRegionTable->regions[i].fd = SHARED_REGION_NO_FILE;
+    }
+    sharedRegionTable->numRegions = 0;
+    sharedRegionTable->numPages = 0;
+}
+
+void deinitializeSharedRegions() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    for (int regionNum = 0; regionNum < sharedRegionTable->numRegions; regionNum++) {
+        SharedRegion *region = &sharedRegionTable->regions[regionNum];
+        if (region->fd == SHARED_REGION_NO_FILE) {
+            continue;
+        }
+        // No thread is left to touch the pages, so nothing is locked
+        for (uint32_t pageIndex = 0; pageIndex < region->numPages && !region->readOnly; pageIndex++) {
+            SharedPage *page = &sharedRegionTable->pages[region->firstPage + pageIndex];
+            if (page->frameNum == SHARED_PAGE_NOT_RESIDENT || !frameTable->entries[page->frameNum].dirty) {
+                continue;
+            }
+            if (!writePageToFile(region, pageIndex, &frameTable->entries[page->frameNum])) {
+                sprintf(logBuffer, "deinitializeSharedRegions(): Error writing page %d back to the file of region %d\n", pageIndex, regionNum);
+                logData(logBuffer);
+                flushLog();
+                perror("Errno");
+            }
+        }
+        close(region->fd);
+        region->fd = SHARED_REGION_NO_FILE;
+    }
+}
+
+#pragma endregion
@@ -0,0 +1,202 @@
+#ifndef VIRTUALMEMFRAMEWORKC_REGION_H
+#define VIRTUALMEMFRAMEWORKC_REGION_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "thread.h"
+#include "page.h"
+#include "frame.h"
+
+#pragma region Shared Region Macros
+
+/* Number of shared regions that can be created */
+#define MAX_SHARED_REGIONS 16
+/* Number of pages all shared regions hold together */
+#define SHARED_REGION_PAGES 2048
+/* Number of mappings of a region that are brought in together */
+#define SHARED_REGION_MAX_MAPPINGS 32
+/* Frame number of a shared page that is not in memory */
+#define SHARED_PAGE_NOT_RESIDENT 0xFFFF
+/* File descriptor of a region whose pages are swapped rather than kept in a
+   file */
+#define SHARED_REGION_NO_FILE -1
+
+#pragma endregion
+
+#pragma region Shared Region Structs
+
+/**
+ * Defines a range of a thread's pages mapping a shared region.
+*/
+typedef struct SharedRegionMapping {
+    uint16_t firstVpn;  // The virtual page number mapping the region's first page
+    uint8_t threadId;   // The threadId of the mapping's thread
+} SharedRegionMapping;
+
+/**
+ * Defines a region of memory that can be mapped into several threads, which
+ * all read and write the same frames. A region's pages are brought in and
+ * swapped out for all of its mappings at once. The pages of a region
+ * created by mapFile are read from and written back to a host file instead
+ * of the swap device.
+*/
+typedef struct SharedRegion {
+    pthread_mutex_t lock;                                   // Lock for the region's pages and mappings
+    pthread_cond_t transitCond;                             // Signalled with the lock held whenever a page of the region stops being in transit
+    uint16_t firstPage;                                     // The region's first page in the shared pages
+    uint16_t numPages;                                      // Number of pages in the region, 0 if it was never created
+    uint8_t numMappings;                                    // Number of mappings
+    bool readOnly;                                          // Whether the region's file could only be opened for reading
+    int fd;                                                 // File descriptor of the file backing the region, or SHARED_REGION_NO_FILE
+    off_t fileOffset;                                       // Offset in the file of the region's first page
+    uint32_t fileLength;                                    // Bytes of the file mapped by the region
+    SharedRegionMapping mappings[SHARED_REGION_MAX_MAPPINGS]; // The threads' pages mapping the region
+} SharedRegion;
+
+/**
+ * Defines a page of a shared region. The page is kept in a single frame for
+ * every mapping while it is in memory, and in a single swap slot otherwise,
+ * so the page table entries mapping it only record which page it is.
+*/
+typedef struct SharedPage {
+    uint16_t frameNum;  // The frame holding the page, SHARED_PAGE_NOT_RESIDENT if it is swapped out
+    uint16_t swapSlot;  // The swap slot holding the page on disk (SWAP_SLOT_NONE if it has none)
+    uint8_t regionNum;  // The region the page belongs to
+    uint8_t inTransit;  // Whether the page's frame is being written to its slot or file with the region unlocked
+} SharedPage;
+
+/**
+ * Defines the table of shared regions. Used for structuring system memory.
+ * Regions are handed out in order and last until the system shuts down,
+ * like the rest of a thread's memory.
+*/
+typedef struct SharedRegionTable {
+    pthread_mutex_t lock;                       // Lock for creating regions
+    uint8_t numRegions;                         // Number of regions created
+    uint16_t numPages;                          // Number of pages given to regions
+    SharedRegion regions[MAX_SHARED_REGIONS];   // All regions
+    SharedPage pages[SHARED_REGION_PAGES];      // The pages of all regions
+} SharedRegionTable;
+
+#pragma endregion
+
+#pragma region Shared Region FunctionDeclarations
+
+/**
+ * Creates a region of at least size bytes that threads can map with
+ * mapSharedRegion. Its pages read as zeros until they are written. Returns
+ * NULL if there are no regions or pages left.
+*/
+SharedRegion* createSharedRegion(int size);
+
+/**
+ * Maps the region into the thread's heap, starting at the next page
+ * boundary, and returns the address it was mapped at, or -1 if there is no
+ * room for it. Writes through any mapping of the region are seen by every
+ * other mapping. The thread's page table must not be locked by the caller.
+*/
+int mapSharedRegion(Thread *thread, SharedRegion *region);
+
+/**
+ * Adds the child's pages as mappings of every region the parent maps, once
+ * forkPageTable has given the child the parent's pages.
+*/
+void forkSharedRegions(const Thread *parent, const Thread *child);
+
+/**
+ * Maps length bytes of the host file at path, starting at offset, into the
+ * thread's heap and returns the address they were mapped at. Nothing is
+ * read until a page is first accessed, when it is read straight from the
+ * file; bytes past the end of the file read as zeros. Dirty pages are
+ * written back to the file rather than to swap when they are evicted and
+ * when the system shuts down. A file that can only be opened for reading is
+ * mapped read only, and writing to it is a kernel panic. The mapping is a
+ * shared region, so forked threads map the same pages. Each call maps the
+ * file afresh, separate calls do not see each other's writes until they
+ * reach the file. Returns -1 if the offset is not page aligned, the file
+ * cannot be opened, or there is no room for the mapping.
+*/
+int mapFile(Thread *thread, const char *path, int offset, int length);
+
+/**
+ * Brings the thread's page of a shared region into memory. If another
+ * mapping already has the page in a frame the page is mapped to that frame,
+ * otherwise the page is read from the region's file, swapped in or zeroed in
+ * a new frame that is mapped to every mapping of the region at once. The thread's page table must not
+ * be locked by the caller.
+*/
+void handleSharedPageFault(const Thread *thread, uint32_t vpn);
+
+/**
+ * Returns the swap slot of the shared page mapped by the page table entry.
+ * The region must be locked by the caller, or the page not be in memory.
+*/
+uint16_t* sharedPageSlot(PTEntry *pte);
+
+/**
+ * Records that the shared page mapped by the page table entry was swapped
+ * out for every mapping. The region must be locked by the caller.
+*/
+void forgetSharedPageFrame(PTEntry *pte);
+
+/**
+ * Returns whether the page table entry maps a page of a file mapped with
+ * mapFile, which is kept in the file rather than a swap slot.
+*/
+bool sharedPageInFile(PTEntry *pte);
+
+/**
+ * Returns whether the page table entry maps a page of a file mapped read
+ * only.
+*/
+bool sharedPageReadOnly(PTEntry *pte);
+
+/**
+ * Writes the frame back to the file holding the page of the page table
+ * entry and marks the frame clean. The region must be locked by the caller,
+ * or the page be in transit.
+*/
+void writeSharedPageToFile(const Thread *thread, FTEntry *fte, PTEntry *pte);
+
+/**
+ * Marks the shared page mapped by the page table entry as in transit while
+ * its frame is written out with the region unlocked. Faults on the page
+ * wait until endSharedPageTransit. The region must be locked by the caller.
+*/
+void beginSharedPageTransit(PTEntry *pte);
+
+/**
+ * Marks the shared page mapped by the page table entry as no longer in
+ * transit and wakes the faults waiting for it. The region must not be
+ * locked by the caller.
+*/
+void endSharedPageTransit(PTEntry *pte);
+
+/**
+ * Locks the region of the shared page mapped by the page table entry
+ * without waiting, as eviction requires. Returns true at once for a page
+ * that is not in a shared region.
+*/
+bool trylockSharedRegion(PTEntry *pte);
+
+/**
+ * Unlocks a region locked by trylockSharedRegion.
+*/
+void unlockSharedRegion(PTEntry *pte);
+
+/**
+ * Empties the shared region table.
+*/
+void initializeSharedRegions();
+
+/**
+ * Writes the dirty pages of every mapped file still in memory back to the
+ * file and closes the files.
+*/
+void deinitializeSharedRegions();
+
+#pragma endregion
+
+#endif //VIRTUALMEMFRAMEWORKC_REGION_H
@@ -0,0 +1,132 @@
+#include "rmap.h"
+#include "page.h"
+
+extern ReverseMap *reverseMap;
+
+#pragma region Reverse Map Functions
+
+bool addFrameSharer(FTEntry *entry, uint8_t threadId, uint16_t vpn) {
+    pthread_mutex_lock(&reverseMap->lock);
+    uint16_t index = reverseMap->freeSharers;
+    if (index == REVERSE_MAP_NONE) {
+        pthread_mutex_unlock(&reverseMap->lock);
+        return false;
+    }
+    reverseMap->freeSharers = reverseMap->sharers[index].next;
+    reverseMap->numFreeSharers--;
+    pthread_mutex_unlock(&reverseMap->lock);
+
+    FrameSharer *sharer = &reverseMap->sharers[index];
+    sharer->threadId = threadId;
+    sharer->vpn = vpn;
+    sharer->next = reverseMap->firstSharers[entry->frameNum];
+    __atomic_store_n(&reverseMap->firstSharers[entry->frameNum], index, __ATOMIC_RELAXED);
+    return true;
+}
+
+/**
+ * Returns a sharer that is no longer mapped to any frame to the free sharers.
+*/
+static void freeFrameSharer(uint16_t index) {
+    pthread_mutex_lock(&reverseMap->lock);
+    reverseMap->sharers[index].next = reverseMap->freeSharers;
+    reverseMap->freeSharers = index;
+    reverseMap->numFreeSharers++;
+    pthread_mutex_unlock(&reverseMap->lock);
+}
+
+bool removeFrameSharer(FTEntry *entry, uint8_t threadId, uint16_t vpn) {
+    uint16_t *link = &reverseMap->firstSharers[entry->frameNum];
+    while (*link != REVERSE_MAP_NONE) {
+        FrameSharer *sharer = &reverseMap->sharers[*link];
+        if (sharer->threadId == threadId && sharer->vpn == vpn) {
+            uint16_t index = *link;
+            __atomic_store_n(link, sharer->next, __ATOMIC_RELAXED);
+            freeFrameSharer(index);
+            return true;
+        }
+        link = &sharer->next;
+    }
+    return false;
+}
+
+bool promoteFrameSharer(FTEntry *entry) {
+    uint16_t index = reverseMap->firstSharers[entry->frameNum];
+    if (index == REVERSE_MAP_NONE) {
+        setFrameOwner(entry, 0, 0);
+        return false;
+    }
+    FrameSharer *sharer = &reverseMap->sharers[index];
+    setFrameOwner(entry, sharer->threadId, sharer->vpn);
+    __atomic_store_n(&reverseMap->firstSharers[entry->frameNum], sharer->next, __ATOMIC_RELAXED);
+    freeFrameSharer(index);
+    return true;
+}
+
+bool frameShared(FTEntry *entry) {
+    return __atomic_load_n(&reverseMap->firstSharers[entry->frameNum], __ATOMIC_RELAXED) != REVERSE_MAP_NONE;
+}
+
+uint16_t firstFrameSharer(FTEntry *entry) {
+    return reverseMap->firstSharers[entry->frameNum];
+}
+
+uint32_t frameSharerThreads(FTEntry *entry) {
+    uint32_t threads = 0;
+    for (uint16_t index = firstFrameSharer(entry); index != REVERSE_MAP_NONE; index = reverseMap->sharers[index].next) {
+        threads |= 1u << (reverseMap->sharers[index].threadId - 1);
+    }
+    return threads;
+}
+
+void unmapFrameSharers(FTEntry *entry) {
+    uint16_t *link = &reverseMap->firstSharers[entry->frameNum];
+    while (*link != REVERSE_MAP_NONE) {
+        uint16_t index = *link;
+        FrameSharer *sharer = &reverseMap->sharers[index];
+        PTEntry *pte = &getThreadPageTable(sharer->threadId)->entries[sharer->vpn];
+        pte->present = 0;
+        pte->frameTblNum = 0;
+        pte->writeProtected = 0;
+        // A page waiting for the frame to be written out is kept, so it can
+        // be woken once it is
+        if (pte->inTransit) {
+            link = &sharer->next;
+            continue;
+        }
+        __atomic_store_n(link, sharer->next, __ATOMIC_RELAXED);
+        freeFrameSharer(index);
+    }
+}
+
+void releaseFrameSharers(FTEntry *entry) {
+    // Nothing else looks at the chain of a frame without an owner
+    uint16_t index = firstFrameSharer(entry);
+    while (index != REVERSE_MAP_NONE) {
+        FrameSharer *sharer = &reverseMap->sharers[index];
+        endPageTransit(getThreadPageTable(sharer->threadId), sharer->vpn);
+        uint16_t next = sharer->next;
+        freeFrameSharer(index);
+        index = next;
+    }
+    __atomic_store_n(&reverseMap->firstSharers[entry->frameNum], REVERSE_MAP_NONE, __ATOMIC_RELAXED);
+}
+
+#pragma endregion
+
+#pragma region Reverse Map Callback
+
+void initializeReverseMap() {
+    pthread_mutex_init(&reverseMap->lock, NULL);
+    for (int i = 0; i < NUM_FRAME_TABLE_ENTRIES; i++) {
+        reverseMap->firstSharers[i] = REVERSE_MAP_NONE;
+    }
+    // Chain every sharer into the free sharers
+    for (int i = 0; i < REVERSE_MAP_ENTRIES; i++) {
+        reverseMap->sharers[i].next = i + 1 < REVERSE_MAP_ENTRIES ? i + 1 : REVERSE_MAP_NONE;
+    }
+    reverseMap->freeSharers = 0;
+    reverseMap->numFreeSharers = REVERSE_MAP_ENTRIES;
+}
+
+#pragma endregion
@@ -0,0 +1,106 @@
+#ifndef VIRTUALMEMFRAMEWORKC_RMAP_H
+#define VIRTUALMEMFRAMEWORKC_RMAP_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "frame.h"
+
+#pragma region Reverse Map Macros
+
+/* Number of pages that can share a frame with its owner across all frames */
+#define REVERSE_MAP_ENTRIES 8192
+/* Index ending a chain of sharers */
+#define REVERSE_MAP_NONE 0xFFFF
+
+#pragma endregion
+
+#pragma region Reverse Map Structs
+
+/**
+ * Defines a page mapped to a frame that it shares with the frame's owner.
+*/
+typedef struct FrameSharer {
+    uint16_t vpn;       // The virtual page number of the page
+    uint16_t next;      // The next sharer of the same frame, or the next free sharer
+    uint8_t threadId;   // The threadId of the page's thread
+} FrameSharer;
+
+/**
+ * Defines the reverse map from frames to the pages mapped to them. A frame's
+ * owner (see frameOwner) is its first mapping, every other page mapped to
+ * the frame is kept in the frame's chain of sharers. A frame's chain only
+ * changes while the frame is locked.
+*/
+typedef struct ReverseMap {
+    pthread_mutex_t lock;                               // Lock for the free sharers
+    uint16_t freeSharers;                               // First free sharer
+    uint16_t numFreeSharers;                            // Number of free sharers
+    uint16_t firstSharers[NUM_FRAME_TABLE_ENTRIES];     // First sharer of each frame
+    FrameSharer sharers[REVERSE_MAP_ENTRIES];           // All sharers
+} ReverseMap;
+
+#pragma endregion
+
+#pragma region Reverse Map FunctionDeclarations
+
+/**
+ * Adds the thread's page to the pages sharing the frame. Returns false if
+ * there is no room left in the reverse map. The frame must be locked by the
+ * caller.
+*/
+bool addFrameSharer(FTEntry *entry, uint8_t threadId, uint16_t vpn);
+
+/**
+ * Removes the thread's page from the pages sharing the frame. Returns false
+ * if the page was not sharing it. The frame must be locked by the caller.
+*/
+bool removeFrameSharer(FTEntry *entry, uint8_t threadId, uint16_t vpn);
+
+/**
+ * Makes the frame's first sharer its owner in place of the current owner,
+ * who no longer maps the frame. Returns false, taking the frame away from
+ * its owner, if it has no sharers. The frame must be locked by the caller.
+*/
+bool promoteFrameSharer(FTEntry *entry);
+
+/**
+ * Returns whether any page besides the frame's owner is mapped to it.
+*/
+bool frameShared(FTEntry *entry);
+
+/**
+ * Returns the index of the frame's first sharer in the reverse map, or
+ * REVERSE_MAP_NONE if it has none. The rest follow through each sharer's
+ * next. The frame must be locked by the caller.
+*/
+uint16_t firstFrameSharer(FTEntry *entry);
+
+/**
+ * Returns a bitmask with bit threadId - 1 set for every thread with a page
+ * sharing the frame. The frame must be locked by the caller.
+*/
+uint32_t frameSharerThreads(FTEntry *entry);
+
+/**
+ * Marks every page sharing the frame as not present and forgets them. Pages
+ * in transit stay on the frame's chain until releaseFrameSharers. The
+ * sharers' page tables and the frame must be locked by the caller.
+*/
+void unmapFrameSharers(FTEntry *entry);
+
+/**
+ * Ends the transit of the pages unmapFrameSharers left on the frame's
+ * chain, now that the frame is written out, and forgets them. The frame
+ * must have no owner, and no page table may be locked by the caller.
+*/
+void releaseFrameSharers(FTEntry *entry);
+
+/**
+ * Empties the reverse map.
+*/
+void initializeReverseMap();
+
+#pragma endregion
+
+#endif //VIRTUALMEMFRAMEWORKC_RMAP_H
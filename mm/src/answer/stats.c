@@ -0,0 +1,85 @@
+#include "stats.h"
+#include "utils.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+VMStats vmStats;
+
+#pragma region Stats Functions
+
+/**
+ * Writes the counters of one of the prefetcher's patterns to the log, with
+ * its precision, the share of its pages that were used, and its coverage,
+ * the share of the faults on swapped out pages it avoided.
+*/
+static void logPrefetchPattern(const char *pattern, uint64_t prefetches, uint64_t hits, uint64_t wasted) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    // Every hit is a fault that would have been taken without the prefetcher
+    uint64_t faults = vmStats.prefetchFaults + vmStats.strideHits + vmStats.correlationHits;
+    sprintf(logBuffer, "VM stats: %" PRIu64 " pages prefetched along %s, %" PRIu64 " hits, %" PRIu64 " wasted, %.1f%% precision, %.1f%% coverage\n",
+                        prefetches, pattern, hits, wasted, prefetches > 0 ? 100.0 * hits / prefetches : 0.0, faults > 0 ? 100.0 * hits / faults : 0.0);
+    logData(logBuffer);
+    flushLog();
+}
+
+void resetVMStats() {
+    memset(&vmStats, 0, sizeof(VMStats));
+}
+
+void logVMStats() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    sprintf(logBuffer, "VM stats: %" PRIu64 " page faults, %" PRIu64 " reads from the zero frame\n",
+                        vmStats.pageFaults, vmStats.zeroFrameReads);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " swap writes in %" PRIu64 " calls (%" PRIu64 " write-backs), %" PRIu64 " clean evictions skipped, %" PRIu64 " zero pages elided, %" PRIu64 " swap reads in %" PRIu64 " calls\n",
+                        vmStats.swapWrites, vmStats.swapWriteCalls, vmStats.writeBacks, vmStats.swapWritesSkipped, vmStats.zeroPagesElided, vmStats.swapReads, vmStats.swapReadCalls);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " pages compressed, %" PRIu64 " decompressed, %" PRIu64 " written back, %" PRIu64 " rejected by the compressed pool\n",
+                        vmStats.poolStores, vmStats.poolLoads, vmStats.poolWriteBacks, vmStats.poolRejects);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " frame magazine refills\n", vmStats.magazineRefills);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " direct reclaims, %" PRIu64 " frames reclaimed in background over %" PRIu64 " wakeups\n",
+                        vmStats.directReclaims, vmStats.reclaimedFrames, vmStats.reclaimerWakeups);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " dirty page clusters flushed over %" PRIu64 " flusher wakeups\n",
+                        vmStats.flushedClusters, vmStats.flusherWakeups);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " evicted pages written out in transit, %" PRIu64 " waits for a page in transit\n",
+                        vmStats.transitWrites, vmStats.transitWaits);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " frames merged, %" PRIu64 " copy-on-write faults\n",
+                        vmStats.framesMerged, vmStats.copyOnWriteFaults);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " shared region pages mapped through another mapping\n", vmStats.sharedPageMaps);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " mapped file pages read, %" PRIu64 " written back\n",
+                        vmStats.fileReads, vmStats.fileWrites);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " pages read ahead, %" PRIu64 " hits, %" PRIu64 " wasted\n",
+                        vmStats.readaheadPages, vmStats.readaheadHits, vmStats.readaheadWasted);
+    logData(logBuffer);
+    flushLog();
+    sprintf(logBuffer, "VM stats: %" PRIu64 " faults seen by the prefetcher, %" PRIu64 " predictions dropped\n",
+                        vmStats.prefetchFaults, vmStats.prefetchesDropped);
+    logData(logBuffer);
+    flushLog();
+    logPrefetchPattern("strides", vmStats.stridePrefetches, vmStats.strideHits, vmStats.strideWasted);
+    logPrefetchPattern("stride sequences", vmStats.correlationPrefetches, vmStats.correlationHits, vmStats.correlationWasted);
+}
+
+#pragma endregion
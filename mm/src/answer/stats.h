@@ -0,0 +1,77 @@
+#ifndef VIRTUALMEMFRAMEWORKC_STATS_H
+#define VIRTUALMEMFRAMEWORKC_STATS_H
+
+#include <stdint.h>
+
+#pragma region Stats Macros
+
+/* Atomically increments one of the vmStats counters */
+#define STAT_INC(counter) __atomic_fetch_add(&vmStats.counter, 1, __ATOMIC_RELAXED)
+
+#pragma endregion
+
+#pragma region Stats Structs
+
+/**
+ * Defines the counters kept by the virtual memory system. Counters are
+ * updated with relaxed atomics so they never need a lock.
+*/
+typedef struct VMStats {
+    uint64_t pageFaults;            // Pages brought into a frame by an access
+    uint64_t zeroFrameReads;        // Reads of never written pages served from the shared zero frame
+    uint64_t swapWrites;            // Pages written to the swap device
+    uint64_t swapWriteCalls;        // Writes issued to the swap device, each for one or more pages
+    uint64_t swapWritesSkipped;     // Evicted pages that were clean and dropped without any I/O
+    uint64_t zeroPagesElided;       // Pages found to be all zeros when written out, kept without a slot or any I/O
+    uint64_t writeBacks;            // Dirty pages written to swap while staying mapped
+    uint64_t flusherWakeups;        // Times the flusher scanned for dirty frames
+    uint64_t flushedClusters;       // Groups of neighbouring dirty pages the flusher wrote back together
+    uint64_t transitWrites;         // Pages written to their slot or file after every lock was dropped
+    uint64_t transitWaits;          // Times an access waited for its page to finish being written out
+    uint64_t swapReads;             // Pages read back from the swap device
+    uint64_t swapReadCalls;         // Reads issued to the swap device, each for one or more pages
+    uint64_t poolStores;            // Evicted pages compressed into the compressed pool
+    uint64_t poolLoads;             // Pages decompressed from the compressed pool on a fault
+    uint64_t poolWriteBacks;        // Pages written from the compressed pool to the swap device to keep it in budget
+    uint64_t poolRejects;           // Evicted pages that did not compress well enough and went to the swap device
+    uint64_t magazineRefills;       // Batches of frames moved from the free list to a thread's magazine
+    uint64_t directReclaims;        // Frames a faulting thread had to evict itself
+    uint64_t reclaimedFrames;       // Frames evicted by the background reclaimer
+    uint64_t reclaimerWakeups;      // Times the background reclaimer was woken
+    uint64_t framesMerged;          // Frames freed by the merger because their page matched another frame
+    uint64_t copyOnWriteFaults;     // Writes to a shared frame that copied it to a frame of the page's own
+    uint64_t sharedPageMaps;        // Pages of shared regions mapped to a frame brought in through another mapping
+    uint64_t fileReads;             // Pages of mapped files read from their file on a fault
+    uint64_t fileWrites;            // Dirty pages of mapped files written back to their file
+    uint64_t readaheadPages;        // Pages brought in ahead of a sequential read fault
+    uint64_t readaheadHits;         // Pages read ahead that were accessed before being evicted
+    uint64_t readaheadWasted;       // Pages read ahead that were evicted without being accessed
+    uint64_t prefetchFaults;        // Faults on swapped out pages recorded by the prefetcher
+    uint64_t prefetchesDropped;     // Predicted pages not prefetched for lack of queue room or free frames, or brought in first
+    uint64_t stridePrefetches;      // Pages prefetched along a repeated stride
+    uint64_t strideHits;            // Pages prefetched along a stride that were accessed before being evicted
+    uint64_t strideWasted;          // Pages prefetched along a stride that were evicted without being accessed
+    uint64_t correlationPrefetches; // Pages prefetched along a sequence of strides seen before
+    uint64_t correlationHits;       // Pages prefetched along a sequence of strides that were accessed before being evicted
+    uint64_t correlationWasted;     // Pages prefetched along a sequence of strides that were evicted without being accessed
+} VMStats;
+
+#pragma endregion
+
+#pragma region Stats FunctionDeclarations
+
+/**
+ * Resets every counter to 0.
+*/
+void resetVMStats();
+
+/**
+ * Writes every counter to the log.
+*/
+void logVMStats();
+
+#pragma endregion
+
+extern VMStats vmStats;
+
+#endif //VIRTUALMEMFRAMEWORKC_STATS_H
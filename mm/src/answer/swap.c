@@ -1,12 +1,22 @@
 #include "swap.h"
 #include "memory.h"
+#include "stats.h"
+#include "frameScan.h"
+#include "lz.h"
+#include "rmap.h"
+#include "region.h"
+#include "swapIo.h"
+#include "swapBackend.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/uio.h>
 
-extern unsigned char *SYSTEM_MEMORY;
 extern FrameTable *frameTable;
+extern SwapDevice *swapDevice;
+extern CompressedPool *compressedPool;
+extern ReverseMap *reverseMap;
 extern const int PAGE_SIZE;
 extern const int USER_BASE_ADDR;
 
@@ -14,88 +24,1116 @@ extern const int USER_BASE_ADDR;
 extern const int MAX_BUFFER_SIZE;
 extern const int MAX_FILE_NAME_SIZE;
 
-void swapPageToDisk(Thread *thread, FTEntry *evictedFTE) {
+uint32_t compressedPoolBudget = DEFAULT_COMPRESSED_POOL_BUDGET;
+bool transitSwapOut = true;
+
+_Static_assert(SWAP_SLOT_POOL_BASE + COMPRESSED_POOL_ENTRIES <= SWAP_SLOT_ZERO, "Swap slot numbers must not collide with SWAP_SLOT_ZERO");
+_Static_assert(COMPRESSED_POOL_BLOCKS < COMPRESSED_POOL_NONE, "Compressed pool blocks must be numbered below COMPRESSED_POOL_NONE");
+
+#pragma region Swap Slot Functions
+
+/**
+ * Finds a free slot in the swap device and marks it as in use. Returns
+ * SWAP_SLOT_NONE if every slot is in use.
+*/
+static uint16_t allocateSwapSlot() {
+    uint16_t slot = SWAP_SLOT_NONE;
+    pthread_mutex_lock(&swapDevice->lock);
+    if (swapDevice->numFreeSlots > 0) {
+        // Search the bitmap one word at a time starting at the hint
+        uint32_t numWords = (NUM_SWAP_SLOTS + 63) / 64;
+        uint32_t word = swapDevice->nextSlotHint / 64;
+        for (uint32_t i = 0; i < numWords; i++, word = (word + 1) % numWords) {
+            uint64_t freeBits = ~swapDevice->slotBitmap[word];
+            if (freeBits == 0) {
+                continue;
+            }
+            uint32_t candidate = word * 64 + __builtin_ctzll(freeBits);
+            if (candidate >= NUM_SWAP_SLOTS) {
+                continue;
+            }
+            swapDevice->slotBitmap[word] |= (1ULL << (candidate % 64));
+            swapDevice->slotRefCounts[candidate] = 1;
+            swapDevice->numFreeSlots--;
+            swapDevice->nextSlotHint = candidate;
+            slot = candidate;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&swapDevice->lock);
+    return slot;
+}
+
+/**
+ * Finds numSlots consecutive free slots in the swap device and marks them as
+ * in use. Returns the first of them, or SWAP_SLOT_NONE if there is no such
+ * run. Runs do not wrap around the end of the device.
+*/
+static uint16_t allocateSwapSlotRun(int numSlots) {
+    uint16_t firstSlot = SWAP_SLOT_NONE;
+    pthread_mutex_lock(&swapDevice->lock);
+    if (swapDevice->numFreeSlots >= (uint32_t)numSlots) {
+        uint32_t runStart = 0;
+        int runLength = 0;
+        for (uint32_t candidate = swapDevice->nextSlotHint, i = 0; i < NUM_SWAP_SLOTS; i++, candidate++) {
+            if (candidate == NUM_SWAP_SLOTS) {
+                candidate = 0;
+                runLength = 0;
+            }
+            // Skip whole words of slots in use
+            if (candidate % 64 == 0 && swapDevice->slotBitmap[candidate / 64] == ~0ULL) {
+                candidate += 63;
+                i += 63;
+                runLength = 0;
+                continue;
+            }
+            if (swapDevice->slotBitmap[candidate / 64] & (1ULL << (candidate % 64))) {
+                runLength = 0;
+                continue;
+            }
+            if (runLength++ == 0) {
+                runStart = candidate;
+            }
+            if (runLength == numSlots) {
+                firstSlot = runStart;
+                break;
+            }
+        }
+        for (int i = 0; firstSlot != SWAP_SLOT_NONE && i < numSlots; i++) {
+            uint32_t slot = firstSlot + i;
+            swapDevice->slotBitmap[slot / 64] |= (1ULL << (slot % 64));
+            swapDevice->slotRefCounts[slot] = 1;
+        }
+        if (firstSlot != SWAP_SLOT_NONE) {
+            swapDevice->numFreeSlots -= numSlots;
+            swapDevice->nextSlotHint = firstSlot + numSlots - 1;
+        }
+    }
+    pthread_mutex_unlock(&swapDevice->lock);
+    return firstSlot;
+}
+
+/**
+ * Drops a page's reference to the slot, marking the slot as free once no
+ * page refers to it.
+*/
+static void freeSwapSlot(uint16_t slot) {
+    pthread_mutex_lock(&swapDevice->lock);
+    bool unused = --swapDevice->slotRefCounts[slot] == 0;
+    pthread_mutex_unlock(&swapDevice->lock);
+    if (!unused) {
+        return;
+    }
+    // Let the backend drop the slot's contents with the device unlocked. The
+    // slot stays marked in use until then, so it cannot be handed out and
+    // written to before the discard
+    swapBackend->discard(slot);
+    pthread_mutex_lock(&swapDevice->lock);
+    swapDevice->slotBitmap[slot / 64] &= ~(1ULL << (slot % 64));
+    swapDevice->numFreeSlots++;
+    pthread_mutex_unlock(&swapDevice->lock);
+}
+
+/**
+ * Adds a reference to the slot for another page to refer to it as well.
+ * Returns false, leaving the slot alone, if it is a slot of the compressed
+ * pool, whose entries each belong to a single page, or already has as many
+ * references as it can count. SWAP_SLOT_ZERO takes any number of pages.
+*/
+static bool addSwapSlotReference(uint16_t slot) {
+    if (slot == SWAP_SLOT_ZERO) {
+        return true;
+    }
+    if (slot == SWAP_SLOT_NONE || slot >= NUM_SWAP_SLOTS) {
+        return false;
+    }
+    pthread_mutex_lock(&swapDevice->lock);
+    bool added = swapDevice->slotRefCounts[slot] < UINT8_MAX;
+    if (added) {
+        swapDevice->slotRefCounts[slot]++;
+    }
+    pthread_mutex_unlock(&swapDevice->lock);
+    return added;
+}
+
+/**
+ * Returns whether more than one page refers to the slot.
+*/
+static bool swapSlotShared(uint16_t slot) {
+    pthread_mutex_lock(&swapDevice->lock);
+    bool shared = swapDevice->slotRefCounts[slot] > 1;
+    pthread_mutex_unlock(&swapDevice->lock);
+    return shared;
+}
+
+#pragma endregion
+
+#pragma region Compressed Pool Functions
+
+/**
+ * Returns whether the slot number stands for a page in the compressed pool.
+*/
+static bool isPoolSlot(uint16_t slot) {
+    return slot >= SWAP_SLOT_POOL_BASE && slot < SWAP_SLOT_POOL_BASE + COMPRESSED_POOL_ENTRIES;
+}
+
+/**
+ * Returns the bytes of blocks taken by a compressed page of the given size.
+*/
+static uint32_t poolBytesForSize(uint32_t size) {
+    return (size + COMPRESSED_POOL_BLOCK_SIZE - 1) / COMPRESSED_POOL_BLOCK_SIZE * COMPRESSED_POOL_BLOCK_SIZE;
+}
+
+/**
+ * Returns the bytes the pool may use, its budget capped at its size.
+*/
+static uint32_t poolCapacity() {
+    return compressedPoolBudget < COMPRESSED_POOL_SIZE ? compressedPoolBudget : COMPRESSED_POOL_SIZE;
+}
+
+/**
+ * Removes the entry from the list of stored pages. The pool must be locked
+ * by the caller.
+*/
+static void unlinkPoolEntry(uint16_t entryNum) {
+    CompressedPage *stored = &compressedPool->entries[entryNum];
+    if (stored->older != COMPRESSED_POOL_NONE) {
+        compressedPool->entries[stored->older].newer = stored->newer;
+    } else {
+        compressedPool->oldest = stored->newer;
+    }
+    if (stored->newer != COMPRESSED_POOL_NONE) {
+        compressedPool->entries[stored->newer].older = stored->older;
+    } else {
+        compressedPool->newest = stored->older;
+    }
+}
+
+/**
+ * Removes the entry from the list of stored pages, unless it is being
+ * written back and already off the list, and returns it and its blocks to
+ * the free chains. The pool must be locked by the caller.
+*/
+static void freePoolEntry(uint16_t entryNum) {
+    CompressedPage *stored = &compressedPool->entries[entryNum];
+    if (!stored->writingBack) {
+        unlinkPoolEntry(entryNum);
+    }
+    // Put the whole chain of blocks in front of the free blocks
+    uint16_t lastBlock = stored->firstBlock;
+    while (compressedPool->nextBlock[lastBlock] != COMPRESSED_POOL_NONE) {
+        lastBlock = compressedPool->nextBlock[lastBlock];
+    }
+    compressedPool->nextBlock[lastBlock] = compressedPool->freeBlocks;
+    compressedPool->freeBlocks = stored->firstBlock;
+    compressedPool->usedBytes -= poolBytesForSize(stored->size);
+    stored->size = 0;
+    stored->writingBack = 0;
+    stored->older = compressedPool->freeEntries;
+    compressedPool->freeEntries = entryNum;
+}
+
+/**
+ * Frees the entry once its page has left the pool. An entry being written
+ * back is left to its writer, which frees it once it finds the page gone, so
+ * the entry cannot be reused for another page meanwhile. The pool must be
+ * locked by the caller.
+*/
+static void dropPoolEntry(uint16_t entryNum) {
+    if (!compressedPool->entries[entryNum].writingBack) {
+        freePoolEntry(entryNum);
+    }
+}
+
+/**
+ * Decompresses a stored page into the page sized buffer. Returns false if
+ * its bytes do not decompress to a whole page. The pool must be locked by
+ * the caller.
+*/
+static bool loadPoolEntry(uint16_t entryNum, uint8_t *page) {
+    CompressedPage *stored = &compressedPool->entries[entryNum];
+    uint8_t compressed[COMPRESSED_PAGE_MAX_SIZE];
+    uint16_t block = stored->firstBlock;
+    for (int copied = 0; copied < stored->size; copied += COMPRESSED_POOL_BLOCK_SIZE) {
+        int blockBytes = stored->size - copied < COMPRESSED_POOL_BLOCK_SIZE ? stored->size - copied : COMPRESSED_POOL_BLOCK_SIZE;
+        memcpy(compressed + copied, compressedPool->blocks[block], blockBytes);
+        block = compressedPool->nextBlock[block];
+    }
+    return lzDecompress(compressed, stored->size, page, PAGE_SIZE) == PAGE_SIZE;
+}
+
+/**
+ * Writes a stored page out to a swap slot and removes it from the pool,
+ * pointing its page table entry at the slot. The entry is taken off the list
+ * and decompressed with the pool locked, then written with the pool
+ * unlocked. The page's owner's page table is then locked to point the page
+ * at the slot, so the caller must hold no page table. If the page left the
+ * pool meanwhile, the slot is freed instead. The pool must be locked by the
+ * caller, and is locked again on return.
+*/
+static void writeBackPoolEntry(const Thread *thread, uint16_t entryNum) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    CompressedPage *stored = &compressedPool->entries[entryNum];
+    uint8_t ownerThreadId = stored->ownerThreadId;
+    uint16_t vpn = stored->vpn;
+    PageTable *ownerTable = getThreadPageTable(ownerThreadId);
+    PTEntry *pte = &ownerTable->entries[vpn];
+    uint8_t page[PAGE_SIZE];
+    if (!loadPoolEntry(entryNum, page)) {
+        sprintf(logBuffer, "Thread %d writeBackPoolEntry(): Thread %d's vpn %d does not decompress\n",
+                            thread->threadId, ownerThreadId, vpn);
+        logData(logBuffer);
+        flushLog();
+        kernelPanic(thread, vpn * PAGE_SIZE);
+        return;
+    }
+    // Whoever takes the entry off the list frees it. Another writer may
+    // already have, in which case this one only gives the page a slot of its
+    // own, which the other finds and leaves be
+    bool freesEntry = !stored->writingBack;
+    if (freesEntry) {
+        unlinkPoolEntry(entryNum);
+        stored->writingBack = 1;
+    }
+    pthread_mutex_unlock(&compressedPool->lock);
+
+    uint16_t slot = allocateSwapSlot();
+    if (slot == SWAP_SLOT_NONE) {
+        sprintf(logBuffer, "Thread %d writeBackPoolEntry(): No free swap slots remaining\n", thread->threadId);
+        logData(logBuffer);
+        flushLog();
+        kernelPanic(thread, vpn * PAGE_SIZE);
+        pthread_mutex_lock(&compressedPool->lock);
+        return;
+    }
+    sprintf(logBuffer, "Thread %d writeBackPoolEntry(): Writing thread %d's vpn %d from the compressed pool to slot %d\n",
+                        thread->threadId, ownerThreadId, vpn, slot);
+    logData(logBuffer);
+    flushLog();
+    struct iovec pageData = {.iov_base = page, .iov_len = PAGE_SIZE};
+    ssize_t writtenBytes = writeSwapSlots(slot, &pageData, 1);
+    if (writtenBytes != PAGE_SIZE) {
+        sprintf(logBuffer, "Thread %d writeBackPoolEntry(): Wrote only %ld bytes to slot %d\n",
+                            thread->threadId, writtenBytes, slot);
+        logData(logBuffer);
+        flushLog();
+        perror("Errno");
+        kernelPanic(thread, vpn * PAGE_SIZE);
+        pthread_mutex_lock(&compressedPool->lock);
+        return;
+    }
+    STAT_INC(swapWrites);
+    STAT_INC(swapWriteCalls);
+    STAT_INC(poolWriteBacks);
+
+    pthread_mutex_lock(&ownerTable->lock);
+    pthread_mutex_lock(&compressedPool->lock);
+    // The owner may have faulted the page back in or discarded it meanwhile.
+    // The owner reads its slot without its page table locked when it faults
+    if (pte->swapSlot == SWAP_SLOT_POOL_BASE + entryNum) {
+        __atomic_store_n(&pte->swapSlot, slot, __ATOMIC_RELAXED);
+    } else {
+        freeSwapSlot(slot);
+    }
+    if (freesEntry) {
+        freePoolEntry(entryNum);
+    }
+    pthread_mutex_unlock(&ownerTable->lock);
+}
+
+/**
+ * Compresses the evicted frame into the pool as the given thread's page.
+ * Returns false, leaving the page alone, if the pool is off, has no room for
+ * it within its budget, or the page does not compress well enough. The
+ * caller holds the page's page table and the frame, so the pool cannot make
+ * room here, see trimCompressedPool.
+*/
+static bool storePageInPool(const Thread *thread, FTEntry *fte, PTEntry *pte, uint8_t threadId, uint16_t vpn) {
     char logBuffer[MAX_BUFFER_SIZE];
-    sprintf(logBuffer, "Thread %d swapPageToDisk(): Beginning swap attempt...\n", thread->threadId);
+    uint32_t capacity = poolCapacity();
+    if (capacity == 0) {
+        return false;
+    }
+    // Compress before taking the lock, only the copy into the blocks needs it
+    uint8_t compressed[COMPRESSED_PAGE_MAX_SIZE];
+    int size = lzCompress(fte->physAddr, PAGE_SIZE, compressed, COMPRESSED_PAGE_MAX_SIZE);
+    if (size == 0 || poolBytesForSize(size) > capacity) {
+        STAT_INC(poolRejects);
+        return false;
+    }
+    pthread_mutex_lock(&compressedPool->lock);
+    // Entries being written back hold on to their blocks, so there are
+    // still as many entries as blocks and an entry is free whenever enough
+    // blocks are
+    if (compressedPool->usedBytes + poolBytesForSize(size) > capacity) {
+        pthread_mutex_unlock(&compressedPool->lock);
+        STAT_INC(poolRejects);
+        return false;
+    }
+    uint16_t entryNum = compressedPool->freeEntries;
+    CompressedPage *stored = &compressedPool->entries[entryNum];
+    compressedPool->freeEntries = stored->older;
+    uint16_t block = compressedPool->freeBlocks;
+    uint16_t lastBlock = block;
+    stored->firstBlock = block;
+    for (int copied = 0; copied < size; copied += COMPRESSED_POOL_BLOCK_SIZE) {
+        int blockBytes = size - copied < COMPRESSED_POOL_BLOCK_SIZE ? size - copied : COMPRESSED_POOL_BLOCK_SIZE;
+        memcpy(compressedPool->blocks[block], compressed + copied, blockBytes);
+        lastBlock = block;
+        block = compressedPool->nextBlock[block];
+    }
+    compressedPool->freeBlocks = block;
+    compressedPool->nextBlock[lastBlock] = COMPRESSED_POOL_NONE;
+    compressedPool->usedBytes += poolBytesForSize(size);
+    stored->size = size;
+    stored->vpn = vpn;
+    stored->ownerThreadId = threadId;
+    // Add the entry to the newest end of the list
+    stored->older = compressedPool->newest;
+    stored->newer = COMPRESSED_POOL_NONE;
+    if (compressedPool->newest != COMPRESSED_POOL_NONE) {
+        compressedPool->entries[compressedPool->newest].newer = entryNum;
+    } else {
+        compressedPool->oldest = entryNum;
+    }
+    compressedPool->newest = entryNum;
+    // The copy in the page's old slot is out of date now
+    if (pte->swapSlot != SWAP_SLOT_NONE && pte->swapSlot != SWAP_SLOT_ZERO) {
+        freeSwapSlot(pte->swapSlot);
+    }
+    pte->swapSlot = SWAP_SLOT_POOL_BASE + entryNum;
+    pthread_mutex_unlock(&compressedPool->lock);
+
+    sprintf(logBuffer, "Thread %d storePageInPool(): Compressed frame %d mapped to thread %d's vpn %d to %d bytes\n",
+                        thread->threadId, fte->frameNum, threadId, vpn, size);
     logData(logBuffer);
     flushLog();
-    // Set the file name
-    char fileName[MAX_FILE_NAME_SIZE];
-    sprintf(fileName, "%d_%d.swp", evictedFTE->ownerThreadId, evictedFTE->virtualPageNum);
+    STAT_INC(poolStores);
+    fte->dirty = 0;
+    return true;
+}
 
-    sprintf(logBuffer, "Thread %d swapPageToDisk(): Swapping frame %d owned by thread %d's vpn %d to file %s\n",
-                        thread->threadId, evictedFTE->frameNum, evictedFTE->ownerThreadId, evictedFTE->virtualPageNum, fileName);
+#pragma endregion
+
+#pragma region Swap Functions
+
+/**
+ * Sets the page's slot to SWAP_SLOT_ZERO and marks the frame clean if the
+ * frame is all zeros, giving up the slot it had. Returns false, leaving the
+ * slot alone, if the frame has anything else in it. The caller holds the
+ * page's page table and the frame.
+*/
+static bool elideZeroPage(const Thread *thread, FTEntry *fte, uint16_t *slot) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    if (!isFrameZero(fte->physAddr)) {
+        return false;
+    }
+    sprintf(logBuffer, "Thread %d elideZeroPage(): Frame %d is all zeros, skipping the write\n",
+                        thread->threadId, fte->frameNum);
     logData(logBuffer);
     flushLog();
-    // Open the file that the frame will be written to
-    FILE *file = fopen(fileName, "w+");
-    // Handle failure to open file with kernelPanic
-    if (file == NULL) {
-        sprintf(logBuffer, "Thread %d swapPageToDisk(): Error opening file %s\n", thread->threadId, fileName);
+    if (*slot != SWAP_SLOT_NONE && *slot != SWAP_SLOT_ZERO) {
+        freeSwapSlot(*slot);
+    }
+    *slot = SWAP_SLOT_ZERO;
+    STAT_INC(zeroPagesElided);
+    fte->dirty = 0;
+    return true;
+}
+
+/**
+ * Makes sure the page has a slot of its own to be written to, giving it a
+ * new one if it has none. Returns false, leaving the page without a slot,
+ * if every slot is in use. The caller holds the page's page table.
+*/
+static bool claimPageSlot(uint16_t *slot) {
+    // A zero page that was written to needs a real slot again, and so does
+    // a page whose slot other pages still refer to
+    if (*slot == SWAP_SLOT_ZERO) {
+        *slot = SWAP_SLOT_NONE;
+    } else if (*slot != SWAP_SLOT_NONE && swapSlotShared(*slot)) {
+        freeSwapSlot(*slot);
+        *slot = SWAP_SLOT_NONE;
+    }
+    // Give the page a slot if it does not already have one
+    if (*slot == SWAP_SLOT_NONE) {
+        *slot = allocateSwapSlot();
+    }
+    return *slot != SWAP_SLOT_NONE;
+}
+
+/**
+ * Writes the frame, holding the page at vpn, to the given slot and marks
+ * the frame clean. Nothing may write to the frame meanwhile.
+*/
+static void writeFrameToSlot(const Thread *thread, FTEntry *fte, uint16_t vpn, uint16_t slot) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    struct iovec pageData = {.iov_base = fte->physAddr, .iov_len = PAGE_SIZE};
+    ssize_t writtenBytes = writeSwapSlots(slot, &pageData, 1);
+    if (writtenBytes != PAGE_SIZE) {
+        sprintf(logBuffer, "Thread %d writeFrameToSlot(): Wrote only %ld bytes from %d to slot %d\n",
+                            thread->threadId, writtenBytes, fte->frameNum, slot);
         logData(logBuffer);
         flushLog();
         perror("Errno");
-        kernelPanic(thread, file);
+        kernelPanic(thread, vpn * PAGE_SIZE);
+        return;
+    }
+    STAT_INC(swapWrites);
+    STAT_INC(swapWriteCalls);
+    fte->dirty = 0;
+}
+
+/**
+ * Writes the frame to its page's swap slot, giving the page a slot if it
+ * does not have one, and marks the frame clean. The caller holds the page's
+ * page table and the frame.
+*/
+static void writePageToSlot(const Thread *thread, FTEntry *fte, uint16_t *slot) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    // Handle running out of swap slots with kernelPanic
+    if (!claimPageSlot(slot)) {
+        sprintf(logBuffer, "Thread %d writePageToSlot(): No free swap slots remaining\n", thread->threadId);
+        logData(logBuffer);
+        flushLog();
+        kernelPanic(thread, frameVirtualPageNum(fte) * PAGE_SIZE);
+        return;
+    }
+    sprintf(logBuffer, "Thread %d writePageToSlot(): Swapping frame %d owned by thread %d's vpn %d to slot %d\n",
+                        thread->threadId, fte->frameNum, frameOwner(fte), frameVirtualPageNum(fte), *slot);
+    logData(logBuffer);
+    flushLog();
+    writeFrameToSlot(thread, fte, frameVirtualPageNum(fte), *slot);
+}
+
+void swapPageCopyToDisk(const Thread *thread, FTEntry *fte, PTEntry *pte, uint8_t threadId, uint16_t vpn) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    sprintf(logBuffer, "Thread %d swapPageCopyToDisk(): Swapping out thread %d's vpn %d from frame %d\n",
+                        thread->threadId, threadId, vpn, fte->frameNum);
+    logData(logBuffer);
+    flushLog();
+    if (!elideZeroPage(thread, fte, &pte->swapSlot) && !storePageInPool(thread, fte, pte, threadId, vpn)) {
+        writePageToSlot(thread, fte, &pte->swapSlot);
+    }
+}
+
+uint16_t beginSwapPageCopy(const Thread *thread, FTEntry *fte, PTEntry *pte, uint8_t threadId, uint16_t vpn, uint8_t *page) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    sprintf(logBuffer, "Thread %d beginSwapPageCopy(): Copying frame %d out for thread %d's vpn %d\n",
+                        thread->threadId, fte->frameNum, threadId, vpn);
+    logData(logBuffer);
+    flushLog();
+    // The frame's dirty bit describes its owner's slot, not the copy's
+    uint8_t dirty = fte->dirty;
+    uint16_t slot = SWAP_SLOT_NONE;
+    if (!elideZeroPage(thread, fte, &pte->swapSlot) && !storePageInPool(thread, fte, pte, threadId, vpn)) {
+        if (claimPageSlot(&pte->swapSlot)) {
+            memcpy(page, fte->physAddr, PAGE_SIZE);
+            slot = pte->swapSlot;
+        } else {
+            sprintf(logBuffer, "Thread %d beginSwapPageCopy(): No free swap slots remaining\n", thread->threadId);
+            logData(logBuffer);
+            flushLog();
+            kernelPanic(thread, vpn * PAGE_SIZE);
+        }
     }
-    // Write the frame to the file
-    uint16_t writtenBytes = fwrite(evictedFTE->physAddr, sizeof(uint8_t), PAGE_SIZE, file);
+    fte->dirty = dirty;
+    return slot;
+}
+
+void finishSwapPageCopy(const Thread *thread, const uint8_t *page, uint16_t vpn, uint16_t slot) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    struct iovec pageData = {.iov_base = (void *)page, .iov_len = PAGE_SIZE};
+    ssize_t writtenBytes = writeSwapSlots(slot, &pageData, 1);
     if (writtenBytes != PAGE_SIZE) {
-        sprintf(logBuffer, "Thread %d swapPageToDisk(): Wrote only %d bytes from %d to %s\n",
-                            thread->threadId, writtenBytes, evictedFTE->frameNum, fileName);
+        sprintf(logBuffer, "Thread %d finishSwapPageCopy(): Wrote only %ld bytes to slot %d\n",
+                            thread->threadId, writtenBytes, slot);
         logData(logBuffer);
         flushLog();
+        perror("Errno");
+        kernelPanic(thread, vpn * PAGE_SIZE);
+        return;
+    }
+    STAT_INC(swapWrites);
+    STAT_INC(swapWriteCalls);
+}
+
+bool beginSwapPageToDisk(const Thread *thread, FTEntry *evictedFTE, PageTransit *transit) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    sprintf(logBuffer, "Thread %d beginSwapPageToDisk(): Beginning swap attempt...\n", thread->threadId);
+    logData(logBuffer);
+    flushLog();
+    // The evicted page's owner's page table is locked by the caller
+    uint8_t ownerThreadId = frameOwner(evictedFTE);
+    uint16_t vpn = frameVirtualPageNum(evictedFTE);
+    PTEntry *pte = &getThreadPageTable(ownerThreadId)->entries[vpn];
+    // A page of a shared region is written to the region's slot for the
+    // page, which every mapping of it reads from. It skips the compressed
+    // pool, whose entries each belong to a single page table entry
+    bool inRegion = pte->sharedRegion;
+    uint16_t *slot = inRegion ? sharedPageSlot(pte) : &pte->swapSlot;
+    uint16_t firstSharer = inRegion ? REVERSE_MAP_NONE : firstFrameSharer(evictedFTE);
+    // Pages sharing the frame without a slot of their own are given a share
+    // of the owner's slot, so the owner's page skips the pool as well then
+    bool sharersNeedSlot = false;
+    for (uint16_t index = firstSharer; index != REVERSE_MAP_NONE; index = reverseMap->sharers[index].next) {
+        FrameSharer *sharer = &reverseMap->sharers[index];
+        sharersNeedSlot |= getThreadPageTable(sharer->threadId)->entries[sharer->vpn].swapSlot == SWAP_SLOT_NONE;
+    }
+    bool inTransit = false;
+    // A page of a mapped file is kept in the file, which a clean page
+    // already matches. Zero pages are written like any other, the file must
+    // hold them
+    if (sharedPageInFile(pte)) {
+        if (evictedFTE->dirty == 0) {
+            STAT_INC(swapWritesSkipped);
+        } else if (transitSwapOut) {
+            inTransit = true;
+        } else {
+            writeSharedPageToFile(thread, evictedFTE, pte);
+        }
+    } else if (evictedFTE->dirty == 0 && *slot != SWAP_SLOT_NONE) {
+        // A clean page still has an up to date copy in its slot, so it can
+        // be dropped without writing it again
+        sprintf(logBuffer, "Thread %d beginSwapPageToDisk(): Frame %d is clean, slot %d is up to date\n",
+                            thread->threadId, evictedFTE->frameNum, *slot);
+        logData(logBuffer);
+        flushLog();
+        STAT_INC(swapWritesSkipped);
+    } else if (!elideZeroPage(thread, evictedFTE, slot)
+               && (inRegion || sharersNeedSlot || !storePageInPool(thread, evictedFTE, pte, ownerThreadId, vpn))) {
+        // Once its pages are unmapped nothing else reads or writes the
+        // frame, so the caller can write it out with every lock dropped
+        if (!transitSwapOut) {
+            writePageToSlot(thread, evictedFTE, slot);
+        } else if (claimPageSlot(slot)) {
+            inTransit = true;
+        } else {
+            sprintf(logBuffer, "Thread %d beginSwapPageToDisk(): No free swap slots remaining\n", thread->threadId);
+            logData(logBuffer);
+            flushLog();
+            kernelPanic(thread, vpn * PAGE_SIZE);
+            return false;
+        }
+    }
+    // Every page sharing the frame is swapped out with it. A sharer's slot
+    // is either up to date or SWAP_SLOT_NONE, since the frame cannot be
+    // written to while it is shared, so a sharer without one can share the
+    // owner's, waiting for it along with the owner while it is in transit.
+    // A sharer the owner's slot has no reference left for is written out on
+    // its own with the locks held, which only happens to a frame shared by
+    // hundreds of pages. The other mappings of a shared region page already
+    // share its slot
+    for (uint16_t index = firstSharer; index != REVERSE_MAP_NONE; index = reverseMap->sharers[index].next) {
+        FrameSharer *sharer = &reverseMap->sharers[index];
+        PTEntry *sharerPte = &getThreadPageTable(sharer->threadId)->entries[sharer->vpn];
+        if (sharerPte->swapSlot != SWAP_SLOT_NONE) {
+            STAT_INC(swapWritesSkipped);
+        } else if (addSwapSlotReference(*slot)) {
+            sharerPte->swapSlot = *slot;
+            if (inTransit) {
+                sharerPte->inTransit = 1;
+            }
+            STAT_INC(swapWritesSkipped);
+        } else {
+            swapPageCopyToDisk(thread, evictedFTE, sharerPte, sharer->threadId, sharer->vpn);
+        }
+    }
+    // Faults on the page wait until it is written out, those on a page of a
+    // shared region in the region, where every mapping of it faults
+    if (inTransit) {
+        if (inRegion) {
+            beginSharedPageTransit(pte);
+        } else {
+            pte->inTransit = 1;
+        }
+        transit->frame = evictedFTE;
+        transit->threadId = ownerThreadId;
+        transit->vpn = vpn;
+        transit->slot = sharedPageInFile(pte) ? SWAP_SLOT_NONE : *slot;
+        transit->evicted = true;
     }
     // Reset the frame table entry's ownership fields
-    evictedFTE->ownerThreadId = 0;
-    evictedFTE->virtualPageNum = 0;
-    // Close the file to save it
-    fclose(file);
+    setFrameOwner(evictedFTE, 0, 0);
+
+    if (!inTransit) {
+        sprintf(logBuffer, "Thread %d beginSwapPageToDisk(): Swap complete...\n", thread->threadId);
+        logData(logBuffer);
+        flushLog();
+    }
+    return inTransit;
+}
+
+void finishPageTransit(const Thread *thread, PageTransit *transit) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    PageTable *ownerTable = getThreadPageTable(transit->threadId);
+    // The page an entry maps never changes, and its slot or file stays
+    // claimed for the page while it is in transit
+    PTEntry *pte = &ownerTable->entries[transit->vpn];
+    sprintf(logBuffer, "Thread %d finishPageTransit(): Writing frame %d holding thread %d's vpn %d in transit\n",
+                        thread->threadId, transit->frame->frameNum, transit->threadId, transit->vpn);
+    logData(logBuffer);
+    flushLog();
+    if (transit->slot == SWAP_SLOT_NONE) {
+        writeSharedPageToFile(thread, transit->frame, pte);
+    } else {
+        writeFrameToSlot(thread, transit->frame, transit->vpn, transit->slot);
+    }
+    STAT_INC(transitWrites);
+
+    // Wake whatever waits for the page. An evicted page's sharers waited
+    // for its slot, a shared region page's mappings for its frame. The
+    // chain of a shared region page cannot change while the page is in
+    // transit, joining it waits in the region
+    if (transit->evicted && !pte->sharedRegion) {
+        endPageTransit(ownerTable, transit->vpn);
+        releaseFrameSharers(transit->frame);
+    } else if (transit->evicted) {
+        endSharedPageTransit(pte);
+    } else {
+        if (pte->sharedRegion) {
+            for (uint16_t index = firstFrameSharer(transit->frame); index != REVERSE_MAP_NONE; index = reverseMap->sharers[index].next) {
+                FrameSharer *sharer = &reverseMap->sharers[index];
+                endPageTransit(getThreadPageTable(sharer->threadId), sharer->vpn);
+            }
+            endSharedPageTransit(pte);
+        }
+        endPageTransit(ownerTable, transit->vpn);
+    }
+
+    sprintf(logBuffer, "Thread %d finishPageTransit(): Swap complete...\n", thread->threadId);
+    logData(logBuffer);
+    flushLog();
+}
+
+uint16_t shareSwapSlot(PTEntry *pte) {
+    uint16_t slot = pte->swapSlot;
+    if (slot != SWAP_SLOT_NONE && slot != SWAP_SLOT_ZERO) {
+        pthread_mutex_lock(&swapDevice->lock);
+        swapDevice->slotRefCounts[slot]++;
+        pthread_mutex_unlock(&swapDevice->lock);
+    }
+    return slot;
+}
 
-    sprintf(logBuffer, "Thread %d swapPageToDisk(): Swap complete...\n", thread->threadId);
+void writeBackPooledPage(const Thread *thread, PTEntry *pte) {
+    pthread_mutex_lock(&compressedPool->lock);
+    // The page may have left the pool meanwhile. Its slot changes under the
+    // pool lock, even when its page table is not held
+    uint16_t slot = __atomic_load_n(&pte->swapSlot, __ATOMIC_RELAXED);
+    if (isPoolSlot(slot)) {
+        writeBackPoolEntry(thread, slot - SWAP_SLOT_POOL_BASE);
+    }
+    pthread_mutex_unlock(&compressedPool->lock);
+}
+
+void trimCompressedPool(const Thread *thread) {
+    uint32_t capacity = poolCapacity();
+    if (capacity == 0) {
+        return;
+    }
+    // Keep room for a page that compresses as badly as the pool accepts, so
+    // the next eviction can store whatever it evicts
+    pthread_mutex_lock(&compressedPool->lock);
+    while (compressedPool->oldest != COMPRESSED_POOL_NONE
+           && compressedPool->usedBytes + poolBytesForSize(COMPRESSED_PAGE_MAX_SIZE) > capacity) {
+        writeBackPoolEntry(thread, compressedPool->oldest);
+    }
+    pthread_mutex_unlock(&compressedPool->lock);
+}
+
+void discardSwapSlot(PTEntry *pte) {
+    if (isPoolSlot(pte->swapSlot)) {
+        pthread_mutex_lock(&compressedPool->lock);
+        // The pool may have written the page out to a slot in the meantime
+        if (isPoolSlot(pte->swapSlot)) {
+            dropPoolEntry(pte->swapSlot - SWAP_SLOT_POOL_BASE);
+            pte->swapSlot = SWAP_SLOT_NONE;
+        }
+        pthread_mutex_unlock(&compressedPool->lock);
+    }
+    if (pte->swapSlot != SWAP_SLOT_NONE && pte->swapSlot != SWAP_SLOT_ZERO) {
+        freeSwapSlot(pte->swapSlot);
+    }
+    pte->swapSlot = SWAP_SLOT_NONE;
+}
+
+bool beginWriteBackPage(const Thread *thread, FTEntry *fte, PageTransit *transit) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    // The page's owner's page table is locked by the caller
+    uint8_t ownerThreadId = frameOwner(fte);
+    uint16_t vpn = frameVirtualPageNum(fte);
+    PTEntry *pte = &getThreadPageTable(ownerThreadId)->entries[vpn];
+    sprintf(logBuffer, "Thread %d beginWriteBackPage(): Writing back thread %d's vpn %d in frame %d\n",
+                        thread->threadId, ownerThreadId, vpn, fte->frameNum);
     logData(logBuffer);
     flushLog();
+    STAT_INC(writeBacks);
+    uint16_t *slot = pte->sharedRegion ? sharedPageSlot(pte) : &pte->swapSlot;
+    bool inFile = sharedPageInFile(pte);
+    if (!inFile && elideZeroPage(thread, fte, slot)) {
+        return false;
+    }
+    if (!inFile && !claimPageSlot(slot)) {
+        sprintf(logBuffer, "Thread %d beginWriteBackPage(): No free swap slots remaining\n", thread->threadId);
+        logData(logBuffer);
+        flushLog();
+        kernelPanic(thread, vpn * PAGE_SIZE);
+        return false;
+    }
+    if (!transitSwapOut) {
+        if (inFile) {
+            writeSharedPageToFile(thread, fte, pte);
+        } else {
+            writeFrameToSlot(thread, fte, vpn, *slot);
+        }
+        return false;
+    }
+    // The page stays mapped. Pages sharing a private frame are write
+    // protected, so only its owner can write to it or give it up, while
+    // every mapping of a shared region page writes straight to its frame.
+    // A write made once the transit ends marks the frame dirty again
+    fte->dirty = 0;
+    pte->inTransit = 1;
+    if (pte->sharedRegion) {
+        beginSharedPageTransit(pte);
+        for (uint16_t index = firstFrameSharer(fte); index != REVERSE_MAP_NONE; index = reverseMap->sharers[index].next) {
+            FrameSharer *sharer = &reverseMap->sharers[index];
+            getThreadPageTable(sharer->threadId)->entries[sharer->vpn].inTransit = 1;
+        }
+    }
+    transit->frame = fte;
+    transit->threadId = ownerThreadId;
+    transit->vpn = vpn;
+    transit->slot = inFile ? SWAP_SLOT_NONE : *slot;
+    transit->evicted = false;
+    return true;
+}
+
+/**
+ * Writes the frames, holding pages of the thread, to their slots with a
+ * single vectored write for each run of consecutive slots, and marks the
+ * frames clean. Nothing may write to the frames meanwhile.
+*/
+static void writeFramesToSlots(const Thread *thread, uint8_t ownerThreadId, FTEntry **frames, const uint16_t *slots, int numFrames) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    struct iovec pageData[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+        pageData[i].iov_base = frames[i]->physAddr;
+        pageData[i].iov_len = PAGE_SIZE;
+    }
+    int runStart = 0;
+    for (int i = 0; i < numFrames; i++) {
+        if (i + 1 < numFrames && slots[i + 1] == slots[i] + 1) {
+            continue;
+        }
+        int runPages = i + 1 - runStart;
+        sprintf(logBuffer, "Thread %d writeFramesToSlots(): Writing %d of thread %d's pages from vpn %d to slots %d to %d\n",
+                            thread->threadId, runPages, ownerThreadId, frameVirtualPageNum(frames[runStart]), slots[runStart], slots[i]);
+        logData(logBuffer);
+        flushLog();
+        ssize_t writtenBytes = writeSwapSlots(slots[runStart], &pageData[runStart], runPages);
+        if (writtenBytes != (ssize_t)runPages * PAGE_SIZE) {
+            sprintf(logBuffer, "Thread %d writeFramesToSlots(): Wrote only %ld bytes to slots %d to %d\n",
+                                thread->threadId, writtenBytes, slots[runStart], slots[i]);
+            logData(logBuffer);
+            flushLog();
+            perror("Errno");
+            kernelPanic(thread, frameVirtualPageNum(frames[runStart]) * PAGE_SIZE);
+            return;
+        }
+        for (int j = runStart; j <= i; j++) {
+            frames[j]->dirty = 0;
+        }
+        __atomic_fetch_add(&vmStats.swapWrites, runPages, __ATOMIC_RELAXED);
+        STAT_INC(swapWriteCalls);
+        runStart = i + 1;
+    }
 }
 
-void swapPageFromDisk(Thread *thread, int virtualPageNumber, uint16_t newFrameNum) {
+int beginWriteBackPageCluster(const Thread *thread, FTEntry **frames, int numFrames, uint16_t *slots) {
     char logBuffer[MAX_BUFFER_SIZE];
-    // Retrieve the frame table entry
+    // The pages' owner's page table is locked by the caller
+    uint8_t ownerThreadId = frameOwner(frames[0]);
+    PageTable *pageTable = getThreadPageTable(ownerThreadId);
+    // Zero pages need no slot, the rest are written together
+    int numPages = 0;
+    bool slotsInPlace = true;
+    for (int i = 0; i < numFrames; i++) {
+        uint16_t *slot = &pageTable->entries[frameVirtualPageNum(frames[i])].swapSlot;
+        if (elideZeroPage(thread, frames[i], slot)) {
+            continue;
+        }
+        // Pages whose slots already follow one another are written over them
+        if (numPages > 0 && *slot != slots[0] + numPages) {
+            slotsInPlace = false;
+        }
+        if (!swapSlotOnDisk(*slot) || swapSlotShared(*slot)) {
+            slotsInPlace = false;
+        }
+        slots[numPages] = *slot;
+        frames[numPages++] = frames[i];
+    }
+    __atomic_fetch_add(&vmStats.writeBacks, numFrames, __ATOMIC_RELAXED);
+    if (numPages == 0) {
+        return 0;
+    }
+
+    if (!slotsInPlace) {
+        // Give up the old slots first so the new run can reuse them
+        for (int i = 0; i < numPages; i++) {
+            discardSwapSlot(&pageTable->entries[frameVirtualPageNum(frames[i])]);
+        }
+        // Without a free run long enough each page gets a slot of its own
+        uint16_t firstSlot = allocateSwapSlotRun(numPages);
+        for (int i = 0; i < numPages; i++) {
+            PTEntry *pte = &pageTable->entries[frameVirtualPageNum(frames[i])];
+            if (firstSlot != SWAP_SLOT_NONE) {
+                pte->swapSlot = firstSlot + i;
+            } else if (!claimPageSlot(&pte->swapSlot)) {
+                sprintf(logBuffer, "Thread %d beginWriteBackPageCluster(): No free swap slots remaining\n", thread->threadId);
+                logData(logBuffer);
+                flushLog();
+                kernelPanic(thread, frameVirtualPageNum(frames[i]) * PAGE_SIZE);
+                return 0;
+            }
+            slots[i] = pte->swapSlot;
+        }
+    }
+    if (!transitSwapOut) {
+        writeFramesToSlots(thread, ownerThreadId, frames, slots, numPages);
+        return 0;
+    }
+    // The pages stay mapped but wait before writing to their frames. A
+    // write made once the transit ends marks a frame dirty again
+    for (int i = 0; i < numPages; i++) {
+        frames[i]->dirty = 0;
+        pageTable->entries[frameVirtualPageNum(frames[i])].inTransit = 1;
+    }
+    return numPages;
+}
+
+void finishPageClusterTransit(const Thread *thread, FTEntry **frames, const uint16_t *slots, int numFrames) {
+    // The frames cannot change hands while their pages are in transit
+    uint8_t ownerThreadId = frameOwner(frames[0]);
+    writeFramesToSlots(thread, ownerThreadId, frames, slots, numFrames);
+    __atomic_fetch_add(&vmStats.transitWrites, numFrames, __ATOMIC_RELAXED);
+    PageTable *pageTable = getThreadPageTable(ownerThreadId);
+    for (int i = 0; i < numFrames; i++) {
+        endPageTransit(pageTable, frameVirtualPageNum(frames[i]));
+    }
+}
+
+void swapPageFromDisk(const Thread *thread, int virtualPageNumber, uint16_t newFrameNum) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    // Retrieve the frame table entry and the page's slot
     FTEntry *fte = &frameTable->entries[newFrameNum];
+    PTEntry *pte = &getThreadPageTable(thread->threadId)->entries[virtualPageNumber];
     pthread_mutex_lock(&fte->lock);
-    sprintf(logBuffer, "Thread %d swapPageFromDisk(): Swapping data in file %d_%d.swp into memory for page %d at new frame %d...\n",
-                        thread->threadId, thread->threadId, virtualPageNumber, virtualPageNumber, newFrameNum);
+    // The compressed pool can move the page to a slot at any time. A page
+    // of a shared region is read from the region's slot, which is never in
+    // the pool
+    uint16_t slot = pte->sharedRegion ? *sharedPageSlot(pte) : __atomic_load_n(&pte->swapSlot, __ATOMIC_RELAXED);
+    sprintf(logBuffer, "Thread %d swapPageFromDisk(): Swapping data in slot %d into memory for page %d at new frame %d...\n",
+                        thread->threadId, slot, virtualPageNumber, newFrameNum);
     logData(logBuffer);
     flushLog();
 
-    // Retreive the file name
-    char fileName[MAX_FILE_NAME_SIZE];
-    int evictedPageAddress = PAGE_SIZE * virtualPageNumber;
-    getCacheFileName(thread, evictedPageAddress, fileName);
-    // Open the swap file associated with that page
-    FILE *file = fopen(fileName, "r");
-    // Handle failure to open file with kernelPanic
-    if (file == NULL) {
-        sprintf(logBuffer, "Thread %d swapPageFromDisk(): Error opening file %s\n", thread->threadId, fileName);
+    // A page in the compressed pool is decompressed and leaves the pool, so
+    // the page has no slot until it is evicted again
+    if (isPoolSlot(slot)) {
+        pthread_mutex_lock(&compressedPool->lock);
+        slot = pte->swapSlot;
+        if (isPoolSlot(slot)) {
+            bool loaded = loadPoolEntry(slot - SWAP_SLOT_POOL_BASE, fte->physAddr);
+            dropPoolEntry(slot - SWAP_SLOT_POOL_BASE);
+            pte->swapSlot = SWAP_SLOT_NONE;
+            pthread_mutex_unlock(&compressedPool->lock);
+            pthread_mutex_unlock(&fte->lock);
+            if (!loaded) {
+                sprintf(logBuffer, "Thread %d swapPageFromDisk(): Page %d does not decompress\n", thread->threadId, virtualPageNumber);
+                logData(logBuffer);
+                flushLog();
+                kernelPanic(thread, virtualPageNumber * PAGE_SIZE);
+                return;
+            }
+            STAT_INC(poolLoads);
+            return;
+        }
+        // It was written out to the slot in the meantime
+        pthread_mutex_unlock(&compressedPool->lock);
+    }
+    // A page that was all zeros is refilled without any I/O
+    if (slot == SWAP_SLOT_ZERO) {
+        memset(fte->physAddr, 0, PAGE_SIZE);
+        pthread_mutex_unlock(&fte->lock);
+        return;
+    }
+    // Handle a page that was never swapped out with kernelPanic
+    if (slot == SWAP_SLOT_NONE) {
+        sprintf(logBuffer, "Thread %d swapPageFromDisk(): Page %d has no swap slot\n", thread->threadId, virtualPageNumber);
         logData(logBuffer);
         flushLog();
-        perror("Errno");
-        kernelPanic(thread, file);
+        pthread_mutex_unlock(&fte->lock);
+        kernelPanic(thread, virtualPageNumber * PAGE_SIZE);
+        return;
     }
     // Read the contents of the swapped page into the frame
-    uint16_t readBytes = fread(fte->physAddr, sizeof(uint8_t), PAGE_SIZE, file);
+    struct iovec pageData = {.iov_base = fte->physAddr, .iov_len = PAGE_SIZE};
+    ssize_t readBytes = readSwapSlots(slot, &pageData, 1);
     if (readBytes != PAGE_SIZE) {
-        sprintf(logBuffer, "Thread %d swapPageFromDisk(): Read only %d bytes from %s to %d\n",
-                    thread->threadId, readBytes, fileName, fte->frameNum);
+        sprintf(logBuffer, "Thread %d swapPageFromDisk(): Read only %ld bytes from slot %d to %d\n",
+                    thread->threadId, readBytes, slot, fte->frameNum);
         logData(logBuffer);
         flushLog();
     }
-    // Update the frame table entry's ownership fields
-    fte->ownerThreadId = thread->threadId;
-    fte->virtualPageNum = virtualPageNumber;
+    STAT_INC(swapReads);
+    STAT_INC(swapReadCalls);
+    // The page keeps its slot, which stays valid until the frame is written to
     pthread_mutex_unlock(&fte->lock);
-    fclose(file);
-    remove(fileName);
 
     sprintf(logBuffer, "Thread %d swapPageFromDisk(): Swap complete...\n", thread->threadId);
     logData(logBuffer);
     flushLog();
 }
+
+bool swapSlotOnDisk(uint16_t slot) {
+    return slot != SWAP_SLOT_NONE && slot != SWAP_SLOT_ZERO && !isPoolSlot(slot);
+}
+
+bool swapSlotInPool(uint16_t slot) {
+    return isPoolSlot(slot);
+}
+
+void swapPagesFromDisk(const Thread *thread, uint32_t firstVpn, const uint16_t *frameNums, int numPages) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    PageTable *pageTable = getThreadPageTable(thread->threadId);
+    struct iovec pages[numPages];
+    SwapSlotRun runs[numPages];
+    int runFirstVpns[numPages];
+    int numRuns = 0;
+    int runStart = 0;
+    // The frames have no owner yet, so nothing else touches them, and only
+    // this thread faults its pages in, so their slots cannot change
+    for (int i = 0; i < numPages; i++) {
+        pages[i].iov_base = frameTable->entries[frameNums[i]].physAddr;
+        pages[i].iov_len = PAGE_SIZE;
+        uint16_t slot = pageTable->entries[firstVpn + i].swapSlot;
+        // Read each run of pages in consecutive slots with a single request
+        if (i + 1 < numPages && pageTable->entries[firstVpn + i + 1].swapSlot == slot + 1) {
+            continue;
+        }
+        uint16_t firstSlot = pageTable->entries[firstVpn + runStart].swapSlot;
+        runs[numRuns] = (SwapSlotRun){.firstSlot = firstSlot, .pages = &pages[runStart], .numPages = i + 1 - runStart};
+        runFirstVpns[numRuns++] = firstVpn + runStart;
+        runStart = i + 1;
+    }
+    // Issue every run at once, so a backend that can overlaps them
+    swapBackend->readPages(runs, numRuns);
+    for (int run = 0; run < numRuns; run++) {
+        uint16_t firstSlot = pageTable->entries[runFirstVpns[run]].swapSlot;
+        int runPages = runs[run].numPages;
+        if (runs[run].result != (ssize_t)runPages * PAGE_SIZE) {
+            sprintf(logBuffer, "Thread %d swapPagesFromDisk(): Read only %ld bytes from slots %d to %d\n",
+                                thread->threadId, runs[run].result, firstSlot, firstSlot + runPages - 1);
+            logData(logBuffer);
+            flushLog();
+        }
+        sprintf(logBuffer, "Thread %d swapPagesFromDisk(): Read vpns %d to %d from slots %d to %d\n",
+                            thread->threadId, runFirstVpns[run], runFirstVpns[run] + runPages - 1, firstSlot, firstSlot + runPages - 1);
+        logData(logBuffer);
+        flushLog();
+        __atomic_fetch_add(&vmStats.swapReads, runPages, __ATOMIC_RELAXED);
+        STAT_INC(swapReadCalls);
+    }
+}
+
+bool readSwapSlot(uint16_t slot, uint8_t *page) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    struct iovec pageData = {.iov_base = page, .iov_len = PAGE_SIZE};
+    ssize_t readBytes = readSwapSlots(slot, &pageData, 1);
+    STAT_INC(swapReadCalls);
+    if (readBytes != PAGE_SIZE) {
+        sprintf(logBuffer, "readSwapSlot(): Read only %ld bytes from slot %d\n", readBytes, slot);
+        logData(logBuffer);
+        flushLog();
+        return false;
+    }
+    STAT_INC(swapReads);
+    return true;
+}
+
+void exportSwapSlot(uint16_t slot, const char *fileName) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    uint8_t page[PAGE_SIZE];
+    struct iovec pageData = {.iov_base = page, .iov_len = PAGE_SIZE};
+    if (slot == SWAP_SLOT_ZERO) {
+        memset(page, 0, PAGE_SIZE);
+    } else if (isPoolSlot(slot)) {
+        pthread_mutex_lock(&compressedPool->lock);
+        bool loaded = loadPoolEntry(slot - SWAP_SLOT_POOL_BASE, page);
+        pthread_mutex_unlock(&compressedPool->lock);
+        if (!loaded) {
+            sprintf(logBuffer, "exportSwapSlot(): Error decompressing slot %d\n", slot);
+            logData(logBuffer);
+            flushLog();
+            return;
+        }
+    } else if (readSwapSlots(slot, &pageData, 1) != PAGE_SIZE) {
+        sprintf(logBuffer, "exportSwapSlot(): Error reading slot %d\n", slot);
+        logData(logBuffer);
+        flushLog();
+        return;
+    }
+    FILE *file = fopen(fileName, "w+");
+    if (file == NULL) {
+        sprintf(logBuffer, "exportSwapSlot(): Error opening file %s\n", fileName);
+        logData(logBuffer);
+        flushLog();
+        perror("Errno");
+        return;
+    }
+    fwrite(page, sizeof(uint8_t), PAGE_SIZE, file);
+    fclose(file);
+}
+
+#pragma endregion
+
+#pragma region Swap Callback
+
+void initializeSwapDevice() {
+    pthread_mutex_init(&swapDevice->lock, NULL);
+    memset(swapDevice->slotBitmap, 0, sizeof(swapDevice->slotBitmap));
+    // Reserve slot 0 so it can be used to mean "no slot"
+    swapDevice->slotBitmap[0] = 1;
+    swapDevice->numFreeSlots = NUM_SWAP_SLOTS - 1;
+    swapDevice->nextSlotHint = 1;
+    // Set up the engine file backends issue their I/O through, then the
+    // store the slots are kept in
+    initializeSwapIo(frameTable->entries[0].physAddr, NUM_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    openSwapBackend();
+
+    // Chain every block and every entry of the compressed pool together
+    pthread_mutex_init(&compressedPool->lock, NULL);
+    for (int i = 0; i < COMPRESSED_POOL_BLOCKS; i++) {
+        compressedPool->nextBlock[i] = i + 1 < COMPRESSED_POOL_BLOCKS ? i + 1 : COMPRESSED_POOL_NONE;
+    }
+    for (int i = 0; i < COMPRESSED_POOL_ENTRIES; i++) {
+        compressedPool->entries[i].size = 0;
+        compressedPool->entries[i].older = i + 1 < COMPRESSED_POOL_ENTRIES ? i + 1 : COMPRESSED_POOL_NONE;
+    }
+    compressedPool->freeBlocks = 0;
+    compressedPool->freeEntries = 0;
+    compressedPool->oldest = COMPRESSED_POOL_NONE;
+    compressedPool->newest = COMPRESSED_POOL_NONE;
+    compressedPool->usedBytes = 0;
+}
+
+void deinitializeSwapDevice() {
+    closeSwapBackend();
+    deinitializeSwapIo();
+    pthread_mutex_destroy(&swapDevice->lock);
+    pthread_mutex_destroy(&compressedPool->lock);
+}
+
+#pragma endregion
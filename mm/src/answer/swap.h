@@ -8,15 +8,292 @@
 #include "page.h"
 #include "frame.h"
 
+#pragma region Swap Macros
+
+/* Every user page of every thread can be backed by one swap slot (32 * 1792).
+   Slot 0 is reserved so that a zeroed page table entry never refers to a slot */
+#define NUM_SWAP_SLOTS (NUM_PAGE_TABLES * NUM_FRAME_TABLE_ENTRIES + 1)
+/* Slot number stored in a page table entry that has no swap slot */
+#define SWAP_SLOT_NONE 0
+/* Slot number stored in a page table entry whose page was all zeros when it
+   was last written out. It has no slot and is refilled with zeros */
+#define SWAP_SLOT_ZERO 0xFFFF
+/* Size of the blocks compressed pages are stored in */
+#define COMPRESSED_POOL_BLOCK_SIZE 128
+/* Number of blocks in the compressed pool (320 KiB) */
+#define COMPRESSED_POOL_BLOCKS 2560
+/* Bytes the compressed pool can hold */
+#define COMPRESSED_POOL_SIZE (COMPRESSED_POOL_BLOCKS * COMPRESSED_POOL_BLOCK_SIZE)
+/* A page takes at least one block, so the pool never holds more pages than
+   it has blocks */
+#define COMPRESSED_POOL_ENTRIES COMPRESSED_POOL_BLOCKS
+/* Pages that do not compress to this size or less go straight to disk */
+#define COMPRESSED_PAGE_MAX_SIZE 3072
+/* Entry number that ends a chain of blocks or entries */
+#define COMPRESSED_POOL_NONE 0xFFFF
+/* Slot numbers from here on stand for pages held in the compressed pool, one
+   for each pool entry */
+#define SWAP_SLOT_POOL_BASE NUM_SWAP_SLOTS
+/* Bytes the compressed pool may use before its least recently stored pages
+   are written out to the swap device */
+#define DEFAULT_COMPRESSED_POOL_BUDGET (256 * 1024)
+
+#pragma endregion
+
+#pragma region Swap Structs
+
+/**
+ * Defines the swap device. All swapped pages live in page sized slots, kept
+ * in the store of the selected swap backend. A bitmap tracks which slots are
+ * in use. A slot can be shared by the pages of forked threads, so each slot
+ * counts the page table entries referring to it.
+*/
+typedef struct SwapDevice {
+    pthread_mutex_t lock;                            // Lock for the slot bitmap and reference counts
+    uint32_t numFreeSlots;                           // Number of slots not in use
+    uint32_t nextSlotHint;                           // Slot the next free slot search starts at
+    uint64_t slotBitmap[(NUM_SWAP_SLOTS + 63) / 64]; // One bit per slot, set if the slot is in use
+    uint8_t slotRefCounts[NUM_SWAP_SLOTS];           // Number of page table entries referring to each slot
+} SwapDevice;
+
+/**
+ * Defines a page held in the compressed pool. Its compressed bytes are kept
+ * in a chain of blocks.
+*/
+typedef struct CompressedPage {
+    uint16_t firstBlock;    // First block of the page's compressed bytes
+    uint16_t size;          // Number of compressed bytes, 0 if the entry is free
+    uint16_t vpn;           // The virtual page number of the page
+    uint8_t ownerThreadId;  // The threadId of the page's owner
+    uint8_t writingBack;    // Set while the page is written out to a slot, the entry is off the list meanwhile
+    uint16_t older;         // Entry stored before this one, or the next free entry
+    uint16_t newer;         // Entry stored after this one
+} CompressedPage;
+
+/**
+ * Defines the compressed pool kept in front of the swap device. Evicted
+ * pages are compressed into it rather than written to disk, and refaulted
+ * pages are decompressed from it. Once it is left with too little room
+ * within its budget, the pages stored longest ago are written out to the
+ * swap device. Entries are kept in a list from least to most recently
+ * stored, and free blocks and free entries in chains of their own.
+*/
+typedef struct CompressedPool {
+    pthread_mutex_t lock;                                               // Lock for the whole pool
+    uint32_t usedBytes;                                                 // Bytes of the blocks in use
+    uint16_t freeBlocks;                                                // First free block
+    uint16_t freeEntries;                                               // First free entry
+    uint16_t oldest;                                                    // Entry stored longest ago
+    uint16_t newest;                                                    // Entry stored most recently
+    uint16_t nextBlock[COMPRESSED_POOL_BLOCKS];                         // Next block in each chain
+    CompressedPage entries[COMPRESSED_POOL_ENTRIES];                    // The pages in the pool
+    uint8_t blocks[COMPRESSED_POOL_BLOCKS][COMPRESSED_POOL_BLOCK_SIZE]; // The compressed bytes
+} CompressedPool;
+
+/**
+ * Defines a frame being written out with its locks dropped. The pages that
+ * need the write are in transit until finishPageTransit is done with it.
+*/
+typedef struct PageTransit {
+    FTEntry *frame;     // The frame being written out
+    uint8_t threadId;   // The threadId of the frame's owner when the write began
+    uint16_t vpn;       // The owner's page held in the frame
+    uint16_t slot;      // The slot the frame is written to, SWAP_SLOT_NONE if it goes to the file of its shared page
+    bool evicted;       // Whether the frame was evicted, rather than written back with its pages still mapped
+} PageTransit;
+
+#pragma endregion
+
+#pragma region Swap FunctionDeclarations
+
+/**
+ * Given a frame table entry, will swap the frame associated with it to disk,
+ * for its owner and for every page sharing it. A page that is all zeros is
+ * not written, its page table entry records SWAP_SLOT_ZERO instead. A page
+ * that compresses well is stored in the compressed pool if it has room, and
+ * only reaches the disk once trimCompressedPool writes it out. A page of a
+ * shared region goes to the region's slot for it, shared by every mapping of
+ * the page, and a dirty page of a mapped file goes back to the file. Pages
+ * sharing the frame without a slot of their own share the owner's slot, up
+ * to the most references a slot can count. Any sharer past that is written
+ * out on its own right away, with the locks held. The frame loses its
+ * owner. The frame and the page tables and region of its pages must be
+ * locked by the caller, as lockEvictionCandidate does.
+ *
+ * Under transitSwapOut, the frame is not written here. Its slot is claimed,
+ * or its file picked, the pages that will read it back are marked in transit
+ * and true is returned with the write described in transit. The caller
+ * unmaps the pages and drops its locks before finishing the write with
+ * finishPageTransit. Returns false if nothing is left to write.
+*/
+bool beginSwapPageToDisk(const Thread *thread, FTEntry *frameTableEntry, PageTransit *transit);
+
+/**
+ * Writes out the frame of a transit begun by beginSwapPageToDisk or
+ * beginWriteBackPage, then ends the transit of every page waiting for it.
+ * Called without any lock. An evicted frame has no owner and is not mapped,
+ * and the pages mapped to a frame being written back wait before writing to
+ * it or giving it up, so nothing changes the frame meanwhile.
+*/
+void finishPageTransit(const Thread *thread, PageTransit *transit);
+
 /**
- * Given a frame table entry, will swap the frame associated with it to disk
+ * Writes a dirty page to its swap slot, or its file if it is a page of a
+ * mapped file, and marks its frame clean without evicting it. A zero page
+ * is elided as usual. The frame and the page tables and region of its pages
+ * must be locked by the caller, as lockEvictionCandidate does.
+ *
+ * Under transitSwapOut, the frame is not written here. It is marked clean,
+ * its slot is claimed and every page mapped to it that could write to it is
+ * marked in transit, so writes wait for the frame to be written out. True
+ * is returned with the write described in transit, for the caller to finish
+ * with finishPageTransit once it has dropped its locks. Returns false if
+ * nothing is left to write.
 */
-void swapPageToDisk(Thread *thread, FTEntry *frameTableEntry);
+bool beginWriteBackPage(const Thread *thread, FTEntry *frameTableEntry, PageTransit *transit);
 
-/** 
+/**
+ * Writes back the dirty pages in the given frames, all mapped to pages of
+ * the same thread outside shared regions and given in order of vpn, and
+ * marks the frames clean. The pages go to consecutive slots with a single
+ * vectored write, over their old slots if those already follow one another,
+ * or to a slot each if no free run is long enough. Zero pages are elided as
+ * usual. The pages' owner's page table and every frame must be locked by
+ * the caller.
+ *
+ * Under transitSwapOut, the frames are not written here. They are marked
+ * clean and their pages in transit, and the frames left to write are moved
+ * to the front of frames with their slots in slots. Returns the number of
+ * them, for the caller to write with finishPageClusterTransit once it has
+ * dropped its locks.
+*/
+int beginWriteBackPageCluster(const Thread *thread, FTEntry **frames, int numFrames, uint16_t *slots);
+
+/**
+ * Writes the frames left by beginWriteBackPageCluster to their slots, each
+ * run of consecutive slots with a single vectored write, then ends the
+ * transit of their pages. Called without any lock, the pages stay mapped
+ * to the frames but wait before writing to them.
+*/
+void finishPageClusterTransit(const Thread *thread, FTEntry **frames, const uint16_t *slots, int numFrames);
+
+/**
  * Given a thread, it's evicted virtual page number, will swap frame associated
- * with that vpn from disk back into memory.
+ * with that vpn from disk back into memory. A page swapped out as all zeros
+ * is zeroed instead of being read, and a page in the compressed pool is
+ * decompressed and removed from the pool.
+*/
+void swapPageFromDisk(const Thread *thread, int virtualPageNumber, uint16_t frameTableNum);
+
+/**
+ * Reads numPages of the thread's pages, starting at firstVpn, from their
+ * swap slots into the given frames. Each run of pages in consecutive slots
+ * is read with a single call. Every page must be in a slot on the swap
+ * device (see swapSlotOnDisk), and the frames must not be mapped yet.
 */
-void swapPageFromDisk(Thread *thread, int virtualPageNumber, uint16_t frameTableNum);
+void swapPagesFromDisk(const Thread *thread, uint32_t firstVpn, const uint16_t *frameNums, int numPages);
+
+/**
+ * Returns whether the slot is one on the swap device, rather than
+ * SWAP_SLOT_NONE, SWAP_SLOT_ZERO or a page in the compressed pool.
+*/
+bool swapSlotOnDisk(uint16_t slot);
+
+/**
+ * Reads the page in the given slot on the swap device into the buffer,
+ * without regard to the page it belongs to. Nothing stops the slot from
+ * being reused meanwhile, so the caller must check that the page still
+ * refers to it before using the bytes. Returns whether the whole page was
+ * read.
+*/
+bool readSwapSlot(uint16_t slot, uint8_t *page);
+
+/**
+ * Returns whether the slot stands for a page in the compressed pool.
+*/
+bool swapSlotInPool(uint16_t slot);
+
+/**
+ * Returns the page's slot with a reference added for another page to refer
+ * to it as well. The page must not be in the compressed pool, since an entry
+ * in the pool belongs to one page table entry, see writeBackPooledPage. The
+ * page's page table must be locked by the caller.
+*/
+uint16_t shareSwapSlot(PTEntry *pte);
+
+/**
+ * Writes the page out of the compressed pool to a slot of its own, if it is
+ * still in the pool. The page's page table is locked to point the page at
+ * the slot once it is written, so the caller must hold no page table.
+*/
+void writeBackPooledPage(const Thread *thread, PTEntry *pte);
+
+/**
+ * Writes the pages stored longest ago in the compressed pool out to the swap
+ * device until the pool has room within its budget for any page. Each page
+ * is written with the pool unlocked and moved to its slot under its owner's
+ * page table lock, so the caller must hold no page table.
+*/
+void trimCompressedPool(const Thread *thread);
+
+/**
+ * Writes the frame out for the thread's page at vpn, which has no slot and
+ * is not mapped to the frame, as beginSwapPageToDisk would: as a zero page, into
+ * the compressed pool or to a slot. The page's page table and the frame must
+ * be locked by the caller.
+*/
+void swapPageCopyToDisk(const Thread *thread, FTEntry *fte, PTEntry *pte, uint8_t threadId, uint16_t vpn);
+
+/**
+ * Gives the thread's page at vpn, which has no slot and is not mapped to the
+ * frame, a copy of the frame without writing to the swap device: a zero page
+ * and a page the compressed pool takes are settled at once. Otherwise the
+ * frame is copied into the page sized buffer and the page is given a slot,
+ * which is returned for the caller to write the buffer to with
+ * finishSwapPageCopy once it has dropped its locks. Returns SWAP_SLOT_NONE
+ * if nothing is left to write. The frame's dirty bit is left as it was. The
+ * page's page table and the frame must be locked by the caller.
+*/
+uint16_t beginSwapPageCopy(const Thread *thread, FTEntry *fte, PTEntry *pte, uint8_t threadId, uint16_t vpn, uint8_t *page);
+
+/**
+ * Writes the buffer filled by beginSwapPageCopy to the slot it returned for
+ * the page at vpn. Called without any lock.
+*/
+void finishSwapPageCopy(const Thread *thread, const uint8_t *page, uint16_t vpn, uint16_t slot);
+
+/**
+ * Frees the page's swap slot, or its entry in the compressed pool, and
+ * leaves it with SWAP_SLOT_NONE. Used when the copy in the slot is out of
+ * date and nothing may write it back. The page's page table must be locked
+ * by the caller.
+*/
+void discardSwapSlot(PTEntry *pte);
+
+/**
+ * Writes the contents of the given swap slot to a file with the given name.
+ * Used to expose a swapped page as a standalone file.
+*/
+void exportSwapSlot(uint16_t slot, const char *fileName);
+
+/**
+ * Opens the swap backend named by swapBackendType, marks every slot as free
+ * and empties the compressed pool.
+*/
+void initializeSwapDevice();
+
+/**
+ * Closes the swap backend, deleting every slot it stored.
+*/
+void deinitializeSwapDevice();
+
+#pragma endregion
+
+/* Bytes the compressed pool may use, at most COMPRESSED_POOL_SIZE. 0 turns
+   the pool off */
+extern uint32_t compressedPoolBudget;
+/* Whether evicted frames are written to their slot or file in transit,
+   with their locks dropped. false writes them with every lock held */
+extern bool transitSwapOut;
 
-#endif // VIRTUALMEMFRAMEWORKC_SWAP_H
\ No newline at end of file
+#endif // VIRTUALMEMFRAMEWORKC_SWAP_H
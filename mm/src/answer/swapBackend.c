@@ -0,0 +1,62 @@
+#include "swapBackend.h"
+#include "utils.h"
+#include <stdio.h>
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+SwapBackendType swapBackendType = SWAP_BACKEND_FILE;
+const SwapBackend *swapBackend = &fileSwapBackend;
+
+/* Every backend, indexed by its SwapBackendType */
+static const SwapBackend *swapBackends[NUM_SWAP_BACKENDS] = {
+    [SWAP_BACKEND_FILE] = &fileSwapBackend,
+    [SWAP_BACKEND_FILE_PER_PAGE] = &filePerPageSwapBackend,
+    [SWAP_BACKEND_RAM] = &ramSwapBackend,
+};
+
+#pragma region Swap Backend Functions
+
+void openSwapBackend() {
+    char logBuffer[MAX_BUFFER_SIZE];
+    if (swapBackendType >= NUM_SWAP_BACKENDS) {
+        swapBackendType = SWAP_BACKEND_FILE;
+    }
+    swapBackend = swapBackends[swapBackendType];
+    if (!swapBackend->open()) {
+        sprintf(logBuffer, "openSwapBackend(): %s swap backend cannot be opened, falling back to %s\n",
+                            swapBackend->name, fileSwapBackend.name);
+        logData(logBuffer);
+        flushLog();
+        swapBackend = &fileSwapBackend;
+        // Without any store at all the swap device is unusable
+        if (!swapBackend->open()) {
+            sprintf(logBuffer, "openSwapBackend(): Error creating swap file %s\n", SWAP_FILE_NAME);
+            logData(logBuffer);
+            flushLog();
+            perror("Errno");
+            kernelPanic(NULL, 0);
+        }
+    }
+    sprintf(logBuffer, "Using %s swap backend\n", swapBackend->name);
+    logData(logBuffer);
+    flushLog();
+}
+
+void closeSwapBackend() {
+    swapBackend->close();
+}
+
+ssize_t readSwapSlots(uint16_t firstSlot, const struct iovec *pages, int numPages) {
+    SwapSlotRun run = {.firstSlot = firstSlot, .pages = pages, .numPages = numPages};
+    swapBackend->readPages(&run, 1);
+    return run.result;
+}
+
+ssize_t writeSwapSlots(uint16_t firstSlot, const struct iovec *pages, int numPages) {
+    SwapSlotRun run = {.firstSlot = firstSlot, .pages = pages, .numPages = numPages};
+    swapBackend->writePages(&run, 1);
+    return run.result;
+}
+
+#pragma endregion
@@ -0,0 +1,93 @@
+#ifndef VIRTUALMEMFRAMEWORKC_SWAPBACKEND_H
+#define VIRTUALMEMFRAMEWORKC_SWAPBACKEND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#pragma region Swap Backend Macros
+
+/* Name of the file backing the swap device under SWAP_BACKEND_FILE */
+#define SWAP_FILE_NAME "swap.dev"
+/* Format of the name of a slot's file under SWAP_BACKEND_FILE_PER_PAGE */
+#define SWAP_SLOT_FILE_FORMAT "slot_%d.swp"
+
+#pragma endregion
+
+#pragma region Swap Backend Structs
+
+/**
+ * Defines the stores the swap device's slots can be kept in.
+*/
+typedef enum SwapBackendType {
+    SWAP_BACKEND_FILE,          // A single preallocated file divided into slots
+    SWAP_BACKEND_FILE_PER_PAGE, // A file of its own for each slot that was written
+    SWAP_BACKEND_RAM,           // Anonymous memory, no disk at all
+    NUM_SWAP_BACKENDS
+} SwapBackendType;
+
+/**
+ * Defines a read or write of one or more pages in consecutive slots.
+*/
+typedef struct SwapSlotRun {
+    uint16_t firstSlot;         // Slot of the first page
+    const struct iovec *pages;  // The buffers of the pages, in slot order
+    int numPages;               // Number of buffers
+    ssize_t result;             // Bytes transferred, or -1 if any part failed, set once the run is done
+} SwapSlotRun;
+
+/**
+ * Defines a backend as the hooks the swap device keeps its slots through.
+ * Slots are allocated and reference counted by the swap device, a backend
+ * only stores their contents. Every hook but open and close may be called
+ * concurrently by different threads, though never for the same slot.
+*/
+typedef struct SwapBackend {
+    const char *name;                                       // Name used in logs and benchmarks
+    bool (*open)();                                         // Creates an empty store, returns false if it cannot
+    void (*writePages)(SwapSlotRun *runs, int numRuns);     // Writes every run and waits for all of them
+    void (*readPages)(SwapSlotRun *runs, int numRuns);      // Reads every run and waits for all of them
+    void (*discard)(uint16_t slot);                         // The slot is no longer used, called before it can be allocated again
+    void (*close)();                                        // Deletes the store
+} SwapBackend;
+
+#pragma endregion
+
+#pragma region Swap Backend FunctionDeclarations
+
+/**
+ * Selects the backend named by swapBackendType and opens it, falling back
+ * to SWAP_BACKEND_FILE if it cannot be opened.
+*/
+void openSwapBackend();
+
+/**
+ * Closes the backend in use, deleting everything it stored.
+*/
+void closeSwapBackend();
+
+/**
+ * Reads numPages pages from consecutive slots starting at firstSlot into the
+ * buffers. Returns the number of bytes read, or -1 on error.
+*/
+ssize_t readSwapSlots(uint16_t firstSlot, const struct iovec *pages, int numPages);
+
+/**
+ * Writes numPages pages from the buffers to consecutive slots starting at
+ * firstSlot. Returns the number of bytes written, or -1 on error.
+*/
+ssize_t writeSwapSlots(uint16_t firstSlot, const struct iovec *pages, int numPages);
+
+#pragma endregion
+
+/* The backend openSwapBackend will select */
+extern SwapBackendType swapBackendType;
+/* The backend currently in use */
+extern const SwapBackend *swapBackend;
+
+extern const SwapBackend fileSwapBackend;
+extern const SwapBackend filePerPageSwapBackend;
+extern const SwapBackend ramSwapBackend;
+
+#endif //VIRTUALMEMFRAMEWORKC_SWAPBACKEND_H
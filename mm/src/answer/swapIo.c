@@ -0,0 +1,54 @@
+#include "swapIo.h"
+#include "utils.h"
+#include <stdio.h>
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+SwapIoEngineType swapIoEngineType = SWAP_IO_SYNC;
+const SwapIoEngine *swapIoEngine = &syncSwapIo;
+
+/* Every engine, indexed by its SwapIoEngineType */
+static const SwapIoEngine *swapIoEngines[NUM_SWAP_IO_ENGINES] = {
+    [SWAP_IO_SYNC] = &syncSwapIo,
+    [SWAP_IO_URING] = &uringSwapIo,
+};
+
+#pragma region Swap IO Functions
+
+void initializeSwapIo(uint8_t *frames, size_t framesSize) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    if (swapIoEngineType >= NUM_SWAP_IO_ENGINES) {
+        swapIoEngineType = SWAP_IO_SYNC;
+    }
+    swapIoEngine = swapIoEngines[swapIoEngineType];
+    if (!swapIoEngine->init(frames, framesSize)) {
+        sprintf(logBuffer, "initializeSwapIo(): %s swap I/O is unavailable, falling back to %s\n",
+                            swapIoEngine->name, syncSwapIo.name);
+        logData(logBuffer);
+        flushLog();
+        swapIoEngine = &syncSwapIo;
+        swapIoEngine->init(frames, framesSize);
+    }
+    sprintf(logBuffer, "Using %s swap I/O\n", swapIoEngine->name);
+    logData(logBuffer);
+    flushLog();
+}
+
+void deinitializeSwapIo() {
+    swapIoEngine->deinit();
+}
+
+ssize_t readSwapPages(int fd, const struct iovec *pages, int numPages, off_t offset) {
+    SwapIoRequest request = {.write = false, .offset = offset, .pages = pages, .numPages = numPages};
+    swapIoEngine->submit(fd, &request, 1);
+    return request.result;
+}
+
+ssize_t writeSwapPages(int fd, const struct iovec *pages, int numPages, off_t offset) {
+    SwapIoRequest request = {.write = true, .offset = offset, .pages = pages, .numPages = numPages};
+    swapIoEngine->submit(fd, &request, 1);
+    return request.result;
+}
+
+#pragma endregion
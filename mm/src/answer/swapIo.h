@@ -0,0 +1,96 @@
+#ifndef VIRTUALMEMFRAMEWORKC_SWAPIO_H
+#define VIRTUALMEMFRAMEWORKC_SWAPIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#pragma region Swap IO Macros
+
+/* Number of entries in the io_uring submission queue. The completion queue
+   is twice as long, and no more entries than it holds are ever in flight */
+#define SWAP_IO_URING_ENTRIES 128
+/* Times the io_uring completion queue is polled for a caller's completions
+   before it sleeps in the kernel for them */
+#define SWAP_IO_URING_POLLS 8
+/* Most nanoseconds a caller sleeps in the kernel before it polls again */
+#define SWAP_IO_URING_WAIT_NS 200000
+
+#pragma endregion
+
+#pragma region Swap IO Structs
+
+/**
+ * Defines the engines swap I/O can be issued through.
+*/
+typedef enum SwapIoEngineType {
+    SWAP_IO_SYNC,           // A blocking preadv or pwritev for each request
+    SWAP_IO_URING,          // Batches of requests submitted to an io_uring at once
+    NUM_SWAP_IO_ENGINES
+} SwapIoEngineType;
+
+/**
+ * Defines a read or write of one or more pages at consecutive offsets of the
+ * swap file.
+*/
+typedef struct SwapIoRequest {
+    bool write;                 // Whether the pages are written to the file rather than read from it
+    off_t offset;               // Byte offset in the file of the first page
+    const struct iovec *pages;  // The buffers of the pages, in file order
+    int numPages;               // Number of buffers
+    ssize_t result;             // Bytes transferred, or -1 if any part failed, set once the request is done
+} SwapIoRequest;
+
+/**
+ * Defines an engine as the hooks the swap device issues its I/O through.
+ * submit may be called concurrently by different threads.
+*/
+typedef struct SwapIoEngine {
+    const char *name;                                                   // Name used in logs and benchmarks
+    bool (*init)(uint8_t *frames, size_t framesSize);                   // Sets the engine up, returns false if it is unavailable
+    void (*deinit)();                                                   // Releases what init set up
+    void (*submit)(int fd, SwapIoRequest *requests, int numRequests);   // Issues every request and waits for all of them
+} SwapIoEngine;
+
+#pragma endregion
+
+#pragma region Swap IO FunctionDeclarations
+
+/**
+ * Selects the engine named by swapIoEngineType and sets it up, falling back
+ * to SWAP_IO_SYNC if it is unavailable. The frames are the memory pages are
+ * read into and written from, which an engine may register with the kernel
+ * up front.
+*/
+void initializeSwapIo(uint8_t *frames, size_t framesSize);
+
+/**
+ * Releases the engine in use.
+*/
+void deinitializeSwapIo();
+
+/**
+ * Reads numPages pages from the file at the given offset into the buffers.
+ * Returns the number of bytes read, or -1 on error.
+*/
+ssize_t readSwapPages(int fd, const struct iovec *pages, int numPages, off_t offset);
+
+/**
+ * Writes numPages pages from the buffers to the file at the given offset.
+ * Returns the number of bytes written, or -1 on error.
+*/
+ssize_t writeSwapPages(int fd, const struct iovec *pages, int numPages, off_t offset);
+
+#pragma endregion
+
+/* The engine initializeSwapIo will select */
+extern SwapIoEngineType swapIoEngineType;
+/* The engine currently in use */
+extern const SwapIoEngine *swapIoEngine;
+
+extern const SwapIoEngine syncSwapIo;
+extern const SwapIoEngine uringSwapIo;
+
+#endif //VIRTUALMEMFRAMEWORKC_SWAPIO_H
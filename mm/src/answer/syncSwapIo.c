@@ -0,0 +1,34 @@
+#include "swapIo.h"
+#include <unistd.h>
+
+#pragma region Sync Swap IO
+
+static bool syncInit(uint8_t *frames, size_t framesSize) {
+    // Nothing is registered, reads and writes go straight to the backend
+    (void)frames;
+    (void)framesSize;
+    return true;
+}
+
+static void syncDeinit() {
+}
+
+static void syncSubmit(int fd, SwapIoRequest *requests, int numRequests) {
+    for (int i = 0; i < numRequests; i++) {
+        SwapIoRequest *request = &requests[i];
+        if (request->write) {
+            request->result = pwritev(fd, request->pages, request->numPages, request->offset);
+        } else {
+            request->result = preadv(fd, request->pages, request->numPages, request->offset);
+        }
+    }
+}
+
+const SwapIoEngine syncSwapIo = {
+    .name = "pread/pwrite",
+    .init = syncInit,
+    .deinit = syncDeinit,
+    .submit = syncSubmit,
+};
+
+#pragma endregion
@@ -3,6 +3,9 @@
 #include <string.h>
 #include "thread.h"
 #include "utils.h"
+#include "frame.h"
+#include "page.h"
+#include "region.h"
 
 extern unsigned char *SYSTEM_MEMORY;
 typedef struct PageDirectory PageDirectory;
@@ -27,10 +30,26 @@ Thread* createThread() {
     return ret;
 }
 
+Thread* forkThread(const Thread* parent) {
+    // Thread ids are never reused, so once every page table has been given
+    // out there is none left for the child
+    if (currentThreadId > NUM_PAGE_TABLES) {
+        return NULL;
+    }
+    Thread* ret = createThread();
+    ret->heapBottom = parent->heapBottom;
+    ret->stackTop = parent->stackTop;
+    forkPageTable(parent, ret);
+    forkSharedRegions(parent, ret);
+    return ret;
+}
+
 void destroyThread(Thread* thread) {
     // This is line is ABSOLUTELY REQUIRED for the tests to run properly. This allows the thread to finish its work
     // DO NOT REMOVE.
     if (thread->thread) pthread_join(thread->thread, NULL);
+    // Give the frames the thread kept for itself back to the other threads
+    drainFrameMagazine(thread);
     // Destroy the thread's page table mutex
     // pthread_mutex_destroy(&thread->ptLock);
 
@@ -25,6 +25,18 @@ typedef struct Thread
  */
 Thread* createThread();
 
+/**
+ * Creates a thread with a copy of the parent's address space. The copy is
+ * made lazily: the child shares every page of the parent, and a page is only
+ * copied once either thread writes to it. The cost of a fork grows with the
+ * size of the parent's page table, not with the data in its pages. Shared
+ * regions mapped by the parent are mapped by the child as well.
+ * @param parent The thread whose address space is copied.
+ * @return A thread like one from createThread, with the parent's heap and stack, or NULL if no page table
+ * is left for the child.
+ */
+Thread* forkThread(const Thread* parent);
+
 /**
  * Destroys a thread object and cleans up any allocated memory. This function will also do a pthread_join so that
  * the called thread can finish completing. Removing the pthread_join will cause bad behavior.
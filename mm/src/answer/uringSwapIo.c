@@ -0,0 +1,370 @@
+#include "swapIo.h"
+#include "utils.h"
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Max log buffer size
+extern const int MAX_BUFFER_SIZE;
+
+/**
+ * Defines the part of a request carried out by one submission queue entry,
+ * found again through the entry's user_data when it completes. A request is
+ * split wherever its buffers are not next to each other in memory.
+*/
+typedef struct UringSwapIoOp {
+    SwapIoRequest *request; // The request the entry is part of
+    uint32_t length;        // Bytes the entry transfers
+    int *numPending;        // Entries of the submitting call that have not completed yet
+} UringSwapIoOp;
+
+/**
+ * Defines the io_uring shared by every thread. Submitters fill the
+ * submission queue under its lock and enter the kernel once for their whole
+ * batch. Completions are reaped by whichever waiting thread gets to them
+ * first, each one handed to the call it belongs to, so the I/O of different
+ * threads overlaps.
+*/
+typedef struct UringSwapIo {
+    int fd;                         // File descriptor of the ring
+    pthread_mutex_t submitLock;     // Lock for the submission queue
+    pthread_mutex_t completeLock;   // Lock for the completion queue
+    uint32_t numInFlight;           // Entries submitted and not yet reaped, at most cqEntries
+    bool canWait;                   // Whether the kernel takes a timeout for waiting on completions
+    bool buffersRegistered;         // Whether the frames are registered as a fixed buffer
+    uint8_t *frames;                // The registered frames
+    size_t framesSize;              // Bytes of the registered frames
+    void *sqRing;                   // Mapping of the submission queue
+    size_t sqRingSize;              // Bytes of the submission queue mapping
+    uint32_t *sqTail;               // Next submission queue entry to fill
+    uint32_t *sqMask;               // Mask of the submission queue's indices
+    uint32_t *sqArray;              // Entries submitted, by index into sqes
+    uint32_t sqEntries;             // Number of entries in the submission queue
+    struct io_uring_sqe *sqes;      // The submission queue entries
+    size_t sqesSize;                // Bytes of the submission queue entries
+    void *cqRing;                   // Mapping of the completion queue, the same as sqRing if shared
+    size_t cqRingSize;              // Bytes of the completion queue mapping
+    uint32_t *cqHead;               // Next completion to reap
+    uint32_t *cqTail;               // Completion after the last one posted
+    uint32_t *cqMask;               // Mask of the completion queue's indices
+    uint32_t cqEntries;             // Number of entries in the completion queue
+    struct io_uring_cqe *cqes;      // The completion queue entries
+} UringSwapIo;
+
+static UringSwapIo ring = {
+    .fd = -1,
+    .submitLock = PTHREAD_MUTEX_INITIALIZER,
+    .completeLock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+#pragma region Uring Swap IO Functions
+
+/**
+ * Unmaps whatever parts of the ring are mapped and closes it.
+*/
+static void releaseRing() {
+    if (ring.sqes != NULL && ring.sqes != MAP_FAILED) {
+        munmap(ring.sqes, ring.sqesSize);
+    }
+    if (ring.cqRing != NULL && ring.cqRing != MAP_FAILED && ring.cqRing != ring.sqRing) {
+        munmap(ring.cqRing, ring.cqRingSize);
+    }
+    if (ring.sqRing != NULL && ring.sqRing != MAP_FAILED) {
+        munmap(ring.sqRing, ring.sqRingSize);
+    }
+    if (ring.fd >= 0) {
+        close(ring.fd);
+    }
+    ring.fd = -1;
+    ring.sqRing = NULL;
+    ring.cqRing = NULL;
+    ring.sqes = NULL;
+}
+
+/**
+ * Returns whether the kernel carries out every opcode the ring submits.
+ * Kernels before 5.6 set up a ring but know neither IORING_OP_READ nor
+ * IORING_REGISTER_PROBE, so a failed probe means the ring cannot be used.
+*/
+static bool ringSupportsSwapOps() {
+    static const uint8_t swapOps[] = {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED};
+    size_t probeSize = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probeSize);
+    bool supported = syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0;
+    for (size_t i = 0; supported && i < sizeof(swapOps); i++) {
+        supported = swapOps[i] <= probe->last_op && (probe->ops[swapOps[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return supported;
+}
+
+/**
+ * Hands every completion posted so far to the call it belongs to. Returns
+ * whether there were any.
+*/
+static bool reapCompletions() {
+    pthread_mutex_lock(&ring.completeLock);
+    uint32_t head = *ring.cqHead;
+    uint32_t tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+    uint32_t numReaped = tail - head;
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cqMask];
+        UringSwapIoOp *op = (UringSwapIoOp *)(uintptr_t)cqe->user_data;
+        // The request must be settled before its caller can see it is done
+        if (cqe->res < 0) {
+            op->request->result = -1;
+        } else if (op->request->result >= 0) {
+            op->request->result += cqe->res;
+        }
+        __atomic_sub_fetch(op->numPending, 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&ring.numInFlight, numReaped, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&ring.completeLock);
+    return numReaped > 0;
+}
+
+/**
+ * Submits the given number of entries filled after the last submission,
+ * reaping completions while the kernel has no room for them. The
+ * submission queue must be locked by the caller.
+*/
+static void submitEntries(uint32_t numEntries) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    while (numEntries > 0) {
+        int submitted = syscall(__NR_io_uring_enter, ring.fd, numEntries, 0, 0, NULL, 0);
+        if (submitted >= 0) {
+            numEntries -= submitted;
+            continue;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // The entries still point into the callers' stacks, so nothing
+            // can be given back to them
+            sprintf(logBuffer, "submitEntries(): io_uring_enter failed submitting %d entries\n", numEntries);
+            logData(logBuffer);
+            flushLog();
+            perror("Errno");
+            kernelPanic(NULL, 0);
+            return;
+        }
+        reapCompletions();
+        sched_yield();
+    }
+}
+
+/**
+ * Waits until none of the calling submitter's entries are pending. Polls the
+ * completion queue first, since pages in the page cache complete within
+ * microseconds, then sleeps in the kernel until completions are posted.
+ * Another thread may reap the caller's completion while it sleeps, so every
+ * sleep is bounded.
+*/
+static void waitForCompletions(int *numPending) {
+    for (int poll = 0; __atomic_load_n(numPending, __ATOMIC_ACQUIRE) > 0; poll++) {
+        if (reapCompletions()) {
+            continue;
+        }
+        if (poll < SWAP_IO_URING_POLLS || !ring.canWait) {
+            sched_yield();
+            continue;
+        }
+        struct __kernel_timespec timeout = {.tv_sec = 0, .tv_nsec = SWAP_IO_URING_WAIT_NS};
+        struct io_uring_getevents_arg waitArg = {.ts = (uint64_t)(uintptr_t)&timeout};
+        syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &waitArg, sizeof(waitArg));
+    }
+}
+
+/**
+ * Returns whether the buffer lies within the registered frames.
+*/
+static bool inRegisteredFrames(const uint8_t *buffer, size_t length) {
+    return ring.buffersRegistered && buffer >= ring.frames && buffer + length <= ring.frames + ring.framesSize;
+}
+
+/**
+ * Returns the number of entries the request is split into.
+*/
+static int countEntries(const SwapIoRequest *request) {
+    int numEntries = 0;
+    for (int i = 0; i < request->numPages; i++) {
+        const uint8_t *base = request->pages[i].iov_base;
+        bool fixed = inRegisteredFrames(base, request->pages[i].iov_len);
+        if (i == 0 || (uint8_t *)request->pages[i - 1].iov_base + request->pages[i - 1].iov_len != base
+            || inRegisteredFrames(request->pages[i - 1].iov_base, request->pages[i - 1].iov_len) != fixed) {
+            numEntries++;
+        }
+    }
+    return numEntries;
+}
+
+#pragma endregion
+
+#pragma region Uring Swap IO
+
+static bool uringInit(uint8_t *frames, size_t framesSize) {
+    char logBuffer[MAX_BUFFER_SIZE];
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring.fd = syscall(__NR_io_uring_setup, SWAP_IO_URING_ENTRIES, &params);
+    if (ring.fd < 0) {
+        ring.fd = -1;
+        return false;
+    }
+    if (!ringSupportsSwapOps()) {
+        sprintf(logBuffer, "uringInit(): The kernel cannot read or write files through the ring\n");
+        logData(logBuffer);
+        flushLog();
+        releaseRing();
+        return false;
+    }
+    // Map the queues. Newer kernels share one mapping between both rings
+    ring.sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring.cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring.cqRingSize > ring.sqRingSize) {
+            ring.sqRingSize = ring.cqRingSize;
+        }
+        ring.cqRingSize = ring.sqRingSize;
+    }
+    ring.sqRing = mmap(NULL, ring.sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sqRing == MAP_FAILED) {
+        releaseRing();
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.cqRing = ring.sqRing;
+    } else {
+        ring.cqRing = mmap(NULL, ring.cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    }
+    ring.sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    if (ring.cqRing == MAP_FAILED || ring.sqes == MAP_FAILED) {
+        releaseRing();
+        return false;
+    }
+    ring.sqTail = (uint32_t *)((uint8_t *)ring.sqRing + params.sq_off.tail);
+    ring.sqMask = (uint32_t *)((uint8_t *)ring.sqRing + params.sq_off.ring_mask);
+    ring.sqArray = (uint32_t *)((uint8_t *)ring.sqRing + params.sq_off.array);
+    ring.cqHead = (uint32_t *)((uint8_t *)ring.cqRing + params.cq_off.head);
+    ring.cqTail = (uint32_t *)((uint8_t *)ring.cqRing + params.cq_off.tail);
+    ring.cqMask = (uint32_t *)((uint8_t *)ring.cqRing + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)((uint8_t *)ring.cqRing + params.cq_off.cqes);
+    ring.sqEntries = params.sq_entries;
+    ring.cqEntries = params.cq_entries;
+    ring.numInFlight = 0;
+    ring.canWait = (params.features & IORING_FEAT_EXT_ARG) != 0;
+
+    // Register the frames so pages move straight between them and the file
+    // without the kernel pinning them again for every entry. Without it the
+    // ring still works, only the frames are not pinned up front
+    struct iovec buffer = {.iov_base = frames, .iov_len = framesSize};
+    ring.frames = frames;
+    ring.framesSize = framesSize;
+    ring.buffersRegistered = syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, &buffer, 1) == 0;
+    sprintf(logBuffer, "uringInit(): Ring of %d entries set up, frames %s\n",
+                        params.sq_entries, ring.buffersRegistered ? "registered" : "not registered");
+    logData(logBuffer);
+    flushLog();
+    return true;
+}
+
+static void uringDeinit() {
+    releaseRing();
+}
+
+static void uringSubmit(int fd, SwapIoRequest *requests, int numRequests) {
+    int numEntries = 0;
+    for (int i = 0; i < numRequests; i++) {
+        requests[i].result = 0;
+        numEntries += countEntries(&requests[i]);
+    }
+    if (numEntries == 0) {
+        return;
+    }
+    UringSwapIoOp ops[numEntries];
+    int numPending = numEntries;
+
+    pthread_mutex_lock(&ring.submitLock);
+    uint32_t tail = *ring.sqTail;
+    uint32_t numQueued = 0;
+    int opNum = 0;
+    for (int i = 0; i < numRequests; i++) {
+        SwapIoRequest *request = &requests[i];
+        off_t offset = request->offset;
+        for (int page = 0; page < request->numPages;) {
+            // Join the buffers that follow each other in memory
+            uint8_t *base = request->pages[page].iov_base;
+            bool fixed = inRegisteredFrames(base, request->pages[page].iov_len);
+            uint32_t length = 0;
+            do {
+                length += request->pages[page].iov_len;
+                page++;
+            } while (page < request->numPages && (uint8_t *)request->pages[page].iov_base == base + length
+                     && inRegisteredFrames(request->pages[page].iov_base, request->pages[page].iov_len) == fixed);
+
+            // Never have more entries in flight than completions fit, and
+            // submit what is queued once the submission queue is full
+            while (__atomic_load_n(&ring.numInFlight, __ATOMIC_RELAXED) >= ring.cqEntries) {
+                __atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+                submitEntries(numQueued);
+                numQueued = 0;
+                if (!reapCompletions()) {
+                    sched_yield();
+                }
+            }
+            if (numQueued == ring.sqEntries) {
+                __atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+                submitEntries(numQueued);
+                numQueued = 0;
+            }
+
+            UringSwapIoOp *op = &ops[opNum++];
+            op->request = request;
+            op->length = length;
+            op->numPending = &numPending;
+            uint32_t index = tail & *ring.sqMask;
+            struct io_uring_sqe *sqe = &ring.sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            if (request->write) {
+                sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            } else {
+                sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            }
+            sqe->fd = fd;
+            sqe->addr = (uint64_t)(uintptr_t)base;
+            sqe->len = length;
+            sqe->off = offset;
+            sqe->buf_index = 0;
+            sqe->user_data = (uint64_t)(uintptr_t)op;
+            ring.sqArray[index] = index;
+            tail++;
+            numQueued++;
+            __atomic_add_fetch(&ring.numInFlight, 1, __ATOMIC_RELAXED);
+            offset += length;
+        }
+    }
+    // Submit the whole batch with a single call
+    __atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+    submitEntries(numQueued);
+    pthread_mutex_unlock(&ring.submitLock);
+
+    waitForCompletions(&numPending);
+    // A part that moved fewer bytes than asked leaves the total short, as
+    // a short preadv or pwritev would
+}
+
+const SwapIoEngine uringSwapIo = {
+    .name = "io_uring",
+    .init = uringInit,
+    .deinit = uringDeinit,
+    .submit = uringSubmit,
+};
+
+#pragma endregion
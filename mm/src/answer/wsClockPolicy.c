@@ -0,0 +1,106 @@
+#include "policy.h"
+#include "page.h"
+#include "reclaim.h"
+#include <pthread.h>
+
+extern FrameTable *frameTable;
+
+uint32_t workingSetWindow = DEFAULT_WORKING_SET_WINDOW;
+
+/* The frame the clock hand points at */
+static int currentlyCheckedFrame = 0;
+/* Lock for the hand, held while it moves */
+static pthread_mutex_t handLock = PTHREAD_MUTEX_INITIALIZER;
+
+#pragma region WSClock Policy
+
+/**
+ * Returns the virtual time of the given thread.
+*/
+static uint32_t threadVirtualTime(uint8_t threadId) {
+    return __atomic_load_n(&getThreadPageTable(threadId)->virtualTime, __ATOMIC_RELAXED);
+}
+
+static void wsClockInit() {
+    currentlyCheckedFrame = 0;
+}
+
+static void wsClockOnAllocate(FTEntry *entry) {
+    entry->lastUse = threadVirtualTime(frameOwner(entry));
+    markFrameAccessed(entry);
+}
+
+static void wsClockOnAccess(FTEntry *entry) {
+    // The hand turns the accessed bit into a last use time when it passes
+    markFrameAccessed(entry);
+}
+
+static FTEntry* wsClockPickVictim() {
+    // Evict the first clean frame that has left its owner's working set,
+    // scheduling dirty ones for write back on the way. Once the hand has gone
+    // all the way around without finding one, fall back to the unreferenced
+    // frame that was least recently used in its owner's virtual time
+    pthread_mutex_lock(&handLock);
+    FTEntry *evictedFrameTE = NULL;
+    FTEntry *oldestFrameTE = NULL;
+    uint32_t oldestAge = 0;
+    int framesChecked = 0;
+    for (; evictedFrameTE == NULL; currentlyCheckedFrame++) {
+        // Prevent accessing outside frame table bounds
+        if (currentlyCheckedFrame == NUM_FRAME_TABLE_ENTRIES) {
+            currentlyCheckedFrame = 0;
+        }
+        FTEntry *entry = &frameTable->entries[currentlyCheckedFrame];
+        uint8_t ownerThreadId = frameOwner(entry);
+        if (ownerThreadId == 0) {
+            continue;
+        }
+        framesChecked++;
+        if (framesChecked > NUM_FRAME_TABLE_ENTRIES) {
+            if (oldestFrameTE != NULL && lockEvictionCandidate(oldestFrameTE, true)) {
+                evictedFrameTE = oldestFrameTE;
+                break;
+            }
+            // The oldest frame's owner is busy, so take any unreferenced one
+            oldestFrameTE = NULL;
+            if (!frameAccessed(entry) && lockEvictionCandidate(entry, true)) {
+                evictedFrameTE = entry;
+            }
+            continue;
+        }
+        uint32_t now = threadVirtualTime(ownerThreadId);
+        if (clearFrameAccessed(entry)) {
+            entry->lastUse = now;
+            continue;
+        }
+        // Pages referenced within the window are in the working set
+        uint32_t age = now - entry->lastUse;
+        if (age <= workingSetWindow) {
+            if (oldestFrameTE == NULL || age > oldestAge) {
+                oldestFrameTE = entry;
+                oldestAge = age;
+            }
+            continue;
+        }
+        if (entry->dirty) {
+            scheduleWriteBack(entry->frameNum);
+            continue;
+        }
+        if (lockEvictionCandidate(entry, true)) {
+            evictedFrameTE = entry;
+        }
+    }
+    pthread_mutex_unlock(&handLock);
+    return evictedFrameTE;
+}
+
+const ReplacementPolicy wsClockPolicy = {
+    .name = "wsclock",
+    .init = wsClockInit,
+    .onAllocate = wsClockOnAllocate,
+    .onAccess = wsClockOnAccess,
+    .onEvict = NULL,
+    .pickVictim = wsClockPickVictim,
+};
+
+#pragma endregion
@@ -7,6 +7,20 @@
 #include "tests/stack/singleThreadedTests.h"
 #include "tests/stack/multiThreadedTests.h"
 #include "pagingTests.h"
+#include "tests/benchmarks/hitRateBenchmarks.h"
+#include "tests/benchmarks/freeListBenchmarks.h"
+#include "tests/benchmarks/evictionBenchmarks.h"
+#include "tests/benchmarks/frameScanBenchmarks.h"
+#include "tests/benchmarks/mergeBenchmarks.h"
+#include "tests/benchmarks/forkBenchmarks.h"
+#include "tests/benchmarks/regionBenchmarks.h"
+#include "tests/benchmarks/fileMapBenchmarks.h"
+#include "tests/benchmarks/readaheadBenchmarks.h"
+#include "tests/benchmarks/prefetchBenchmarks.h"
+#include "tests/benchmarks/flusherBenchmarks.h"
+#include "tests/benchmarks/swapIoBenchmarks.h"
+#include "tests/benchmarks/swapBackendBenchmarks.h"
+#include "tests/benchmarks/transitBenchmarks.h"
 #include "unity.h"
 #include "system.h"
 
@@ -18,6 +32,7 @@
 // #define RUN_MULTI_THREADED_STACK_TESTS
 // #define RUN_PAGING_TESTS
 // #define EXTRA_LONG_RUNNING_TESTS
+// #define RUN_BENCHMARKS
 
 
 extern bool panicExpected;
@@ -80,11 +95,52 @@ int main(void) {
     #ifdef RUN_PAGING_TESTS
     RUN_TEST(testDataPagedInCorrectly);
     RUN_TEST(testDataPagedOutCorrectly);
+    RUN_TEST(testFreeFrameStackUnderContention);
+    RUN_TEST(testBuddyAllocatorSplitsAndCoalesces);
+    RUN_TEST(testCompressionRoundTripsAndRejectsNoise);
+    RUN_TEST(testForkedThreadSeesThenDiverges);
+    RUN_TEST(testMappedFileWrittenBack);
+    RUN_TEST(testMergedPagesDivergeOnWrite);
+    RUN_TEST(testSharedRegionSeenAfterEviction);
+    RUN_TEST(testReadaheadReturnsSwappedPages);
+    RUN_TEST(testPrefetchReturnsSwappedPages);
+    RUN_TEST(testFlushedPagesReadBackIntact);
+    RUN_TEST(testSwapBackendsRoundTripPages);
+    RUN_TEST(testSwapIoEnginesReturnSameData);
+    RUN_TEST(testFaultWaitsForPageInTransit);
+    RUN_TEST(testSwapSlotsAllocatedInRunsAndFreed);
+    RUN_TEST(testCleanPagesDroppedWithoutWrite);
+    RUN_TEST(testZeroPageElidedAndReadBackZeroed);
+    RUN_TEST(testZeroFrameStaysZeroAfterFirstWrite);
     #endif
     #ifdef EXTRA_LONG_RUNNING_TESTS
     RUN_TEST(testMultiThreadedReadAllHeapMemory);
     RUN_TEST(testMultiThreadedReadAllStackMemory);
     #endif
+    #ifdef RUN_BENCHMARKS
+    RUN_TEST(benchmarkLoopingHitRate);
+    RUN_TEST(benchmarkScanHitRate);
+    RUN_TEST(benchmarkConcurrentHitRate);
+    RUN_TEST(benchmarkZipfianHitRate);
+    RUN_TEST(benchmarkFreeFramePoolContention);
+    RUN_TEST(benchmarkLargeCopyThroughput);
+    RUN_TEST(benchmarkConcurrentEvictionThroughput);
+    RUN_TEST(benchmarkSparseReservation);
+    RUN_TEST(benchmarkZeroPageEviction);
+    RUN_TEST(benchmarkCompressedPoolFaultLatency);
+    RUN_TEST(benchmarkSamePageMerging);
+    RUN_TEST(benchmarkForkCost);
+    RUN_TEST(benchmarkSharedRegionExchange);
+    RUN_TEST(benchmarkMappedFileStartup);
+    RUN_TEST(benchmarkSequentialReadahead);
+    RUN_TEST(benchmarkPatternPrefetch);
+    RUN_TEST(benchmarkDirtyPageFlushing);
+    RUN_TEST(benchmarkSwapIoEngines);
+    RUN_TEST(benchmarkSwapBackends);
+    RUN_TEST(benchmarkSwapOutInTransit);
+    RUN_TEST(benchmarkVictimScanCost);
+    RUN_TEST(benchmarkZeroPageCheck);
+    #endif
 
     return UNITY_END();
 
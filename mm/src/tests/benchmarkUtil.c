@@ -0,0 +1,54 @@
+#include "benchmarkUtil.h"
+#include "system.h"
+#include "swap.h"
+#include "prefetch.h"
+#include "readahead.h"
+#include "reclaim.h"
+#include "flusher.h"
+
+double elapsedSeconds(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+uint64_t nanosBetween(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000ull + end->tv_nsec - start->tv_nsec;
+}
+
+int compareNanos(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+BenchmarkSettings currentBenchmarkSettings() {
+    BenchmarkSettings settings = {
+        .freeFramePoolType = freeFramePoolType,
+        .replacementPolicyType = replacementPolicyType,
+        .swapBackendType = swapBackendType,
+        .swapIoEngineType = swapIoEngineType,
+        .compressedPoolBudget = compressedPoolBudget,
+        .transitSwapOut = transitSwapOut,
+        .prefetchDegree = prefetchDegree,
+        .readaheadMaxWindow = readaheadMaxWindow,
+        .reclaimLowWatermark = reclaimConfig.lowWatermark,
+        .flusherEnabled = flusherConfig.enabled,
+    };
+    return settings;
+}
+
+void restartSystem(const BenchmarkSettings *settings) {
+    systemShutdown();
+    if (settings != NULL) {
+        freeFramePoolType = settings->freeFramePoolType;
+        replacementPolicyType = settings->replacementPolicyType;
+        swapBackendType = settings->swapBackendType;
+        swapIoEngineType = settings->swapIoEngineType;
+        compressedPoolBudget = settings->compressedPoolBudget;
+        transitSwapOut = settings->transitSwapOut;
+        prefetchDegree = settings->prefetchDegree;
+        readaheadMaxWindow = settings->readaheadMaxWindow;
+        reclaimConfig.lowWatermark = settings->reclaimLowWatermark;
+        flusherConfig.enabled = settings->flusherEnabled;
+    }
+    systemInit();
+}
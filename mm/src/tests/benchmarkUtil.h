@@ -0,0 +1,55 @@
+#ifndef VIRTUALMEMFRAMEWORKC_BENCHMARKUTIL_H
+#define VIRTUALMEMFRAMEWORKC_BENCHMARKUTIL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "frame.h"
+#include "policy.h"
+#include "swapBackend.h"
+#include "swapIo.h"
+
+/**
+ * The settings benchmarks run the system under. The system reads them while
+ * it runs, so they are only changed by restartSystem.
+ */
+typedef struct BenchmarkSettings {
+    FreeFramePoolType freeFramePoolType;
+    ReplacementPolicyType replacementPolicyType;
+    SwapBackendType swapBackendType;
+    SwapIoEngineType swapIoEngineType;
+    uint32_t compressedPoolBudget;
+    bool transitSwapOut;
+    uint8_t prefetchDegree;
+    uint8_t readaheadMaxWindow;
+    uint16_t reclaimLowWatermark;
+    bool flusherEnabled;
+} BenchmarkSettings;
+
+/**
+ * Returns the seconds between two CLOCK_MONOTONIC times.
+ */
+double elapsedSeconds(const struct timespec *start, const struct timespec *end);
+
+/**
+ * Returns the nanoseconds between two CLOCK_MONOTONIC times.
+ */
+uint64_t nanosBetween(const struct timespec *start, const struct timespec *end);
+
+/**
+ * Orders two uint64_t latencies for qsort, shortest first.
+ */
+int compareNanos(const void *a, const void *b);
+
+/**
+ * Returns the settings the system is running with.
+ */
+BenchmarkSettings currentBenchmarkSettings();
+
+/**
+ * Shuts the system down and starts it again with the given settings, with
+ * every frame free. NULL keeps the current settings.
+ */
+void restartSystem(const BenchmarkSettings *settings);
+
+#endif //VIRTUALMEMFRAMEWORKC_BENCHMARKUTIL_H
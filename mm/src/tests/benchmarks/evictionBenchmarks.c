@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "evictionBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "swap.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Pages shared out between the threads, more than fit in memory */
+#define EVICTION_BENCHMARK_PAGES 4096
+/* Times each thread sweeps its pages */
+#define EVICTION_BENCHMARK_SWEEPS 2
+
+/* Pages written by the thread whose working set the reservation competes with */
+#define RESERVATION_BENCHMARK_RESIDENT_PAGES 1024
+/* Pages reserved at once, most of the address space */
+#define RESERVATION_BENCHMARK_RESERVED_PAGES 1536
+/* Only one in this many reserved pages is written */
+#define RESERVATION_BENCHMARK_TOUCH_STRIDE 64
+
+/* Pages written by each of the zero page benchmark's threads, together more
+   than fit in memory. Every other one is all zeros */
+#define ZERO_PAGE_BENCHMARK_PAGES 1024
+#define ZERO_PAGE_BENCHMARK_THREADS 2
+
+/* Pages written by each of the compressed pool benchmark's threads, together
+   more than fit in memory */
+#define POOL_BENCHMARK_PAGES 1024
+#define POOL_BENCHMARK_THREADS 2
+/* Size of the records the compressed pool benchmark fills its pages with */
+#define POOL_BENCHMARK_RECORD_SIZE 16
+
+static const int evictionBenchmarkThreadCounts[] = {4, 8, 16, 32};
+
+/**
+ * Defines one thread of the eviction benchmark.
+ */
+typedef struct EvictionBenchmarkThread {
+    Thread *thread;
+    int heapAddr;
+    int numPages;
+} EvictionBenchmarkThread;
+
+/**
+ * Body of each benchmark thread. Writes to every one of its pages in turn,
+ * faulting and evicting once memory is full.
+ */
+static void* sweepPages(void *arg) {
+    EvictionBenchmarkThread *benchmarkThread = arg;
+    for (int sweep = 0; sweep < EVICTION_BENCHMARK_SWEEPS; sweep++) {
+        for (int page = 0; page < benchmarkThread->numPages; page++) {
+            writeToAddr(benchmarkThread->thread, benchmarkThread->heapAddr + page * PAGE_SIZE, sizeof(int), &page);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Sweeps the same number of pages with the given number of threads at once
+ * and reports how fast frames were evicted.
+ */
+static void runConcurrentEviction(int numThreads) {
+    EvictionBenchmarkThread threads[32];
+    for (int x = 0; x < numThreads; x++) {
+        threads[x].thread = createThread();
+        threads[x].numPages = EVICTION_BENCHMARK_PAGES / numThreads;
+        threads[x].heapAddr = allocateHeapMem(threads[x].thread, threads[x].numPages * PAGE_SIZE);
+    }
+
+    uint64_t evictionsBefore = vmStats.swapWrites + vmStats.swapWritesSkipped;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int x = 0; x < numThreads; x++) {
+        pthread_create(&threads[x].thread->thread, NULL, sweepPages, &threads[x]);
+    }
+    for (int x = 0; x < numThreads; x++) {
+        pthread_join(threads[x].thread->thread, NULL);
+        threads[x].thread->thread = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    uint64_t evictions = vmStats.swapWrites + vmStats.swapWritesSkipped - evictionsBefore;
+    printf("BENCHMARK concurrent eviction (%d threads): %lu evictions, %.0f evictions per second\n",
+           numThreads, (unsigned long)evictions, evictions / elapsedSeconds(&start, &end));
+
+    for (int x = 0; x < numThreads; x++) {
+        destroyThread(threads[x].thread);
+    }
+}
+
+/**
+ * Measures how eviction throughput changes as more threads fault at once.
+ */
+void benchmarkConcurrentEvictionThroughput() {
+    for (size_t x = 0; x < sizeof(evictionBenchmarkThreadCounts) / sizeof(int); x++) {
+        restartSystem(NULL);
+        runConcurrentEviction(evictionBenchmarkThreadCounts[x]);
+    }
+}
+
+/**
+ * Reserves most of a thread's address space while another thread's working
+ * set fills much of memory, then writes to a few of the reserved pages.
+ * Reports how long that took and how many frames had to be evicted for it.
+ */
+void benchmarkSparseReservation() {
+    restartSystem(NULL);
+    Thread *resident = createThread();
+    int residentAddr = allocateHeapMem(resident, RESERVATION_BENCHMARK_RESIDENT_PAGES * PAGE_SIZE);
+    for (int page = 0; page < RESERVATION_BENCHMARK_RESIDENT_PAGES; page++) {
+        writeToAddr(resident, residentAddr + page * PAGE_SIZE, sizeof(int), &page);
+    }
+
+    Thread *reserver = createThread();
+    uint64_t evictionsBefore = vmStats.swapWrites + vmStats.swapWritesSkipped;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int reservedAddr = allocateHeapMem(reserver, RESERVATION_BENCHMARK_RESERVED_PAGES * PAGE_SIZE);
+    for (int page = 0; page < RESERVATION_BENCHMARK_RESERVED_PAGES; page += RESERVATION_BENCHMARK_TOUCH_STRIDE) {
+        writeToAddr(reserver, reservedAddr + page * PAGE_SIZE, sizeof(int), &page);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    uint64_t evictions = vmStats.swapWrites + vmStats.swapWritesSkipped - evictionsBefore;
+    printf("BENCHMARK sparse reservation (%d pages, %d written): %.2f ms, %lu evictions\n",
+           RESERVATION_BENCHMARK_RESERVED_PAGES, RESERVATION_BENCHMARK_RESERVED_PAGES / RESERVATION_BENCHMARK_TOUCH_STRIDE,
+           elapsedSeconds(&start, &end) * 1e3, (unsigned long)evictions);
+    destroyThread(resident);
+    destroyThread(reserver);
+}
+
+/**
+ * Writes more pages than fit in memory, every other one all zeros, then
+ * reads them all back. Reports how many zero pages were swapped out without
+ * any I/O and how much I/O was left.
+ */
+void benchmarkZeroPageEviction() {
+    restartSystem(NULL);
+    uint8_t *zeros = calloc(1, PAGE_SIZE);
+    uint8_t *data = malloc(PAGE_SIZE);
+    uint8_t *readBack = malloc(PAGE_SIZE);
+    for (int x = 0; x < PAGE_SIZE; x++) {
+        data[x] = x * 31 + 1;
+    }
+    Thread *threads[ZERO_PAGE_BENCHMARK_THREADS];
+    int addrs[ZERO_PAGE_BENCHMARK_THREADS];
+    for (int t = 0; t < ZERO_PAGE_BENCHMARK_THREADS; t++) {
+        threads[t] = createThread();
+        addrs[t] = allocateHeapMem(threads[t], ZERO_PAGE_BENCHMARK_PAGES * PAGE_SIZE);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < ZERO_PAGE_BENCHMARK_THREADS; t++) {
+        for (int page = 0; page < ZERO_PAGE_BENCHMARK_PAGES; page++) {
+            writeToAddr(threads[t], addrs[t] + page * PAGE_SIZE, PAGE_SIZE, page % 2 ? data : zeros);
+        }
+    }
+    for (int t = 0; t < ZERO_PAGE_BENCHMARK_THREADS; t++) {
+        for (int page = 0; page < ZERO_PAGE_BENCHMARK_PAGES; page++) {
+            readFromAddr(threads[t], addrs[t] + page * PAGE_SIZE, PAGE_SIZE, readBack);
+            TEST_ASSERT_EQUAL_MEMORY(page % 2 ? data : zeros, readBack, PAGE_SIZE);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("BENCHMARK zero page eviction (%d pages, half zero): %.2f ms, %lu zero pages elided, %lu swap writes, %lu swap reads\n",
+           ZERO_PAGE_BENCHMARK_THREADS * ZERO_PAGE_BENCHMARK_PAGES, elapsedSeconds(&start, &end) * 1e3,
+           (unsigned long)vmStats.zeroPagesElided, (unsigned long)vmStats.swapWrites, (unsigned long)vmStats.swapReads);
+    for (int t = 0; t < ZERO_PAGE_BENCHMARK_THREADS; t++) {
+        destroyThread(threads[t]);
+    }
+    free(zeros);
+    free(data);
+    free(readBack);
+}
+
+/**
+ * Fills a page with records that look like typical heap data: a counting id,
+ * a few flags and a small value, so the page compresses to about a third.
+*/
+static void fillRecordPage(uint8_t *page, int pageNum) {
+    for (int offset = 0; offset < PAGE_SIZE; offset += POOL_BENCHMARK_RECORD_SIZE) {
+        uint32_t record[POOL_BENCHMARK_RECORD_SIZE / sizeof(uint32_t)] = {
+            pageNum * (PAGE_SIZE / POOL_BENCHMARK_RECORD_SIZE) + offset / POOL_BENCHMARK_RECORD_SIZE, 7, (offset / 64) % 5 * 1000, 0
+        };
+        memcpy(page + offset, record, POOL_BENCHMARK_RECORD_SIZE);
+    }
+}
+
+/**
+ * Writes compressible pages, more than fit in memory, then reads them all
+ * back and reports the average time taken by each fault with the compressed
+ * pool given the budget.
+*/
+static void runCompressedPoolFaults(uint32_t budget) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    settings.compressedPoolBudget = budget;
+    // Without the reclaimer each fault evicts a frame itself, so the time is
+    // not spent waiting for the reclaimer to finish with a page table
+    settings.reclaimLowWatermark = 0;
+    restartSystem(&settings);
+    uint8_t *page = malloc(PAGE_SIZE);
+    uint8_t *readBack = malloc(POOL_BENCHMARK_THREADS * POOL_BENCHMARK_PAGES * PAGE_SIZE);
+    Thread *threads[POOL_BENCHMARK_THREADS];
+    int addrs[POOL_BENCHMARK_THREADS];
+    for (int t = 0; t < POOL_BENCHMARK_THREADS; t++) {
+        threads[t] = createThread();
+        addrs[t] = allocateHeapMem(threads[t], POOL_BENCHMARK_PAGES * PAGE_SIZE);
+        for (int pageNum = 0; pageNum < POOL_BENCHMARK_PAGES; pageNum++) {
+            fillRecordPage(page, t * POOL_BENCHMARK_PAGES + pageNum);
+            writeToAddr(threads[t], addrs[t] + pageNum * PAGE_SIZE, PAGE_SIZE, page);
+        }
+    }
+
+    // Only the reads are timed, the pages are checked afterwards
+    uint64_t faultsBefore = vmStats.pageFaults;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < POOL_BENCHMARK_THREADS; t++) {
+        for (int pageNum = 0; pageNum < POOL_BENCHMARK_PAGES; pageNum++) {
+            readFromAddr(threads[t], addrs[t] + pageNum * PAGE_SIZE, PAGE_SIZE, readBack + (t * POOL_BENCHMARK_PAGES + pageNum) * PAGE_SIZE);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    for (int pageNum = 0; pageNum < POOL_BENCHMARK_THREADS * POOL_BENCHMARK_PAGES; pageNum++) {
+        fillRecordPage(page, pageNum);
+        TEST_ASSERT_EQUAL_MEMORY(page, readBack + pageNum * PAGE_SIZE, PAGE_SIZE);
+    }
+
+    uint64_t faults = vmStats.pageFaults - faultsBefore;
+    printf("BENCHMARK compressed pool faults (%u KiB budget): %.2f us per fault over %lu faults, %lu from the pool, %lu from disk, %lu written back\n",
+           budget / 1024, elapsedSeconds(&start, &end) * 1e6 / (faults ? faults : 1), (unsigned long)faults,
+           (unsigned long)vmStats.poolLoads, (unsigned long)vmStats.swapReads, (unsigned long)vmStats.poolWriteBacks);
+    for (int t = 0; t < POOL_BENCHMARK_THREADS; t++) {
+        destroyThread(threads[t]);
+    }
+    free(page);
+    free(readBack);
+    restartSystem(&defaults);
+}
+
+void benchmarkCompressedPoolFaultLatency() {
+    runCompressedPoolFaults(0);
+    runCompressedPoolFaults(DEFAULT_COMPRESSED_POOL_BUDGET);
+    runCompressedPoolFaults(COMPRESSED_POOL_SIZE);
+}
@@ -0,0 +1,9 @@
+#ifndef VIRTUALMEMFRAMEWORKC_EVICTIONBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_EVICTIONBENCHMARKS_H
+
+void benchmarkConcurrentEvictionThroughput();
+void benchmarkSparseReservation();
+void benchmarkZeroPageEviction();
+void benchmarkCompressedPoolFaultLatency();
+
+#endif //VIRTUALMEMFRAMEWORKC_EVICTIONBENCHMARKS_H
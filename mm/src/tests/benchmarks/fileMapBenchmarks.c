@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fileMapBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "region.h"
+#include "stats.h"
+#include "system.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Name of the host file the benchmark maps */
+#define FILE_MAP_BENCHMARK_FILE_NAME "mapped.dat"
+/* Pages in the host file */
+#define FILE_MAP_BENCHMARK_FILE_PAGES 1024
+/* Every this many pages of the file is read once it is loaded */
+#define FILE_MAP_BENCHMARK_TOUCH_STRIDE 32
+
+/**
+ * Fills the page with bytes that depend on the page number and the version
+ * of the page.
+ */
+static void fillFilePage(uint8_t *page, int pageNum, int version) {
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        page[i] = (uint8_t)(pageNum * 17 + version * 59 + i);
+    }
+}
+
+/**
+ * Reads every FILE_MAP_BENCHMARK_TOUCH_STRIDE-th page of the file through
+ * the thread's pages at addr, checking each.
+ */
+static void touchFilePages(Thread *thread, int addr) {
+    uint8_t expected[PAGE_SIZE];
+    uint8_t page[PAGE_SIZE];
+    for (int p = 0; p < FILE_MAP_BENCHMARK_FILE_PAGES; p += FILE_MAP_BENCHMARK_TOUCH_STRIDE) {
+        fillFilePage(expected, p, 0);
+        readFromAddr(thread, addr + p * PAGE_SIZE, PAGE_SIZE, page);
+        TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+    }
+}
+
+/**
+ * Checks that the page of the host file holds the given version.
+ */
+static void checkHostFilePage(int pageNum, int version) {
+    uint8_t expected[PAGE_SIZE];
+    uint8_t page[PAGE_SIZE];
+    int fd = open(FILE_MAP_BENCHMARK_FILE_NAME, O_RDONLY);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT(PAGE_SIZE, pread(fd, page, PAGE_SIZE, (off_t)pageNum * PAGE_SIZE));
+    close(fd);
+    fillFilePage(expected, pageNum, version);
+    TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+}
+
+/**
+ * Times loading a file into a thread's heap by copying all of it in with
+ * writeToAddr against mapping it with mapFile, each followed by reading a
+ * sparse set of its pages. Then checks that pages written through the
+ * mapping reach the file, both when they are evicted and at shutdown.
+ */
+void benchmarkMappedFileStartup() {
+    struct timespec start, end;
+    uint8_t page[PAGE_SIZE];
+    FILE *file = fopen(FILE_MAP_BENCHMARK_FILE_NAME, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    for (int p = 0; p < FILE_MAP_BENCHMARK_FILE_PAGES; p++) {
+        fillFilePage(page, p, 0);
+        fwrite(page, sizeof(uint8_t), PAGE_SIZE, file);
+    }
+    fclose(file);
+    int fileSize = FILE_MAP_BENCHMARK_FILE_PAGES * PAGE_SIZE;
+
+    Thread *copier = createThread();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int copyAddr = allocateHeapMem(copier, fileSize);
+    int fd = open(FILE_MAP_BENCHMARK_FILE_NAME, O_RDONLY);
+    TEST_ASSERT_TRUE(fd >= 0);
+    for (int p = 0; p < FILE_MAP_BENCHMARK_FILE_PAGES; p++) {
+        TEST_ASSERT_EQUAL_INT(PAGE_SIZE, pread(fd, page, PAGE_SIZE, (off_t)p * PAGE_SIZE));
+        writeToAddr(copier, copyAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+    close(fd);
+    touchFilePages(copier, copyAddr);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double copySeconds = elapsedSeconds(&start, &end);
+
+    Thread *mapper = createThread();
+    uint64_t readsBefore = vmStats.fileReads;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int mapAddr = mapFile(mapper, FILE_MAP_BENCHMARK_FILE_NAME, 0, fileSize);
+    TEST_ASSERT_TRUE(mapAddr != -1);
+    touchFilePages(mapper, mapAddr);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double mapSeconds = elapsedSeconds(&start, &end);
+
+    printf("BENCHMARK mapped file (%d pages, 1 in %d read): %.2f ms to copy in and read, %.2f ms to map and read, %lu pages read from the file\n",
+           FILE_MAP_BENCHMARK_FILE_PAGES, FILE_MAP_BENCHMARK_TOUCH_STRIDE, copySeconds * 1e3, mapSeconds * 1e3,
+           (unsigned long)(vmStats.fileReads - readsBefore));
+
+    // A page written through the mapping reaches the file once it is
+    // pushed out of memory
+    fillFilePage(page, 1, 1);
+    writeToAddr(mapper, mapAddr + PAGE_SIZE, PAGE_SIZE, page);
+    Thread *hog = createThread();
+    int hogAddr = allocateHeapMem(hog, MAX_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    for (int p = 0; p < MAX_FRAME_TABLE_ENTRIES; p++) {
+        writeToAddr(hog, hogAddr + p * PAGE_SIZE, sizeof(int), &p);
+    }
+    checkHostFilePage(1, 1);
+    readFromAddr(mapper, mapAddr + PAGE_SIZE, PAGE_SIZE, page);
+    checkHostFilePage(1, 1);
+
+    // And a page still in memory reaches it when the system shuts down
+    fillFilePage(page, 2, 1);
+    writeToAddr(mapper, mapAddr + 2 * PAGE_SIZE, PAGE_SIZE, page);
+    destroyThread(copier);
+    destroyThread(mapper);
+    destroyThread(hog);
+    systemShutdown();
+    checkHostFilePage(2, 1);
+    systemInit();
+    remove(FILE_MAP_BENCHMARK_FILE_NAME);
+}
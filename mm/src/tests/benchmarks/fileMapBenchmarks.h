@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FILEMAPBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_FILEMAPBENCHMARKS_H
+
+void benchmarkMappedFileStartup();
+
+#endif //VIRTUALMEMFRAMEWORKC_FILEMAPBENCHMARKS_H
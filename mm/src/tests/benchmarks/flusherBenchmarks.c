@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "flusherBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Pages written by each of the benchmark's threads, together more than fit
+   in memory */
+#define FLUSH_BENCHMARK_PAGES 1280
+#define FLUSH_BENCHMARK_THREADS 2
+/* Times the pages are written over */
+#define FLUSH_BENCHMARK_SWEEPS 2
+
+/**
+ * Fills the page with bytes that depend on the page number and the sweep
+ * and do not compress, so the page goes to the swap device rather than the
+ * pool.
+ */
+static void fillFlushPage(uint8_t *page, int pageNum, int sweep) {
+    uint32_t state = pageNum * 2654435761u + sweep + 1;
+    for (int i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(page + i, &state, sizeof(uint32_t));
+    }
+}
+
+/**
+ * Writes every page of each thread in turn a few times over, so each page
+ * is dirty when it is evicted, then reads every page back once. Reports the time taken per page
+ * written, how many evictions found their frame already clean, and the
+ * calls it took to write and read the pages.
+ */
+static void runDirtyPageSweeps(bool flusherEnabled) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    settings.compressedPoolBudget = 0;
+    settings.prefetchDegree = 0;
+    settings.flusherEnabled = flusherEnabled;
+    restartSystem(&settings);
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    Thread *threads[FLUSH_BENCHMARK_THREADS];
+    int addrs[FLUSH_BENCHMARK_THREADS];
+    for (int t = 0; t < FLUSH_BENCHMARK_THREADS; t++) {
+        threads[t] = createThread();
+        addrs[t] = allocateHeapMem(threads[t], FLUSH_BENCHMARK_PAGES * PAGE_SIZE);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int sweep = 0; sweep < FLUSH_BENCHMARK_SWEEPS; sweep++) {
+        for (int t = 0; t < FLUSH_BENCHMARK_THREADS; t++) {
+            for (int p = 0; p < FLUSH_BENCHMARK_PAGES; p++) {
+                fillFlushPage(page, p, sweep);
+                writeToAddr(threads[t], addrs[t] + p * PAGE_SIZE, PAGE_SIZE, page);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Pages written while staying mapped were written by the flusher, the
+    // rest of the writes were evictions of dirty frames
+    uint64_t dirtyEvictions = vmStats.swapWrites - vmStats.writeBacks;
+    uint64_t cleanEvictions = vmStats.swapWritesSkipped;
+    uint64_t evictions = dirtyEvictions + cleanEvictions;
+    uint64_t writes = vmStats.swapWrites;
+    uint64_t writeCalls = vmStats.swapWriteCalls;
+    for (int t = 0; t < FLUSH_BENCHMARK_THREADS; t++) {
+        for (int p = 0; p < FLUSH_BENCHMARK_PAGES; p++) {
+            readFromAddr(threads[t], addrs[t] + p * PAGE_SIZE, PAGE_SIZE, page);
+            fillFlushPage(expected, p, FLUSH_BENCHMARK_SWEEPS - 1);
+            TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+        }
+    }
+
+    printf("BENCHMARK dirty page flushing (%s, %d pages x %d): %.2f us per page written, %lu of %lu evictions clean, "
+           "%lu pages written in %lu calls, %lu pages read back in %lu calls\n",
+           flusherEnabled ? "flusher" : "no flusher", FLUSH_BENCHMARK_THREADS * FLUSH_BENCHMARK_PAGES, FLUSH_BENCHMARK_SWEEPS,
+           elapsedSeconds(&start, &end) / (FLUSH_BENCHMARK_THREADS * FLUSH_BENCHMARK_PAGES * FLUSH_BENCHMARK_SWEEPS) * 1e6,
+           (unsigned long)cleanEvictions, (unsigned long)evictions, (unsigned long)writes,
+           (unsigned long)writeCalls, (unsigned long)vmStats.swapReads, (unsigned long)vmStats.swapReadCalls);
+    for (int t = 0; t < FLUSH_BENCHMARK_THREADS; t++) {
+        destroyThread(threads[t]);
+    }
+    restartSystem(&defaults);
+}
+
+/**
+ * Compares writing more dirty pages than fit in memory with and without the
+ * flusher cleaning frames ahead of eviction.
+ */
+void benchmarkDirtyPageFlushing() {
+    runDirtyPageSweeps(false);
+    runDirtyPageSweeps(true);
+}
@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FLUSHERBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_FLUSHERBENCHMARKS_H
+
+void benchmarkDirtyPageFlushing();
+
+#endif //VIRTUALMEMFRAMEWORKC_FLUSHERBENCHMARKS_H
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "forkBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+static const int forkBenchmarkPageCounts[] = {64, 256, 768};
+
+/**
+ * Fills the page with bytes that depend on the page number and the thread
+ * that wrote it.
+ */
+static void fillForkPage(uint8_t *page, int pageNum, int writer) {
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        page[i] = (uint8_t)(pageNum * 13 + writer * 101 + i);
+    }
+}
+
+/**
+ * Checks that each of the thread's pages holds what the given writer wrote
+ * to it.
+ */
+static void checkForkPages(Thread *thread, int heapAddr, int numPages, int writer) {
+    uint8_t expected[PAGE_SIZE];
+    uint8_t page[PAGE_SIZE];
+    for (int p = 0; p < numPages; p++) {
+        fillForkPage(expected, p, writer);
+        readFromAddr(thread, heapAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+    }
+}
+
+/**
+ * Copies a thread with the given number of written pages, first eagerly
+ * through readFromAddr and writeToAddr and then with forkThread, and times
+ * both. Then has the child overwrite every page, timing the copy-on-write
+ * faults, and checks that the parent still sees its own data.
+ */
+static void runFork(int numPages) {
+    uint8_t page[PAGE_SIZE];
+    Thread *parent = createThread();
+    int heapAddr = allocateHeapMem(parent, numPages * PAGE_SIZE);
+    for (int p = 0; p < numPages; p++) {
+        fillForkPage(page, p, 0);
+        writeToAddr(parent, heapAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Thread *copy = createThread();
+    allocateHeapMem(copy, numPages * PAGE_SIZE);
+    for (int p = 0; p < numPages; p++) {
+        readFromAddr(parent, heapAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        writeToAddr(copy, heapAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double copySeconds = elapsedSeconds(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Thread *child = forkThread(parent);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double forkSeconds = elapsedSeconds(&start, &end);
+    checkForkPages(child, heapAddr, numPages, 0);
+
+    uint64_t faultsBefore = vmStats.copyOnWriteFaults;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int p = 0; p < numPages; p++) {
+        fillForkPage(page, p, 1);
+        writeToAddr(child, heapAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double writeSeconds = elapsedSeconds(&start, &end);
+    uint64_t numFaults = vmStats.copyOnWriteFaults - faultsBefore;
+    checkForkPages(child, heapAddr, numPages, 1);
+    checkForkPages(parent, heapAddr, numPages, 0);
+
+    printf("BENCHMARK fork (%d pages): %.1f us to fork, %.1f us to copy eagerly, then %.2f us per page written by the child (%lu copy-on-write faults)\n",
+           numPages, forkSeconds * 1e6, copySeconds * 1e6, writeSeconds / numPages * 1e6, (unsigned long)numFaults);
+    destroyThread(parent);
+    destroyThread(copy);
+    destroyThread(child);
+}
+
+/**
+ * Compares forkThread with copying a thread's pages one by one for threads
+ * of several sizes. The fork only walks the page table, so it should stay
+ * far cheaper than the copy as the pages grow.
+ */
+void benchmarkForkCost() {
+    for (size_t i = 0; i < sizeof(forkBenchmarkPageCounts) / sizeof(forkBenchmarkPageCounts[0]); i++) {
+        // Start each size from an empty system
+        restartSystem(NULL);
+        runFork(forkBenchmarkPageCounts[i]);
+    }
+}
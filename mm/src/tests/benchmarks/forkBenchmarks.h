@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FORKBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_FORKBENCHMARKS_H
+
+void benchmarkForkCost();
+
+#endif //VIRTUALMEMFRAMEWORKC_FORKBENCHMARKS_H
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include "frameScanBenchmarks.h"
+#include "frame.h"
+#include "frameScan.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+/* Searches timed for each layout */
+#define SCAN_BENCHMARK_SEARCHES 200000
+/* Zero checks timed for each kind of scan */
+#define ZERO_CHECK_BENCHMARK_CHECKS 200000
+
+extern const int PAGE_SIZE;
+
+/**
+ * Defines a frame table entry as it was laid out before the frame table was
+ * split into arrays, with the accessed bit and owner inside each entry.
+ */
+typedef struct LegacyFTEntry {
+    pthread_mutex_t lock;
+    uint8_t accessed;
+    uint8_t dirty;
+    uint8_t ownerThreadId;
+    uint16_t virtualPageNum;
+    uint16_t frameNum;
+    uint32_t lastUse;
+    uint8_t *physAddr;
+    struct LegacyFTEntry *next;
+} LegacyFTEntry;
+
+static LegacyFTEntry legacyEntries[NUM_FRAME_TABLE_ENTRIES];
+static uint64_t accessedBitmap[FRAME_BITMAP_WORDS];
+static uint64_t ownedBitmap[FRAME_BITMAP_WORDS];
+
+/**
+ * Returns the frame that is the only eviction candidate in the given search,
+ * spread over the whole table.
+ */
+static int candidateFrame(int search) {
+    return (search * 7919) % NUM_FRAME_TABLE_ENTRIES;
+}
+
+/**
+ * Times searches for the one owned frame that was not accessed, walking the
+ * entries of the old layout one at a time.
+ */
+static void runLegacyScan() {
+    for (int x = 0; x < NUM_FRAME_TABLE_ENTRIES; x++) {
+        legacyEntries[x].ownerThreadId = 1;
+        legacyEntries[x].accessed = 1;
+    }
+    uint32_t checksum = 0, expected = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int search = 0; search < SCAN_BENCHMARK_SEARCHES; search++) {
+        int candidate = candidateFrame(search);
+        legacyEntries[candidate].accessed = 0;
+        for (int x = 0; x < NUM_FRAME_TABLE_ENTRIES; x++) {
+            if (legacyEntries[x].ownerThreadId != 0 && legacyEntries[x].accessed == 0) {
+                checksum += x;
+                break;
+            }
+        }
+        legacyEntries[candidate].accessed = 1;
+        expected += candidate;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    TEST_ASSERT_EQUAL_UINT32(expected, checksum);
+    printf("BENCHMARK victim scan (entry per frame): %.1f ns per search\n",
+           elapsedSeconds(&start, &end) / SCAN_BENCHMARK_SEARCHES * 1e9);
+}
+
+/**
+ * Times the same searches over the accessed and owned bitmaps, one group of
+ * FRAME_SCAN_WIDTH frames at a time.
+ */
+static void runBitmapScan(const char *name) {
+    for (int x = 0; x < FRAME_BITMAP_WORDS; x++) {
+        ownedBitmap[x] = ~0ULL;
+        accessedBitmap[x] = ~0ULL;
+    }
+    uint32_t checksum = 0, expected = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int search = 0; search < SCAN_BENCHMARK_SEARCHES; search++) {
+        int candidate = candidateFrame(search);
+        accessedBitmap[candidate / 64] &= ~(1ULL << (candidate % 64));
+        for (int group = 0; group < FRAME_BITMAP_WORDS; group += FRAME_SCAN_WORDS) {
+            uint64_t candidates[FRAME_SCAN_WORDS];
+            if (!findEvictionCandidates(&accessedBitmap[group], &ownedBitmap[group], candidates)) {
+                continue;
+            }
+            int word = 0;
+            while (candidates[word] == 0) {
+                word++;
+            }
+            checksum += (group + word) * 64 + __builtin_ctzll(candidates[word]);
+            break;
+        }
+        accessedBitmap[candidate / 64] |= 1ULL << (candidate % 64);
+        expected += candidate;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    TEST_ASSERT_EQUAL_UINT32(expected, checksum);
+    printf("BENCHMARK victim scan (bitmap, %s): %.1f ns per search\n",
+           name, elapsedSeconds(&start, &end) / SCAN_BENCHMARK_SEARCHES * 1e9);
+}
+
+/**
+ * Compares the cost of finding the clock's next victim in the old entry per
+ * frame layout with the bitmap scan, using each kind of scan the processor
+ * supports. Leaves the widest scan selected.
+ */
+void benchmarkVictimScanCost() {
+    const char *names[] = {[FRAME_SCAN_SCALAR] = "scalar", [FRAME_SCAN_SSE2] = "SSE2", [FRAME_SCAN_AVX2] = "AVX2"};
+    runLegacyScan();
+    for (int type = FRAME_SCAN_SCALAR; type < NUM_FRAME_SCAN_TYPES; type++) {
+        if (!frameScanSupported(type)) {
+            printf("BENCHMARK victim scan (bitmap, %s): not supported\n", names[type]);
+            continue;
+        }
+        frameScanType = type;
+        runBitmapScan(names[type]);
+    }
+    initializeFrameScan();
+}
+
+/**
+ * Times checking pages that are zero, which means looking at every byte,
+ * and pages with one non-zero byte anywhere, with each kind of scan the
+ * processor supports. Leaves the widest scan selected.
+ */
+void benchmarkZeroPageCheck() {
+    const char *names[] = {[FRAME_SCAN_SCALAR] = "scalar", [FRAME_SCAN_SSE2] = "SSE2", [FRAME_SCAN_AVX2] = "AVX2"};
+    static uint8_t page[4096] __attribute__((aligned(64)));
+    for (int type = FRAME_SCAN_SCALAR; type < NUM_FRAME_SCAN_TYPES; type++) {
+        if (!frameScanSupported(type)) {
+            printf("BENCHMARK zero page check (%s): not supported\n", names[type]);
+            continue;
+        }
+        frameScanType = type;
+        int numZero = 0;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int check = 0; check < ZERO_CHECK_BENCHMARK_CHECKS; check++) {
+            // Vary the page so the checks cannot be hoisted out of the loop
+            page[check % PAGE_SIZE] = check & 1;
+            numZero += isFrameZero(page);
+            page[check % PAGE_SIZE] = 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        TEST_ASSERT_EQUAL(ZERO_CHECK_BENCHMARK_CHECKS / 2, numZero);
+        printf("BENCHMARK zero page check (%s): %.1f ns per page, half of them zero\n",
+               names[type], elapsedSeconds(&start, &end) / ZERO_CHECK_BENCHMARK_CHECKS * 1e9);
+    }
+    initializeFrameScan();
+}
@@ -0,0 +1,7 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FRAMESCANBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_FRAMESCANBENCHMARKS_H
+
+void benchmarkVictimScanCost();
+void benchmarkZeroPageCheck();
+
+#endif //VIRTUALMEMFRAMEWORKC_FRAMESCANBENCHMARKS_H
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include "freeListBenchmarks.h"
+#include "frame.h"
+#include "memory.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+/* Frames each thread takes and returns */
+#define POOL_BENCHMARK_OPERATIONS 100000
+/* Size of each read and write in the copy benchmark (64 KiB) */
+#define COPY_BENCHMARK_SIZE (64 * 1024)
+/* Number of times the copy benchmark writes and reads its buffer */
+#define COPY_BENCHMARK_ROUNDS 200
+
+static const int poolBenchmarkThreadCounts[] = {1, 4, 16, 32};
+
+/**
+ * Body of each benchmark thread. Repeatedly takes a frame from the pool of
+ * free frames and returns it.
+ */
+static void* takeAndReturnFrames(void *arg) {
+    (void)arg;
+    for (int x = 0; x < POOL_BENCHMARK_OPERATIONS; x++) {
+        FTEntry *entry = takeFrameFromFreeList();
+        TEST_ASSERT_NOT_NULL(entry);
+        returnFrameToFreeList(entry);
+    }
+    return NULL;
+}
+
+/**
+ * Runs the take and return loop on the given number of threads at once and
+ * reports the combined throughput.
+ */
+static void runPoolContention(const char *name, int numThreads) {
+    pthread_t threads[32];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int x = 0; x < numThreads; x++) {
+        pthread_create(&threads[x], NULL, takeAndReturnFrames, NULL);
+    }
+    for (int x = 0; x < numThreads; x++) {
+        pthread_join(threads[x], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsedSeconds(&start, &end);
+    printf("BENCHMARK free frame pool (%s, %d threads): %.2f million take/return pairs per second\n",
+           name, numThreads, numThreads * (double)POOL_BENCHMARK_OPERATIONS / seconds / 1e6);
+    TEST_ASSERT_EQUAL(NUM_FRAME_TABLE_ENTRIES, countFreeFrames());
+}
+
+/**
+ * Compares the mutex guarded free list, the lock free stack and the buddy
+ * allocator under increasing contention. Leaves the default pool selected.
+ */
+void benchmarkFreeFramePoolContention() {
+    const char *names[] = {[FREE_POOL_LIST] = "mutex list", [FREE_POOL_STACK] = "lock free stack", [FREE_POOL_BUDDY] = "buddy allocator"};
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    for (int type = FREE_POOL_LIST; type <= FREE_POOL_BUDDY; type++) {
+        settings.freeFramePoolType = type;
+        restartSystem(&settings);
+        for (size_t x = 0; x < sizeof(poolBenchmarkThreadCounts) / sizeof(int); x++) {
+            runPoolContention(names[type], poolBenchmarkThreadCounts[x]);
+        }
+    }
+    restartSystem(&defaults);
+}
+
+/**
+ * Allocates a 64 KiB heap buffer and times writing it and reading it back
+ * whole. Frames handed out one at a time are copied page by page, while a
+ * contiguous run from the buddy allocator is copied in one go. Leaves the
+ * default pool selected.
+ */
+void benchmarkLargeCopyThroughput() {
+    const char *names[] = {[FREE_POOL_LIST] = "mutex list", [FREE_POOL_STACK] = "lock free stack", [FREE_POOL_BUDDY] = "buddy allocator"};
+    static uint8_t data[COPY_BENCHMARK_SIZE];
+    static uint8_t readBack[COPY_BENCHMARK_SIZE];
+    for (int x = 0; x < COPY_BENCHMARK_SIZE; x++) {
+        data[x] = x * 31;
+    }
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    for (int type = FREE_POOL_LIST; type <= FREE_POOL_BUDDY; type++) {
+        settings.freeFramePoolType = type;
+        restartSystem(&settings);
+        Thread *thread = createThread();
+        int addr = allocateHeapMem(thread, COPY_BENCHMARK_SIZE);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int round = 0; round < COPY_BENCHMARK_ROUNDS; round++) {
+            writeToAddr(thread, addr, COPY_BENCHMARK_SIZE, data);
+            readFromAddr(thread, addr, COPY_BENCHMARK_SIZE, readBack);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        TEST_ASSERT_EQUAL_MEMORY(data, readBack, COPY_BENCHMARK_SIZE);
+        double seconds = elapsedSeconds(&start, &end);
+        printf("BENCHMARK 64 KiB copies (%s): %.1f us per write and read\n",
+               names[type], seconds / COPY_BENCHMARK_ROUNDS * 1e6);
+        destroyThread(thread);
+    }
+    restartSystem(&defaults);
+}
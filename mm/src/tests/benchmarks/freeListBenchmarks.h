@@ -0,0 +1,7 @@
+#ifndef VIRTUALMEMFRAMEWORKC_FREELISTBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_FREELISTBENCHMARKS_H
+
+void benchmarkFreeFramePoolContention();
+void benchmarkLargeCopyThroughput();
+
+#endif //VIRTUALMEMFRAMEWORKC_FREELISTBENCHMARKS_H
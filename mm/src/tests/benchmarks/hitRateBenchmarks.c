@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "hitRateBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "stats.h"
+#include "policy.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+extern const int USER_BASE_ADDR;
+extern const int STACK_END_ADDR;
+
+/* Two threads with a full heap each give 2560 pages for 1792 frames */
+#define BENCHMARK_THREADS 2
+#define BENCHMARK_PAGES_PER_THREAD 1280
+#define BENCHMARK_PAGES (BENCHMARK_THREADS * BENCHMARK_PAGES_PER_THREAD)
+#define BENCHMARK_ACCESSES 40000
+/* Size of the hot loop in the looping benchmark (fits in memory) */
+#define BENCHMARK_HOT_PAGES 512
+/* Threads in the concurrent benchmark, each with its own heap */
+#define CONCURRENT_BENCHMARK_THREADS 8
+#define CONCURRENT_BENCHMARK_PAGES_PER_THREAD 320
+/* Pages each thread keeps returning to, together they fit in memory */
+#define CONCURRENT_BENCHMARK_HOT_PAGES 160
+#define CONCURRENT_BENCHMARK_ACCESSES_PER_THREAD 5000
+
+/**
+ * Defines one thread of the concurrent benchmark.
+ */
+typedef struct ConcurrentBenchmarkThread {
+    Thread *thread;
+    int heapAddr;
+} ConcurrentBenchmarkThread;
+
+typedef struct BenchmarkSpace {
+    Thread *threads[BENCHMARK_THREADS];
+    int heapAddrs[BENCHMARK_THREADS];
+} BenchmarkSpace;
+
+/* Hot-set faults after the sweep in the scan benchmark, by policy */
+static uint64_t scanFaults[NUM_REPLACEMENT_POLICIES];
+
+/**
+ * Writes to each of the pages in turn so that they are given frames, since
+ * pages that were never written are read from the zero frame without
+ * faulting.
+ */
+static void populatePages(Thread *thread, int addr, int numPages) {
+    for (int page = 0; page < numPages; page++) {
+        writeToAddr(thread, addr + page * PAGE_SIZE, sizeof(int), &page);
+    }
+}
+
+static void createBenchmarkSpace(BenchmarkSpace *space) {
+    for (int x = 0; x < BENCHMARK_THREADS; x++) {
+        space->threads[x] = createThread();
+        space->heapAddrs[x] = allocateHeapMem(space->threads[x], BENCHMARK_PAGES_PER_THREAD * PAGE_SIZE);
+        populatePages(space->threads[x], space->heapAddrs[x], BENCHMARK_PAGES_PER_THREAD);
+    }
+}
+
+static void destroyBenchmarkSpace(BenchmarkSpace *space) {
+    for (int x = 0; x < BENCHMARK_THREADS; x++) {
+        destroyThread(space->threads[x]);
+    }
+}
+
+static void touchPage(BenchmarkSpace *space, int page) {
+    int thread = page / BENCHMARK_PAGES_PER_THREAD;
+    int addr = space->heapAddrs[thread] + (page % BENCHMARK_PAGES_PER_THREAD) * PAGE_SIZE;
+    int value;
+    readFromAddr(space->threads[thread], addr, sizeof(int), &value);
+}
+
+static void reportHitRate(const char *name, int accesses, uint64_t faults) {
+    printf("BENCHMARK %s (%s): %d accesses, %lu faults, hit rate %.2f%%\n", name, replacementPolicy->name,
+           accesses, (unsigned long)faults, 100.0 * (accesses - (double)faults) / accesses);
+}
+
+/**
+ * Runs the benchmark once under every replacement policy with the given
+ * settings, restarting the system in between. Leaves the system running with
+ * the settings it had before.
+ */
+static void runUnderEachPolicy(void (*benchmark)(), BenchmarkSettings settings) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    for (int type = 0; type < NUM_REPLACEMENT_POLICIES; type++) {
+        settings.replacementPolicyType = type;
+        restartSystem(&settings);
+        benchmark();
+    }
+    restartSystem(&defaults);
+}
+
+/**
+ * Loops over a hot set that fits in memory while a sequential scan sweeps the
+ * rest of the pages, alternating one access of each.
+ */
+static void runLoopingHitRate() {
+    BenchmarkSpace space;
+    createBenchmarkSpace(&space);
+
+    uint64_t faultsBefore = vmStats.pageFaults;
+    int scanPage = BENCHMARK_HOT_PAGES;
+    for (int x = 0; x < BENCHMARK_ACCESSES / 2; x++) {
+        touchPage(&space, x % BENCHMARK_HOT_PAGES);
+        touchPage(&space, scanPage);
+        scanPage = scanPage + 1 == BENCHMARK_PAGES ? BENCHMARK_HOT_PAGES : scanPage + 1;
+    }
+    reportHitRate("looping", BENCHMARK_ACCESSES, vmStats.pageFaults - faultsBefore);
+
+    destroyBenchmarkSpace(&space);
+}
+
+/**
+ * Warms up a hot set that fits in memory, sweeps every page once, then
+ * measures how much of the hot set survived the sweep.
+ */
+static void runScanHitRate() {
+    BenchmarkSpace space;
+    createBenchmarkSpace(&space);
+
+    for (int pass = 0; pass < 4; pass++) {
+        for (int page = 0; page < BENCHMARK_HOT_PAGES; page++) {
+            touchPage(&space, page);
+        }
+    }
+    for (int page = BENCHMARK_HOT_PAGES; page < BENCHMARK_PAGES; page++) {
+        touchPage(&space, page);
+    }
+    uint64_t faultsBefore = vmStats.pageFaults;
+    for (int page = 0; page < BENCHMARK_HOT_PAGES; page++) {
+        touchPage(&space, page);
+    }
+    scanFaults[replacementPolicyType] = vmStats.pageFaults - faultsBefore;
+    reportHitRate("scan", BENCHMARK_HOT_PAGES, scanFaults[replacementPolicyType]);
+
+    destroyBenchmarkSpace(&space);
+}
+
+/**
+ * Body of each concurrent benchmark thread. Cycles through its hot set and
+ * sweeps through the rest of its heap on every tenth access.
+ */
+static void* runConcurrentBenchmarkThread(void *arg) {
+    ConcurrentBenchmarkThread *benchmarkThread = arg;
+    int hotPage = 0;
+    int coldPage = CONCURRENT_BENCHMARK_HOT_PAGES;
+    for (int x = 0; x < CONCURRENT_BENCHMARK_ACCESSES_PER_THREAD; x++) {
+        int page;
+        if (x % 10 == 9) {
+            page = coldPage;
+            coldPage = coldPage + 1 == CONCURRENT_BENCHMARK_PAGES_PER_THREAD ? CONCURRENT_BENCHMARK_HOT_PAGES : coldPage + 1;
+        } else {
+            page = hotPage;
+            hotPage = (hotPage + 1) % CONCURRENT_BENCHMARK_HOT_PAGES;
+        }
+        int value;
+        readFromAddr(benchmarkThread->thread, benchmarkThread->heapAddr + page * PAGE_SIZE, sizeof(int), &value);
+    }
+    return NULL;
+}
+
+/**
+ * Runs several threads at once whose hot sets together fit in memory while
+ * their sweeps do not.
+ */
+static void runConcurrentHitRate() {
+    ConcurrentBenchmarkThread threads[CONCURRENT_BENCHMARK_THREADS];
+    for (int x = 0; x < CONCURRENT_BENCHMARK_THREADS; x++) {
+        threads[x].thread = createThread();
+        threads[x].heapAddr = allocateHeapMem(threads[x].thread, CONCURRENT_BENCHMARK_PAGES_PER_THREAD * PAGE_SIZE);
+        populatePages(threads[x].thread, threads[x].heapAddr, CONCURRENT_BENCHMARK_PAGES_PER_THREAD);
+    }
+
+    uint64_t faultsBefore = vmStats.pageFaults;
+    for (int x = 0; x < CONCURRENT_BENCHMARK_THREADS; x++) {
+        pthread_create(&threads[x].thread->thread, NULL, runConcurrentBenchmarkThread, &threads[x]);
+    }
+    for (int x = 0; x < CONCURRENT_BENCHMARK_THREADS; x++) {
+        pthread_join(threads[x].thread->thread, NULL);
+        threads[x].thread->thread = 0;
+    }
+    reportHitRate("concurrent", CONCURRENT_BENCHMARK_THREADS * CONCURRENT_BENCHMARK_ACCESSES_PER_THREAD,
+                  vmStats.pageFaults - faultsBefore);
+
+    for (int x = 0; x < CONCURRENT_BENCHMARK_THREADS; x++) {
+        destroyThread(threads[x].thread);
+    }
+}
+
+/**
+ * Accesses pages with Zipf distributed popularity (exponent 1). Ranks are
+ * scattered over the pages so popularity is not tied to page order.
+ */
+static void runZipfianHitRate() {
+    BenchmarkSpace space;
+    createBenchmarkSpace(&space);
+
+    double *cdf = malloc(sizeof(double) * BENCHMARK_PAGES);
+    double total = 0;
+    for (int rank = 0; rank < BENCHMARK_PAGES; rank++) {
+        total += 1.0 / (rank + 1);
+        cdf[rank] = total;
+    }
+    srandom(5600);
+
+    uint64_t faultsBefore = vmStats.pageFaults;
+    for (int x = 0; x < BENCHMARK_ACCESSES; x++) {
+        double target = total * random() / RAND_MAX;
+        int low = 0;
+        int high = BENCHMARK_PAGES - 1;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (cdf[mid] < target) low = mid + 1;
+            else high = mid;
+        }
+        touchPage(&space, (int)((low * 7919L) % BENCHMARK_PAGES));
+    }
+    reportHitRate("zipfian", BENCHMARK_ACCESSES, vmStats.pageFaults - faultsBefore);
+
+    free(cdf);
+    destroyBenchmarkSpace(&space);
+}
+
+void benchmarkLoopingHitRate() {
+    runUnderEachPolicy(runLoopingHitRate, currentBenchmarkSettings());
+}
+
+void benchmarkScanHitRate() {
+    // Readahead and prefetching bring pages of the sweep back in ahead of
+    // the faults, and the reclaimer evicts alongside them. Without all three
+    // the outcome depends on the policy alone and not on timing
+    BenchmarkSettings settings = currentBenchmarkSettings();
+    settings.readaheadMaxWindow = 0;
+    settings.prefetchDegree = 0;
+    settings.reclaimLowWatermark = 0;
+    runUnderEachPolicy(runScanHitRate, settings);
+    // The sweep is what ARC is built to resist, so it must keep more of the
+    // hot set than the clock does
+    TEST_ASSERT_TRUE(scanFaults[POLICY_ARC] < scanFaults[POLICY_CLOCK]);
+}
+
+void benchmarkConcurrentHitRate() {
+    runUnderEachPolicy(runConcurrentHitRate, currentBenchmarkSettings());
+}
+
+void benchmarkZipfianHitRate() {
+    runUnderEachPolicy(runZipfianHitRate, currentBenchmarkSettings());
+}
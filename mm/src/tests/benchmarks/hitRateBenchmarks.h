@@ -0,0 +1,9 @@
+#ifndef VIRTUALMEMFRAMEWORKC_HITRATEBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_HITRATEBENCHMARKS_H
+
+void benchmarkLoopingHitRate();
+void benchmarkScanHitRate();
+void benchmarkConcurrentHitRate();
+void benchmarkZipfianHitRate();
+
+#endif //VIRTUALMEMFRAMEWORKC_HITRATEBENCHMARKS_H
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mergeBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "merge.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Threads writing the same pages */
+#define MERGE_BENCHMARK_THREADS 4
+/* Pages written by each thread, all of them fit in memory together */
+#define MERGE_BENCHMARK_PAGES 256
+/* Number of different pages each thread writes */
+#define MERGE_BENCHMARK_DISTINCT_PAGES 64
+
+/**
+ * Fills the page with bytes that only depend on which of the distinct
+ * pages it is.
+ */
+static void fillDistinctPage(uint8_t *page, int distinctPage) {
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        page[i] = (uint8_t)(distinctPage * 131 + i * 7);
+    }
+}
+
+/**
+ * Times writing a word to every page of every thread.
+ */
+static double timePageWrites(Thread **threads, int *heapAddrs) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int x = 0; x < MERGE_BENCHMARK_THREADS; x++) {
+        for (int page = 0; page < MERGE_BENCHMARK_PAGES; page++) {
+            writeToAddr(threads[x], heapAddrs[x] + page * PAGE_SIZE, sizeof(int), &page);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsedSeconds(&start, &end);
+}
+
+/**
+ * Has several threads write the same few pages over and over, lets the
+ * merger scan the frame table until they are merged, and reports the frames
+ * saved and the cost of a scan. Then writes to every page, timing the
+ * copy-on-write faults against the same writes to frames of their own. Runs
+ * the scans directly with the background merger stopped, so they can be
+ * timed.
+ */
+void benchmarkSamePageMerging() {
+    Thread *threads[MERGE_BENCHMARK_THREADS];
+    int heapAddrs[MERGE_BENCHMARK_THREADS];
+    uint8_t page[PAGE_SIZE];
+    stopMerger();
+    for (int x = 0; x < MERGE_BENCHMARK_THREADS; x++) {
+        threads[x] = createThread();
+        heapAddrs[x] = allocateHeapMem(threads[x], MERGE_BENCHMARK_PAGES * PAGE_SIZE);
+        for (int p = 0; p < MERGE_BENCHMARK_PAGES; p++) {
+            fillDistinctPage(page, p % MERGE_BENCHMARK_DISTINCT_PAGES);
+            writeToAddr(threads[x], heapAddrs[x] + p * PAGE_SIZE, PAGE_SIZE, page);
+        }
+    }
+
+    // The first pass only checksums the frames, the second finds them
+    // unchanged and merges them. The scans start wherever the last one
+    // stopped, so a third makes sure two whole passes were made
+    uint16_t freeBefore = countFreeFrames();
+    int numMerged = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int pass = 0; pass < 3; pass++) {
+        numMerged += scanFramesForMerging(NUM_FRAME_TABLE_ENTRIES);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint16_t freeAfter = countFreeFrames();
+    printf("BENCHMARK same page merging: %d pages in %d frames merged into %d frames, %d frames freed\n",
+           MERGE_BENCHMARK_THREADS * MERGE_BENCHMARK_PAGES, MERGE_BENCHMARK_THREADS * MERGE_BENCHMARK_PAGES,
+           MERGE_BENCHMARK_THREADS * MERGE_BENCHMARK_PAGES - numMerged, freeAfter - freeBefore);
+    printf("BENCHMARK same page merging: %.2f us per frame scanned\n",
+           elapsedSeconds(&start, &end) / (3 * NUM_FRAME_TABLE_ENTRIES) * 1e6);
+    TEST_ASSERT_EQUAL_INT(MERGE_BENCHMARK_THREADS * MERGE_BENCHMARK_PAGES - MERGE_BENCHMARK_DISTINCT_PAGES, numMerged);
+
+    // Every page is write protected now, so the first writes copy their frames
+    uint64_t faultsBefore = vmStats.copyOnWriteFaults;
+    double copySeconds = timePageWrites(threads, heapAddrs);
+    uint64_t numFaults = vmStats.copyOnWriteFaults - faultsBefore;
+    double privateSeconds = timePageWrites(threads, heapAddrs);
+    printf("BENCHMARK same page merging: %.2f us per write breaking sharing (%lu copy-on-write faults), %.2f us per write to a frame of its own\n",
+           copySeconds / (MERGE_BENCHMARK_THREADS * MERGE_BENCHMARK_PAGES) * 1e6, (unsigned long)numFaults,
+           privateSeconds / (MERGE_BENCHMARK_THREADS * MERGE_BENCHMARK_PAGES) * 1e6);
+
+    // Every page kept its contents apart from the word just written
+    for (int x = 0; x < MERGE_BENCHMARK_THREADS; x++) {
+        for (int p = 0; p < MERGE_BENCHMARK_PAGES; p++) {
+            uint8_t expected[PAGE_SIZE];
+            fillDistinctPage(expected, p % MERGE_BENCHMARK_DISTINCT_PAGES);
+            memcpy(expected, &p, sizeof(int));
+            readFromAddr(threads[x], heapAddrs[x] + p * PAGE_SIZE, PAGE_SIZE, page);
+            TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+        }
+    }
+    for (int x = 0; x < MERGE_BENCHMARK_THREADS; x++) {
+        destroyThread(threads[x]);
+    }
+}
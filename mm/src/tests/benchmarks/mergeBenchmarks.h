@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_MERGEBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_MERGEBENCHMARKS_H
+
+void benchmarkSamePageMerging();
+
+#endif //VIRTUALMEMFRAMEWORKC_MERGEBENCHMARKS_H
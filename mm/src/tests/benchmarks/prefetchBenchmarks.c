@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "prefetchBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "prefetch.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Pages written, swapped out and then read back */
+#define PREFETCH_BENCHMARK_PAGES 1020
+/* Pages between the pages read one after another by the strided walk */
+#define PREFETCH_BENCHMARK_STRIDE 3
+/* Arrays walked side by side by the interleaved walk */
+#define PREFETCH_BENCHMARK_ARRAYS 3
+
+/**
+ * Fills the page with bytes that depend on the page number and do not
+ * compress, so the page goes to the swap device rather than the pool.
+ */
+static void fillPrefetchPage(uint8_t *page, int pageNum) {
+    uint32_t state = pageNum * 2654435761u + 1;
+    for (int i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(page + i, &state, sizeof(uint32_t));
+    }
+}
+
+/**
+ * Returns the percentage part is of whole, or 0 if whole is 0.
+ */
+static double percentOf(uint64_t part, uint64_t whole) {
+    return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+/**
+ * Writes the pages, pushes them all out to swap, and reads every page back
+ * once with the prefetcher predicting the given number of pages ahead. The
+ * strided walk reads every third page, three times over. The interleaved
+ * walk reads the pages as three arrays side by side, the first page of
+ * each, then the second of each and so on, which has no constant stride.
+ * Reports the time taken per page and the precision and coverage of each
+ * of the prefetcher's patterns.
+ */
+static void runPrefetchWalk(uint8_t degree, bool strided) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    settings.compressedPoolBudget = 0;
+    settings.prefetchDegree = degree;
+    restartSystem(&settings);
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    Thread *reader = createThread();
+    Thread *hog = createThread();
+    int addr = allocateHeapMem(reader, PREFETCH_BENCHMARK_PAGES * PAGE_SIZE);
+    for (int p = 0; p < PREFETCH_BENCHMARK_PAGES; p++) {
+        fillPrefetchPage(page, p);
+        writeToAddr(reader, addr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+    // Fill every frame with the hog's pages so the reader's are swapped out
+    int hogAddr = allocateHeapMem(hog, MAX_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    for (int p = 0; p < MAX_FRAME_TABLE_ENTRIES; p++) {
+        writeToAddr(hog, hogAddr + p * PAGE_SIZE, sizeof(int), &p);
+    }
+
+    int order[PREFETCH_BENCHMARK_PAGES];
+    int walkPages = PREFETCH_BENCHMARK_PAGES / PREFETCH_BENCHMARK_STRIDE;
+    int arrayPages = PREFETCH_BENCHMARK_PAGES / PREFETCH_BENCHMARK_ARRAYS;
+    for (int i = 0; i < PREFETCH_BENCHMARK_PAGES; i++) {
+        if (strided) {
+            // Each walk starts one page after the last one did
+            order[i] = i / walkPages + i % walkPages * PREFETCH_BENCHMARK_STRIDE;
+        } else {
+            order[i] = i % PREFETCH_BENCHMARK_ARRAYS * arrayPages + i / PREFETCH_BENCHMARK_ARRAYS;
+        }
+    }
+
+    uint64_t faultsBefore = vmStats.pageFaults;
+    uint64_t readsBefore = vmStats.swapReads;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < PREFETCH_BENCHMARK_PAGES; i++) {
+        readFromAddr(reader, addr + order[i] * PAGE_SIZE, PAGE_SIZE, page);
+        fillPrefetchPage(expected, order[i]);
+        TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Every hit is a fault the reader would otherwise have taken
+    uint64_t faults = vmStats.prefetchFaults + vmStats.strideHits + vmStats.correlationHits;
+    printf("BENCHMARK prefetch (%s, %d pages, %d ahead): %.2f us per page, %lu faults, %lu pages read; "
+           "stride: %lu prefetched, %.0f%% precision, %.0f%% coverage; sequence: %lu prefetched, %.0f%% precision, %.0f%% coverage\n",
+           strided ? "strided" : "interleaved", PREFETCH_BENCHMARK_PAGES, degree,
+           elapsedSeconds(&start, &end) / PREFETCH_BENCHMARK_PAGES * 1e6,
+           (unsigned long)(vmStats.pageFaults - faultsBefore), (unsigned long)(vmStats.swapReads - readsBefore),
+           (unsigned long)vmStats.stridePrefetches, percentOf(vmStats.strideHits, vmStats.stridePrefetches),
+           percentOf(vmStats.strideHits, faults), (unsigned long)vmStats.correlationPrefetches,
+           percentOf(vmStats.correlationHits, vmStats.correlationPrefetches), percentOf(vmStats.correlationHits, faults));
+    destroyThread(reader);
+    destroyThread(hog);
+    restartSystem(&defaults);
+}
+
+/**
+ * Compares a strided walk and an interleaved walk over swapped out pages
+ * with and without the prefetcher.
+ */
+void benchmarkPatternPrefetch() {
+    runPrefetchWalk(0, true);
+    runPrefetchWalk(DEFAULT_PREFETCH_DEGREE, true);
+    runPrefetchWalk(0, false);
+    runPrefetchWalk(DEFAULT_PREFETCH_DEGREE, false);
+}
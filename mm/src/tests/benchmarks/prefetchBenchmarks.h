@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_PREFETCHBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_PREFETCHBENCHMARKS_H
+
+void benchmarkPatternPrefetch();
+
+#endif //VIRTUALMEMFRAMEWORKC_PREFETCHBENCHMARKS_H
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "readaheadBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "readahead.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Pages written, swapped out and then read back */
+#define READAHEAD_BENCHMARK_PAGES 1024
+
+/**
+ * Fills the page with bytes that depend on the page number and do not
+ * compress, so the page goes to the swap device rather than the pool.
+ */
+static void fillScanPage(uint8_t *page, int pageNum) {
+    uint32_t state = pageNum * 2654435761u + 1;
+    for (int i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(page + i, &state, sizeof(uint32_t));
+    }
+}
+
+/**
+ * Writes the pages, pushes them all out to swap, and reads them back with
+ * the given readahead window, in order or in a shuffled order. Reports the
+ * time taken per page and how the pages read ahead were used.
+ */
+static void runReadaheadScan(uint8_t maxWindow, bool sequential) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    settings.compressedPoolBudget = 0;
+    settings.readaheadMaxWindow = maxWindow;
+    // The prefetcher would follow a sequential scan as well
+    settings.prefetchDegree = 0;
+    restartSystem(&settings);
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    Thread *reader = createThread();
+    Thread *hog = createThread();
+    int addr = allocateHeapMem(reader, READAHEAD_BENCHMARK_PAGES * PAGE_SIZE);
+    for (int p = 0; p < READAHEAD_BENCHMARK_PAGES; p++) {
+        fillScanPage(page, p);
+        writeToAddr(reader, addr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+    // Fill every frame with the hog's pages so the reader's are swapped out
+    int hogAddr = allocateHeapMem(hog, MAX_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    for (int p = 0; p < MAX_FRAME_TABLE_ENTRIES; p++) {
+        writeToAddr(hog, hogAddr + p * PAGE_SIZE, sizeof(int), &p);
+    }
+
+    int order[READAHEAD_BENCHMARK_PAGES];
+    for (int p = 0; p < READAHEAD_BENCHMARK_PAGES; p++) {
+        order[p] = p;
+    }
+    srand(7);
+    for (int p = READAHEAD_BENCHMARK_PAGES - 1; !sequential && p > 0; p--) {
+        int other = rand() % (p + 1);
+        int swapped = order[p];
+        order[p] = order[other];
+        order[other] = swapped;
+    }
+
+    uint64_t faultsBefore = vmStats.pageFaults;
+    uint64_t readsBefore = vmStats.swapReads;
+    uint64_t callsBefore = vmStats.swapReadCalls;
+    uint64_t readaheadBefore = vmStats.readaheadPages;
+    uint64_t hitsBefore = vmStats.readaheadHits;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < READAHEAD_BENCHMARK_PAGES; i++) {
+        readFromAddr(reader, addr + order[i] * PAGE_SIZE, PAGE_SIZE, page);
+        fillScanPage(expected, order[i]);
+        TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("BENCHMARK readahead (%s, %d pages, window up to %d): %.2f us per page, %lu faults, %lu pages read in %lu calls, %lu read ahead, %lu hits, %lu wasted\n",
+           sequential ? "sequential" : "shuffled", READAHEAD_BENCHMARK_PAGES, maxWindow,
+           elapsedSeconds(&start, &end) / READAHEAD_BENCHMARK_PAGES * 1e6,
+           (unsigned long)(vmStats.pageFaults - faultsBefore), (unsigned long)(vmStats.swapReads - readsBefore),
+           (unsigned long)(vmStats.swapReadCalls - callsBefore), (unsigned long)(vmStats.readaheadPages - readaheadBefore),
+           (unsigned long)(vmStats.readaheadHits - hitsBefore), (unsigned long)vmStats.readaheadWasted);
+    destroyThread(reader);
+    destroyThread(hog);
+    restartSystem(&defaults);
+}
+
+/**
+ * Compares reading swapped out pages in order with and without readahead,
+ * and checks that a shuffled read order does not trigger it.
+ */
+void benchmarkSequentialReadahead() {
+    runReadaheadScan(0, true);
+    runReadaheadScan(DEFAULT_READAHEAD_MAX_WINDOW, true);
+    runReadaheadScan(DEFAULT_READAHEAD_MAX_WINDOW, false);
+}
@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_READAHEADBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_READAHEADBENCHMARKS_H
+
+void benchmarkSequentialReadahead();
+
+#endif //VIRTUALMEMFRAMEWORKC_READAHEADBENCHMARKS_H
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "regionBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "region.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Pages in each buffer passed from the producer to the consumer */
+#define REGION_BENCHMARK_BUFFER_PAGES 64
+/* Buffers passed from the producer to the consumer */
+#define REGION_BENCHMARK_BUFFERS 50
+/* Pages of the region written before memory is filled, then read back */
+#define REGION_BENCHMARK_EVICTED_PAGES 512
+
+/**
+ * Fills the page with bytes that depend on the buffer and page number.
+ */
+static void fillBufferPage(uint8_t *page, int buffer, int pageNum) {
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        page[i] = (uint8_t)(buffer * 31 + pageNum * 7 + i);
+    }
+}
+
+/**
+ * Writes the buffer to the producer's pages at producerAddr and has the
+ * consumer read it back from consumerAddr, checking what it reads. If
+ * copyAddr is not -1 the producer's pages are private, so each page is
+ * first copied from them into the consumer's pages at copyAddr.
+ */
+static void passBuffer(Thread *producer, int producerAddr, Thread *consumer, int consumerAddr, int copyAddr, int buffer) {
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    for (int p = 0; p < REGION_BENCHMARK_BUFFER_PAGES; p++) {
+        fillBufferPage(page, buffer, p);
+        writeToAddr(producer, producerAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+    if (copyAddr != -1) {
+        for (int p = 0; p < REGION_BENCHMARK_BUFFER_PAGES; p++) {
+            readFromAddr(producer, producerAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+            writeToAddr(consumer, copyAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        }
+        consumerAddr = copyAddr;
+    }
+    for (int p = 0; p < REGION_BENCHMARK_BUFFER_PAGES; p++) {
+        fillBufferPage(expected, buffer, p);
+        readFromAddr(consumer, consumerAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+    }
+}
+
+/**
+ * Times a producer passing buffers to a consumer through a shared region
+ * against copying them from the producer's memory into the consumer's.
+ * Then fills a region through one mapping, has another thread push it out
+ * of memory, and reads it back through a second mapping, checking that
+ * bringing each page in for one mapping brought it in for the other.
+ */
+void benchmarkSharedRegionExchange() {
+    struct timespec start, end;
+    Thread *producer = createThread();
+    Thread *consumer = createThread();
+    SharedRegion *region = createSharedRegion(REGION_BENCHMARK_BUFFER_PAGES * PAGE_SIZE);
+    TEST_ASSERT_NOT_NULL(region);
+    int producerAddr = mapSharedRegion(producer, region);
+    int consumerAddr = mapSharedRegion(consumer, region);
+    TEST_ASSERT_TRUE(producerAddr != -1);
+    TEST_ASSERT_TRUE(consumerAddr != -1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int buffer = 0; buffer < REGION_BENCHMARK_BUFFERS; buffer++) {
+        passBuffer(producer, producerAddr, consumer, consumerAddr, -1, buffer);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double sharedSeconds = elapsedSeconds(&start, &end);
+
+    int privateAddr = allocateHeapMem(producer, REGION_BENCHMARK_BUFFER_PAGES * PAGE_SIZE);
+    int copyAddr = allocateHeapMem(consumer, REGION_BENCHMARK_BUFFER_PAGES * PAGE_SIZE);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int buffer = 0; buffer < REGION_BENCHMARK_BUFFERS; buffer++) {
+        passBuffer(producer, privateAddr, consumer, -1, copyAddr, buffer);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double copySeconds = elapsedSeconds(&start, &end);
+
+    printf("BENCHMARK shared region (%d page buffers): %.1f us per buffer passed through the region, %.1f us per buffer copied\n",
+           REGION_BENCHMARK_BUFFER_PAGES, sharedSeconds / REGION_BENCHMARK_BUFFERS * 1e6, copySeconds / REGION_BENCHMARK_BUFFERS * 1e6);
+    destroyThread(producer);
+    destroyThread(consumer);
+
+    // Start again from an empty system so the region is all that is swapped
+    restartSystem(NULL);
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    Thread *writer = createThread();
+    Thread *reader = createThread();
+    Thread *hog = createThread();
+    region = createSharedRegion(REGION_BENCHMARK_EVICTED_PAGES * PAGE_SIZE);
+    int writerAddr = mapSharedRegion(writer, region);
+    int readerAddr = mapSharedRegion(reader, region);
+    for (int p = 0; p < REGION_BENCHMARK_EVICTED_PAGES; p++) {
+        fillBufferPage(page, 1, p);
+        writeToAddr(writer, writerAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+    }
+    // Fill every frame with the hog's pages so the region is swapped out
+    int hogAddr = allocateHeapMem(hog, MAX_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    for (int p = 0; p < MAX_FRAME_TABLE_ENTRIES; p++) {
+        writeToAddr(hog, hogAddr + p * PAGE_SIZE, sizeof(int), &p);
+    }
+
+    uint64_t faultsBefore = vmStats.pageFaults;
+    uint64_t mapsBefore = vmStats.sharedPageMaps;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int p = 0; p < REGION_BENCHMARK_EVICTED_PAGES; p++) {
+        fillBufferPage(expected, 1, p);
+        readFromAddr(reader, readerAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t readerFaults = vmStats.pageFaults - faultsBefore;
+    uint64_t writerMaps = vmStats.sharedPageMaps - mapsBefore;
+    faultsBefore = vmStats.pageFaults;
+    for (int p = 0; p < REGION_BENCHMARK_EVICTED_PAGES; p++) {
+        fillBufferPage(expected, 1, p);
+        readFromAddr(writer, writerAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+    }
+    uint64_t writerFaults = vmStats.pageFaults - faultsBefore;
+
+    printf("BENCHMARK shared region (%d pages, then memory filled): %.2f us per page read back, %lu faults through one mapping mapped %lu pages of the other, which then took %lu faults\n",
+           REGION_BENCHMARK_EVICTED_PAGES, elapsedSeconds(&start, &end) / REGION_BENCHMARK_EVICTED_PAGES * 1e6,
+           (unsigned long)readerFaults, (unsigned long)writerMaps, (unsigned long)writerFaults);
+    destroyThread(writer);
+    destroyThread(reader);
+    destroyThread(hog);
+}
@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_REGIONBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_REGIONBENCHMARKS_H
+
+void benchmarkSharedRegionExchange();
+
+#endif //VIRTUALMEMFRAMEWORKC_REGIONBENCHMARKS_H
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "swapBackendBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "swap.h"
+#include "swapBackend.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Threads whose pages are swept, one after the other */
+#define SWAP_BACKEND_BENCHMARK_THREADS 2
+/* Pages of each thread, together more than fit in memory */
+#define SWAP_BACKEND_BENCHMARK_PAGES 1200
+/* Sweeps over every thread's pages, alternately reading and writing them */
+#define SWAP_BACKEND_BENCHMARK_SWEEPS 4
+
+/**
+ * Fills the page with bytes that depend on the page number and the sweep
+ * and do not compress, so the page goes to the swap device rather than the
+ * pool.
+ */
+static void fillBackendPage(uint8_t *page, int pageNum, int sweep) {
+    uint32_t state = pageNum * 2654435761u + sweep + 1;
+    for (int i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(page + i, &state, sizeof(uint32_t));
+    }
+}
+
+/**
+ * Sweeps the threads' pages with swap slots kept by the given backend and
+ * reports the time taken per swap read or write.
+ */
+static void runSwapBackend(SwapBackendType backendType) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    settings.compressedPoolBudget = 0;
+    settings.swapBackendType = backendType;
+    restartSystem(&settings);
+    Thread *threads[SWAP_BACKEND_BENCHMARK_THREADS];
+    int heapAddrs[SWAP_BACKEND_BENCHMARK_THREADS];
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    for (int t = 0; t < SWAP_BACKEND_BENCHMARK_THREADS; t++) {
+        threads[t] = createThread();
+        heapAddrs[t] = allocateHeapMem(threads[t], SWAP_BACKEND_BENCHMARK_PAGES * PAGE_SIZE);
+        for (int p = 0; p < SWAP_BACKEND_BENCHMARK_PAGES; p++) {
+            fillBackendPage(page, p, 0);
+            writeToAddr(threads[t], heapAddrs[t] + p * PAGE_SIZE, PAGE_SIZE, page);
+        }
+    }
+
+    uint64_t swapsBefore = vmStats.swapReads + vmStats.swapWrites;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int sweep = 1; sweep <= SWAP_BACKEND_BENCHMARK_SWEEPS; sweep++) {
+        // Every other sweep rewrites the pages, so they are dirty when they
+        // are evicted again
+        bool write = sweep % 2 == 0;
+        for (int t = 0; t < SWAP_BACKEND_BENCHMARK_THREADS; t++) {
+            for (int p = 0; p < SWAP_BACKEND_BENCHMARK_PAGES; p++) {
+                int addr = heapAddrs[t] + p * PAGE_SIZE;
+                if (write) {
+                    fillBackendPage(page, p, sweep);
+                    writeToAddr(threads[t], addr, PAGE_SIZE, page);
+                } else {
+                    readFromAddr(threads[t], addr, PAGE_SIZE, page);
+                    fillBackendPage(expected, p, sweep - 1);
+                    TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+                }
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t swaps = vmStats.swapReads + vmStats.swapWrites - swapsBefore;
+    uint64_t nanos = nanosBetween(&start, &end);
+    printf("BENCHMARK swap backend (%s): %llu pages swapped in %.1f ms, %.1f us per page\n",
+           swapBackend->name, (unsigned long long)swaps, nanos / 1e6, swaps > 0 ? nanos / 1e3 / swaps : 0.0);
+    for (int t = 0; t < SWAP_BACKEND_BENCHMARK_THREADS; t++) {
+        destroyThread(threads[t]);
+    }
+    restartSystem(&defaults);
+}
+
+/**
+ * Compares sweeping more pages than fit in memory with swap slots kept in a
+ * file per page, in a single file and in memory. The RAM backend leaves only
+ * the cost of paging itself.
+ */
+void benchmarkSwapBackends() {
+    runSwapBackend(SWAP_BACKEND_FILE_PER_PAGE);
+    runSwapBackend(SWAP_BACKEND_FILE);
+    runSwapBackend(SWAP_BACKEND_RAM);
+}
@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_SWAPBACKENDBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_SWAPBACKENDBENCHMARKS_H
+
+void benchmarkSwapBackends();
+
+#endif //VIRTUALMEMFRAMEWORKC_SWAPBACKENDBENCHMARKS_H
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "swapIoBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "page.h"
+#include "swap.h"
+#include "swapIo.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Threads faulting at once */
+#define SWAP_IO_BENCHMARK_THREADS 4
+/* Pages of each thread, together more than fit in memory */
+#define SWAP_IO_BENCHMARK_PAGES 600
+/* Pages each thread accesses at random, half of them written */
+#define SWAP_IO_BENCHMARK_ACCESSES 1500
+
+/**
+ * Defines one thread of the swap I/O benchmark and the latencies of the
+ * faults it took.
+ */
+typedef struct SwapIoBenchmarkThread {
+    Thread *thread;
+    int heapAddr;
+    unsigned int seed;
+    int numFaults;
+    uint64_t faultNanos[SWAP_IO_BENCHMARK_ACCESSES];
+} SwapIoBenchmarkThread;
+
+/**
+ * Fills the page with bytes that depend on the page number and do not
+ * compress, so the page goes to the swap device rather than the pool.
+ */
+static void fillSwapIoPage(uint8_t *page, int pageNum) {
+    uint32_t state = pageNum * 2654435761u + 1;
+    for (int i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(page + i, &state, sizeof(uint32_t));
+    }
+}
+
+/**
+ * Body of each benchmark thread. Reads or writes whole pages at random,
+ * timing each access to a page that was not in memory.
+ */
+static void* accessPagesAtRandom(void *arg) {
+    SwapIoBenchmarkThread *benchmarkThread = arg;
+    PageTable *pageTable = getThreadPageTable(benchmarkThread->thread->threadId);
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    for (int i = 0; i < SWAP_IO_BENCHMARK_ACCESSES; i++) {
+        int pageNum = rand_r(&benchmarkThread->seed) % SWAP_IO_BENCHMARK_PAGES;
+        int addr = benchmarkThread->heapAddr + pageNum * PAGE_SIZE;
+        bool write = rand_r(&benchmarkThread->seed) % 2;
+        // Only the thread itself brings its pages in, so a page that is
+        // not present now faults on the access
+        bool faults = !pageTable->entries[virtualAddressToVPN(addr)].present;
+        fillSwapIoPage(expected, pageNum);
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (write) {
+            writeToAddr(benchmarkThread->thread, addr, PAGE_SIZE, expected);
+        } else {
+            readFromAddr(benchmarkThread->thread, addr, PAGE_SIZE, page);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (!write) {
+            TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+        }
+        if (faults) {
+            benchmarkThread->faultNanos[benchmarkThread->numFaults++] = nanosBetween(&start, &end);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Runs the threads against swap I/O issued through the given engine and
+ * reports the swap I/O operations per second and the median and 99th
+ * percentile fault latency.
+ */
+static void runSwapIoEngine(SwapIoEngineType engineType) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    settings.compressedPoolBudget = 0;
+    settings.swapIoEngineType = engineType;
+    restartSystem(&settings);
+    static SwapIoBenchmarkThread threads[SWAP_IO_BENCHMARK_THREADS];
+    uint8_t page[PAGE_SIZE];
+    for (int t = 0; t < SWAP_IO_BENCHMARK_THREADS; t++) {
+        threads[t].thread = createThread();
+        threads[t].heapAddr = allocateHeapMem(threads[t].thread, SWAP_IO_BENCHMARK_PAGES * PAGE_SIZE);
+        threads[t].seed = t + 1;
+        threads[t].numFaults = 0;
+        for (int p = 0; p < SWAP_IO_BENCHMARK_PAGES; p++) {
+            fillSwapIoPage(page, p);
+            writeToAddr(threads[t].thread, threads[t].heapAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        }
+    }
+
+    uint64_t swapOpsBefore = vmStats.swapReadCalls + vmStats.swapWriteCalls;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < SWAP_IO_BENCHMARK_THREADS; t++) {
+        pthread_create(&threads[t].thread->thread, NULL, accessPagesAtRandom, &threads[t]);
+    }
+    for (int t = 0; t < SWAP_IO_BENCHMARK_THREADS; t++) {
+        pthread_join(threads[t].thread->thread, NULL);
+        threads[t].thread->thread = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t swapOps = vmStats.swapReadCalls + vmStats.swapWriteCalls - swapOpsBefore;
+
+    static uint64_t faultNanos[SWAP_IO_BENCHMARK_THREADS * SWAP_IO_BENCHMARK_ACCESSES];
+    int numFaults = 0;
+    for (int t = 0; t < SWAP_IO_BENCHMARK_THREADS; t++) {
+        memcpy(&faultNanos[numFaults], threads[t].faultNanos, threads[t].numFaults * sizeof(uint64_t));
+        numFaults += threads[t].numFaults;
+    }
+    qsort(faultNanos, numFaults, sizeof(uint64_t), compareNanos);
+    printf("BENCHMARK swap I/O (%s, %d threads): %.0f swap IOPS, %d faults, %.1f us median and %.1f us p99 fault latency\n",
+           swapIoEngine->name, SWAP_IO_BENCHMARK_THREADS, swapOps / (nanosBetween(&start, &end) / 1e9), numFaults,
+           numFaults > 0 ? faultNanos[numFaults / 2] / 1e3 : 0.0, numFaults > 0 ? faultNanos[numFaults * 99 / 100] / 1e3 : 0.0);
+    for (int t = 0; t < SWAP_IO_BENCHMARK_THREADS; t++) {
+        destroyThread(threads[t].thread);
+    }
+    restartSystem(&defaults);
+}
+
+/**
+ * Compares random page faults from several threads with swap I/O issued
+ * through pread and pwrite and through io_uring.
+ */
+void benchmarkSwapIoEngines() {
+    runSwapIoEngine(SWAP_IO_SYNC);
+    runSwapIoEngine(SWAP_IO_URING);
+}
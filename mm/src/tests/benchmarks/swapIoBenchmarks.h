@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_SWAPIOBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_SWAPIOBENCHMARKS_H
+
+void benchmarkSwapIoEngines();
+
+#endif //VIRTUALMEMFRAMEWORKC_SWAPIOBENCHMARKS_H
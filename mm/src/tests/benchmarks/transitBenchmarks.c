@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "transitBenchmarks.h"
+#include "thread.h"
+#include "memory.h"
+#include "page.h"
+#include "swap.h"
+#include "stats.h"
+#include "benchmarkUtil.h"
+#include "unity.h"
+
+extern const int PAGE_SIZE;
+
+/* Threads accessing their pages at once */
+#define TRANSIT_BENCHMARK_THREADS 4
+/* Pages of each thread, together more than fit in memory */
+#define TRANSIT_BENCHMARK_PAGES 600
+/* Pages each thread accesses at random, half of them written */
+#define TRANSIT_BENCHMARK_ACCESSES 2000
+
+/**
+ * Defines one thread of the benchmark and the latencies of its accesses,
+ * split by whether the page was in memory.
+ */
+typedef struct TransitBenchmarkThread {
+    Thread *thread;
+    int heapAddr;
+    unsigned int seed;
+    int numHits;
+    int numFaults;
+    uint64_t hitNanos[TRANSIT_BENCHMARK_ACCESSES];
+    uint64_t faultNanos[TRANSIT_BENCHMARK_ACCESSES];
+} TransitBenchmarkThread;
+
+/**
+ * Fills the page with bytes that depend on the page number and do not
+ * compress, so the page goes to the swap device rather than the pool.
+ */
+static void fillTransitPage(uint8_t *page, int pageNum) {
+    uint32_t state = pageNum * 2654435761u + 1;
+    for (int i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(page + i, &state, sizeof(uint32_t));
+    }
+}
+
+/**
+ * Body of each benchmark thread. Reads or writes whole pages at random,
+ * timing every access.
+ */
+static void* accessPagesDuringEvictions(void *arg) {
+    TransitBenchmarkThread *benchmarkThread = arg;
+    PageTable *pageTable = getThreadPageTable(benchmarkThread->thread->threadId);
+    uint8_t page[PAGE_SIZE];
+    uint8_t expected[PAGE_SIZE];
+    for (int i = 0; i < TRANSIT_BENCHMARK_ACCESSES; i++) {
+        int pageNum = rand_r(&benchmarkThread->seed) % TRANSIT_BENCHMARK_PAGES;
+        int addr = benchmarkThread->heapAddr + pageNum * PAGE_SIZE;
+        bool write = rand_r(&benchmarkThread->seed) % 2;
+        // Only the thread itself brings its pages in, so a page that is
+        // not present now faults on the access
+        bool faults = !pageTable->entries[virtualAddressToVPN(addr)].present;
+        fillTransitPage(expected, pageNum);
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (write) {
+            writeToAddr(benchmarkThread->thread, addr, PAGE_SIZE, expected);
+        } else {
+            readFromAddr(benchmarkThread->thread, addr, PAGE_SIZE, page);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (!write) {
+            TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+        }
+        if (faults) {
+            benchmarkThread->faultNanos[benchmarkThread->numFaults++] = nanosBetween(&start, &end);
+        } else {
+            benchmarkThread->hitNanos[benchmarkThread->numHits++] = nanosBetween(&start, &end);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Sorts the latencies and returns their 99th percentile in microseconds.
+ */
+static double p99Micros(uint64_t *nanos, int numNanos) {
+    if (numNanos == 0) {
+        return 0.0;
+    }
+    qsort(nanos, numNanos, sizeof(uint64_t), compareNanos);
+    return nanos[numNanos * 99 / 100] / 1e3;
+}
+
+/**
+ * Runs the threads with evicted pages written out in transit or under their
+ * locks, and reports the access rate and the 99th percentile latency of
+ * accesses to pages in memory and of faults.
+ */
+static void runSwapOut(bool inTransit) {
+    BenchmarkSettings defaults = currentBenchmarkSettings();
+    BenchmarkSettings settings = defaults;
+    settings.compressedPoolBudget = 0;
+    settings.transitSwapOut = inTransit;
+    restartSystem(&settings);
+    static TransitBenchmarkThread threads[TRANSIT_BENCHMARK_THREADS];
+    uint8_t page[PAGE_SIZE];
+    for (int t = 0; t < TRANSIT_BENCHMARK_THREADS; t++) {
+        threads[t].thread = createThread();
+        threads[t].heapAddr = allocateHeapMem(threads[t].thread, TRANSIT_BENCHMARK_PAGES * PAGE_SIZE);
+        threads[t].seed = t + 1;
+        threads[t].numHits = 0;
+        threads[t].numFaults = 0;
+        for (int p = 0; p < TRANSIT_BENCHMARK_PAGES; p++) {
+            fillTransitPage(page, p);
+            writeToAddr(threads[t].thread, threads[t].heapAddr + p * PAGE_SIZE, PAGE_SIZE, page);
+        }
+    }
+
+    uint64_t transitWritesBefore = vmStats.transitWrites;
+    uint64_t transitWaitsBefore = vmStats.transitWaits;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < TRANSIT_BENCHMARK_THREADS; t++) {
+        pthread_create(&threads[t].thread->thread, NULL, accessPagesDuringEvictions, &threads[t]);
+    }
+    for (int t = 0; t < TRANSIT_BENCHMARK_THREADS; t++) {
+        pthread_join(threads[t].thread->thread, NULL);
+        threads[t].thread->thread = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    static uint64_t hitNanos[TRANSIT_BENCHMARK_THREADS * TRANSIT_BENCHMARK_ACCESSES];
+    static uint64_t faultNanos[TRANSIT_BENCHMARK_THREADS * TRANSIT_BENCHMARK_ACCESSES];
+    int numHits = 0;
+    int numFaults = 0;
+    for (int t = 0; t < TRANSIT_BENCHMARK_THREADS; t++) {
+        memcpy(&hitNanos[numHits], threads[t].hitNanos, threads[t].numHits * sizeof(uint64_t));
+        numHits += threads[t].numHits;
+        memcpy(&faultNanos[numFaults], threads[t].faultNanos, threads[t].numFaults * sizeof(uint64_t));
+        numFaults += threads[t].numFaults;
+    }
+    printf("BENCHMARK swap out (%s, %d threads): %.0f accesses per second, %.1f us p99 hit latency, %.1f us p99 fault latency, %llu pages written in transit, %llu waits for them\n",
+           inTransit ? "in transit" : "under locks", TRANSIT_BENCHMARK_THREADS,
+           TRANSIT_BENCHMARK_THREADS * TRANSIT_BENCHMARK_ACCESSES / (nanosBetween(&start, &end) / 1e9),
+           p99Micros(hitNanos, numHits), p99Micros(faultNanos, numFaults),
+           (unsigned long long)(vmStats.transitWrites - transitWritesBefore),
+           (unsigned long long)(vmStats.transitWaits - transitWaitsBefore));
+    for (int t = 0; t < TRANSIT_BENCHMARK_THREADS; t++) {
+        destroyThread(threads[t].thread);
+    }
+    restartSystem(&defaults);
+}
+
+/**
+ * Compares random accesses from several threads while their pages are
+ * evicted, with evicted pages written out under their page table and frame
+ * locks and written out in transit with the locks dropped.
+ */
+void benchmarkSwapOutInTransit() {
+    runSwapOut(false);
+    runSwapOut(true);
+}
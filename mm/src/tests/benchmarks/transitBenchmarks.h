@@ -0,0 +1,6 @@
+#ifndef VIRTUALMEMFRAMEWORKC_TRANSITBENCHMARKS_H
+#define VIRTUALMEMFRAMEWORKC_TRANSITBENCHMARKS_H
+
+void benchmarkSwapOutInTransit();
+
+#endif //VIRTUALMEMFRAMEWORKC_TRANSITBENCHMARKS_H
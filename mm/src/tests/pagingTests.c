@@ -1,13 +1,100 @@
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
 #include "pagingTests.h"
 #include "memory.h"
 #include "thread.h"
+#include "frame.h"
+#include "buddy.h"
+#include "lz.h"
+#include "swap.h"
+#include "swapBackend.h"
+#include "swapIo.h"
+#include "region.h"
+#include "merge.h"
+#include "reclaim.h"
+#include "flusher.h"
+#include "prefetch.h"
+#include "readahead.h"
+#include "stats.h"
+#include "system.h"
 #include "utils.h"
 #include "unity.h"
 
 extern const int PAGE_SIZE;
 extern const int USER_BASE_ADDR;
 
+/* Host file mapped by the file mapping test */
+#define MAP_TEST_FILE_NAME "mapTest.dat"
+/* Pages in the host file */
+#define MAP_TEST_FILE_PAGES 4
+
+/* Pages read back in order by the readahead test */
+#define READAHEAD_TEST_PAGES 32
+
+/* Pages written by the prefetch test, every third of which is read back */
+#define PREFETCH_TEST_PAGES 60
+/* Pages between the pages read one after another by the prefetch test */
+#define PREFETCH_TEST_STRIDE 3
+/* Most milliseconds the prefetch test waits for the prefetcher */
+#define PREFETCH_TEST_WAIT_MS 1000
+
+/* Pages written back by the flusher test, one cluster's worth */
+#define FLUSH_TEST_PAGES DEFAULT_FLUSH_CLUSTER_PAGES
+
+/* Pages swapped out and back by the swap backend and engine tests */
+#define SWAP_TEST_PAGES 24
+
+/* Times the pages of every frame are written over to push a thread's pages
+   out of memory before giving up */
+#define PUSH_OUT_MAX_SWEEPS 8
+
+/* Most seconds the transit test waits for the page's write to be held */
+#define TRANSIT_TEST_WAIT_SECONDS 10
+/* Most milliseconds the transit test waits for the fault to start waiting */
+#define TRANSIT_TEST_WAIT_MS 1000
+
+/* Pages written back in runs of slots by the slot allocator test */
+#define SLOT_TEST_PAGES (2 * DEFAULT_FLUSH_CLUSTER_PAGES)
+
+/* Pages swapped out, read back and swapped out again by the clean page test */
+#define CLEAN_TEST_PAGES 16
+
+/* Threads taking frames from the free frame stack at once */
+#define STACK_TEST_THREADS 8
+/* Frames each thread holds at a time */
+#define STACK_TEST_BATCH 16
+/* Times each thread takes and returns its batch */
+#define STACK_TEST_ROUNDS 2000
+
+extern BuddyAllocator *buddyAllocator;
+extern SwapDevice *swapDevice;
+extern uint8_t *zeroFrame;
+extern uint8_t currentThreadId;
+
+/* The backend the transit test passes every write through to */
+static const SwapBackend *transitTestBackend;
+/* The page whose write the transit test holds, its bytes and its page table
+   entry, and the bytes the test reads it back into */
+static Thread *transitTestWriter;
+static int transitTestAddr;
+static const void *transitTestData;
+static const PTEntry *transitTestEntry;
+static void *transitTestReadData;
+/* Whether the page's write is being held, and whether it may go on */
+static bool transitTestHeld;
+static bool transitTestReleased;
+static pthread_mutex_t transitTestLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t transitTestCond = PTHREAD_COND_INITIALIZER;
+
+/* Number of threads holding each frame, never more than one */
+static uint8_t stackTestHolders[NUM_FRAME_TABLE_ENTRIES];
+/* Number of times a frame was handed out while already held */
+static int stackTestDoubleTakes;
+
 void testDataPagedOutCorrectly() {
     Thread* thread1 = createThread();
     void *data = createRandomData(PAGE_SIZE);
@@ -70,4 +157,872 @@ void testDataPagedInCorrectly() {
     free(data);
     free(data2);
     free(readData);
-}
\ No newline at end of file
+}
+
+/**
+ * Body of each thread of the free frame stack test. Takes a batch of frames,
+ * checks that no other thread holds any of them, and returns them, over and
+ * over.
+ */
+static void* takeAndReturnStackFrames(void *arg) {
+    (void)arg;
+    FTEntry *batch[STACK_TEST_BATCH];
+    for (int round = 0; round < STACK_TEST_ROUNDS; round++) {
+        for (int i = 0; i < STACK_TEST_BATCH; i++) {
+            batch[i] = takeFrameFromFreeList();
+            if (__atomic_add_fetch(&stackTestHolders[batch[i]->frameNum], 1, __ATOMIC_RELAXED) != 1) {
+                __atomic_add_fetch(&stackTestDoubleTakes, 1, __ATOMIC_RELAXED);
+            }
+        }
+        for (int i = 0; i < STACK_TEST_BATCH; i++) {
+            __atomic_sub_fetch(&stackTestHolders[batch[i]->frameNum], 1, __ATOMIC_RELAXED);
+            returnFrameToFreeList(batch[i]);
+        }
+    }
+    return NULL;
+}
+
+void testFreeFrameStackUnderContention() {
+    FreeFramePoolType defaultType = freeFramePoolType;
+    systemShutdown();
+    freeFramePoolType = FREE_POOL_STACK;
+    systemInit();
+
+    stackTestDoubleTakes = 0;
+    pthread_t threads[STACK_TEST_THREADS];
+    for (int t = 0; t < STACK_TEST_THREADS; t++) {
+        pthread_create(&threads[t], NULL, takeAndReturnStackFrames, NULL);
+    }
+    for (int t = 0; t < STACK_TEST_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    TEST_ASSERT_EQUAL_INT(0, stackTestDoubleTakes);
+    TEST_ASSERT_EQUAL(NUM_FRAME_TABLE_ENTRIES, countFreeFrames());
+
+    // Popping the whole stack hands out every frame exactly once
+    FTEntry *entries[NUM_FRAME_TABLE_ENTRIES];
+    bool seen[NUM_FRAME_TABLE_ENTRIES] = {false};
+    for (int i = 0; i < NUM_FRAME_TABLE_ENTRIES; i++) {
+        entries[i] = takeFrameFromFreeList();
+        TEST_ASSERT_NOT_NULL(entries[i]);
+        TEST_ASSERT_FALSE(seen[entries[i]->frameNum]);
+        seen[entries[i]->frameNum] = true;
+    }
+    TEST_ASSERT_NULL(takeFrameFromFreeList());
+    for (int i = 0; i < NUM_FRAME_TABLE_ENTRIES; i++) {
+        returnFrameToFreeList(entries[i]);
+    }
+
+    systemShutdown();
+    freeFramePoolType = defaultType;
+    systemInit();
+}
+
+void testBuddyAllocatorSplitsAndCoalesces() {
+    FreeFramePoolType defaultType = freeFramePoolType;
+    systemShutdown();
+    freeFramePoolType = FREE_POOL_BUDDY;
+    systemInit();
+
+    // Taking one frame splits the first largest run all the way down,
+    // leaving one free run of each smaller order behind it
+    uint16_t single = allocateFrameRun(0);
+    TEST_ASSERT_EQUAL_UINT16(0, single);
+    TEST_ASSERT_EQUAL_UINT8(BUDDY_NOT_FREE, buddyAllocator->freeOrder[0]);
+    for (int order = 0; order < BUDDY_MAX_ORDER; order++) {
+        TEST_ASSERT_EQUAL_UINT8(order, buddyAllocator->freeOrder[1 << order]);
+    }
+    TEST_ASSERT_EQUAL(NUM_FRAME_TABLE_ENTRIES - 1, countBuddyFreeFrames());
+
+    // A pair comes from the free run of that size, without another split
+    uint16_t pair = allocateFrameRun(1);
+    TEST_ASSERT_EQUAL_UINT16(2, pair);
+    TEST_ASSERT_EQUAL_UINT8(BUDDY_NOT_FREE, buddyAllocator->freeOrder[2]);
+    TEST_ASSERT_EQUAL_UINT8(2, buddyAllocator->freeOrder[4]);
+
+    // The single frame merges with its free buddy, but not with the pair
+    freeFrameRun(single, 0);
+    TEST_ASSERT_EQUAL_UINT8(1, buddyAllocator->freeOrder[0]);
+    TEST_ASSERT_EQUAL_UINT8(BUDDY_NOT_FREE, buddyAllocator->freeOrder[1]);
+
+    // Freeing the pair merges every run back into the largest one
+    freeFrameRun(pair, 1);
+    TEST_ASSERT_EQUAL_UINT8(BUDDY_MAX_ORDER, buddyAllocator->freeOrder[0]);
+    for (int order = 0; order < BUDDY_MAX_ORDER; order++) {
+        TEST_ASSERT_EQUAL_UINT8(BUDDY_NOT_FREE, buddyAllocator->freeOrder[1 << order]);
+    }
+    TEST_ASSERT_EQUAL(NUM_FRAME_TABLE_ENTRIES, countBuddyFreeFrames());
+
+    // A run larger than the allocator keeps is never handed out
+    TEST_ASSERT_EQUAL_UINT16(BUDDY_NONE, allocateFrameRun(BUDDY_MAX_ORDER + 1));
+
+    systemShutdown();
+    freeFramePoolType = defaultType;
+    systemInit();
+}
+
+void testCompressionRoundTripsAndRejectsNoise() {
+    uint8_t *page = malloc(PAGE_SIZE);
+    uint8_t *compressed = malloc(PAGE_SIZE);
+    uint8_t *decompressed = malloc(PAGE_SIZE);
+
+    // Short records that repeat with small changes, like most heap pages
+    for (int offset = 0; offset < PAGE_SIZE; offset += 16) {
+        uint32_t record[4] = {offset / 16, 7, (offset / 64) % 5 * 1000, 0};
+        memcpy(page + offset, record, sizeof(record));
+    }
+    int compressedSize = lzCompress(page, PAGE_SIZE, compressed, COMPRESSED_PAGE_MAX_SIZE);
+    TEST_ASSERT_TRUE(compressedSize > 0);
+    TEST_ASSERT_TRUE(compressedSize <= COMPRESSED_PAGE_MAX_SIZE);
+    TEST_ASSERT_EQUAL_INT(PAGE_SIZE, lzDecompress(compressed, compressedSize, decompressed, PAGE_SIZE));
+    TEST_ASSERT_EQUAL_MEMORY(page, decompressed, PAGE_SIZE);
+
+    // A page too small to hold the output is refused rather than overrun
+    TEST_ASSERT_EQUAL_INT(-1, lzDecompress(compressed, compressedSize, decompressed, PAGE_SIZE / 2));
+
+    // Random bytes do not compress, so they are refused with no room to spare
+    uint32_t state = 2463534242u;
+    for (int i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(page + i, &state, sizeof(uint32_t));
+    }
+    TEST_ASSERT_EQUAL_INT(0, lzCompress(page, PAGE_SIZE, compressed, COMPRESSED_PAGE_MAX_SIZE));
+
+    free(page);
+    free(compressed);
+    free(decompressed);
+}
+
+void testForkedThreadSeesThenDiverges() {
+    Thread *parent = createThread();
+    void *data = createRandomData(2 * PAGE_SIZE);
+    void *childData = createRandomData(PAGE_SIZE);
+    void *readData = malloc(2 * PAGE_SIZE);
+    int addr = allocateAndWriteHeapData(parent, data, 2 * PAGE_SIZE, 2 * PAGE_SIZE);
+
+    // The child starts out with the parent's data
+    Thread *child = forkThread(parent);
+    TEST_ASSERT_NOT_NULL(child);
+    readFromAddr(child, addr, 2 * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, 2 * PAGE_SIZE);
+
+    // Once the child writes a page the parent keeps its own copy, and the
+    // page the child did not write stays the same for both
+    writeToAddr(child, addr, PAGE_SIZE, childData);
+    readFromAddr(child, addr, 2 * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(childData, readData, PAGE_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY((uint8_t *)data + PAGE_SIZE, (uint8_t *)readData + PAGE_SIZE, PAGE_SIZE);
+    readFromAddr(parent, addr, 2 * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, 2 * PAGE_SIZE);
+
+    // And a write by the parent is not seen by the child
+    writeToAddr(parent, addr + PAGE_SIZE, PAGE_SIZE, childData);
+    readFromAddr(child, addr + PAGE_SIZE, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY((uint8_t *)data + PAGE_SIZE, readData, PAGE_SIZE);
+
+    // A fork fails once no page table is left for the child
+    Thread *threads[NUM_PAGE_TABLES];
+    int numThreads = 0;
+    while (currentThreadId <= NUM_PAGE_TABLES) {
+        threads[numThreads++] = createThread();
+    }
+    TEST_ASSERT_NULL(forkThread(parent));
+
+    for (int i = 0; i < numThreads; i++) {
+        destroyThread(threads[i]);
+    }
+    destroyThread(child);
+    destroyThread(parent);
+    free(data);
+    free(childData);
+    free(readData);
+}
+
+/**
+ * Returns the thread's page table entry for the page holding the address.
+ */
+static PTEntry* pageEntry(const Thread *thread, int addr) {
+    return &getThreadPageTable(thread->threadId)->entries[virtualAddressToVPN(addr)];
+}
+
+/**
+ * Has a new thread write to as many pages as there are frames, over and
+ * over until none of the thread's numPages pages from addr is left in
+ * memory. Returns the new thread, for the caller to destroy.
+ */
+static Thread* pushOutOfMemory(const Thread *thread, int addr, int numPages) {
+    Thread *hog = createThread();
+    int hogAddr = allocateHeapMem(hog, MAX_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    for (int sweep = 0; sweep < PUSH_OUT_MAX_SWEEPS; sweep++) {
+        for (int p = 0; p < MAX_FRAME_TABLE_ENTRIES; p++) {
+            writeToAddr(hog, hogAddr + p * PAGE_SIZE, sizeof(int), &p);
+        }
+        bool resident = false;
+        for (int p = 0; p < numPages; p++) {
+            resident |= pageEntry(thread, addr + p * PAGE_SIZE)->present;
+        }
+        if (!resident) {
+            return hog;
+        }
+    }
+    TEST_FAIL_MESSAGE("Pages stayed in memory");
+    return hog;
+}
+
+/**
+ * Has a new thread write the pages of data, pushes them out of memory and
+ * reads them back into readData. The pages are random, so they do not
+ * compress and go to the swap device.
+ */
+static void swapPagesOutAndIn(const void *data, int numPages, void *readData) {
+    Thread *thread = createThread();
+    int addr = allocateAndWriteHeapData(thread, (void *)data, numPages * PAGE_SIZE, numPages * PAGE_SIZE);
+    Thread *hog = pushOutOfMemory(thread, addr, numPages);
+    readFromAddr(thread, addr, numPages * PAGE_SIZE, readData);
+    destroyThread(hog);
+    destroyThread(thread);
+}
+
+/**
+ * Checks that the page of the host file holds the given bytes.
+ */
+static void checkMappedFilePage(int pageNum, const void *expected) {
+    uint8_t page[PAGE_SIZE];
+    int fd = open(MAP_TEST_FILE_NAME, O_RDONLY);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT(PAGE_SIZE, pread(fd, page, PAGE_SIZE, (off_t)pageNum * PAGE_SIZE));
+    close(fd);
+    TEST_ASSERT_EQUAL_MEMORY(expected, page, PAGE_SIZE);
+}
+
+void testMappedFileWrittenBack() {
+    void *fileData = createRandomData(MAP_TEST_FILE_PAGES * PAGE_SIZE);
+    void *evictedData = createRandomData(PAGE_SIZE);
+    void *residentData = createRandomData(PAGE_SIZE);
+    void *readData = malloc(MAP_TEST_FILE_PAGES * PAGE_SIZE);
+    FILE *file = fopen(MAP_TEST_FILE_NAME, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(fileData, 1, MAP_TEST_FILE_PAGES * PAGE_SIZE, file);
+    fclose(file);
+
+    // The mapping reads the file as it is
+    Thread *mapper = createThread();
+    int addr = mapFile(mapper, MAP_TEST_FILE_NAME, 0, MAP_TEST_FILE_PAGES * PAGE_SIZE);
+    TEST_ASSERT_TRUE(addr != -1);
+    readFromAddr(mapper, addr, MAP_TEST_FILE_PAGES * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(fileData, readData, MAP_TEST_FILE_PAGES * PAGE_SIZE);
+
+    // A page written through the mapping reaches the file once it is
+    // pushed out of memory
+    writeToAddr(mapper, addr + PAGE_SIZE, PAGE_SIZE, evictedData);
+    Thread *hog = createThread();
+    int hogAddr = allocateHeapMem(hog, MAX_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    for (int p = 0; p < MAX_FRAME_TABLE_ENTRIES; p++) {
+        writeToAddr(hog, hogAddr + p * PAGE_SIZE, sizeof(int), &p);
+    }
+    checkMappedFilePage(1, evictedData);
+    readFromAddr(mapper, addr + PAGE_SIZE, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(evictedData, readData, PAGE_SIZE);
+
+    // And a page still in memory reaches it when the system shuts down
+    writeToAddr(mapper, addr + 2 * PAGE_SIZE, PAGE_SIZE, residentData);
+    destroyThread(mapper);
+    destroyThread(hog);
+    systemShutdown();
+    checkMappedFilePage(2, residentData);
+    checkMappedFilePage(0, fileData);
+    checkMappedFilePage(3, (uint8_t *)fileData + 3 * PAGE_SIZE);
+    systemInit();
+
+    remove(MAP_TEST_FILE_NAME);
+    free(fileData);
+    free(evictedData);
+    free(residentData);
+    free(readData);
+}
+
+void testMergedPagesDivergeOnWrite() {
+    void *data = createRandomData(PAGE_SIZE);
+    void *newData = createRandomData(PAGE_SIZE);
+    void *readData = malloc(PAGE_SIZE);
+    // The scans are run here, so the background merger must not take the
+    // frames first
+    stopMerger();
+    Thread *first = createThread();
+    Thread *second = createThread();
+    int firstAddr = allocateAndWriteHeapData(first, data, PAGE_SIZE, PAGE_SIZE);
+    int secondAddr = allocateAndWriteHeapData(second, data, PAGE_SIZE, PAGE_SIZE);
+
+    // The first pass only checksums the frames, the second finds them
+    // unchanged and merges them, and the third makes sure of two whole passes
+    int numMerged = 0;
+    for (int pass = 0; pass < 3; pass++) {
+        numMerged += scanFramesForMerging(NUM_FRAME_TABLE_ENTRIES);
+    }
+    TEST_ASSERT_EQUAL_INT(1, numMerged);
+    readFromAddr(second, secondAddr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, PAGE_SIZE);
+
+    // A write to one of the pages copies the frame, leaving the other alone
+    writeToAddr(first, firstAddr, PAGE_SIZE, newData);
+    readFromAddr(first, firstAddr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(newData, readData, PAGE_SIZE);
+    readFromAddr(second, secondAddr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, PAGE_SIZE);
+
+    // And the other page is its own once more, a write to it is not seen by
+    // the first
+    writeToAddr(second, secondAddr, sizeof(int), &numMerged);
+    readFromAddr(first, firstAddr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(newData, readData, PAGE_SIZE);
+
+    destroyThread(first);
+    destroyThread(second);
+    free(data);
+    free(newData);
+    free(readData);
+}
+
+void testSharedRegionSeenAfterEviction() {
+    void *data = createRandomData(2 * PAGE_SIZE);
+    void *readerData = createRandomData(PAGE_SIZE);
+    void *readData = malloc(2 * PAGE_SIZE);
+    Thread *writer = createThread();
+    Thread *reader = createThread();
+    SharedRegion *region = createSharedRegion(2 * PAGE_SIZE);
+    TEST_ASSERT_NOT_NULL(region);
+    int writerAddr = mapSharedRegion(writer, region);
+    int readerAddr = mapSharedRegion(reader, region);
+    TEST_ASSERT_TRUE(writerAddr != -1);
+    TEST_ASSERT_TRUE(readerAddr != -1);
+
+    // Both mappings see a write through either of them
+    writeToAddr(writer, writerAddr, 2 * PAGE_SIZE, data);
+    readFromAddr(reader, readerAddr, 2 * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, 2 * PAGE_SIZE);
+    writeToAddr(reader, readerAddr + PAGE_SIZE, PAGE_SIZE, readerData);
+    readFromAddr(writer, writerAddr + PAGE_SIZE, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(readerData, readData, PAGE_SIZE);
+
+    // Once the region is pushed out of memory the other mapping still reads
+    // what was last written through either
+    Thread *hog = pushOutOfMemory(writer, writerAddr, 2);
+    TEST_ASSERT_FALSE(pageEntry(reader, readerAddr + PAGE_SIZE)->present);
+    readFromAddr(reader, readerAddr, 2 * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, PAGE_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(readerData, (uint8_t *)readData + PAGE_SIZE, PAGE_SIZE);
+    readFromAddr(writer, writerAddr, 2 * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, PAGE_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(readerData, (uint8_t *)readData + PAGE_SIZE, PAGE_SIZE);
+
+    destroyThread(hog);
+    destroyThread(writer);
+    destroyThread(reader);
+    free(data);
+    free(readerData);
+    free(readData);
+}
+
+void testReadaheadReturnsSwappedPages() {
+    // The pages are kept out of the compressed pool and away from the
+    // prefetcher, so every page after a fault comes from readahead
+    uint32_t defaultBudget = compressedPoolBudget;
+    uint8_t defaultDegree = prefetchDegree;
+    systemShutdown();
+    compressedPoolBudget = 0;
+    prefetchDegree = 0;
+    systemInit();
+
+    void *data = createRandomData(READAHEAD_TEST_PAGES * PAGE_SIZE);
+    void *readData = malloc(PAGE_SIZE);
+    Thread *reader = createThread();
+    int addr = allocateAndWriteHeapData(reader, data, READAHEAD_TEST_PAGES * PAGE_SIZE, READAHEAD_TEST_PAGES * PAGE_SIZE);
+    Thread *hog = pushOutOfMemory(reader, addr, READAHEAD_TEST_PAGES);
+
+    // Reading the pages in order brings the ones after each fault in
+    // ahead of time, each with its own bytes
+    uint64_t readaheadBefore = vmStats.readaheadPages;
+    for (int p = 0; p < READAHEAD_TEST_PAGES; p++) {
+        readFromAddr(reader, addr + p * PAGE_SIZE, PAGE_SIZE, readData);
+        TEST_ASSERT_EQUAL_MEMORY((uint8_t *)data + p * PAGE_SIZE, readData, PAGE_SIZE);
+    }
+    TEST_ASSERT_TRUE(vmStats.readaheadPages > readaheadBefore);
+
+    destroyThread(hog);
+    destroyThread(reader);
+    free(data);
+    free(readData);
+    systemShutdown();
+    compressedPoolBudget = defaultBudget;
+    prefetchDegree = defaultDegree;
+    systemInit();
+}
+
+void testPrefetchReturnsSwappedPages() {
+    // Without readahead every page brought in ahead of a fault comes from
+    // the prefetcher following the stride
+    uint32_t defaultBudget = compressedPoolBudget;
+    uint8_t defaultWindow = readaheadMaxWindow;
+    systemShutdown();
+    compressedPoolBudget = 0;
+    readaheadMaxWindow = 0;
+    systemInit();
+
+    void *data = createRandomData(PREFETCH_TEST_PAGES * PAGE_SIZE);
+    void *readData = malloc(PAGE_SIZE);
+    Thread *reader = createThread();
+    int addr = allocateAndWriteHeapData(reader, data, PREFETCH_TEST_PAGES * PAGE_SIZE, PREFETCH_TEST_PAGES * PAGE_SIZE);
+    // The prefetcher never takes the last free frames, so the hog's are
+    // given back before the walk
+    destroyThread(pushOutOfMemory(reader, addr, PREFETCH_TEST_PAGES));
+
+    // Each page of the walk is mapped with its own bytes, whether the
+    // prefetcher or the reader gets to it first. The walk covers half of
+    // the pages, so the pages predicted ahead of its last faults are left
+    // for the prefetcher, which brings them in in the background
+    uint64_t prefetchesBefore = vmStats.stridePrefetches;
+    for (int p = 0; p < PREFETCH_TEST_PAGES / 2; p += PREFETCH_TEST_STRIDE) {
+        readFromAddr(reader, addr + p * PAGE_SIZE, PAGE_SIZE, readData);
+        TEST_ASSERT_EQUAL_MEMORY((uint8_t *)data + p * PAGE_SIZE, readData, PAGE_SIZE);
+    }
+    for (int waitedMs = 0; vmStats.stridePrefetches == prefetchesBefore && waitedMs < PREFETCH_TEST_WAIT_MS; waitedMs++) {
+        usleep(1000);
+    }
+    TEST_ASSERT_TRUE(vmStats.stridePrefetches > prefetchesBefore);
+
+    // The prefetched pages and the pages the walk stepped over read back
+    // intact as well
+    for (int p = 0; p < PREFETCH_TEST_PAGES; p++) {
+        readFromAddr(reader, addr + p * PAGE_SIZE, PAGE_SIZE, readData);
+        TEST_ASSERT_EQUAL_MEMORY((uint8_t *)data + p * PAGE_SIZE, readData, PAGE_SIZE);
+    }
+
+    destroyThread(reader);
+    free(data);
+    free(readData);
+    systemShutdown();
+    compressedPoolBudget = defaultBudget;
+    readaheadMaxWindow = defaultWindow;
+    systemInit();
+}
+
+void testFlushedPagesReadBackIntact() {
+    void *data = createRandomData(FLUSH_TEST_PAGES * PAGE_SIZE);
+    void *newData = createRandomData(PAGE_SIZE);
+    void *readData = malloc(FLUSH_TEST_PAGES * PAGE_SIZE);
+    // The pages are written back here, so the background flusher must not
+    // get to them first
+    stopFlusher();
+    Thread *writer = createThread();
+    int addr = allocateAndWriteHeapData(writer, data, FLUSH_TEST_PAGES * PAGE_SIZE, FLUSH_TEST_PAGES * PAGE_SIZE);
+
+    // Only frames that look cold are written back
+    clearFramesAccessed(0, NUM_FRAME_TABLE_ENTRIES);
+    uint64_t writeBacksBefore = vmStats.writeBacks;
+    TEST_ASSERT_TRUE(flushDirtyFrames(NUM_FRAME_TABLE_ENTRIES) > 0);
+    TEST_ASSERT_EQUAL_INT(FLUSH_TEST_PAGES, vmStats.writeBacks - writeBacksBefore);
+    readFromAddr(writer, addr, FLUSH_TEST_PAGES * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, FLUSH_TEST_PAGES * PAGE_SIZE);
+
+    // A page written again after it was cleaned is written out once more,
+    // and the rest are dropped on eviction and read back from their slots
+    memcpy(data, newData, PAGE_SIZE);
+    writeToAddr(writer, addr, PAGE_SIZE, newData);
+    uint64_t skippedBefore = vmStats.swapWritesSkipped;
+    Thread *hog = pushOutOfMemory(writer, addr, FLUSH_TEST_PAGES);
+    TEST_ASSERT_TRUE(vmStats.swapWritesSkipped > skippedBefore);
+    readFromAddr(writer, addr, FLUSH_TEST_PAGES * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, FLUSH_TEST_PAGES * PAGE_SIZE);
+
+    destroyThread(hog);
+    destroyThread(writer);
+    free(data);
+    free(newData);
+    free(readData);
+}
+
+void testSwapBackendsRoundTripPages() {
+    SwapBackendType defaultBackend = swapBackendType;
+    const SwapBackendType backendTypes[] = {SWAP_BACKEND_RAM, SWAP_BACKEND_FILE_PER_PAGE};
+    const SwapBackend *backends[] = {&ramSwapBackend, &filePerPageSwapBackend};
+    void *data = createRandomData(SWAP_TEST_PAGES * PAGE_SIZE);
+    void *newData = createRandomData(SWAP_TEST_PAGES * PAGE_SIZE);
+    void *readData = malloc(SWAP_TEST_PAGES * PAGE_SIZE);
+    for (int b = 0; b < 2; b++) {
+        systemShutdown();
+        swapBackendType = backendTypes[b];
+        systemInit();
+        TEST_ASSERT_TRUE(swapBackend == backends[b]);
+
+        swapPagesOutAndIn(data, SWAP_TEST_PAGES, readData);
+        TEST_ASSERT_EQUAL_MEMORY(data, readData, SWAP_TEST_PAGES * PAGE_SIZE);
+        // And once more with other bytes, once the first pages gave their
+        // slots back
+        swapPagesOutAndIn(newData, SWAP_TEST_PAGES, readData);
+        TEST_ASSERT_EQUAL_MEMORY(newData, readData, SWAP_TEST_PAGES * PAGE_SIZE);
+    }
+
+    free(data);
+    free(newData);
+    free(readData);
+    systemShutdown();
+    swapBackendType = defaultBackend;
+    systemInit();
+}
+
+void testSwapIoEnginesReturnSameData() {
+    // The io_uring engine falls back to the sync one where the kernel has
+    // no io_uring, which still has to read back the same pages
+    SwapIoEngineType defaultEngine = swapIoEngineType;
+    void *data = createRandomData(SWAP_TEST_PAGES * PAGE_SIZE);
+    void *syncData = malloc(SWAP_TEST_PAGES * PAGE_SIZE);
+    void *uringData = malloc(SWAP_TEST_PAGES * PAGE_SIZE);
+    systemShutdown();
+    swapIoEngineType = SWAP_IO_SYNC;
+    systemInit();
+    swapPagesOutAndIn(data, SWAP_TEST_PAGES, syncData);
+    systemShutdown();
+    swapIoEngineType = SWAP_IO_URING;
+    systemInit();
+    swapPagesOutAndIn(data, SWAP_TEST_PAGES, uringData);
+
+    TEST_ASSERT_EQUAL_MEMORY(data, syncData, SWAP_TEST_PAGES * PAGE_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(syncData, uringData, SWAP_TEST_PAGES * PAGE_SIZE);
+
+    free(data);
+    free(syncData);
+    free(uringData);
+    systemShutdown();
+    swapIoEngineType = defaultEngine;
+    systemInit();
+}
+
+/**
+ * Holds the write of the transit test's page once it is evicted, until the
+ * test releases it, then passes every write on to the real backend.
+ */
+static void holdTransitTestWrite(SwapSlotRun *runs, int numRuns) {
+    for (int r = 0; r < numRuns; r++) {
+        for (int p = 0; p < runs[r].numPages; p++) {
+            if (transitTestEntry->present || memcmp(runs[r].pages[p].iov_base, transitTestData, PAGE_SIZE) != 0) {
+                continue;
+            }
+            pthread_mutex_lock(&transitTestLock);
+            transitTestHeld = true;
+            pthread_cond_broadcast(&transitTestCond);
+            while (!transitTestReleased) {
+                pthread_cond_wait(&transitTestCond, &transitTestLock);
+            }
+            pthread_mutex_unlock(&transitTestLock);
+        }
+    }
+    transitTestBackend->writePages(runs, numRuns);
+}
+
+static void readTransitTestPages(SwapSlotRun *runs, int numRuns) {
+    transitTestBackend->readPages(runs, numRuns);
+}
+
+static void discardTransitTestSlot(uint16_t slot) {
+    transitTestBackend->discard(slot);
+}
+
+/* Stands in for the backend in use while the transit test runs, it is never
+   opened or closed */
+static const SwapBackend transitTestSwapBackend = {
+    .name = "transit test",
+    .writePages = holdTransitTestWrite,
+    .readPages = readTransitTestPages,
+    .discard = discardTransitTestSlot,
+};
+
+/**
+ * Body of the transit test's hog. Writes to as many pages as there are
+ * frames, evicting the page whose write is held along the way, and
+ * returns the thread.
+ */
+static void* evictTransitTestPage(void *arg) {
+    (void)arg;
+    Thread *hog = createThread();
+    int hogAddr = allocateHeapMem(hog, MAX_FRAME_TABLE_ENTRIES * PAGE_SIZE);
+    for (int sweep = 0; sweep < PUSH_OUT_MAX_SWEEPS && !__atomic_load_n(&transitTestHeld, __ATOMIC_RELAXED); sweep++) {
+        for (int p = 0; p < MAX_FRAME_TABLE_ENTRIES; p++) {
+            writeToAddr(hog, hogAddr + p * PAGE_SIZE, sizeof(int), &p);
+        }
+    }
+    return hog;
+}
+
+/**
+ * Body of the transit test's reader. Reads the page in transit.
+ */
+static void* readTransitTestPage(void *arg) {
+    (void)arg;
+    readFromAddr(transitTestWriter, transitTestAddr, PAGE_SIZE, transitTestReadData);
+    return NULL;
+}
+
+void testFaultWaitsForPageInTransit() {
+    // Only the hog evicts, one frame at a time as it faults, and nothing
+    // writes the page back while it stays in memory
+    stopFlusher();
+    stopReclaimer();
+    void *data = createRandomData(PAGE_SIZE);
+    void *readData = malloc(PAGE_SIZE);
+    Thread *writer = createThread();
+    int addr = allocateAndWriteHeapData(writer, data, PAGE_SIZE, PAGE_SIZE);
+
+    // The page is in transit once its write is held, unmapped but not in
+    // its slot yet
+    transitTestBackend = swapBackend;
+    transitTestWriter = writer;
+    transitTestAddr = addr;
+    transitTestData = data;
+    transitTestEntry = pageEntry(writer, addr);
+    transitTestReadData = readData;
+    transitTestHeld = false;
+    transitTestReleased = false;
+    swapBackend = &transitTestSwapBackend;
+    pthread_t hogThread;
+    pthread_create(&hogThread, NULL, evictTransitTestPage, NULL);
+    struct timespec giveUpAt;
+    clock_gettime(CLOCK_REALTIME, &giveUpAt);
+    giveUpAt.tv_sec += TRANSIT_TEST_WAIT_SECONDS;
+    pthread_mutex_lock(&transitTestLock);
+    while (!transitTestHeld) {
+        if (pthread_cond_timedwait(&transitTestCond, &transitTestLock, &giveUpAt) != 0) {
+            break;
+        }
+    }
+    bool held = transitTestHeld;
+    pthread_mutex_unlock(&transitTestLock);
+    bool inTransit = transitTestEntry->inTransit;
+
+    // A fault on the page waits for the write rather than read a slot that
+    // has not been written
+    uint64_t waitsBefore = vmStats.transitWaits;
+    pthread_t readerThread;
+    if (held) {
+        pthread_create(&readerThread, NULL, readTransitTestPage, NULL);
+        for (int waitedMs = 0; vmStats.transitWaits == waitsBefore && waitedMs < TRANSIT_TEST_WAIT_MS; waitedMs++) {
+            usleep(1000);
+        }
+    }
+    bool waited = vmStats.transitWaits > waitsBefore;
+
+    // Once the write goes on, the fault reads back what was written
+    pthread_mutex_lock(&transitTestLock);
+    transitTestReleased = true;
+    pthread_cond_broadcast(&transitTestCond);
+    pthread_mutex_unlock(&transitTestLock);
+    if (held) {
+        pthread_join(readerThread, NULL);
+    }
+    Thread *hog;
+    pthread_join(hogThread, (void **)&hog);
+    swapBackend = transitTestBackend;
+    TEST_ASSERT_TRUE(held);
+    TEST_ASSERT_TRUE(inTransit);
+    TEST_ASSERT_TRUE(waited);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, PAGE_SIZE);
+
+    destroyThread(hog);
+    destroyThread(writer);
+    free(data);
+    free(readData);
+}
+
+/**
+ * Returns whether the swap device's bitmap marks the slot as in use.
+ */
+static bool swapSlotInUse(uint16_t slot) {
+    return swapDevice->slotBitmap[slot / 64] & (1ULL << (slot % 64));
+}
+
+/**
+ * Returns the number of slots the swap device's bitmap marks as in use.
+ */
+static uint32_t countSwapSlotsInUse() {
+    uint32_t numInUse = 0;
+    for (int word = 0; word < (NUM_SWAP_SLOTS + 63) / 64; word++) {
+        numInUse += __builtin_popcountll(swapDevice->slotBitmap[word]);
+    }
+    return numInUse;
+}
+
+void testSwapSlotsAllocatedInRunsAndFreed() {
+    // The pages are written back here, so the background flusher must not
+    // get to them first
+    stopFlusher();
+    uint32_t freeBefore = swapDevice->numFreeSlots;
+    TEST_ASSERT_EQUAL_INT(NUM_SWAP_SLOTS - freeBefore, countSwapSlotsInUse());
+    void *data = createRandomData(SLOT_TEST_PAGES * PAGE_SIZE);
+    void *zeros = calloc(1, PAGE_SIZE);
+    void *readData = malloc(SLOT_TEST_PAGES * PAGE_SIZE);
+    Thread *writer = createThread();
+    int addr = allocateAndWriteHeapData(writer, data, SLOT_TEST_PAGES * PAGE_SIZE, SLOT_TEST_PAGES * PAGE_SIZE);
+
+    // Each aligned block of pages written back together is given a run of
+    // consecutive slots, a slot of its own for each page
+    clearFramesAccessed(0, NUM_FRAME_TABLE_ENTRIES);
+    flushDirtyFrames(NUM_FRAME_TABLE_ENTRIES);
+    uint16_t slots[SLOT_TEST_PAGES];
+    for (int p = 0; p < SLOT_TEST_PAGES; p++) {
+        slots[p] = pageEntry(writer, addr + p * PAGE_SIZE)->swapSlot;
+        TEST_ASSERT_TRUE(swapSlotOnDisk(slots[p]));
+        TEST_ASSERT_TRUE(swapSlotInUse(slots[p]));
+        TEST_ASSERT_EQUAL_INT(1, swapDevice->slotRefCounts[slots[p]]);
+        if (p > 0 && virtualAddressToVPN(addr + p * PAGE_SIZE) % DEFAULT_FLUSH_CLUSTER_PAGES != 0) {
+            TEST_ASSERT_EQUAL_INT(slots[p - 1] + 1, slots[p]);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(freeBefore - SLOT_TEST_PAGES, swapDevice->numFreeSlots);
+
+    // Pages written again are written over the slots they already have,
+    // rather than given new ones
+    writeToAddr(writer, addr, SLOT_TEST_PAGES * PAGE_SIZE, data);
+    clearFramesAccessed(0, NUM_FRAME_TABLE_ENTRIES);
+    flushDirtyFrames(NUM_FRAME_TABLE_ENTRIES);
+    for (int p = 0; p < SLOT_TEST_PAGES; p++) {
+        TEST_ASSERT_EQUAL_INT(slots[p], pageEntry(writer, addr + p * PAGE_SIZE)->swapSlot);
+    }
+    TEST_ASSERT_EQUAL_INT(freeBefore - SLOT_TEST_PAGES, swapDevice->numFreeSlots);
+
+    // A page that became all zeros gives its slot back, and the bitmap
+    // agrees with the count of free slots throughout
+    memcpy(data, zeros, PAGE_SIZE);
+    writeToAddr(writer, addr, PAGE_SIZE, zeros);
+    clearFramesAccessed(0, NUM_FRAME_TABLE_ENTRIES);
+    flushDirtyFrames(NUM_FRAME_TABLE_ENTRIES);
+    TEST_ASSERT_EQUAL_INT(SWAP_SLOT_ZERO, pageEntry(writer, addr)->swapSlot);
+    TEST_ASSERT_EQUAL_INT(freeBefore - (SLOT_TEST_PAGES - 1), swapDevice->numFreeSlots);
+    TEST_ASSERT_EQUAL_INT(NUM_SWAP_SLOTS - swapDevice->numFreeSlots, countSwapSlotsInUse());
+
+    // And every page still reads back from its slot once evicted
+    Thread *hog = pushOutOfMemory(writer, addr, SLOT_TEST_PAGES);
+    readFromAddr(writer, addr, SLOT_TEST_PAGES * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, SLOT_TEST_PAGES * PAGE_SIZE);
+
+    destroyThread(hog);
+    destroyThread(writer);
+    free(data);
+    free(zeros);
+    free(readData);
+}
+
+void testCleanPagesDroppedWithoutWrite() {
+    // Without write backs ahead of eviction or prefetches, the only clean
+    // frames evicted are the pages read back below
+    uint8_t defaultDegree = prefetchDegree;
+    systemShutdown();
+    prefetchDegree = 0;
+    systemInit();
+    stopFlusher();
+    stopReclaimer();
+    void *data = createRandomData(CLEAN_TEST_PAGES * PAGE_SIZE);
+    void *readData = malloc(CLEAN_TEST_PAGES * PAGE_SIZE);
+    Thread *writer = createThread();
+    int addr = allocateAndWriteHeapData(writer, data, CLEAN_TEST_PAGES * PAGE_SIZE, CLEAN_TEST_PAGES * PAGE_SIZE);
+    destroyThread(pushOutOfMemory(writer, addr, CLEAN_TEST_PAGES));
+    readFromAddr(writer, addr, CLEAN_TEST_PAGES * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, CLEAN_TEST_PAGES * PAGE_SIZE);
+    uint16_t slots[CLEAN_TEST_PAGES];
+    for (int p = 0; p < CLEAN_TEST_PAGES; p++) {
+        slots[p] = pageEntry(writer, addr + p * PAGE_SIZE)->swapSlot;
+        TEST_ASSERT_TRUE(swapSlotOnDisk(slots[p]));
+    }
+
+    // The pages were only read since they came back, so their slots are up
+    // to date and they are dropped without being written again
+    uint64_t skippedBefore = vmStats.swapWritesSkipped;
+    Thread *hog = pushOutOfMemory(writer, addr, CLEAN_TEST_PAGES);
+    TEST_ASSERT_EQUAL_INT(CLEAN_TEST_PAGES, vmStats.swapWritesSkipped - skippedBefore);
+    for (int p = 0; p < CLEAN_TEST_PAGES; p++) {
+        TEST_ASSERT_EQUAL_INT(slots[p], pageEntry(writer, addr + p * PAGE_SIZE)->swapSlot);
+    }
+    readFromAddr(writer, addr, CLEAN_TEST_PAGES * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, CLEAN_TEST_PAGES * PAGE_SIZE);
+
+    destroyThread(hog);
+    destroyThread(writer);
+    free(data);
+    free(readData);
+    systemShutdown();
+    prefetchDegree = defaultDegree;
+    systemInit();
+}
+
+void testZeroPageElidedAndReadBackZeroed() {
+    void *data = createRandomData(PAGE_SIZE);
+    void *zeros = calloc(1, PAGE_SIZE);
+    void *readData = malloc(PAGE_SIZE);
+    Thread *writer = createThread();
+    int addr = allocateAndWriteHeapData(writer, data, PAGE_SIZE, PAGE_SIZE);
+    writeToAddr(writer, addr, PAGE_SIZE, zeros);
+
+    // A page that is all zeros when evicted takes no slot and no write
+    uint64_t elidedBefore = vmStats.zeroPagesElided;
+    Thread *hog = pushOutOfMemory(writer, addr, 1);
+    TEST_ASSERT_EQUAL_INT(SWAP_SLOT_ZERO, pageEntry(writer, addr)->swapSlot);
+    TEST_ASSERT_TRUE(vmStats.zeroPagesElided > elidedBefore);
+    readFromAddr(writer, addr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(zeros, readData, PAGE_SIZE);
+    destroyThread(hog);
+
+    // Once written to again it needs a slot of its own to be evicted to
+    writeToAddr(writer, addr, PAGE_SIZE, data);
+    hog = pushOutOfMemory(writer, addr, 1);
+    TEST_ASSERT_TRUE(swapSlotOnDisk(pageEntry(writer, addr)->swapSlot));
+    readFromAddr(writer, addr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(data, readData, PAGE_SIZE);
+
+    destroyThread(hog);
+    destroyThread(writer);
+    free(data);
+    free(zeros);
+    free(readData);
+}
+
+void testZeroFrameStaysZeroAfterFirstWrite() {
+    void *data = createRandomData(PAGE_SIZE);
+    uint8_t *zeros = calloc(1, PAGE_SIZE);
+    uint8_t *expected = calloc(1, PAGE_SIZE);
+    void *readData = malloc(2 * PAGE_SIZE);
+    Thread *first = createThread();
+    Thread *second = createThread();
+    int firstAddr = allocateHeapMem(first, 2 * PAGE_SIZE);
+    int secondAddr = allocateHeapMem(second, PAGE_SIZE);
+
+    // Pages never written read zeros from the shared zero frame, without a
+    // frame of their own
+    uint64_t zeroReadsBefore = vmStats.zeroFrameReads;
+    readFromAddr(first, firstAddr, 2 * PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(zeros, readData, PAGE_SIZE);
+    TEST_ASSERT_EQUAL_MEMORY(zeros, (uint8_t *)readData + PAGE_SIZE, PAGE_SIZE);
+    TEST_ASSERT_TRUE(vmStats.zeroFrameReads > zeroReadsBefore);
+    TEST_ASSERT_FALSE(pageEntry(first, firstAddr)->present);
+
+    // The first write copies the zero frame to a frame of the page's own,
+    // so the bytes it did not write stay zero
+    memcpy(expected + 8, data, PAGE_SIZE - 16);
+    writeToAddr(first, firstAddr + 8, PAGE_SIZE - 16, data);
+    TEST_ASSERT_TRUE(pageEntry(first, firstAddr)->present);
+    readFromAddr(first, firstAddr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(expected, readData, PAGE_SIZE);
+
+    // And the zero frame is left as it was for every other page reading it
+    TEST_ASSERT_EQUAL_MEMORY(zeros, zeroFrame, PAGE_SIZE);
+    readFromAddr(first, firstAddr + PAGE_SIZE, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(zeros, readData, PAGE_SIZE);
+    readFromAddr(second, secondAddr, PAGE_SIZE, readData);
+    TEST_ASSERT_EQUAL_MEMORY(zeros, readData, PAGE_SIZE);
+
+    destroyThread(first);
+    destroyThread(second);
+    free(data);
+    free(zeros);
+    free(expected);
+    free(readData);
+}
@@ -3,4 +3,21 @@
 
 void testDataPagedOutCorrectly();
 void testDataPagedInCorrectly();
+void testFreeFrameStackUnderContention();
+void testBuddyAllocatorSplitsAndCoalesces();
+void testCompressionRoundTripsAndRejectsNoise();
+void testForkedThreadSeesThenDiverges();
+void testMappedFileWrittenBack();
+void testMergedPagesDivergeOnWrite();
+void testSharedRegionSeenAfterEviction();
+void testReadaheadReturnsSwappedPages();
+void testPrefetchReturnsSwappedPages();
+void testFlushedPagesReadBackIntact();
+void testSwapBackendsRoundTripPages();
+void testSwapIoEnginesReturnSameData();
+void testFaultWaitsForPageInTransit();
+void testSwapSlotsAllocatedInRunsAndFreed();
+void testCleanPagesDroppedWithoutWrite();
+void testZeroPageElidedAndReadBackZeroed();
+void testZeroFrameStaysZeroAfterFirstWrite();
 #endif //VIRTUALMEMFRAMEWORKC_PAGINGTESTS_H